@@ -0,0 +1,108 @@
+/*
+ * This program counts the heap allocations made to build and parse the
+ * LoRaWAN frame header of a typical uplink and downlink, with the MAC
+ * commands held by value and with the MacCommand objects of the older API.
+ */
+
+#include "ns3/lora-frame-header.h"
+#include "ns3/command-line.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+using namespace ns3;
+using namespace lorawan;
+
+namespace {
+uint64_t g_allocations = 0;
+}
+
+void *
+operator new (std::size_t size)
+{
+  g_allocations++;
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+// Average number of allocations of a call to function
+template <typename F>
+double
+CountAllocations (F function, uint32_t nRuns)
+{
+  uint64_t before = g_allocations;
+  for (uint32_t i = 0; i < nRuns; i++)
+    {
+      function ();
+    }
+  return double (g_allocations - before) / nRuns;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nRuns = 1000;
+
+  CommandLine cmd;
+  cmd.AddValue ("nRuns", "Number of headers to build and parse", nRuns);
+  cmd.Parse (argc, argv);
+
+  // An uplink answering a LinkAdrReq and a DevStatusReq
+  LoraFrameHeader uplink;
+  uplink.SetAsUplink ();
+  uplink.AddLinkAdrAns (true, true, true);
+  uplink.AddCommand (MacCommandValue::CreateDevStatusAns (10, 10));
+  Buffer buffer;
+  buffer.AddAtStart (uplink.GetSerializedSize ());
+  uplink.Serialize (buffer.Begin ());
+
+  double parseValues = CountAllocations ([&buffer] ()
+    {
+      LoraFrameHeader header;
+      header.SetAsUplink ();
+      header.Deserialize (buffer.Begin ());
+      return header.GetCommandValues ().Find (LINK_ADR_ANS) != 0;
+    }, nRuns);
+  double parseObjects = CountAllocations ([&buffer] ()
+    {
+      LoraFrameHeader header;
+      header.SetAsUplink ();
+      header.Deserialize (buffer.Begin ());
+      return header.GetCommands ().size ();
+    }, nRuns);
+
+  // A downlink carrying a LinkAdrReq and a LinkCheckAns
+  double buildValues = CountAllocations ([] ()
+    {
+      LoraFrameHeader header;
+      header.SetAsDownlink ();
+      header.AddCommand (MacCommandValue::CreateLinkAdrReq (5, 1, 0b111, 0, 1));
+      header.AddLinkCheckAns (10, 1);
+      return header.GetFOptsLen ();
+    }, nRuns);
+  double buildObjects = CountAllocations ([] ()
+    {
+      LoraFrameHeader header;
+      header.SetAsDownlink ();
+      header.AddCommand (Create<LinkAdrReq> (5, 1, 0b111, 0, 1));
+      header.AddCommand (Create<LinkCheckAns> (10, 1));
+      return header.GetFOptsLen ();
+    }, nRuns);
+
+  std::cout << "Allocations to parse an uplink:    " << parseValues
+            << " (values), " << parseObjects << " (MacCommand objects)" << std::endl;
+  std::cout << "Allocations to build a downlink:   " << buildValues
+            << " (values), " << buildObjects << " (MacCommand objects)" << std::endl;
+
+  return 0;
+}
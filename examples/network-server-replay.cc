@@ -0,0 +1,207 @@
+/*
+ * This program measures how fast the Network Server processes uplinks, by
+ * replaying a trace of uplinks straight into it without simulating the
+ * radio. The trace is read from a CSV file (see
+ * UplinkTraceReplayer::ReadCsvTrace), or generated from periodic devices
+ * heard by a few gateways each.
+ */
+
+#include "ns3/uplink-trace-replayer.h"
+#include "ns3/network-server-helper.h"
+#include "ns3/lora-channel.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/lora-phy-helper.h"
+#include "ns3/lorawan-mac-helper.h"
+#include "ns3/lora-helper.h"
+#include "ns3/class-a-end-device-lorawan-mac.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <set>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("NetworkServerReplay");
+
+bool
+CompareTime (const UplinkTraceReplayer::UplinkRecord &a,
+             const UplinkTraceReplayer::UplinkRecord &b)
+{
+  return a.time < b.time;
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string traceFile = "";
+  uint32_t nDevices = 1000;
+  uint32_t nGateways = 10;
+  uint32_t gatewaysPerUplink = 3;
+  double period = 600;
+  double simulationTime = 3600;
+  bool adrEnabled = true;
+
+  CommandLine cmd;
+  cmd.AddValue ("traceFile", "CSV trace of uplinks to replay, instead of a generated one",
+                traceFile);
+  cmd.AddValue ("nDevices", "Number of devices in the generated trace", nDevices);
+  cmd.AddValue ("nGateways", "Number of gateways in the generated trace", nGateways);
+  cmd.AddValue ("gatewaysPerUplink", "Gateways that receive each generated uplink",
+                gatewaysPerUplink);
+  cmd.AddValue ("period", "Seconds between the generated uplinks of a device", period);
+  cmd.AddValue ("simulationTime", "Seconds covered by the generated trace", simulationTime);
+  cmd.AddValue ("adrEnabled", "Whether the Network Server runs ADR", adrEnabled);
+  cmd.Parse (argc, argv);
+
+  /***************
+   *  Get trace  *
+   ***************/
+
+  std::vector<UplinkTraceReplayer::UplinkRecord> trace;
+  if (traceFile != "")
+    {
+      NS_ABORT_MSG_IF (!UplinkTraceReplayer::ReadCsvTrace (traceFile, trace),
+                       "Can't read " << traceFile);
+      nGateways = 0;
+      for (uint32_t i = 0; i < trace.size (); i++)
+        {
+          nGateways = std::max (nGateways, trace[i].gateway + 1);
+        }
+    }
+  else
+    {
+      NS_ABORT_MSG_IF (gatewaysPerUplink > nGateways, "Not enough gateways");
+
+      Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+      const double frequencies[] = {868.1, 868.3, 868.5};
+      std::vector<uint32_t> gateways (nGateways);
+      for (uint32_t device = 0; device < nDevices; device++)
+        {
+          uint8_t sf = random->GetInteger (7, 12);
+          double offset = random->GetValue (0, period);
+          uint16_t fCnt = 0;
+          for (double time = offset; time < simulationTime; time += period)
+            {
+              // Each copy of the uplink comes from a different gateway
+              for (uint32_t i = 0; i < nGateways; i++)
+                {
+                  gateways[i] = i;
+                }
+              for (uint32_t i = 0; i < gatewaysPerUplink; i++)
+                {
+                  std::swap (gateways[i], gateways[random->GetInteger (i, nGateways - 1)]);
+
+                  UplinkTraceReplayer::UplinkRecord record;
+                  record.time = Seconds (time);
+                  record.devAddr = device + 1;
+                  record.fCnt = fCnt;
+                  record.gateway = gateways[i];
+                  record.sf = sf;
+                  record.rxPower = random->GetValue (-130, -90);
+                  record.frequency = frequencies[fCnt % 3];
+                  trace.push_back (record);
+                }
+              fCnt++;
+            }
+        }
+      std::stable_sort (trace.begin (), trace.end (), CompareTime);
+    }
+
+  /************************
+   *  Create the network  *
+   ************************/
+
+  // The radio is never used, but the devices need their MAC and PHY layers
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  // Create a device for each address in the trace
+  std::set<uint32_t> devAddrs;
+  for (uint32_t i = 0; i < trace.size (); i++)
+    {
+      devAddrs.insert (trace[i].devAddr);
+    }
+  NodeContainer endDevices;
+  endDevices.Create (devAddrs.size ());
+  mobility.Install (endDevices);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  helper.Install (phyHelper, macHelper, endDevices);
+  std::set<uint32_t>::iterator devAddr = devAddrs.begin ();
+  for (NodeContainer::Iterator j = endDevices.Begin (); j != endDevices.End (); ++j, ++devAddr)
+    {
+      (*j)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()
+        ->GetObject<ClassAEndDeviceLorawanMac> ()->SetDeviceAddress (LoraDeviceAddress (*devAddr));
+    }
+
+  NodeContainer gateways;
+  gateways.Create (nGateways);
+  mobility.Install (gateways);
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  // The replayer takes the place of the gateways' Forwarders
+  Ptr<Node> networkServer = CreateObject<Node> ();
+  NetworkServerHelper networkServerHelper;
+  networkServerHelper.SetGateways (gateways);
+  networkServerHelper.SetEndDevices (endDevices);
+  networkServerHelper.EnableAdr (adrEnabled);
+  networkServerHelper.EnableDirectBackhaul (true);
+  networkServerHelper.SetAttribute ("ProfileStages", BooleanValue (true));
+  Ptr<NetworkServer> ns = networkServerHelper.Install (networkServer).Get (0)
+    ->GetObject<NetworkServer> ();
+
+  Ptr<UplinkTraceReplayer> replayer = CreateObject<UplinkTraceReplayer> ();
+  replayer->SetTrace (trace);
+  replayer->SetNetworkServer (ns);
+  replayer->SetGateways (gateways);
+  networkServer->AddApplication (replayer);
+
+  /****************
+   *  Simulation  *
+   ****************/
+
+  std::cout << "Replaying " << trace.size () << " uplinks from " << devAddrs.size ()
+            << " devices through " << nGateways << " gateways" << std::endl;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  double runTime = std::chrono::duration<double>
+    (std::chrono::steady_clock::now () - start).count ();
+
+  const NetworkServer::StageTimes &stages = ns->GetStageTimes ();
+  double receiveTime = replayer->GetReceiveTime ();
+  std::cout << "Uplinks: " << replayer->GetNUplinks ()
+            << ", dropped: " << replayer->GetNDropped ()
+            << ", downlinks: " << replayer->GetNDownlinks ()
+            << ", missed replies: " << ns->GetNetworkScheduler ()->GetNMissedReplies ()
+            << std::endl;
+  std::cout << "Run: " << runTime << " s, "
+            << replayer->GetNUplinks () / runTime << " uplinks/s" << std::endl;
+  std::cout << "Receive: " << receiveTime << " s, "
+            << replayer->GetNUplinks () / receiveTime << " uplinks/s" << std::endl;
+  if (stages.nUplinks > 0)
+    {
+      std::cout << "Per uplink (us): decode " << 1e6 * stages.decode / stages.nUplinks
+                << ", scheduler " << 1e6 * stages.scheduler / stages.nUplinks
+                << ", status " << 1e6 * stages.status / stages.nUplinks
+                << ", controller " << 1e6 * stages.controller / stages.nUplinks
+                << std::endl;
+    }
+
+  Simulator::Destroy ();
+
+  return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * This program measures how fast the Network Server ingests the UDP traffic
+ * of Semtech packet forwarders. A stand-in for the forwarders, in this same
+ * process, sends PUSH_DATA datagrams with batches of rxpk objects to the
+ * SemtechUdpIngest application over the loopback interface, and counts the
+ * txpk objects the server sends back for confirmed uplinks.
+ *
+ * The ingest port can also be fed by real forwarders or by an external
+ * replayer, by setting nUplinks to 0 and running with the realtime simulator
+ * (--SimulatorImplementationType=ns3::RealtimeSimulatorImpl).
+ */
+
+#include "ns3/semtech-udp-ingest.h"
+#include "ns3/network-server-helper.h"
+#include "ns3/lora-channel.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/lora-phy-helper.h"
+#include "ns3/lorawan-mac-helper.h"
+#include "ns3/lora-helper.h"
+#include "ns3/lora-frame-header.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/class-a-end-device-lorawan-mac.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("SemtechUdpIngestExample");
+
+/**
+ * A stand-in for a set of packet forwarders, sharing one socket.
+ */
+class PacketForwarderStandIn
+{
+public:
+  PacketForwarderStandIn (uint16_t port, uint32_t nGateways)
+    : m_nGateways (nGateways),
+      m_nTxpks (0)
+  {
+    m_socket = socket (AF_INET, SOCK_DGRAM, 0);
+    fcntl (m_socket, F_SETFL, fcntl (m_socket, F_GETFL) | O_NONBLOCK);
+    int bufferSize = 1 << 22;
+    setsockopt (m_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof (bufferSize));
+    std::memset (&m_server, 0, sizeof (m_server));
+    m_server.sin_family = AF_INET;
+    m_server.sin_port = htons (port);
+    m_server.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  }
+
+  ~PacketForwarderStandIn ()
+  {
+    close (m_socket);
+  }
+
+  // Tell the server where to send the downlinks of each gateway
+  void PullData (void)
+  {
+    for (uint32_t gateway = 0; gateway < m_nGateways; gateway++)
+      {
+        std::vector<uint8_t> datagram = MakeHeader (0x02, gateway);
+        Send (datagram);
+      }
+  }
+
+  // Send an uplink of a device, received by every gateway
+  void PushData (uint32_t devAddr, uint16_t fCnt, uint8_t sf, uint32_t tmst)
+  {
+    Ptr<Packet> packet = Create<Packet> (10);
+    LoraFrameHeader frameHdr;
+    frameHdr.SetAsUplink ();
+    frameHdr.SetAddress (LoraDeviceAddress (devAddr));
+    frameHdr.SetFCnt (fCnt);
+    packet->AddHeader (frameHdr);
+    LorawanMacHeader macHdr;
+    macHdr.SetMType (LorawanMacHeader::CONFIRMED_DATA_UP);
+    packet->AddHeader (macHdr);
+
+    SemtechUdpIngest::Rxpk rxpk;
+    rxpk.tmst = tmst;
+    rxpk.freq = 868.1;
+    rxpk.sf = sf;
+
+    // Append a dummy MIC
+    rxpk.data.resize (packet->GetSize () + 4, 0);
+    packet->CopyData (&rxpk.data[0], packet->GetSize ());
+
+    for (uint32_t gateway = 0; gateway < m_nGateways; gateway++)
+      {
+        rxpk.rssi = -100 - int (gateway);
+        std::string text = "{\"rxpk\":[" + SemtechUdpIngest::FormatRxpk (rxpk) + "]}";
+        std::vector<uint8_t> datagram = MakeHeader (0x00, gateway);
+        datagram.insert (datagram.end (), text.begin (), text.end ());
+        Send (datagram);
+      }
+  }
+
+  // Count the txpk the server sent
+  void Drain (void)
+  {
+    uint8_t buffer[2048];
+    ssize_t size;
+    while ((size = recv (m_socket, buffer, sizeof (buffer), 0)) >= 0)
+      {
+        if (size > 4 && buffer[3] == 0x03)
+          {
+            m_nTxpks++;
+          }
+      }
+  }
+
+  uint64_t GetNTxpks (void) const
+  {
+    return m_nTxpks;
+  }
+
+private:
+  std::vector<uint8_t> MakeHeader (uint8_t identifier, uint32_t gateway)
+  {
+    std::vector<uint8_t> header (12, 0);
+    header[0] = 2;
+    header[1] = rand () & 0xff;
+    header[2] = rand () & 0xff;
+    header[3] = identifier;
+    header[8] = (gateway >> 24) & 0xff;
+    header[9] = (gateway >> 16) & 0xff;
+    header[10] = (gateway >> 8) & 0xff;
+    header[11] = gateway & 0xff;
+    return header;
+  }
+
+  void Send (const std::vector<uint8_t> &datagram)
+  {
+    sendto (m_socket, &datagram[0], datagram.size (), 0, (sockaddr *) &m_server,
+            sizeof (m_server));
+  }
+
+  int m_socket;
+  sockaddr_in m_server;
+  uint32_t m_nGateways;
+  uint64_t m_nTxpks;
+};
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nDevices = 1000;
+  uint32_t nGateways = 3;
+  uint32_t nUplinks = 10000;
+  double uplinkInterval = 0.01;
+  uint16_t port = 1700;
+
+  CommandLine cmd;
+  cmd.AddValue ("nDevices", "Number of devices", nDevices);
+  cmd.AddValue ("nGateways", "Number of gateways", nGateways);
+  cmd.AddValue ("nUplinks", "Number of uplinks the stand-in sends", nUplinks);
+  cmd.AddValue ("uplinkInterval", "Seconds between two uplinks of the stand-in",
+                uplinkInterval);
+  cmd.AddValue ("port", "UDP port of the ingest", port);
+  cmd.Parse (argc, argv);
+
+  /************************
+   *  Create the network  *
+   ************************/
+
+  // The radio is never used, but the devices need their MAC and PHY layers
+  Ptr<LogDistancePropagationLossModel> loss = CreateObject<LogDistancePropagationLossModel> ();
+  Ptr<PropagationDelayModel> delay = CreateObject<ConstantSpeedPropagationDelayModel> ();
+  Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
+
+  LoraPhyHelper phyHelper = LoraPhyHelper ();
+  phyHelper.SetChannel (channel);
+  LorawanMacHelper macHelper = LorawanMacHelper ();
+  LoraHelper helper = LoraHelper ();
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  NodeContainer endDevices;
+  endDevices.Create (nDevices);
+  mobility.Install (endDevices);
+  phyHelper.SetDeviceType (LoraPhyHelper::ED);
+  macHelper.SetDeviceType (LorawanMacHelper::ED_A);
+  helper.Install (phyHelper, macHelper, endDevices);
+  for (uint32_t i = 0; i < nDevices; i++)
+    {
+      endDevices.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ()->GetMac ()
+        ->GetObject<ClassAEndDeviceLorawanMac> ()->SetDeviceAddress (LoraDeviceAddress (i + 1));
+    }
+
+  NodeContainer gateways;
+  gateways.Create (nGateways);
+  mobility.Install (gateways);
+  phyHelper.SetDeviceType (LoraPhyHelper::GW);
+  macHelper.SetDeviceType (LorawanMacHelper::GW);
+  helper.Install (phyHelper, macHelper, gateways);
+
+  Ptr<Node> networkServer = CreateObject<Node> ();
+  NetworkServerHelper networkServerHelper;
+  networkServerHelper.SetGateways (gateways);
+  networkServerHelper.SetEndDevices (endDevices);
+  networkServerHelper.EnableDirectBackhaul (true);
+  Ptr<NetworkServer> ns = networkServerHelper.Install (networkServer).Get (0)
+    ->GetObject<NetworkServer> ();
+
+  Ptr<SemtechUdpIngest> ingest = CreateObject<SemtechUdpIngest> ();
+  ingest->SetAttribute ("Port", UintegerValue (port));
+  ingest->SetNetworkServer (ns);
+  ingest->SetGateways (gateways);
+  networkServer->AddApplication (ingest);
+
+  /*********************
+   *  Drive the ingest *
+   *********************/
+
+  PacketForwarderStandIn standIn (port, nGateways);
+  Simulator::Schedule (Seconds (0), &PacketForwarderStandIn::PullData, &standIn);
+  for (uint32_t i = 0; i < nUplinks; i++)
+    {
+      Time time = MilliSeconds (1) + Seconds (i * uplinkInterval);
+      Simulator::Schedule (time, &PacketForwarderStandIn::PushData, &standIn,
+                           i % nDevices + 1, uint16_t (i / nDevices), uint8_t (7 + i % 6),
+                           uint32_t (time.GetMicroSeconds ()));
+      Simulator::Schedule (time, &PacketForwarderStandIn::Drain, &standIn);
+    }
+  Time end = MilliSeconds (1) + Seconds (nUplinks * uplinkInterval + 3);
+  Simulator::Schedule (end, &PacketForwarderStandIn::Drain, &standIn);
+  if (nUplinks > 0)
+    {
+      ingest->SetStopTime (end + MilliSeconds (1));
+    }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Simulator::Run ();
+  double runTime = std::chrono::duration<double>
+    (std::chrono::steady_clock::now () - start).count ();
+
+  std::cout << "Datagrams: " << ingest->GetNDatagrams ()
+            << ", uplinks: " << ingest->GetNUplinks ()
+            << ", dropped: " << ingest->GetNDropped ()
+            << ", downlinks: " << ingest->GetNDownlinks ()
+            << ", undeliverable: " << ingest->GetNUndeliverable ()
+            << ", txpk received: " << standIn.GetNTxpks () << std::endl;
+  std::cout << "Run: " << runTime << " s, "
+            << ingest->GetNUplinks () / runTime << " uplinks/s" << std::endl;
+
+  Simulator::Destroy ();
+
+  return 0;
+}
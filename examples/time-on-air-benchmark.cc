@@ -0,0 +1,64 @@
+/*
+ * This program measures the cost of a call to LoraPhy::GetOnAirTime, which
+ * reads a precomputed table of symbol counts, against the floating point
+ * formula of LoraPhy::ComputeOnAirTime.
+ */
+
+#include "ns3/lora-phy.h"
+#include "ns3/command-line.h"
+#include "ns3/log.h"
+#include <chrono>
+#include <iostream>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("TimeOnAirBenchmark");
+
+template <typename F>
+double
+MeasureNsPerCall (F function, uint32_t nCalls, int64_t &checksum)
+{
+  LoraTxParameters txParams;
+  auto start = std::chrono::steady_clock::now ();
+  for (uint32_t i = 0; i < nCalls; i++)
+    {
+      // Cycle through SFs and payload sizes so that no result can be reused
+      txParams.sf = 7 + i % 6;
+      txParams.lowDataRateOptimizationEnabled = txParams.sf >= 11;
+      checksum += function (10 + i % 200, txParams).GetNanoSeconds ();
+    }
+  auto end = std::chrono::steady_clock::now ();
+  return std::chrono::duration<double, std::nano> (end - start).count () / nCalls;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nCalls = 10000000;
+
+  CommandLine cmd;
+  cmd.AddValue ("nCalls", "Number of calls to time for each implementation", nCalls);
+  cmd.Parse (argc, argv);
+
+  // Build the table before timing
+  LoraTxParameters txParams;
+  LoraPhy::GetOnAirTime (uint32_t (10), txParams);
+
+  int64_t tableChecksum = 0;
+  int64_t formulaChecksum = 0;
+  double tableNs = MeasureNsPerCall (
+      [] (uint32_t size, LoraTxParameters params) { return LoraPhy::GetOnAirTime (size, params); },
+      nCalls, tableChecksum);
+  double formulaNs = MeasureNsPerCall (
+      [] (uint32_t size, LoraTxParameters params) { return LoraPhy::ComputeOnAirTime (size, params); },
+      nCalls, formulaChecksum);
+
+  std::cout << "Table:   " << tableNs << " ns/call" << std::endl;
+  std::cout << "Formula: " << formulaNs << " ns/call" << std::endl;
+  std::cout << "Speedup: " << formulaNs / tableNs << std::endl;
+  std::cout << "Total time on air difference: " << tableChecksum - formulaChecksum << " ns"
+            << std::endl;
+
+  return 0;
+}
@@ -75,6 +75,15 @@ ForwarderHelper::InstallPriv (Ptr<Node> node) const
   app->SetNode (node);
   node->AddApplication (app);
 
+  // Use the in-process link to the NS, if the NetworkServerHelper set one up
+  Ptr<DirectBackhaul> directBackhaul = node->GetObject<DirectBackhaul> ();
+  if (directBackhaul != 0)
+    {
+      app->SetDirectBackhaul (directBackhaul);
+      directBackhaul->SetGatewayCallback (MakeCallback
+                                            (&Forwarder::ReceiveFromPointToPoint, app));
+    }
+
   // Link the Forwarder to the NetDevices
   for (uint32_t i = 0; i < node->GetNDevices (); i++)
     {
@@ -22,6 +22,7 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include "ns3/lorawan-mac-header.h"
+#include "ns3/lorawan-header-view.h"
 #include <iostream>
 #include <fstream>
 
@@ -55,13 +56,17 @@ namespace ns3
       {
         NS_LOG_INFO("A new packet was sent by the MAC layer");
 
-        MacPacketStatus status;
-        status.packet = packet;
-        status.sendTime = Simulator::Now();
-        status.senderId = Simulator::GetContext();
-        status.receivedTime = Time::Max();
+        uint64_t uid = packet->GetUid();
+        if (m_macPacketIndices.Insert(uid) == m_macPacketTracker.size())
+        {
+          MacPacketStatus status;
+          status.uid = uid;
+          status.sendTime = Simulator::Now();
+          status.senderId = Simulator::GetContext();
+          status.receivedTime = Time::Max();
 
-        m_macPacketTracker.insert(std::pair<Ptr<Packet const>, MacPacketStatus>(packet, status));
+          m_macPacketTracker.push_back(status);
+        }
       }
     }
 
@@ -73,37 +78,38 @@ namespace ns3
       NS_LOG_INFO("Finished retransmission attempts for a packet");
       NS_LOG_DEBUG("Packet: " << packet << "ReqTx " << unsigned(reqTx) << ", succ: " << success << ", firstAttempt: " << firstAttempt.GetSeconds());
 
-      RetransmissionStatus entry;
-      entry.firstAttempt = firstAttempt;
-      entry.finishTime = Simulator::Now();
-      entry.reTxAttempts = reqTx;
-      entry.successful = success;
+      if (m_reTransmissionIndices.Insert(packet->GetUid()) == m_reTransmissionTracker.size())
+      {
+        RetransmissionStatus entry;
+        entry.firstAttempt = firstAttempt;
+        entry.finishTime = Simulator::Now();
+        entry.reTxAttempts = reqTx;
+        entry.successful = success;
 
-      m_reTransmissionTracker.insert(std::pair<Ptr<Packet>, RetransmissionStatus>(packet, entry));
+        m_reTransmissionTracker.push_back(entry);
+      }
     }
 
     void
     LoraPacketTracker::MacGwReceptionCallback(Ptr<Packet const> packet)
     {
-      if (IsUplink(packet))
-      {
-        NS_LOG_INFO("A packet was successfully received"
-                    << " at the MAC layer of gateway " << Simulator::GetContext());
+      // Gateways only pass uplinks to their upper layers
+      NS_LOG_INFO("A packet was successfully received"
+                  << " at the MAC layer of gateway " << Simulator::GetContext());
 
-        successfullyRecievedPackets++;
-        successfullyRecievedPacketFileStream << Simulator::Now().GetHours() << " " << successfullyRecievedPackets << std::endl;
+      successfullyRecievedPackets++;
+      successfullyRecievedPacketFileStream << Simulator::Now().GetHours() << " " << successfullyRecievedPackets << std::endl;
 
-        // Find the received packet in the m_macPacketTracker
-        auto it = m_macPacketTracker.find(packet);
-        if (it != m_macPacketTracker.end())
-        {
-          (*it).second.receptionTimes.insert(std::pair<int, Time>(Simulator::GetContext(),
-                                                                  Simulator::Now()));
-        }
-        else
-        {
-          NS_ABORT_MSG("Packet not found in tracker");
-        }
+      // Find the received packet in the m_macPacketTracker
+      uint32_t index = m_macPacketIndices.Find(packet->GetUid());
+      if (index != PacketUidIndex::NOT_FOUND)
+      {
+        m_macPacketTracker[index].receptionTimes.Insert(Simulator::GetContext(),
+                                                        Simulator::Now());
+      }
+      else
+      {
+        NS_ABORT_MSG("Packet not found in tracker");
       }
     }
 
@@ -114,93 +120,107 @@ namespace ns3
     void
     LoraPacketTracker::TransmissionCallback(Ptr<Packet const> packet, uint32_t edId)
     {
-      if (IsUplink(packet))
+      uint64_t uid = packet->GetUid();
+
+      // Retransmissions keep the record of the first attempt
+      if (m_packetIndices.Find(uid) != PacketUidIndex::NOT_FOUND)
+      {
+        return;
+      }
+
+      // This is the only place where packets are classified: the other PHY
+      // callbacks simply ignore the packets that have no record. The MAC layer
+      // may have done it already.
+      if (m_macPacketIndices.Find(uid) != PacketUidIndex::NOT_FOUND || IsUplink(packet))
       {
         NS_LOG_INFO("PHY packet " << packet
                                   << " was transmitted by device "
                                   << edId);
         // Create a packetStatus
         PacketStatus status;
-        status.packet = packet;
+        status.uid = uid;
         status.sendTime = Simulator::Now();
         status.senderId = edId;
 
-        m_packetTracker.insert(std::pair<Ptr<Packet const>, PacketStatus>(packet, status));
+        m_packetIndices.Insert(uid);
+        m_packetTracker.push_back(status);
       }
     }
 
+    PacketStatus *
+    LoraPacketTracker::FindPhyPacket(Ptr<Packet const> packet)
+    {
+      uint32_t index = m_packetIndices.Find(packet->GetUid());
+      return index != PacketUidIndex::NOT_FOUND ? &m_packetTracker[index] : 0;
+    }
+
     void
     LoraPacketTracker::PacketReceptionCallback(Ptr<Packet const> packet, uint32_t gwId)
     {
-      if (IsUplink(packet))
+      PacketStatus *status = FindPhyPacket(packet);
+      if (status)
       {
         // Remove the successfully received packet from the list of sent ones
         NS_LOG_INFO("PHY packet " << packet
                                   << " was successfully received at gateway "
                                   << gwId);
 
-        std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId,
-                                                                           RECEIVED));
+        status->outcomes.Insert(gwId, RECEIVED);
       }
     }
 
     void
     LoraPacketTracker::InterferenceCallback(Ptr<Packet const> packet, uint32_t gwId)
     {
-      if (IsUplink(packet))
+      PacketStatus *status = FindPhyPacket(packet);
+      if (status)
       {
         NS_LOG_INFO("PHY packet " << packet
                                   << " was interfered at gateway "
                                   << gwId);
 
-        std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId,
-                                                                           INTERFERED));
+        status->outcomes.Insert(gwId, INTERFERED);
       }
     }
 
     void
     LoraPacketTracker::NoMoreReceiversCallback(Ptr<Packet const> packet, uint32_t gwId)
     {
-      if (IsUplink(packet))
+      PacketStatus *status = FindPhyPacket(packet);
+      if (status)
       {
         NS_LOG_INFO("PHY packet " << packet
                                   << " was lost because no more receivers at gateway "
                                   << gwId);
-        std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId,
-                                                                           NO_MORE_RECEIVERS));
+        status->outcomes.Insert(gwId, NO_MORE_RECEIVERS);
       }
     }
 
     void
     LoraPacketTracker::UnderSensitivityCallback(Ptr<Packet const> packet, uint32_t gwId)
     {
-      if (IsUplink(packet))
+      PacketStatus *status = FindPhyPacket(packet);
+      if (status)
       {
         NS_LOG_INFO("PHY packet " << packet
                                   << " was lost because under sensitivity at gateway "
                                   << gwId);
 
-        std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId,
-                                                                           UNDER_SENSITIVITY));
+        status->outcomes.Insert(gwId, UNDER_SENSITIVITY);
       }
     }
 
     void
     LoraPacketTracker::LostBecauseTxCallback(Ptr<Packet const> packet, uint32_t gwId)
     {
-      if (IsUplink(packet))
+      PacketStatus *status = FindPhyPacket(packet);
+      if (status)
       {
         NS_LOG_INFO("PHY packet " << packet
                                   << " was lost because of GW transmission at gateway "
                                   << gwId);
 
-        std::map<Ptr<Packet const>, PacketStatus>::iterator it = m_packetTracker.find(packet);
-        (*it).second.outcomes.insert(std::pair<int, enum PhyPacketOutcome>(gwId,
-                                                                           LOST_BECAUSE_TX));
+        status->outcomes.Insert(gwId, LOST_BECAUSE_TX);
       }
     }
 
@@ -209,10 +229,7 @@ namespace ns3
     {
       NS_LOG_FUNCTION(this);
 
-      LorawanMacHeader mHdr;
-      Ptr<Packet> copy = packet->Copy();
-      copy->RemoveHeader(mHdr);
-      return mHdr.IsUplink();
+      return LorawanHeaderView(packet).IsUplink();
     }
 
     ////////////////////////
@@ -233,16 +250,17 @@ namespace ns3
            itPhy != m_packetTracker.end();
            ++itPhy)
       {
-        if ((*itPhy).second.sendTime >= startTime && (*itPhy).second.sendTime <= stopTime)
+        if ((*itPhy).sendTime >= startTime && (*itPhy).sendTime <= stopTime)
         {
           packetCounts.at(0)++;
 
-          NS_LOG_DEBUG("Dealing with packet " << (*itPhy).second.packet);
-          NS_LOG_DEBUG("This packet was received by " << (*itPhy).second.outcomes.size() << " gateways");
+          NS_LOG_DEBUG("Dealing with packet " << (*itPhy).uid);
+          NS_LOG_DEBUG("This packet was received by " << (*itPhy).outcomes.GetN() << " gateways");
 
-          if ((*itPhy).second.outcomes.count(gwId) > 0)
+          const PhyPacketOutcome *outcome = (*itPhy).outcomes.Find(gwId);
+          if (outcome)
           {
-            switch ((*itPhy).second.outcomes.at(gwId))
+            switch (*outcome)
             {
             case RECEIVED:
             {
@@ -294,16 +312,17 @@ namespace ns3
            itPhy != m_packetTracker.end();
            ++itPhy)
       {
-        if ((*itPhy).second.sendTime >= startTime && (*itPhy).second.sendTime <= stopTime)
+        if ((*itPhy).sendTime >= startTime && (*itPhy).sendTime <= stopTime)
         {
           packetCounts.at(0)++;
 
-          NS_LOG_DEBUG("Dealing with packet " << (*itPhy).second.packet);
-          NS_LOG_DEBUG("This packet was received by " << (*itPhy).second.outcomes.size() << " gateways");
+          NS_LOG_DEBUG("Dealing with packet " << (*itPhy).uid);
+          NS_LOG_DEBUG("This packet was received by " << (*itPhy).outcomes.GetN() << " gateways");
 
-          if ((*itPhy).second.outcomes.count(gwId) > 0)
+          const PhyPacketOutcome *outcome = (*itPhy).outcomes.Find(gwId);
+          if (outcome)
           {
-            switch ((*itPhy).second.outcomes.at(gwId))
+            switch (*outcome)
             {
             case RECEIVED:
             {
@@ -359,10 +378,10 @@ namespace ns3
            it != m_macPacketTracker.end();
            ++it)
       {
-        if ((*it).second.sendTime >= startTime && (*it).second.sendTime <= stopTime)
+        if ((*it).sendTime >= startTime && (*it).sendTime <= stopTime)
         {
           sent++;
-          if ((*it).second.receptionTimes.size())
+          if ((*it).receptionTimes.GetN())
           {
             received++;
           }
@@ -380,9 +399,9 @@ namespace ns3
       Time MaxTime = Seconds(0);
       for (auto it = m_macPacketTracker.begin(); it != m_macPacketTracker.end(); ++it)
       {
-        if ((*it).second.sendTime > MaxTime)
+        if ((*it).sendTime > MaxTime)
         {
-          MaxTime = (*it).second.sendTime;
+          MaxTime = (*it).sendTime;
         }
       }
 
@@ -394,10 +413,10 @@ namespace ns3
         double received = 0;
         for (auto it = m_macPacketTracker.begin(); it != m_macPacketTracker.end(); ++it)  //For every packet
         {
-          if ((*it).second.sendTime > t && (*it).second.sendTime < t + interval)  //If this packet was sent within the current interval
+          if ((*it).sendTime > t && (*it).sendTime < t + interval)  //If this packet was sent within the current interval
           {
             sent++;
-            if ((*it).second.receptionTimes.size()) //if the packet was receieved.
+            if ((*it).receptionTimes.GetN()) //if the packet was receieved.
             {
               received++;
             }
@@ -430,12 +449,12 @@ namespace ns3
            it != m_reTransmissionTracker.end();
            ++it)
       {
-        if ((*it).second.firstAttempt >= startTime && (*it).second.firstAttempt <= stopTime)
+        if ((*it).firstAttempt >= startTime && (*it).firstAttempt <= stopTime)
         {
           sent++;
           NS_LOG_DEBUG("Found a packet");
-          NS_LOG_DEBUG("Number of attempts: " << unsigned(it->second.reTxAttempts) << ", successful: " << it->second.successful);
-          if (it->second.successful)
+          NS_LOG_DEBUG("Number of attempts: " << unsigned(it->reTxAttempts) << ", successful: " << it->successful);
+          if (it->successful)
           {
             received++;
           }
@@ -450,9 +469,9 @@ namespace ns3
       double sent = 0;
       double received = 0;
       for (auto it = m_macPacketTracker.begin(); it != m_macPacketTracker.end(); ++it) { //For every packet
-        if ((*it).second.sendTime >= startTime && (*it).second.sendTime <= stopTime) {
+        if ((*it).sendTime >= startTime && (*it).sendTime <= stopTime) {
           sent++;
-          if ((*it).second.receptionTimes.size()) { //if the packet was receieved.
+          if ((*it).receptionTimes.GetN()) { //if the packet was receieved.
             received++;
           }
         }
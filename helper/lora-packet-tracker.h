@@ -23,10 +23,13 @@
 
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
+#include "ns3/assert.h"
+#include "ns3/dense-index.h"
 
-#include <map>
 #include <string>
 #include <fstream>
+#include <utility>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -41,21 +44,93 @@ enum PhyPacketOutcome
   UNSET
 };
 
+/**
+ * A small map from the id of a gateway to a value. Most packets are heard by
+ * at most one gateway, so the first entry is kept inline and only further
+ * ones go to the heap. An empty map is smaller than an empty std::map.
+ */
+template <typename T>
+class PerGatewayValues
+{
+public:
+  static const uint32_t NONE = 0xffffffff;   //!< Id of the empty inline entry
+
+  PerGatewayValues () : m_first (NONE, T ())
+  {
+  }
+
+  /**
+   * Set the value of a gateway, unless it already has one.
+   */
+  void Insert (uint32_t gwId, const T &value)
+  {
+    NS_ASSERT (gwId != NONE);
+    if (Find (gwId))
+      {
+        return;
+      }
+    if (m_first.first == NONE)
+      {
+        m_first = std::make_pair (gwId, value);
+      }
+    else
+      {
+        m_others.push_back (std::make_pair (gwId, value));
+      }
+  }
+
+  /**
+   * Get the value of a gateway.
+   *
+   * \return A pointer to the value, or 0 if the gateway has none.
+   */
+  const T *Find (uint32_t gwId) const
+  {
+    if (m_first.first == gwId && gwId != NONE)
+      {
+        return &m_first.second;
+      }
+    for (uint32_t i = 0; i < m_others.size (); i++)
+      {
+        if (m_others[i].first == gwId)
+          {
+            return &m_others[i].second;
+          }
+      }
+    return 0;
+  }
+
+  /**
+   * Get the number of gateways that have a value.
+   */
+  uint32_t GetN (void) const
+  {
+    return (m_first.first != NONE) + m_others.size ();
+  }
+
+private:
+  std::pair<uint32_t, T> m_first;   //!< The first entry, or NONE
+  std::vector<std::pair<uint32_t, T> > m_others;   //!< The other ones
+};
+
+template <typename T>
+const uint32_t PerGatewayValues<T>::NONE;
+
 struct PacketStatus
 {
-  Ptr<Packet const> packet;
+  uint64_t uid;
   uint32_t senderId;
   Time sendTime;
-  std::map<int, enum PhyPacketOutcome> outcomes;
+  PerGatewayValues<enum PhyPacketOutcome> outcomes;
 };
 
 struct MacPacketStatus
 {
-  Ptr<Packet const> packet;
+  uint64_t uid;
   uint32_t senderId;
   Time sendTime;
   Time receivedTime;
-  std::map<int, Time> receptionTimes;
+  PerGatewayValues<Time> receptionTimes;
 };
 
 struct RetransmissionStatus
@@ -66,9 +141,12 @@ struct RetransmissionStatus
   bool successful;
 };
 
-typedef std::map<Ptr<Packet const>, MacPacketStatus> MacPacketData;
-typedef std::map<Ptr<Packet const>, PacketStatus> PhyPacketData;
-typedef std::map<Ptr<Packet const>, RetransmissionStatus> RetransmissionData;
+// Records are stored by order of transmission, and found through the UID of
+// their packet, which copies of the packet share
+typedef std::vector<MacPacketStatus> MacPacketData;
+typedef std::vector<PacketStatus> PhyPacketData;
+typedef std::vector<RetransmissionStatus> RetransmissionData;
+typedef DenseIndex<uint64_t, PacketUidHash> PacketUidIndex;
 
 
 class LoraPacketTracker
@@ -168,8 +246,19 @@ public:
   double GetPacketReceptionRate(ns3::Time startTime, ns3::Time stopTime);
 private:
   PhyPacketData m_packetTracker;
+  PacketUidIndex m_packetIndices;   //!< Indices in m_packetTracker
   MacPacketData m_macPacketTracker;
+  PacketUidIndex m_macPacketIndices;   //!< Indices in m_macPacketTracker
   RetransmissionData m_reTransmissionTracker;
+  PacketUidIndex m_reTransmissionIndices;   //!< Indices in
+                                            //!< m_reTransmissionTracker
+
+  /**
+   * Get the record of the PHY transmission of a packet.
+   *
+   * \return The record, or 0 if the packet is not a tracked uplink.
+   */
+  PacketStatus *FindPhyPacket (Ptr<Packet const> packet);
 
   //File saving functions.
   std::string m_outputFile_prefix;
@@ -19,6 +19,7 @@
  */
 
 #include "ns3/lorawan-mac-helper.h"
+#include "ns3/lorawan-region.h"
 #include "ns3/gateway-lora-phy.h"
 #include "ns3/end-device-lora-phy.h"
 #include "ns3/lora-net-device.h"
@@ -133,6 +134,36 @@ LorawanMacHelper::Create (Ptr<Node> node, Ptr<NetDevice> device) const
   return mac;
 }
 
+/**
+ * Fill the data rate and transmission power tables of a plan from a
+ * compile-time region description.
+ */
+template <typename Region>
+static void
+SetDataRateTables (Ptr<RegionPlan> plan)
+{
+  std::vector<uint8_t> sfForDataRate (Region::GetNDataRates ());
+  std::vector<double> bandwidthForDataRate (Region::GetNDataRates ());
+  std::vector<uint32_t> maxAppPayloadForDataRate (Region::GetNDataRates ());
+  for (uint8_t dr = 0; dr < Region::GetNDataRates (); dr++)
+    {
+      sfForDataRate[dr] = Region::GetSfForDataRate (dr);
+      bandwidthForDataRate[dr] = Region::GetBandwidthForDataRate (dr);
+      maxAppPayloadForDataRate[dr] = Region::GetMaxAppPayloadForDataRate (dr);
+    }
+
+  std::vector<double> txDbmForTxPower (Region::GetNTxPowers ());
+  for (uint8_t txPower = 0; txPower < Region::GetNTxPowers (); txPower++)
+    {
+      txDbmForTxPower[txPower] = Region::GetTxDbmForTxPower (txPower);
+    }
+
+  plan->SetSfForDataRate (sfForDataRate);
+  plan->SetBandwidthForDataRate (bandwidthForDataRate);
+  plan->SetMaxAppPayloadForDataRate (maxAppPayloadForDataRate);
+  plan->SetTxDbmForTxPower (txDbmForTxPower);
+}
+
 void
 LorawanMacHelper::ConfigureForAlohaRegion (Ptr<ClassAEndDeviceLorawanMac> edMac) const
 {
@@ -140,11 +171,6 @@ LorawanMacHelper::ConfigureForAlohaRegion (Ptr<ClassAEndDeviceLorawanMac> edMac)
 
   ApplyCommonAlohaConfigurations (edMac);
 
-  /////////////////////////////////////////////////////
-  // TxPower -> Transmission power in dBm conversion //
-  /////////////////////////////////////////////////////
-  edMac->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
-
   ////////////////////////////////////////////////////////////
   // Matrix to know which DataRate the GW will respond with //
   ////////////////////////////////////////////////////////////
@@ -204,30 +230,41 @@ LorawanMacHelper::ApplyCommonAlohaConfigurations (Ptr<LorawanMac> lorawanMac) co
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  // All the devices installed by this helper share the same plan
+  if (m_alohaPlan == 0)
+    {
+      m_alohaPlan = CreateAlohaPlan ();
+    }
+  lorawanMac->SetRegionPlan (m_alohaPlan);
+}
+
+Ptr<RegionPlan>
+LorawanMacHelper::CreateAlohaPlan (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  Ptr<RegionPlan> plan = CreateObject<RegionPlan> ();
+
   //////////////
   // SubBands //
   //////////////
 
-  LogicalLoraChannelHelper channelHelper;
-  channelHelper.AddSubBand (868, 868.6, 1, 14);
+  plan->AddSubBand (Create<SubBand> (868, 868.6, 1, 14));
 
   //////////////////////
   // Default channels //
   //////////////////////
   Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel> (868.1, 0, 5);
-  channelHelper.AddChannel (lc1);
-
-  lorawanMac->SetLogicalLoraChannelHelper (channelHelper);
+  plan->AddChannel (lc1);
 
   ///////////////////////////////////////////////
-  // DataRate -> SF, DataRate -> Bandwidth     //
-  // and DataRate -> MaxAppPayload conversions //
+  // DataRate -> SF, DataRate -> Bandwidth,    //
+  // DataRate -> MaxAppPayload and TxPower ->  //
+  // transmission power in dBm conversions     //
   ///////////////////////////////////////////////
-  lorawanMac->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
-  lorawanMac->SetBandwidthForDataRate (
-      std::vector<double>{125000, 125000, 125000, 125000, 125000, 125000, 250000});
-  lorawanMac->SetMaxAppPayloadForDataRate (
-      std::vector<uint32_t>{59, 59, 59, 123, 230, 230, 230, 230});
+  SetDataRateTables<Eu868Region> (plan);
+
+  return plan;
 }
 
 void
@@ -237,11 +274,6 @@ LorawanMacHelper::ConfigureForEuRegion (Ptr<ClassAEndDeviceLorawanMac> edMac) co
 
   ApplyCommonEuConfigurations (edMac);
 
-  /////////////////////////////////////////////////////
-  // TxPower -> Transmission power in dBm conversion //
-  /////////////////////////////////////////////////////
-  edMac->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
-
   ////////////////////////////////////////////////////////////
   // Matrix to know which DataRate the GW will respond with //
   ////////////////////////////////////////////////////////////
@@ -310,14 +342,28 @@ LorawanMacHelper::ApplyCommonEuConfigurations (Ptr<LorawanMac> lorawanMac) const
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  // All the devices installed by this helper share the same plan
+  if (m_euPlan == 0)
+    {
+      m_euPlan = CreateEuPlan ();
+    }
+  lorawanMac->SetRegionPlan (m_euPlan);
+}
+
+Ptr<RegionPlan>
+LorawanMacHelper::CreateEuPlan (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  Ptr<RegionPlan> plan = CreateObject<RegionPlan> ();
+
   //////////////
   // SubBands //
   //////////////
 
-  LogicalLoraChannelHelper channelHelper;
-  channelHelper.AddSubBand (868, 868.6, 0.01, 14);
-  channelHelper.AddSubBand (868.7, 869.2, 0.001, 14);
-  channelHelper.AddSubBand (869.4, 869.65, 0.1, 27);
+  plan->AddSubBand (Create<SubBand> (868, 868.6, 0.01, 14));
+  plan->AddSubBand (Create<SubBand> (868.7, 869.2, 0.001, 14));
+  plan->AddSubBand (Create<SubBand> (869.4, 869.65, 0.1, 27));
 
   //////////////////////
   // Default channels //
@@ -325,21 +371,18 @@ LorawanMacHelper::ApplyCommonEuConfigurations (Ptr<LorawanMac> lorawanMac) const
   Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel> (868.1, 0, 5);
   Ptr<LogicalLoraChannel> lc2 = CreateObject<LogicalLoraChannel> (868.3, 0, 5);
   Ptr<LogicalLoraChannel> lc3 = CreateObject<LogicalLoraChannel> (868.5, 0, 5);
-  channelHelper.AddChannel (lc1);
-  channelHelper.AddChannel (lc2);
-  channelHelper.AddChannel (lc3);
-
-  lorawanMac->SetLogicalLoraChannelHelper (channelHelper);
+  plan->AddChannel (lc1);
+  plan->AddChannel (lc2);
+  plan->AddChannel (lc3);
 
   ///////////////////////////////////////////////
-  // DataRate -> SF, DataRate -> Bandwidth     //
-  // and DataRate -> MaxAppPayload conversions //
+  // DataRate -> SF, DataRate -> Bandwidth,    //
+  // DataRate -> MaxAppPayload and TxPower ->  //
+  // transmission power in dBm conversions     //
   ///////////////////////////////////////////////
-  lorawanMac->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
-  lorawanMac->SetBandwidthForDataRate (
-      std::vector<double>{125000, 125000, 125000, 125000, 125000, 125000, 250000});
-  lorawanMac->SetMaxAppPayloadForDataRate (
-      std::vector<uint32_t>{59, 59, 59, 123, 230, 230, 230, 230});
+  SetDataRateTables<Eu868Region> (plan);
+
+  return plan;
 }
 
 ///////////////////////////////
@@ -351,11 +394,6 @@ LorawanMacHelper::ConfigureForSingleChannelRegion (Ptr<ClassAEndDeviceLorawanMac
 
   ApplyCommonSingleChannelConfigurations (edMac);
 
-  /////////////////////////////////////////////////////
-  // TxPower -> Transmission power in dBm conversion //
-  /////////////////////////////////////////////////////
-  edMac->SetTxDbmForTxPower (std::vector<double>{16, 14, 12, 10, 8, 6, 4, 2});
-
   ////////////////////////////////////////////////////////////
   // Matrix to know which DataRate the GW will respond with //
   ////////////////////////////////////////////////////////////
@@ -422,32 +460,43 @@ LorawanMacHelper::ApplyCommonSingleChannelConfigurations (Ptr<LorawanMac> lorawa
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  // All the devices installed by this helper share the same plan
+  if (m_singleChannelPlan == 0)
+    {
+      m_singleChannelPlan = CreateSingleChannelPlan ();
+    }
+  lorawanMac->SetRegionPlan (m_singleChannelPlan);
+}
+
+Ptr<RegionPlan>
+LorawanMacHelper::CreateSingleChannelPlan (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  Ptr<RegionPlan> plan = CreateObject<RegionPlan> ();
+
   //////////////
   // SubBands //
   //////////////
 
-  LogicalLoraChannelHelper channelHelper;
-  channelHelper.AddSubBand (868, 868.6, 0.01, 14);
-  channelHelper.AddSubBand (868.7, 869.2, 0.001, 14);
-  channelHelper.AddSubBand (869.4, 869.65, 0.1, 27);
+  plan->AddSubBand (Create<SubBand> (868, 868.6, 0.01, 14));
+  plan->AddSubBand (Create<SubBand> (868.7, 869.2, 0.001, 14));
+  plan->AddSubBand (Create<SubBand> (869.4, 869.65, 0.1, 27));
 
   //////////////////////
   // Default channels //
   //////////////////////
   Ptr<LogicalLoraChannel> lc1 = CreateObject<LogicalLoraChannel> (868.1, 0, 5);
-  channelHelper.AddChannel (lc1);
-
-  lorawanMac->SetLogicalLoraChannelHelper (channelHelper);
+  plan->AddChannel (lc1);
 
   ///////////////////////////////////////////////
-  // DataRate -> SF, DataRate -> Bandwidth     //
-  // and DataRate -> MaxAppPayload conversions //
+  // DataRate -> SF, DataRate -> Bandwidth,    //
+  // DataRate -> MaxAppPayload and TxPower ->  //
+  // transmission power in dBm conversions     //
   ///////////////////////////////////////////////
-  lorawanMac->SetSfForDataRate (std::vector<uint8_t>{12, 11, 10, 9, 8, 7, 7});
-  lorawanMac->SetBandwidthForDataRate (
-      std::vector<double>{125000, 125000, 125000, 125000, 125000, 125000, 250000});
-  lorawanMac->SetMaxAppPayloadForDataRate (
-      std::vector<uint32_t>{59, 59, 59, 123, 230, 230, 230, 230});
+  SetDataRateTables<Eu868Region> (plan);
+
+  return plan;
 }
 
 std::vector<int>
@@ -25,6 +25,7 @@
 #include "ns3/lora-channel.h"
 #include "ns3/lora-phy.h"
 #include "ns3/lorawan-mac.h"
+#include "ns3/region-plan.h"
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/lora-device-address-generator.h"
 #include "ns3/gateway-lorawan-mac.h"
@@ -134,6 +135,11 @@ private:
    */
   void ApplyCommonEuConfigurations (Ptr<LorawanMac> lorawanMac) const;
 
+  /**
+   * Build the plan of the 868 MHz EU region.
+   */
+  static Ptr<RegionPlan> CreateEuPlan (void);
+
   /**
    * Perform region-specific configurations for the SINGLECHANNEL band.
    */
@@ -150,6 +156,11 @@ private:
    */
   void ApplyCommonSingleChannelConfigurations (Ptr<LorawanMac> lorawanMac) const;
 
+  /**
+   * Build the plan of the SINGLECHANNEL region.
+   */
+  static Ptr<RegionPlan> CreateSingleChannelPlan (void);
+
   /**
    * Perform region-specific configurations for the ALOHA band.
    */
@@ -166,10 +177,18 @@ private:
    */
   void ApplyCommonAlohaConfigurations (Ptr<LorawanMac> lorawanMac) const;
 
+  /**
+   * Build the plan of the ALOHA region.
+   */
+  static Ptr<RegionPlan> CreateAlohaPlan (void);
+
   ObjectFactory m_mac;
   Ptr<LoraDeviceAddressGenerator> m_addrGen; //!< Pointer to the address generator to use
   enum DeviceType m_deviceType; //!< The kind of device to install
   enum Regions m_region; //!< The region in which the device will operate
+  mutable Ptr<RegionPlan> m_euPlan; //!< The EU plan shared by the devices
+  mutable Ptr<RegionPlan> m_singleChannelPlan; //!< The SINGLECHANNEL plan shared by the devices
+  mutable Ptr<RegionPlan> m_alohaPlan; //!< The ALOHA plan shared by the devices
 };
 
 } // namespace lorawan
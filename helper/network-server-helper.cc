@@ -32,9 +32,11 @@ namespace lorawan {
 
 NS_LOG_COMPONENT_DEFINE ("NetworkServerHelper");
 
-NetworkServerHelper::NetworkServerHelper ()
+NetworkServerHelper::NetworkServerHelper () :
+  m_directBackhaulEnabled (false)
 {
   m_factory.SetTypeId ("ns3::NetworkServer");
+  m_directBackhaulFactory.SetTypeId ("ns3::DirectBackhaul");
   p2pHelper.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
   p2pHelper.SetChannelAttribute ("Delay", StringValue ("2ms"));
   SetAdr ("ns3::AdrComponent");
@@ -95,6 +97,16 @@ NetworkServerHelper::InstallPriv (Ptr<Node> node)
        i != m_gateways.End ();
        i++)
     {
+      if (m_directBackhaulEnabled)
+        {
+          // The gateway's Forwarder will find the link on its node
+          Ptr<DirectBackhaul> directBackhaul =
+            m_directBackhaulFactory.Create<DirectBackhaul> ();
+          (*i)->AggregateObject (directBackhaul);
+          app->AddGateway (*i, directBackhaul);
+          continue;
+        }
+
       // Add the connections with the gateway
       // Create a PointToPoint link between gateway and NS
       NetDeviceContainer container = p2pHelper.Install (node, *i);
@@ -129,6 +141,21 @@ NetworkServerHelper::EnableAdr (bool enableAdr)
   m_adrEnabled = enableAdr;
 }
 
+void
+NetworkServerHelper::EnableDirectBackhaul (bool enableDirectBackhaul)
+{
+  NS_LOG_FUNCTION (this << enableDirectBackhaul);
+
+  m_directBackhaulEnabled = enableDirectBackhaul;
+}
+
+void
+NetworkServerHelper::SetDirectBackhaulAttribute (std::string name,
+                                                 const AttributeValue &value)
+{
+  m_directBackhaulFactory.Set (name, value);
+}
+
 void
 NetworkServerHelper::SetAdr (std::string type)
 {
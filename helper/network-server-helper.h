@@ -73,6 +73,19 @@ public:
    */
   void SetAdr (std::string type);
 
+  /**
+   * Connect the gateways to the Network Server through in-process links,
+   * which hand packets to the other side after a latency, instead of
+   * PointToPoint links. Must be called before Install, and the Forwarders
+   * must be installed on the gateways after it.
+   */
+  void EnableDirectBackhaul (bool enableDirectBackhaul);
+
+  /**
+   * Set an attribute of the in-process links, for example their Latency.
+   */
+  void SetDirectBackhaulAttribute (std::string name, const AttributeValue &value);
+
 private:
   void InstallComponents (Ptr<NetworkServer> netServer);
   Ptr<Application> InstallPriv (Ptr<Node> node);
@@ -88,6 +101,10 @@ private:
   bool m_adrEnabled;
 
   ObjectFactory m_adrSupportFactory;
+
+  bool m_directBackhaulEnabled;   //!< Whether to use in-process links
+
+  ObjectFactory m_directBackhaulFactory;
 };
 
 } // namespace ns3
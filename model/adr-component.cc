@@ -19,6 +19,9 @@
  */
 
 #include "ns3/adr-component.h"
+#include "ns3/lorawan-region.h"
+#include "ns3/simulator.h"
+#include <algorithm>
 
 namespace ns3 {
 namespace lorawan {
@@ -67,6 +70,13 @@ TypeId AdrComponent::GetTypeId (void)
                    BooleanValue (true),
                    MakeBooleanAccessor (&AdrComponent::m_toggleTxPower),
                    MakeBooleanChecker ())
+    .AddAttribute ("EvaluationInterval",
+                   "Interval between batched evaluations of all the devices "
+                   "that received packets. If zero, each device is evaluated "
+                   "just before its reply",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&AdrComponent::m_evaluationInterval),
+                   MakeTimeChecker ())
   ;
   return tid;
 }
@@ -75,18 +85,228 @@ AdrComponent::AdrComponent ()
 {
 }
 
+AdrComponent::SnrWindow::SnrWindow ()
+  : m_nPushed (0),
+    m_n (0),
+    m_sum (0)
+{
+  m_min.head = m_min.n = 0;
+  m_max.head = m_max.n = 0;
+}
+
+uint64_t
+AdrComponent::SnrWindow::Candidates::Front (void) const
+{
+  return ring[head];
+}
+
+uint64_t
+AdrComponent::SnrWindow::Candidates::Back (void) const
+{
+  return ring[(head + n - 1) % ring.size ()];
+}
+
+void
+AdrComponent::SnrWindow::Candidates::PopFront (void)
+{
+  head = (head + 1) % ring.size ();
+  n--;
+}
+
+void
+AdrComponent::SnrWindow::Candidates::PopBack (void)
+{
+  n--;
+}
+
+void
+AdrComponent::SnrWindow::Candidates::PushBack (uint64_t number)
+{
+  NS_ASSERT (n < ring.size ());
+  ring[(head + n) % ring.size ()] = number;
+  n++;
+}
+
+void
+AdrComponent::SnrWindow::Resize (uint32_t size)
+{
+  // Keep the most recent SNRs that still fit
+  std::vector<double> kept;
+  for (uint64_t number = m_nPushed - std::min (m_n, size); number < m_nPushed; number++)
+    {
+      kept.push_back (GetValue (number));
+    }
+
+  m_values.assign (size, 0);
+  m_min.ring.assign (size, 0);
+  m_max.ring.assign (size, 0);
+  m_min.head = m_min.n = 0;
+  m_max.head = m_max.n = 0;
+  m_nPushed = 0;
+  m_n = 0;
+  m_sum = 0;
+  for (std::vector<double>::const_iterator it = kept.begin (); it != kept.end (); ++it)
+    {
+      Push (*it, size);
+    }
+}
+
+double
+AdrComponent::SnrWindow::GetValue (uint64_t number) const
+{
+  return m_values[number % m_values.size ()];
+}
+
+void
+AdrComponent::SnrWindow::Push (double snr, uint32_t size)
+{
+  if (size == 0)
+    {
+      return;
+    }
+  if (size != m_values.size ())
+    {
+      Resize (size);
+    }
+
+  // Evict the oldest value if the window is full, freeing its slot
+  if (m_n == size)
+    {
+      uint64_t oldest = m_nPushed - size;
+      m_sum -= GetValue (oldest);
+      m_n--;
+      if (m_min.Front () == oldest)
+        {
+          m_min.PopFront ();
+        }
+      if (m_max.Front () == oldest)
+        {
+          m_max.PopFront ();
+        }
+    }
+
+  // Values that are dominated by the new one can never be the extremes again
+  while (m_min.n && GetValue (m_min.Back ()) >= snr)
+    {
+      m_min.PopBack ();
+    }
+  while (m_max.n && GetValue (m_max.Back ()) <= snr)
+    {
+      m_max.PopBack ();
+    }
+  m_values[m_nPushed % size] = snr;
+  m_min.PushBack (m_nPushed);
+  m_max.PushBack (m_nPushed);
+  m_nPushed++;
+  m_n++;
+  m_sum += snr;
+}
+
+uint32_t
+AdrComponent::SnrWindow::GetN (void) const
+{
+  return m_n;
+}
+
+double
+AdrComponent::SnrWindow::GetSum (void) const
+{
+  return m_sum;
+}
+
+double
+AdrComponent::SnrWindow::GetMin (void) const
+{
+  NS_ASSERT (m_min.n);
+  return GetValue (m_min.Front ());
+}
+
+double
+AdrComponent::SnrWindow::GetMax (void) const
+{
+  NS_ASSERT (m_max.n);
+  return GetValue (m_max.Front ());
+}
+
+uint32_t
+AdrComponent::GetDeviceIndex (Ptr<NetworkStatus> networkStatus, LoraDeviceAddress address)
+{
+  uint32_t index = networkStatus->GetEndDeviceIndex (address);
+  NS_ASSERT (index != NetworkStatus::NOT_FOUND);
+  if (index >= m_devices.size ())
+    {
+      m_devices.resize (index + 1);
+    }
+  return index;
+}
+
+double
+AdrComponent::GetDeviceSnr (const DeviceAdrState &device, Ptr<EndDeviceStatus> status)
+{
+  // The statistics of the previous packets are combined with the last one
+  const SnrWindow &window = device.window;
+  double lastSnr = RxPowerToSNR (GetReceivedPower (status->GetLastReceivedPacketInfo ().gwList));
+  switch (historyAveraging)
+    {
+    case AdrComponent::AVERAGE:
+      return (window.GetSum () + lastSnr) / (window.GetN () + 1);
+    case AdrComponent::MAXIMUM:
+      return window.GetN () ? std::max (window.GetMax (), lastSnr) : lastSnr;
+    case AdrComponent::MINIMUM:
+      return window.GetN () ? std::min (window.GetMin (), lastSnr) : lastSnr;
+    default:
+      return 0;
+    }
+}
+
 AdrComponent::~AdrComponent ()
 {
 }
 
-void AdrComponent::OnReceivedPacket (Ptr<const Packet> packet,
+void AdrComponent::OnReceivedPacket (const DecodedUplink &uplink,
                                      Ptr<EndDeviceStatus> status,
                                      Ptr<NetworkStatus> networkStatus)
 {
-  NS_LOG_FUNCTION (this->GetTypeId () << packet << networkStatus);
+  NS_LOG_FUNCTION (this->GetTypeId () << uplink.packet << networkStatus);
+
+  // Make sure the device keeps enough packets for the algorithm, and the
+  // previous packet for the statistics below
+  status->ReserveReceivedPacketHistory (std::max (historyRange, 2));
 
   // We will only act just before reply, when all Gateways will have received
-  // the packet, since we need their respective received power.
+  // the packet, since we need their respective received power. A new packet
+  // means that the previous one won't be received by any more gateways, so
+  // its SNR can go into the device's statistics.
+  uint32_t index = GetDeviceIndex (networkStatus, uplink.frameHeader.GetAddress ());
+  DeviceAdrState &device = m_devices[index];
+  uint16_t fCnt = uplink.frameHeader.GetFCnt ();
+  const EndDeviceStatus::ReceivedPacketList &packetList = status->GetReceivedPacketList ();
+  if (device.hasLastPacket && device.lastFCnt != fCnt
+      && packetList.GetLast ().fCnt == fCnt && packetList.GetSize () > 1
+      && packetList.Get (1).fCnt == device.lastFCnt)
+    {
+      double snr = RxPowerToSNR (GetReceivedPower (packetList.Get (1).gwList));
+      device.window.Push (snr, historyRange > 1 ? historyRange - 1 : 0);
+    }
+  device.lastFCnt = fCnt;
+  device.hasLastPacket = true;
+
+  // In batched mode, mark the device for the next evaluation
+  if (m_evaluationInterval.IsStrictlyPositive ())
+    {
+      device.status = status;
+      if (!device.changed)
+        {
+          device.changed = true;
+          m_changedDevices.push_back (index);
+        }
+      if (!m_evaluationEvent.IsRunning ())
+        {
+          m_evaluationEvent = Simulator::Schedule (m_evaluationInterval,
+                                                   &AdrComponent::EvaluateDevices,
+                                                   this);
+        }
+    }
 }
 
 void
@@ -95,19 +315,26 @@ AdrComponent::BeforeSendingReply (Ptr<EndDeviceStatus> status,
 {
   NS_LOG_FUNCTION (this << status << networkStatus);
 
-  Ptr<Packet> myPacket = status->GetLastPacketReceivedFromDevice ()->Copy ();
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  myPacket->RemoveHeader (mHdr);
-  myPacket->RemoveHeader (fHdr);
+  uint32_t index = GetDeviceIndex (networkStatus, status->m_endDeviceAddress);
+
+  // In batched mode, only send what the last evaluation decided
+  if (m_evaluationInterval.IsStrictlyPositive ())
+    {
+      DeviceAdrState &device = m_devices[index];
+      if (device.hasPendingRequest)
+        {
+          AddLinkAdrReq (status, device.pendingDataRate, device.pendingTxPower);
+          device.hasPendingRequest = false;
+        }
+      return;
+    }
 
   //Execute the ADR algotithm only if the request bit is set
-  if (fHdr.GetAdr ())
+  if (status->GetLastReceivedPacketInfo ().adr)
     {
-      if (int(status->GetReceivedPacketList ().size ()) < historyRange)
+      if (int(status->GetReceivedPacketList ().GetSize ()) < historyRange)
         {
-          NS_LOG_ERROR ("Not enough packets received by this device (" << status->GetReceivedPacketList ().size () << ") for the algorithm to work (need " << historyRange << ")");
+          NS_LOG_ERROR ("Not enough packets received by this device (" << status->GetReceivedPacketList ().GetSize () << ") for the algorithm to work (need " << historyRange << ")");
         }
       else
         {
@@ -126,7 +353,8 @@ AdrComponent::BeforeSendingReply (Ptr<EndDeviceStatus> status,
           //ADR Algorithm
           AdrImplementation (&newDataRate,
                              &newTxPower,
-                             status);
+                             status,
+                             index);
 
           // Change the power back to the default if we don't want to change it
           if (!m_toggleTxPower)
@@ -136,27 +364,7 @@ AdrComponent::BeforeSendingReply (Ptr<EndDeviceStatus> status,
 
           if (newDataRate != SfToDr (spreadingFactor) || newTxPower != transmissionPower)
             {
-              //Create a list with mandatory channel indexes
-              int channels[] = {0, 1, 2};
-              std::list<int> enabledChannels (channels,
-                                              channels + sizeof(channels) /
-                                              sizeof(int));
-
-              //Repetitions Setting
-              const int rep = 1;
-
-              NS_LOG_DEBUG ("Sending LinkAdrReq with DR = " << (unsigned)newDataRate << " and TP = " << (unsigned)newTxPower << " dBm");
-
-              status->m_reply.frameHeader.AddLinkAdrReq (newDataRate,
-                                                         GetTxPowerIndex (newTxPower),
-                                                         enabledChannels,
-                                                         rep);
-              status->m_reply.frameHeader.SetAsDownlink ();
-              status->m_reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
-
-              status->m_reply.needsReply = true;
-
-              std::cout << "ADR_FULFILLED: " << ns3::Simulator::Now ().GetDays () << std::endl;
+              AddLinkAdrReq (status, newDataRate, newTxPower);
             }
           else
             {
@@ -176,42 +384,129 @@ void AdrComponent::OnFailedReply (Ptr<EndDeviceStatus> status,
   NS_LOG_FUNCTION (this->GetTypeId () << networkStatus);
 }
 
+bool
+AdrComponent::MayAddToReply (Ptr<EndDeviceStatus> status,
+                             Ptr<NetworkStatus> networkStatus)
+{
+  if (m_evaluationInterval.IsStrictlyPositive ())
+    {
+      uint32_t index = networkStatus->GetEndDeviceIndex (status->m_endDeviceAddress);
+      return index < m_devices.size () && m_devices[index].hasPendingRequest;
+    }
+
+  return status->GetLastReceivedPacketInfo ().adr
+         && int(status->GetReceivedPacketList ().GetSize ()) >= historyRange;
+}
+
+void
+AdrComponent::AddLinkAdrReq (Ptr<EndDeviceStatus> status, uint8_t newDataRate,
+                             uint8_t newTxPower)
+{
+  //Create a list with mandatory channel indexes
+  int channels[] = {0, 1, 2};
+  std::list<int> enabledChannels (channels,
+                                  channels + sizeof(channels) /
+                                  sizeof(int));
+
+  //Repetitions Setting
+  const int rep = 1;
+
+  NS_LOG_DEBUG ("Sending LinkAdrReq with DR = " << (unsigned)newDataRate << " and TP = " << (unsigned)newTxPower << " dBm");
+
+  EndDeviceStatus::Reply &reply = status->GetReply ();
+  reply.frameHeader.AddLinkAdrReq (newDataRate,
+                                   GetTxPowerIndex (newTxPower),
+                                   enabledChannels,
+                                   rep);
+  reply.frameHeader.SetAsDownlink ();
+  reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
+
+  reply.needsReply = true;
+
+  std::cout << "ADR_FULFILLED: " << ns3::Simulator::Now ().GetDays () << std::endl;
+}
+
+void
+AdrComponent::EvaluateDevices (void)
+{
+  NS_LOG_FUNCTION (this << m_changedDevices.size ());
+
+  // Gather the inputs of the devices that asked for ADR and have enough
+  // history, clearing the marks of all changed devices
+  m_batchDevices.clear ();
+  m_batchSnrs.clear ();
+  m_batchSpreadingFactors.clear ();
+  m_batchTxPowers.clear ();
+  for (auto it = m_changedDevices.begin (); it != m_changedDevices.end (); ++it)
+    {
+      DeviceAdrState &device = m_devices[*it];
+      device.changed = false;
+      Ptr<EndDeviceStatus> status = device.status;
+      if (!status->GetLastReceivedPacketInfo ().adr
+          || int(status->GetReceivedPacketList ().GetSize ()) < historyRange)
+        {
+          continue;
+        }
+      m_batchDevices.push_back (*it);
+      m_batchSnrs.push_back (GetDeviceSnr (device, status));
+      m_batchSpreadingFactors.push_back (status->GetFirstReceiveWindowSpreadingFactor ());
+      m_batchTxPowers.push_back (status->GetMac ()->GetTransmissionPower ());
+    }
+  m_changedDevices.clear ();
+
+  // Run the algorithm on all of them in one pass
+  uint32_t nDevices = m_batchDevices.size ();
+  m_batchNewDataRates.resize (nDevices);
+  m_batchNewTxPowers.resize (nDevices);
+  for (uint32_t i = 0; i < nDevices; i++)
+    {
+      ComputeAdrParameters (m_batchSnrs[i], m_batchSpreadingFactors[i], m_batchTxPowers[i],
+                            &m_batchNewDataRates[i], &m_batchNewTxPowers[i]);
+    }
+
+  // Queue the changes for the devices' next receive window
+  for (uint32_t i = 0; i < nDevices; i++)
+    {
+      uint8_t txPower = m_batchTxPowers[i];
+      uint8_t newTxPower = m_toggleTxPower ? m_batchNewTxPowers[i] : txPower;
+      uint8_t newDataRate = m_batchNewDataRates[i];
+      DeviceAdrState &device = m_devices[m_batchDevices[i]];
+      device.hasPendingRequest = newDataRate != SfToDr (m_batchSpreadingFactors[i])
+        || newTxPower != txPower;
+      device.pendingDataRate = newDataRate;
+      device.pendingTxPower = newTxPower;
+    }
+
+  NS_LOG_DEBUG ("Evaluated ADR for " << nDevices << " devices");
+}
+
 void AdrComponent::AdrImplementation (uint8_t *newDataRate,
                                       uint8_t *newTxPower,
-                                      Ptr<EndDeviceStatus> status)
+                                      Ptr<EndDeviceStatus> status,
+                                      uint32_t deviceIndex)
 {
   //Compute the maximum or median SNR, based on the boolean value historyAveraging
-  double m_SNR = 0;
-  switch (historyAveraging)
-    {
-    case AdrComponent::AVERAGE:
-      m_SNR = GetAverageSNR (status->GetReceivedPacketList (),
-                             historyRange);
-      break;
-    case AdrComponent::MAXIMUM:
-      m_SNR = GetMaxSNR (status->GetReceivedPacketList (),
-                         historyRange);
-      break;
-    case AdrComponent::MINIMUM:
-      m_SNR = GetMinSNR (status->GetReceivedPacketList (),
-                         historyRange);
-    }
+  double m_SNR = GetDeviceSnr (m_devices[deviceIndex], status);
 
   NS_LOG_DEBUG ("m_SNR = " << m_SNR);
 
-  //Get the SF used by the device
-  uint8_t spreadingFactor = status->GetFirstReceiveWindowSpreadingFactor ();
+  ComputeAdrParameters (m_SNR, status->GetFirstReceiveWindowSpreadingFactor (),
+                        status->GetMac ()->GetTransmissionPower (),
+                        newDataRate, newTxPower);
+}
 
+void
+AdrComponent::ComputeAdrParameters (double m_SNR, uint8_t spreadingFactor,
+                                    double transmissionPower, uint8_t *newDataRate,
+                                    uint8_t *newTxPower)
+{
   NS_LOG_DEBUG ("SF = " << (unsigned)spreadingFactor);
 
   //Get the device data rate and use it to get the SNR demodulation treshold
-  double req_SNR = treshold[SfToDr (spreadingFactor)];
+  double req_SNR = Eu868Region::GetRequiredSnr (SfToDr (spreadingFactor));
 
   NS_LOG_DEBUG ("Required SNR = " << req_SNR);
 
-  //Get the device transmission power (dBm)
-  double transmissionPower = status->GetMac ()->GetTransmissionPower ();
-
   NS_LOG_DEBUG ("Transmission Power = " << transmissionPower);
 
   //Compute the SNR margin taking into consideration the SNR of
@@ -260,27 +555,9 @@ void AdrComponent::AdrImplementation (uint8_t *newDataRate,
 
 uint8_t AdrComponent::SfToDr (uint8_t sf)
 {
-  switch (sf)
-    {
-    case 12:
-      return 0;
-      break;
-    case 11:
-      return 1;
-      break;
-    case 10:
-      return 2;
-      break;
-    case 9:
-      return 3;
-      break;
-    case 8:
-      return 4;
-      break;
-    default:
-      return 5;
-      break;
-    }
+  // SF7 and anything that is not an EU868 SF map to DR5
+  uint8_t dataRate = Eu868Region::GetDataRate (sf, 125000);
+  return dataRate == INVALID_DATA_RATE ? 5 : dataRate;
 }
 
 double AdrComponent::RxPowerToSNR (double transmissionPower)
@@ -290,9 +567,9 @@ double AdrComponent::RxPowerToSNR (double transmissionPower)
 }
 
 //Get the maximum received power (it considers the values in dB!)
-double AdrComponent::GetMinTxFromGateways (EndDeviceStatus::GatewayList gwList)
+double AdrComponent::GetMinTxFromGateways (const EndDeviceStatus::GatewayList &gwList)
 {
-  EndDeviceStatus::GatewayList::iterator it = gwList.begin ();
+  EndDeviceStatus::GatewayList::const_iterator it = gwList.begin ();
   double min = it->second.rxPower;
 
   for (; it != gwList.end (); it++)
@@ -307,9 +584,9 @@ double AdrComponent::GetMinTxFromGateways (EndDeviceStatus::GatewayList gwList)
 }
 
 //Get the maximum received power (it considers the values in dB!)
-double AdrComponent::GetMaxTxFromGateways (EndDeviceStatus::GatewayList gwList)
+double AdrComponent::GetMaxTxFromGateways (const EndDeviceStatus::GatewayList &gwList)
 {
-  EndDeviceStatus::GatewayList::iterator it = gwList.begin ();
+  EndDeviceStatus::GatewayList::const_iterator it = gwList.begin ();
   double max = it->second.rxPower;
 
   for (; it != gwList.end (); it++)
@@ -324,11 +601,11 @@ double AdrComponent::GetMaxTxFromGateways (EndDeviceStatus::GatewayList gwList)
 }
 
 //Get the maximum received power
-double AdrComponent::GetAverageTxFromGateways (EndDeviceStatus::GatewayList gwList)
+double AdrComponent::GetAverageTxFromGateways (const EndDeviceStatus::GatewayList &gwList)
 {
   double sum = 0;
 
-  for (EndDeviceStatus::GatewayList::iterator it = gwList.begin (); it != gwList.end (); it++)
+  for (EndDeviceStatus::GatewayList::const_iterator it = gwList.begin (); it != gwList.end (); it++)
     {
       NS_LOG_DEBUG ("Gateway at " << it->first << " has TP " << it->second.rxPower);
       sum += it->second.rxPower;
@@ -342,7 +619,7 @@ double AdrComponent::GetAverageTxFromGateways (EndDeviceStatus::GatewayList gwLi
 }
 
 double
-AdrComponent::GetReceivedPower (EndDeviceStatus::GatewayList gwList)
+AdrComponent::GetReceivedPower (const EndDeviceStatus::GatewayList &gwList)
 {
   switch (tpAveraging)
     {
@@ -357,86 +634,6 @@ AdrComponent::GetReceivedPower (EndDeviceStatus::GatewayList gwList)
     }
 }
 
-// TODO Make this more elegant
-double AdrComponent::GetMinSNR (EndDeviceStatus::ReceivedPacketList packetList,
-                                int historyRange)
-{
-  double m_SNR;
-
-  //Take elements from the list starting at the end
-  auto it = packetList.rbegin ();
-  double min = RxPowerToSNR (GetReceivedPower (it->second.gwList));
-
-  for (int i = 0; i < historyRange; i++, it++)
-    {
-      m_SNR = RxPowerToSNR (GetReceivedPower (it->second.gwList));
-
-      NS_LOG_DEBUG ("Received power: " << GetReceivedPower (it->second.gwList));
-      NS_LOG_DEBUG ("m_SNR = " << m_SNR);
-
-      if (m_SNR < min)
-        {
-          min = m_SNR;
-        }
-    }
-
-  NS_LOG_DEBUG ("SNR (min) = " << min);
-
-  return min;
-}
-
-double AdrComponent::GetMaxSNR (EndDeviceStatus::ReceivedPacketList packetList,
-                                int historyRange)
-{
-  double m_SNR;
-
-  //Take elements from the list starting at the end
-  auto it = packetList.rbegin ();
-  double max = RxPowerToSNR (GetReceivedPower (it->second.gwList));
-
-  for (int i = 0; i < historyRange; i++, it++)
-    {
-      m_SNR = RxPowerToSNR (GetReceivedPower (it->second.gwList));
-
-      NS_LOG_DEBUG ("Received power: " << GetReceivedPower (it->second.gwList));
-      NS_LOG_DEBUG ("m_SNR = " << m_SNR);
-
-      if (m_SNR > max)
-        {
-          max = m_SNR;
-        }
-    }
-
-  NS_LOG_DEBUG ("SNR (max) = " << max);
-
-  return max;
-}
-
-double AdrComponent::GetAverageSNR (EndDeviceStatus::ReceivedPacketList packetList,
-                                    int historyRange)
-{
-  double sum = 0;
-  double m_SNR;
-
-  //Take elements from the list starting at the end
-  auto it = packetList.rbegin ();
-  for (int i = 0; i < historyRange; i++, it++)
-    {
-      m_SNR = RxPowerToSNR (GetReceivedPower (it->second.gwList));
-
-      NS_LOG_DEBUG ("Received power: " << GetReceivedPower (it->second.gwList));
-      NS_LOG_DEBUG ("m_SNR = " << m_SNR);
-
-      sum += m_SNR;
-    }
-
-  double average = sum / historyRange;
-
-  NS_LOG_DEBUG ("SNR (average) = " << average);
-
-  return average;
-}
-
 int AdrComponent::GetTxPowerIndex (int txPower)
 {
   if (txPower >= 16)
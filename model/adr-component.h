@@ -26,6 +26,9 @@
 #include "ns3/packet.h"
 #include "ns3/network-status.h"
 #include "ns3/network-controller-components.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -45,6 +48,64 @@ enum CombiningMethod
     MAXIMUM,
     MINIMUM,
   };
+  /**
+   * Sum, minimum and maximum of the last SNRs of a device, updated in
+   * constant time as values enter and leave the window. The SNRs are kept in
+   * a ring as large as the window, and the minimum and maximum with
+   * monotonic queues of positions in that ring, which are rings themselves.
+   */
+  class SnrWindow
+  {
+  public:
+    SnrWindow ();
+
+    /**
+     * Add an SNR, evicting the oldest ones so that at most size are kept.
+     */
+    void Push (double snr, uint32_t size);
+
+    uint32_t GetN (void) const;
+    double GetSum (void) const;
+    double GetMin (void) const;
+    double GetMax (void) const;
+
+  private:
+    /**
+     * A monotonic queue of the numbers of the pushed SNRs that may still be
+     * the extreme of the window.
+     */
+    struct Candidates
+    {
+      std::vector<uint64_t> ring;  //!< Push numbers, as large as the window
+      uint32_t head;               //!< Position of the oldest candidate
+      uint32_t n;                  //!< Number of candidates
+
+      uint64_t Front (void) const;
+      uint64_t Back (void) const;
+      void PopFront (void);
+      void PopBack (void);
+      void PushBack (uint64_t number);
+    };
+
+    /**
+     * Make room for size SNRs, keeping the most recent ones that fit.
+     */
+    void Resize (uint32_t size);
+
+    /**
+     * Get the SNR with a push number in the window.
+     */
+    double GetValue (uint64_t number) const;
+
+    std::vector<double> m_values;  //!< The SNRs, by push number modulo the
+                                   //!< window size
+    Candidates m_min;              //!< Increasing candidates
+    Candidates m_max;              //!< Decreasing candidates
+    uint64_t m_nPushed;            //!< Number of SNRs pushed so far
+    uint32_t m_n;                  //!< Number of SNRs in the window
+    double m_sum;                  //!< Sum of the SNRs in the window
+  };
+
   static TypeId GetTypeId (void);
 
   //Constructor
@@ -52,7 +113,7 @@ enum CombiningMethod
   //Destructor
   virtual ~AdrComponent ();
 
-  void OnReceivedPacket (Ptr<const Packet> packet,
+  void OnReceivedPacket (const DecodedUplink &uplink,
                          Ptr<EndDeviceStatus> status,
                          Ptr<NetworkStatus> networkStatus);
 
@@ -61,31 +122,96 @@ enum CombiningMethod
 
   void OnFailedReply (Ptr<EndDeviceStatus> status,
                       Ptr<NetworkStatus> networkStatus);
+
+  /**
+   * In batched mode, whether the last evaluation queued a LinkAdrReq for
+   * the device. Otherwise, whether the device asked for ADR and has enough
+   * packets for the algorithm, in which case it may get a LinkAdrReq.
+   */
+  bool MayAddToReply (Ptr<EndDeviceStatus> status,
+                      Ptr<NetworkStatus> networkStatus);
 private:
   void AdrImplementation (uint8_t *newDataRate,
                           uint8_t *newTxPower,
-                          Ptr<EndDeviceStatus> status);
+                          Ptr<EndDeviceStatus> status,
+                          uint32_t deviceIndex);
+
+  /**
+   * Compute the new data rate and transmission power of a device from its
+   * SNR and current parameters.
+   */
+  void ComputeAdrParameters (double snr, uint8_t spreadingFactor,
+                             double transmissionPower, uint8_t *newDataRate,
+                             uint8_t *newTxPower);
+
+  /**
+   * Add a LinkAdrReq command to the reply of a device.
+   */
+  void AddLinkAdrReq (Ptr<EndDeviceStatus> status, uint8_t newDataRate,
+                      uint8_t newTxPower);
+
+  /**
+   * Evaluate ADR for all the devices that received packets since the last
+   * evaluation, queueing the resulting LinkAdrReqs for their next receive
+   * window.
+   */
+  void EvaluateDevices (void);
 
   uint8_t SfToDr (uint8_t sf);
 
   double RxPowerToSNR (double transmissionPower);
 
-  double GetMinTxFromGateways (EndDeviceStatus::GatewayList gwList);
-
-  double GetMaxTxFromGateways (EndDeviceStatus::GatewayList gwList);
+  double GetMinTxFromGateways (const EndDeviceStatus::GatewayList &gwList);
 
-  double GetAverageTxFromGateways (EndDeviceStatus::GatewayList gwList);
+  double GetMaxTxFromGateways (const EndDeviceStatus::GatewayList &gwList);
 
-  double GetReceivedPower (EndDeviceStatus::GatewayList gwList);
+  double GetAverageTxFromGateways (const EndDeviceStatus::GatewayList &gwList);
 
-  double GetMinSNR (EndDeviceStatus::ReceivedPacketList packetList,
-                    int historyRange);
+  double GetReceivedPower (const EndDeviceStatus::GatewayList &gwList);
 
-  double GetMaxSNR (EndDeviceStatus::ReceivedPacketList packetList,
-                    int historyRange);
+  /**
+   * ADR state of a device. The last packet is left out of the SNR window
+   * until the next one arrives, since more gateways may still receive it.
+   */
+  struct DeviceAdrState
+  {
+    SnrWindow window;            //!< SNRs of the packets before the last one
+    uint16_t lastFCnt = 0;       //!< Frame counter of the last packet
+    bool hasLastPacket = false;  //!< Whether a packet was received at all
+    Ptr<EndDeviceStatus> status; //!< The device's status at the server
+    bool changed = false;        //!< Whether packets arrived since the last
+                                 //!< batched evaluation
+    bool hasPendingRequest = false;  //!< Whether a LinkAdrReq is queued
+    uint8_t pendingDataRate = 0;     //!< Data rate of the queued LinkAdrReq
+    uint8_t pendingTxPower = 0;      //!< TX power of the queued LinkAdrReq
+  };
 
-  double GetAverageSNR (EndDeviceStatus::ReceivedPacketList packetList,
-                        int historyRange);
+  /**
+   * Get the index of a device in the NetworkStatus, making room for its ADR
+   * state.
+   */
+  uint32_t GetDeviceIndex (Ptr<NetworkStatus> networkStatus, LoraDeviceAddress address);
+
+  /**
+   * Get the SNR of a device, combining the last packet with the previous
+   * ones according to the MultiplePacketsCombiningMethod.
+   */
+  double GetDeviceSnr (const DeviceAdrState &device, Ptr<EndDeviceStatus> status);
+
+  std::vector<DeviceAdrState> m_devices;   //!< ADR state, by the device's
+                                           //!< index in the NetworkStatus
+
+  Time m_evaluationInterval;        //!< Period of the batched evaluation
+  EventId m_evaluationEvent;        //!< The next batched evaluation
+  std::vector<uint32_t> m_changedDevices;  //!< Devices to evaluate next
+
+  // Inputs and outputs of the batched evaluation, one entry per device
+  std::vector<uint32_t> m_batchDevices;
+  std::vector<double> m_batchSnrs;
+  std::vector<uint8_t> m_batchSpreadingFactors;
+  std::vector<double> m_batchTxPowers;
+  std::vector<uint8_t> m_batchNewDataRates;
+  std::vector<uint8_t> m_batchNewTxPowers;
 
   int GetTxPowerIndex (int txPower);
 
@@ -116,9 +242,7 @@ private:
   //Noise Figure (dB)
   const int NF = 6;
 
-  //Vector containing the required SNR for the 6 allowed SF levels
-  //ranging from 7 to 12 (the SNR values are in dB).
-  double treshold[6] = {-20.0, -17.5, -15.0, -12.5, -10.0, -7.5};
+  //The required SNR of each data rate is read from Eu868Region
 
   bool m_toggleTxPower;
 };
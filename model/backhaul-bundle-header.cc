@@ -0,0 +1,203 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/backhaul-bundle-header.h"
+#include "ns3/log.h"
+#include <cstring>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("BackhaulBundleHeader");
+
+NS_OBJECT_ENSURE_REGISTERED (BackhaulBundleHeader);
+NS_OBJECT_ENSURE_REGISTERED (BackhaulBundleTag);
+
+namespace {
+
+// Doubles travel as their bit patterns, so that they arrive unchanged
+uint64_t
+DoubleToBits (double value)
+{
+  uint64_t bits;
+  std::memcpy (&bits, &value, sizeof (bits));
+  return bits;
+}
+
+double
+BitsToDouble (uint64_t bits)
+{
+  double value;
+  std::memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+} // anonymous namespace
+
+const uint32_t BackhaulBundleHeader::MAX_FRAMES;
+
+TypeId
+BackhaulBundleHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BackhaulBundleHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("lorawan")
+    .AddConstructor<BackhaulBundleHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+BackhaulBundleHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+BackhaulBundleHeader::BackhaulBundleHeader ()
+{
+}
+
+BackhaulBundleHeader::~BackhaulBundleHeader ()
+{
+}
+
+uint32_t
+BackhaulBundleHeader::GetSerializedSize (void) const
+{
+  // Number of frames, then for each frame its size, SF, destroyedBy and data
+  // rate, receive power and frequency
+  return 1 + m_sizes.size () * (2 + 3 + 2 * 8);
+}
+
+void
+BackhaulBundleHeader::Serialize (Buffer::Iterator start) const
+{
+  start.WriteU8 (m_sizes.size ());
+  for (uint32_t i = 0; i < m_sizes.size (); i++)
+    {
+      LoraTag tag = m_tags[i];
+      start.WriteHtonU16 (m_sizes[i]);
+      start.WriteU8 (tag.GetSpreadingFactor ());
+      start.WriteU8 (tag.GetDestroyedBy ());
+      start.WriteU8 (tag.GetDataRate ());
+      start.WriteHtonU64 (DoubleToBits (tag.GetReceivePower ()));
+      start.WriteHtonU64 (DoubleToBits (tag.GetFrequency ()));
+    }
+}
+
+uint32_t
+BackhaulBundleHeader::Deserialize (Buffer::Iterator start)
+{
+  Clear ();
+  uint32_t nFrames = start.ReadU8 ();
+  for (uint32_t i = 0; i < nFrames; i++)
+    {
+      uint16_t size = start.ReadNtohU16 ();
+      LoraTag tag;
+      tag.SetSpreadingFactor (start.ReadU8 ());
+      tag.SetDestroyedBy (start.ReadU8 ());
+      tag.SetDataRate (start.ReadU8 ());
+      tag.SetReceivePower (BitsToDouble (start.ReadNtohU64 ()));
+      tag.SetFrequency (BitsToDouble (start.ReadNtohU64 ()));
+      m_sizes.push_back (size);
+      m_tags.push_back (tag);
+    }
+  return GetSerializedSize ();
+}
+
+void
+BackhaulBundleHeader::Print (std::ostream &os) const
+{
+  os << "Frames=" << m_sizes.size ();
+}
+
+void
+BackhaulBundleHeader::AddFrame (uint32_t size, const LoraTag &tag)
+{
+  NS_ASSERT_MSG (m_sizes.size () < MAX_FRAMES, "Too many frames in the bundle");
+  NS_ASSERT (size <= 0xffff);
+
+  m_sizes.push_back (size);
+  m_tags.push_back (tag);
+}
+
+uint32_t
+BackhaulBundleHeader::GetNFrames (void) const
+{
+  return m_sizes.size ();
+}
+
+uint32_t
+BackhaulBundleHeader::GetFrameSize (uint32_t i) const
+{
+  NS_ASSERT (i < m_sizes.size ());
+  return m_sizes[i];
+}
+
+const LoraTag &
+BackhaulBundleHeader::GetFrameTag (uint32_t i) const
+{
+  NS_ASSERT (i < m_tags.size ());
+  return m_tags[i];
+}
+
+void
+BackhaulBundleHeader::Clear (void)
+{
+  m_sizes.clear ();
+  m_tags.clear ();
+}
+
+TypeId
+BackhaulBundleTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::BackhaulBundleTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("lorawan")
+    .AddConstructor<BackhaulBundleTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+BackhaulBundleTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+BackhaulBundleTag::GetSerializedSize (void) const
+{
+  return 0;
+}
+
+void
+BackhaulBundleTag::Serialize (TagBuffer i) const
+{
+}
+
+void
+BackhaulBundleTag::Deserialize (TagBuffer i)
+{
+}
+
+void
+BackhaulBundleTag::Print (std::ostream &os) const
+{
+}
+
+} // namespace lorawan
+} // namespace ns3
@@ -0,0 +1,108 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BACKHAUL_BUNDLE_HEADER_H
+#define BACKHAUL_BUNDLE_HEADER_H
+
+#include "ns3/header.h"
+#include "ns3/tag.h"
+#include "ns3/lora-tag.h"
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Header of a backhaul packet that bundles several uplinks received by a
+ * gateway.
+ *
+ * The frames follow the header back to back. For each of them, the header
+ * holds its size and the reception information that travels in the LoraTag
+ * of a single uplink, since packet tags are lost when packets are
+ * concatenated.
+ */
+class BackhaulBundleHeader : public Header
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  BackhaulBundleHeader ();
+  virtual ~BackhaulBundleHeader ();
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+  virtual void Print (std::ostream &os) const;
+
+  /**
+   * The maximum number of frames in a bundle.
+   */
+  static const uint32_t MAX_FRAMES = 255;
+
+  /**
+   * Add a frame at the end of the bundle.
+   *
+   * \param size The size of the frame, in bytes.
+   * \param tag The LoraTag the gateway put on the frame.
+   */
+  void AddFrame (uint32_t size, const LoraTag &tag);
+
+  /**
+   * Get the number of frames in the bundle.
+   */
+  uint32_t GetNFrames (void) const;
+
+  /**
+   * Get the size of a frame, in bytes.
+   */
+  uint32_t GetFrameSize (uint32_t i) const;
+
+  /**
+   * Get the LoraTag of a frame.
+   */
+  const LoraTag &GetFrameTag (uint32_t i) const;
+
+  /**
+   * Remove all the frames.
+   */
+  void Clear (void);
+
+private:
+  std::vector<uint16_t> m_sizes;  //!< Size of each frame
+  std::vector<LoraTag> m_tags;    //!< Reception information of each frame
+};
+
+/**
+ * Tag that marks a backhaul packet as a bundle, starting with a
+ * BackhaulBundleHeader.
+ */
+class BackhaulBundleTag : public Tag
+{
+public:
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* BACKHAUL_BUNDLE_HEADER_H */
@@ -25,8 +25,10 @@
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/end-device-lorawan-mac.h"
 #include "ns3/end-device-lora-phy.h"
+#include "ns3/lorawan-region.h"
 #include "ns3/log.h"
 #include <algorithm>
+#include <limits>
 
 namespace ns3
 {
@@ -44,15 +46,34 @@ namespace ns3
                               .SetParent<EndDeviceLorawanMac>()
                               .SetGroupName("lorawan")
                               .AddConstructor<ClassAEndDeviceLorawanMac>()
+                              .AddTraceSource("GeneticConverged",
+                                              "Trace source fired when the genetic optimizer of this node converges.",
+                                              MakeTraceSourceAccessor(&ClassAEndDeviceLorawanMac::m_geneticConverged),
+                                              "ns3::ClassAEndDeviceLorawanMac::GeneticConvergedTracedCallback")
+                              .AddTraceSource("LastNPSR",
+                                              "The PSR of the last LinkStatisticsWindow frames with an outcome, "
+                                              "updated once the window is full.",
+                                              MakeTraceSourceAccessor(&ClassAEndDeviceLorawanMac::lastNPacketSuccessRate),
+                                              "ns3::TracedValueCallback::Double")
+                              .AddTraceSource("SuccessRateEwma",
+                                              "The exponentially weighted moving average of the PSR.",
+                                              MakeTraceSourceAccessor(&ClassAEndDeviceLorawanMac::m_successRateEwma),
+                                              "ns3::TracedValueCallback::Double")
+                              .AddTraceSource("PacketErrorRate",
+                                              "The fraction of the frames with an outcome that were not acknowledged, "
+                                              "since the link statistics were last reset.",
+                                              MakeTraceSourceAccessor(&ClassAEndDeviceLorawanMac::PacketErrorRate),
+                                              "ns3::TracedValueCallback::Double")
                               .AddTraceSource("NumberOfFramesSent",
                                               "The number of Frames sent from this node.",
                                               MakeTraceSourceAccessor(&ClassAEndDeviceLorawanMac::TransmissionsSent),
                                               "ns3::TracedValueCallback::Int32")
                               .AddAttribute("FailedTransmissionCount",
                                             "The number of transmissions that didn't get an ACK.",
-                                            DoubleValue(0),
-                                            MakeIntegerAccessor(&ClassAEndDeviceLorawanMac::UnacknowledgedTransmissions),
-                                            MakeIntegerChecker<uint32_t>())
+                                            TypeId::ATTR_GET,
+                                            UintegerValue(0),
+                                            MakeUintegerAccessor(&ClassAEndDeviceLorawanMac::GetFailedTransmissionCount),
+                                            MakeUintegerChecker<uint32_t>())
                               .AddAttribute("LastFitnessLevel",
                                             "The fitness level of the last tx paramset used to tx.",
                                             DoubleValue(0),
@@ -63,16 +84,20 @@ namespace ns3
                                             BooleanValue(false),
                                             MakeBooleanAccessor(&ClassAEndDeviceLorawanMac::useGeneticParamaterSelection),
                                             MakeBooleanChecker())
-                              .AddAttribute("PacketErrorRate",
-                                            "The factor of packets that are NOT acknowledged vs number of packets sent out.",
-                                            DoubleValue(false),
-                                            MakeDoubleAccessor(&ClassAEndDeviceLorawanMac::PacketErrorRate),
-                                            MakeDoubleChecker<float>())
-                              .AddAttribute("LastNPSR",
-                                            "The PSR of the last N (32) frames sent. Interval set externally.",
-                                            DoubleValue(false),
-                                            MakeDoubleAccessor(&ClassAEndDeviceLorawanMac::lastNPacketSuccessRate),
-                                            MakeDoubleChecker<float>())
+                              .AddAttribute("LinkStatisticsWindow",
+                                            "The number of most recent frames the LastNPSR is computed on.",
+                                            UintegerValue(32),
+                                            MakeUintegerAccessor(&ClassAEndDeviceLorawanMac::SetLinkStatisticsWindow,
+                                                                 &ClassAEndDeviceLorawanMac::GetLinkStatisticsWindow),
+                                            MakeUintegerChecker<uint32_t>(1))
+                              .AddAttribute("LinkStatisticsEwmaAlpha",
+                                            "The weight of the last frame in the moving average of the PSR, "
+                                            "in (0, 1].",
+                                            DoubleValue(0.1),
+                                            MakeDoubleAccessor(&ClassAEndDeviceLorawanMac::SetLinkStatisticsEwmaAlpha,
+                                                               &ClassAEndDeviceLorawanMac::GetLinkStatisticsEwmaAlpha),
+                                            // A zero weight would freeze the average
+                                            MakeDoubleChecker<double>(std::numeric_limits<double>::min(), 1))
                               .AddAttribute("TotalPowerConsumption",
                                             "Total accumulated power consumption of this node.",
                                             DoubleValue(false),
@@ -83,6 +108,15 @@ namespace ns3
                                             IntegerValue(false),
                                             MakeIntegerAccessor(&ClassAEndDeviceLorawanMac::TransmissionsSent),
                                             MakeIntegerChecker<uint32_t>())
+                              .AddAttribute("AnalyticalReceiveWindows",
+                                            "Whether to account for the receive windows of an uplink no downlink can "
+                                            "answer without opening them. The network server is asked for pending "
+                                            "downlinks before it receives the uplink, so only confirmed, ADR and "
+                                            "LinkCheckReq uplinks are known to trigger a reply: do not enable with "
+                                            "network server components that answer other uplinks.",
+                                            BooleanValue(false),
+                                            MakeBooleanAccessor(&ClassAEndDeviceLorawanMac::m_analyticalReceiveWindows),
+                                            MakeBooleanChecker())
                               .AddAttribute("Location_X", "Location X",
                                             DoubleValue(0),
                                             MakeDoubleAccessor( &ClassAEndDeviceLorawanMac::setXPosition,
@@ -102,7 +136,9 @@ namespace ns3
                                                              m_receiveDelay1(Seconds(1)),
                                                              // LoraWAN default
                                                              m_receiveDelay2(Seconds(2)),
-                                                             m_rx1DrOffset(0)
+                                                             m_rx1DrOffset(0),
+                                                             m_analyticalReceiveWindows(false),
+                                                             m_analyticalWindowsEnd(Seconds(0))
     {
       NS_LOG_FUNCTION(this);
 
@@ -164,7 +200,6 @@ namespace ns3
     ClassAEndDeviceLorawanMac::SendToPhy(Ptr<Packet> packetToSend)
     {
       TransmissionsSent++;
-      PacketErrorRate = static_cast<float>(UnacknowledgedTransmissions) / static_cast<float>(TransmissionsSent);
 
       //std::cout << "Sent " << +TransmissionsSent << " Transmissions." << std::endl;
 
@@ -193,6 +228,17 @@ namespace ns3
 
       if (useGeneticParamaterSelection)
       {
+        // Nothing has been evaluated yet in this run: start from the seeds, if any.
+        if (m_geneticSeedPending && !m_geneticSeedCallback.IsNull())
+        {
+          m_geneticSeedPending = false;
+          std::vector<Ptr<TransmissionParameterSet>> seeds = m_geneticSeedCallback(m_address);
+          if (!seeds.empty())
+          {
+            geneticTXParameterOptimizer->Initialize(seeds);
+          }
+        }
+
         if(geneticTXParameterOptimizer->IsOptimizing()) {
           SetMType(LorawanMacHeader::CONFIRMED_DATA_UP);
         }else{
@@ -210,33 +256,10 @@ namespace ns3
         //This is PROBABLY unecessary. ADRACKREQ's require datarates to be set like this, but the device
         //  should still be able to listen without messing around with DR stuff.  
         //Let's remove this chunk and see if things still work w/o adr.
-        if (params.sf == 12)
-        {
-          m_dataRate = 0;
-        }
-        if (params.sf == 11)
-        {
-          m_dataRate = 1;
-        }
-        if (params.sf == 10)
-        {
-          m_dataRate = 2;
-        }
-        if (params.sf == 9)
-        {
-          m_dataRate = 3;
-        }
-        if (params.sf == 8)
+        uint8_t dataRate = Eu868Region::GetDataRate(params.sf, params.bandwidthHz);
+        if (dataRate != INVALID_DATA_RATE)
         {
-          m_dataRate = 4;
-        }
-        if (params.sf == 7 && params.bandwidthHz == 125000)
-        {
-          m_dataRate = 5;
-        }
-        if (params.sf == 7 && params.bandwidthHz == 250000)
-        {
-          m_dataRate = 6;
+          m_dataRate = dataRate;
         }
       }
       else
@@ -464,6 +487,27 @@ namespace ns3
     {
       //NS_LOG_FUNCTION_NOARGS ();
 
+      if (CanSkipReceiveWindows())
+      {
+        Ptr<EndDeviceLoraPhy> phy = m_phy->GetObject<EndDeviceLoraPhy>();
+        phy->SwitchToSleep();
+
+        // Both windows would have closed empty: charge the time they would
+        // have spent in standby and end the transmission right away.
+        double tSym1 = pow(2, GetSfFromDataRate(GetFirstReceiveWindowDataRate())) / GetBandwidthFromDataRate(GetFirstReceiveWindowDataRate());
+        double tSym2 = pow(2, GetSfFromDataRate(GetSecondReceiveWindowDataRate())) / GetBandwidthFromDataRate(GetSecondReceiveWindowDataRate());
+        Time secondWindowDuration = Seconds(m_receiveWindowDurationInSymbols * tSym2);
+        phy->AccountStandbyInterval(Seconds(m_receiveWindowDurationInSymbols * tSym1) + secondWindowDuration);
+        m_analyticalWindowsEnd = Simulator::Now() + m_receiveDelay2 + secondWindowDuration;
+
+        NS_LOG_DEBUG("No downlink can follow: receive windows accounted until " << m_analyticalWindowsEnd.GetSeconds());
+
+        uint8_t txs = m_maxNumbTx - (m_retxParams.retxLeft);
+        m_requiredTxCallback(txs, true, m_retxParams.firstAttempt, m_retxParams.packet);
+        resetRetransmissionParameters();
+        return;
+      }
+
       // Schedule the opening of the first receive window
       Simulator::Schedule(m_receiveDelay1,
                           &ClassAEndDeviceLorawanMac::OpenFirstReceiveWindow, this);
@@ -485,6 +529,21 @@ namespace ns3
       m_phy->GetObject<EndDeviceLoraPhy>()->SwitchToSleep();
     }
 
+    bool
+    ClassAEndDeviceLorawanMac::CanSkipReceiveWindows(void)
+    {
+      // Replies to confirmed traffic, to ADR and to MAC commands are decided
+      // by the NS after it receives this uplink, so they can not be known yet:
+      // the oracle below only knows about downlinks that are already waiting.
+      // Any other reply triggered by this uplink is not covered by these flags.
+      return m_analyticalReceiveWindows &&
+             !m_retxParams.waitingAck &&
+             !m_controlDataRate &&
+             !m_uplinkRequestsReply &&
+             !m_downlinkPendingCallback.IsNull() &&
+             !m_downlinkPendingCallback(m_address);
+    }
+
     void
     ClassAEndDeviceLorawanMac::OpenFirstReceiveWindow(void)
     {
@@ -640,12 +699,9 @@ namespace ns3
     {
       setLastFrameSuccess(false);
 
-      UnacknowledgedTransmissions++;
-      PacketErrorRate = static_cast<float>(UnacknowledgedTransmissions) / static_cast<float>(TransmissionsSent);
-
       if (useGeneticParamaterSelection)
       {
-        geneticTXParameterOptimizer->SetCurrentTransmissionParameterSetSuccess(false);
+        setGeneticTransmissionSuccess(false);
       }
     }
 
@@ -658,32 +714,78 @@ namespace ns3
       {
 
         NS_LOG_INFO("Successfully Recieved Ack from Transmission with fitness: " << geneticTXParameterOptimizer->GetCurrentTransmissionParameterSet()->fitness());
-        geneticTXParameterOptimizer->SetCurrentTransmissionParameterSetSuccess(true);
+        setGeneticTransmissionSuccess(true);
       }
     }
 
     void
-    ClassAEndDeviceLorawanMac::setLastFrameSuccess(bool success)
+    ClassAEndDeviceLorawanMac::setGeneticTransmissionSuccess(bool success)
     {
-      for (int i = 0; i < 31; i++)
+      bool wasOptimizing = geneticTXParameterOptimizer->IsOptimizing();
+      geneticTXParameterOptimizer->SetCurrentTransmissionParameterSetSuccess(success);
+      if (wasOptimizing && !geneticTXParameterOptimizer->IsOptimizing())
       {
-        lastNTransmissionSuccess[i] = lastNTransmissionSuccess[i + 1];
+        m_geneticConverged(m_address, geneticTXParameterOptimizer->GetCurrentTransmissionParameterSet());
       }
-      lastNTransmissionSuccess[31] = success;
-      if (TransmissionsSent.Get() >= 32)
+    }
+
+    void
+    ClassAEndDeviceLorawanMac::SetGeneticSeedCallback(Callback<std::vector<Ptr<TransmissionParameterSet>>, LoraDeviceAddress> callback)
+    {
+      m_geneticSeedCallback = callback;
+    }
+
+    void
+    ClassAEndDeviceLorawanMac::SetDownlinkPendingCallback(Callback<bool, LoraDeviceAddress> callback)
+    {
+      m_downlinkPendingCallback = callback;
+    }
+
+    void
+    ClassAEndDeviceLorawanMac::setLastFrameSuccess(bool success)
+    {
+      // The traced values are views of the link statistics
+      m_linkStatistics.AddOutcome(success);
+      PacketErrorRate = m_linkStatistics.GetTotalErrorRate();
+      m_successRateEwma = m_linkStatistics.GetSuccessRateEwma();
+      if (m_linkStatistics.IsWindowFull())
       {
-        double successful = 0;
-        for (int i = 0; i < 32; i++)
-        {
-          if (lastNTransmissionSuccess[i] == true)
-          {
-            successful += 1.0;
-          }
-        }
-        lastNPacketSuccessRate = successful / 32.0;
+        lastNPacketSuccessRate = m_linkStatistics.GetWindowSuccessRate();
       }
     }
 
+    void
+    ClassAEndDeviceLorawanMac::SetLinkStatisticsWindow(uint32_t window)
+    {
+      m_linkStatistics.SetWindow(window);
+      PacketErrorRate = m_linkStatistics.GetTotalErrorRate();
+      m_successRateEwma = m_linkStatistics.GetSuccessRateEwma();
+    }
+
+    uint32_t
+    ClassAEndDeviceLorawanMac::GetLinkStatisticsWindow(void) const
+    {
+      return m_linkStatistics.GetWindow();
+    }
+
+    void
+    ClassAEndDeviceLorawanMac::SetLinkStatisticsEwmaAlpha(double alpha)
+    {
+      m_linkStatistics.SetEwmaAlpha(alpha);
+    }
+
+    double
+    ClassAEndDeviceLorawanMac::GetLinkStatisticsEwmaAlpha(void) const
+    {
+      return m_linkStatistics.GetEwmaAlpha();
+    }
+
+    uint32_t
+    ClassAEndDeviceLorawanMac::GetFailedTransmissionCount(void) const
+    {
+      return m_linkStatistics.GetTotalFailures();
+    }
+
     /////////////////////////
     // Getters and Setters //
     /////////////////////////
@@ -711,6 +813,12 @@ namespace ns3
           NS_LOG_DEBUG("Duration until endSecondRxWindow for new transmission:" << (endSecondRxWindow - Simulator::Now()).GetSeconds());
           waitingTime = std::max(waitingTime, endSecondRxWindow - Simulator::Now());
         }
+        else if (m_analyticalWindowsEnd > Simulator::Now())
+        {
+          NS_LOG_WARN("Attempting to send during analytical receive windows:"
+                      << " Transmission postponed.");
+          waitingTime = std::max(waitingTime, m_analyticalWindowsEnd - Simulator::Now());
+        }
       }
       // This is a retransmitted packet, it can not be sent until the end of
       // ACK_TIMEOUT (this timer starts when the second receive window was open)
@@ -757,6 +865,12 @@ namespace ns3
       return m_secondReceiveWindowFrequency;
     }
 
+    Time
+    ClassAEndDeviceLorawanMac::GetReceiveDelay(int window) const
+    {
+      return window == 1 ? m_receiveDelay1 : m_receiveDelay2;
+    }
+
     /////////////////////////
     // MAC command methods //
     /////////////////////////
@@ -794,8 +908,8 @@ namespace ns3
 
       // Craft a RxParamSetupAns as response
       //NS_LOG_INFO ("Adding RxParamSetupAns reply");
-      m_macCommandList.push_back(CreateObject<RxParamSetupAns>(offsetOk,
-                                                               dataRateOk, true));
+      m_macCommandList.Add(MacCommandValue::CreateRxParamSetupAns(offsetOk,
+                                                                  dataRateOk, true));
     }
 
   } /* namespace lorawan */
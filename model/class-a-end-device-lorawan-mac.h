@@ -33,6 +33,7 @@
 #include "ns3/trace-source-accessor.h"
 #include "ns3/genetic-tx-parameter-optimizer.h"
 #include "ns3/transmission-parameter-set.h"
+#include "ns3/link-statistics.h"
 #include "ns3/string.h"
 #include "lora-utils.h"
 #include "ns3/simulator.h"
@@ -161,9 +162,57 @@ public:
    */
   double GetSecondReceiveWindowFrequency (void);
 
+  /**
+   * Get the delay between the end of an uplink and the opening of one of its
+   * receive windows.
+   *
+   * \param window The window number (1 or 2).
+   * \return The delay.
+   */
+  Time GetReceiveDelay (int window) const;
+
   // Called when an acknowledgement is requested but none is recieved.
   void AckNotRecieved (void);
 
+  /**
+   * Set the number of most recent frames the LastNPSR is computed on. This
+   * discards the outcomes recorded so far.
+   */
+  void SetLinkStatisticsWindow (uint32_t window);
+  uint32_t GetLinkStatisticsWindow (void) const;
+
+  void SetLinkStatisticsEwmaAlpha (double alpha);
+  double GetLinkStatisticsEwmaAlpha (void) const;
+
+  /**
+   * Get the number of frames that were not acknowledged, as recorded by the
+   * link statistics.
+   */
+  uint32_t GetFailedTransmissionCount (void) const;
+
+  /**
+   * Set the callback used to fetch the initial population of the genetic
+   * optimizer before the first uplink (e.g., the genomes that converged at
+   * neighbouring devices).
+   */
+  void SetGeneticSeedCallback (Callback<std::vector<Ptr<TransmissionParameterSet> >, LoraDeviceAddress> callback);
+
+  /**
+   * Set the callback used to ask the network server whether a downlink is
+   * already waiting for this device. It is only used when the
+   * AnalyticalReceiveWindows attribute is set.
+   */
+  void SetDownlinkPendingCallback (Callback<bool, LoraDeviceAddress> callback);
+
+  /**
+   * TracedCallback signature for the convergence of the genetic optimizer.
+   *
+   * \param address The address of this device.
+   * \param tps The most fit transmission parameter set.
+   */
+  typedef void (*GeneticConvergedTracedCallback)(LoraDeviceAddress address,
+                                                 Ptr<const TransmissionParameterSet> tps);
+
   /////////////////////////
   // MAC command methods //
   /////////////////////////
@@ -239,17 +288,51 @@ private:
   TracedValue<float> m_lastFitnessLevel = 0;
 
   TracedValue<uint32_t> TransmissionsSent = 0;
-  TracedValue<uint32_t> UnacknowledgedTransmissions = 0;
   TracedValue<double> PacketErrorRate = 0;
   TracedValue<double> TotalPowerConsumption = 0;
   
   Ptr<GeneticTXParameterOptimizer> geneticTXParameterOptimizer;
 
+  // Forward the outcome of a transmission to the genetic optimizer.
+  void setGeneticTransmissionSuccess (bool success);
+
+  /**
+   * Whether receive windows that can not contain a downlink are accounted for
+   * without scheduling their events.
+   */
+  bool m_analyticalReceiveWindows;
+
+  /**
+   * The end of the last pair of receive windows that was accounted for
+   * analytically.
+   */
+  Time m_analyticalWindowsEnd;
+
+  Callback<bool, LoraDeviceAddress> m_downlinkPendingCallback;
+
+  /**
+   * Whether no downlink can be sent in the windows following the current
+   * uplink.
+   *
+   * The network server is asked through m_downlinkPendingCallback when the
+   * transmission ends, before it has received the uplink. Replies triggered by
+   * the uplink itself are therefore invisible to it, and are only excluded by
+   * the uplink's own flags: a confirmed uplink, the ADR bit and a pending
+   * LinkCheckReq. Any other reply the network server decides upon receiving
+   * the uplink is missed by a device that skips its windows.
+   */
+  bool CanSkipReceiveWindows (void);
+
+  Callback<std::vector<Ptr<TransmissionParameterSet> >, LoraDeviceAddress> m_geneticSeedCallback;
+  bool m_geneticSeedPending = true;
+  TracedCallback<LoraDeviceAddress, Ptr<const TransmissionParameterSet> > m_geneticConverged;
+
   //this keeps track of the last transmission parameters for logging.
   LoraTxParameters lastParams;
 
-  bool lastNTransmissionSuccess[32];
+  LinkStatistics m_linkStatistics;
   TracedValue<double> lastNPacketSuccessRate = 0;
+  TracedValue<double> m_successRateEwma = 0;
   void setLastFrameSuccess(bool success);
 
 
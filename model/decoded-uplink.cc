@@ -0,0 +1,48 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/decoded-uplink.h"
+#include "ns3/lora-tag.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("DecodedUplink");
+
+DecodedUplink::DecodedUplink (Ptr<const Packet> packet, const Address &gatewayAddress) :
+  packet (packet),
+  gatewayAddress (gatewayAddress),
+  receiveTime (Simulator::Now ())
+{
+  NS_LOG_FUNCTION (this << packet << gatewayAddress);
+
+  // The MAC header can be peeked, but the frame header follows it
+  Ptr<Packet> copy = packet->Copy ();
+  copy->RemoveHeader (macHeader);
+  frameHeader.SetAsUplink ();
+  copy->PeekHeader (frameHeader);
+
+  LoraTag tag;
+  packet->PeekPacketTag (tag);
+  sf = tag.GetSpreadingFactor ();
+  frequency = tag.GetFrequency ();
+  receivePower = tag.GetReceivePower ();
+}
+
+} // namespace lorawan
+} // namespace ns3
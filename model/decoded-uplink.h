@@ -0,0 +1,60 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef DECODED_UPLINK_H
+#define DECODED_UPLINK_H
+
+#include "ns3/packet.h"
+#include "ns3/address.h"
+#include "ns3/nstime.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/lora-frame-header.h"
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * An uplink received by the network server, with its headers and reception
+ * metadata decoded.
+ *
+ * The NetworkServer builds one for each packet a gateway forwards and passes
+ * it to the scheduler, the status and the controller components, so that the
+ * packet is copied and parsed once per reception.
+ */
+struct DecodedUplink
+{
+  /**
+   * Decode a packet forwarded by a gateway.
+   *
+   * \param packet The packet, as received from the gateway.
+   * \param gatewayAddress The address of the gateway.
+   */
+  DecodedUplink (Ptr<const Packet> packet, const Address &gatewayAddress);
+
+  Ptr<const Packet> packet;       //!< The packet, headers included
+  LorawanMacHeader macHeader;     //!< The MAC header of the packet
+  LoraFrameHeader frameHeader;    //!< The frame header, MAC commands included
+  uint8_t sf;                     //!< The SF from the LoraTag
+  double frequency;               //!< The frequency from the LoraTag
+  double receivePower;            //!< The gateway receive power from the LoraTag
+  Address gatewayAddress;         //!< The gateway that forwarded the packet
+  Time receiveTime;               //!< The time the server received the packet
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* DECODED_UPLINK_H */
@@ -0,0 +1,180 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef DENSE_INDEX_H
+#define DENSE_INDEX_H
+
+#include "ns3/address.h"
+#include "ns3/lora-device-address.h"
+#include <vector>
+#include <stdint.h>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Hash of a LoraDeviceAddress, for use with DenseIndex.
+ */
+struct LoraDeviceAddressHash
+{
+  uint32_t operator() (const LoraDeviceAddress &address) const
+  {
+    // Fibonacci hashing spreads consecutive addresses over the table
+    return address.Get () * 2654435761u;
+  }
+};
+
+/**
+ * Hash of an Address, for use with DenseIndex.
+ */
+struct AddressHash
+{
+  uint32_t operator() (const Address &address) const
+  {
+    // FNV-1a over the address bytes
+    uint8_t buffer[Address::MAX_SIZE];
+    uint32_t length = address.CopyTo (buffer);
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++)
+      {
+        hash = (hash ^ buffer[i]) * 16777619u;
+      }
+    return hash;
+  }
+};
+
+/**
+ * Hash of a packet UID, for use with DenseIndex.
+ */
+struct PacketUidHash
+{
+  uint32_t operator() (uint64_t uid) const
+  {
+    // Take the high bits of a Fibonacci hash, since DenseIndex keeps the low
+    // ones
+    return (uid * 11400714819323198485ull) >> 32;
+  }
+};
+
+/**
+ * Map keys to the dense indices 0, 1, ... N-1, in order of insertion.
+ *
+ * Lookups go through an open addressing hash table with linear probing,
+ * which is kept at most half full. Keys can't be removed, so that the indices
+ * can be used to address contiguous arrays of per-key data.
+ */
+template <typename Key, typename Hash>
+class DenseIndex
+{
+public:
+  static const uint32_t NOT_FOUND = 0xffffffff;
+
+  DenseIndex () : m_slots (16, NOT_FOUND)
+  {
+  }
+
+  /**
+   * Get the index of a key.
+   *
+   * \return The index, or NOT_FOUND if the key was never inserted.
+   */
+  uint32_t Find (const Key &key) const
+  {
+    uint32_t mask = m_slots.size () - 1;
+    for (uint32_t slot = Hash () (key) & mask; ; slot = (slot + 1) & mask)
+      {
+        uint32_t index = m_slots[slot];
+        if (index == NOT_FOUND || m_keys[index] == key)
+          {
+            return index;
+          }
+      }
+  }
+
+  /**
+   * Insert a key, if it isn't there already.
+   *
+   * \return The index of the key.
+   */
+  uint32_t Insert (const Key &key)
+  {
+    uint32_t index = Find (key);
+    if (index != NOT_FOUND)
+      {
+        return index;
+      }
+
+    index = m_keys.size ();
+    m_keys.push_back (key);
+    if (2 * m_keys.size () > m_slots.size ())
+      {
+        Rehash (2 * m_slots.size ());
+      }
+    else
+      {
+        Place (index);
+      }
+    return index;
+  }
+
+  /**
+   * Get the key at an index.
+   */
+  const Key &GetKey (uint32_t index) const
+  {
+    return m_keys[index];
+  }
+
+  /**
+   * Get the number of keys in the index.
+   */
+  uint32_t GetN (void) const
+  {
+    return m_keys.size ();
+  }
+
+private:
+  void Place (uint32_t index)
+  {
+    uint32_t mask = m_slots.size () - 1;
+    uint32_t slot = Hash () (m_keys[index]) & mask;
+    while (m_slots[slot] != NOT_FOUND)
+      {
+        slot = (slot + 1) & mask;
+      }
+    m_slots[slot] = index;
+  }
+
+  void Rehash (uint32_t nSlots)
+  {
+    m_slots.assign (nSlots, NOT_FOUND);
+    for (uint32_t index = 0; index < m_keys.size (); index++)
+      {
+        Place (index);
+      }
+  }
+
+  std::vector<uint32_t> m_slots;  //!< Hash table of indices into m_keys
+  std::vector<Key> m_keys;        //!< Keys, by index
+};
+
+template <typename Key, typename Hash>
+const uint32_t DenseIndex<Key, Hash>::NOT_FOUND;
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* DENSE_INDEX_H */
@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/direct-backhaul.h"
+#include "ns3/mac48-address.h"
+#include "ns3/pointer.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("DirectBackhaul");
+
+NS_OBJECT_ENSURE_REGISTERED (DirectBackhaul);
+
+TypeId
+DirectBackhaul::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::DirectBackhaul")
+    .SetParent<Object> ()
+    .AddConstructor<DirectBackhaul> ()
+    .AddAttribute ("Latency",
+                   "The time it takes a packet to reach the other side, in "
+                   "seconds",
+                   StringValue ("ns3::ConstantRandomVariable[Constant=0.002]"),
+                   MakePointerAccessor (&DirectBackhaul::m_latency),
+                   MakePointerChecker<RandomVariableStream> ())
+    .SetGroupName ("lorawan");
+  return tid;
+}
+
+DirectBackhaul::DirectBackhaul () :
+  m_address (Mac48Address::Allocate ())
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DirectBackhaul::~DirectBackhaul ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+Address
+DirectBackhaul::GetAddress (void) const
+{
+  return m_address;
+}
+
+void
+DirectBackhaul::SetNetworkServerCallback (NetDevice::ReceiveCallback callback)
+{
+  m_networkServerCallback = callback;
+}
+
+void
+DirectBackhaul::SetGatewayCallback (NetDevice::ReceiveCallback callback)
+{
+  m_gatewayCallback = callback;
+}
+
+void
+DirectBackhaul::SendToNetworkServer (Ptr<const Packet> packet)
+{
+  NS_LOG_FUNCTION (this << packet);
+
+  NS_ASSERT_MSG (!m_networkServerCallback.IsNull (),
+                 "Gateway is not connected to a network server");
+  Simulator::Schedule (Seconds (m_latency->GetValue ()), &DirectBackhaul::Deliver,
+                       this, m_networkServerCallback, packet);
+}
+
+void
+DirectBackhaul::SendToGateway (Ptr<const Packet> packet)
+{
+  NS_LOG_FUNCTION (this << packet);
+
+  NS_ASSERT_MSG (!m_gatewayCallback.IsNull (),
+                 "No Forwarder is installed on the gateway");
+  Simulator::Schedule (Seconds (m_latency->GetValue ()), &DirectBackhaul::Deliver,
+                       this, m_gatewayCallback, packet);
+}
+
+int64_t
+DirectBackhaul::AssignStreams (int64_t stream)
+{
+  m_latency->SetStream (stream);
+  return 1;
+}
+
+void
+DirectBackhaul::Deliver (NetDevice::ReceiveCallback callback, Ptr<const Packet> packet)
+{
+  NS_LOG_FUNCTION (this << packet);
+
+  callback (0, packet, 0x800, m_address);
+}
+
+} // namespace lorawan
+} // namespace ns3
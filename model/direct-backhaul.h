@@ -0,0 +1,97 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef DIRECT_BACKHAUL_H
+#define DIRECT_BACKHAUL_H
+
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/address.h"
+#include "ns3/net-device.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * An in-process link between a gateway and the network server.
+ *
+ * Packets are handed to the other side through a callback after a latency
+ * drawn from a random variable, instead of going through a pair of
+ * PointToPointNetDevices and their channel. This is enough when the backhaul
+ * is not the object of the study, and costs one event per packet.
+ *
+ * The NetworkServerHelper aggregates a DirectBackhaul to each gateway node
+ * when the direct backhaul is enabled, and the ForwarderHelper connects the
+ * gateway's Forwarder to it.
+ */
+class DirectBackhaul : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  DirectBackhaul ();
+  virtual ~DirectBackhaul ();
+
+  /**
+   * Get the address that identifies the gateway at the network server.
+   */
+  Address GetAddress (void) const;
+
+  /**
+   * Set the callback that receives uplinks at the network server.
+   *
+   * The callback is given a null NetDevice and the address of the gateway.
+   */
+  void SetNetworkServerCallback (NetDevice::ReceiveCallback callback);
+
+  /**
+   * Set the callback that receives downlinks at the gateway.
+   *
+   * The callback is given a null NetDevice and the address of the gateway.
+   */
+  void SetGatewayCallback (NetDevice::ReceiveCallback callback);
+
+  /**
+   * Send a packet from the gateway to the network server.
+   */
+  void SendToNetworkServer (Ptr<const Packet> packet);
+
+  /**
+   * Send a packet from the network server to the gateway.
+   */
+  void SendToGateway (Ptr<const Packet> packet);
+
+  /**
+   * Assign a fixed random variable stream number to the latency.
+   *
+   * \return The number of streams that were assigned.
+   */
+  int64_t AssignStreams (int64_t stream);
+
+private:
+  void Deliver (NetDevice::ReceiveCallback callback, Ptr<const Packet> packet);
+
+  Address m_address;   //!< Address of the gateway at the network server
+  Ptr<RandomVariableStream> m_latency;  //!< Latency of each packet, in seconds
+  NetDevice::ReceiveCallback m_networkServerCallback;
+  NetDevice::ReceiveCallback m_gatewayCallback;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* DIRECT_BACKHAUL_H */
@@ -39,6 +39,11 @@ EndDeviceLoraPhyListener::~EndDeviceLoraPhyListener ()
 {
 }
 
+void
+EndDeviceLoraPhyListener::NotifyStandbyInterval (Time duration)
+{
+}
+
 TypeId
 EndDeviceLoraPhy::GetTypeId (void)
 {
@@ -176,6 +181,20 @@ EndDeviceLoraPhy::SwitchToSleep (void)
     }
 }
 
+void
+EndDeviceLoraPhy::AccountStandbyInterval (Time duration)
+{
+  NS_LOG_FUNCTION (this << duration);
+
+  NS_ASSERT (m_state == SLEEP);
+
+  // Notify listeners of the interval
+  for (Listeners::const_iterator i = m_listeners.begin (); i != m_listeners.end (); i++)
+    {
+      (*i)->NotifyStandbyInterval (duration);
+    }
+}
+
 EndDeviceLoraPhy::State
 EndDeviceLoraPhy::GetState (void)
 {
@@ -79,6 +79,15 @@ public:
    * Notify listeners that we woke up
    */
   virtual void NotifyStandby (void) = 0;
+
+  /**
+   * Notify listeners that we spent an interval in STANDBY that was accounted
+   * for without switching state, while sleeping. The default implementation
+   * does nothing.
+   *
+   * \param duration the time that would have been spent in STANDBY.
+   */
+  virtual void NotifyStandbyInterval (Time duration);
 };
 
 /**
@@ -208,6 +217,15 @@ public:
    */
   void SwitchToSleep (void);
 
+  /**
+   * Account for an interval spent in STANDBY without actually leaving SLEEP,
+   * by notifying the listeners. This lets the MAC skip scheduling receive
+   * windows it knows will be empty.
+   *
+   * \param duration The time that would have been spent in STANDBY.
+   */
+  void AccountStandbyInterval (Time duration);
+
   /**
    * Add the input listener to the list of objects to be notified of PHY-level
    * events.
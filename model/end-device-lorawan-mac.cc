@@ -122,6 +122,7 @@ EndDeviceLorawanMac::EndDeviceLorawanMac ()
       m_receiveWindowDurationInSymbols (8),
       // LoraWAN default
       m_controlDataRate (false),
+      m_uplinkRequestsReply (false),
       m_lastKnownLinkMargin (0),
       m_lastKnownGatewayCount (0),
       m_aggregatedDutyCycle (1),
@@ -231,7 +232,7 @@ EndDeviceLorawanMac::DoSend (Ptr<Packet> packet)
                    " bytes.");
 
       // Check that MACPayload length is below the allowed maximum
-      if (packet->GetSize () > m_maxAppPayloadForDataRate.at (m_dataRate))
+      if (packet->GetSize () > GetMaxAppPayloadForDataRate (m_dataRate))
         {
           NS_LOG_WARN ("Attempting to send a packet larger than the maximum allowed"
                        << " size at this DataRate (DR" << unsigned(m_dataRate) <<
@@ -245,8 +246,9 @@ EndDeviceLorawanMac::DoSend (Ptr<Packet> packet)
       ApplyNecessaryOptions (macHdr);
       packet->AddHeader (macHdr);
 
-      // Reset MAC command list
-      m_macCommandList.clear ();
+      // Remember whether the NS will have to answer, then reset MAC command list
+      m_uplinkRequestsReply = m_macCommandList.Find (LINK_CHECK_REQ) != 0;
+      m_macCommandList.Clear ();
 
       if (m_retxParams.waitingAck)
         {
@@ -369,23 +371,19 @@ EndDeviceLorawanMac::ParseCommands (LoraFrameHeader frameHeader)
         }
     }
 
-  std::list<Ptr<MacCommand> > commands = frameHeader.GetCommands ();
-  std::list<Ptr<MacCommand> >::iterator it;
-  for (it = commands.begin (); it != commands.end (); it++)
+  const MacCommandList &commands = frameHeader.GetCommandValues ();
+  for (auto it = commands.begin (); it != commands.end (); it++)
     {
       NS_LOG_DEBUG ("Iterating over the MAC commands...");
-      enum MacCommandType type = (*it)->GetCommandType ();
+      enum MacCommandType type = it->GetCommandType ();
       switch (type)
         {
         case (LINK_CHECK_ANS):
           {
             NS_LOG_DEBUG ("Detected a LinkCheckAns command.");
 
-            // Cast the command
-            Ptr<LinkCheckAns> linkCheckAns = (*it)->GetObject<LinkCheckAns> ();
-
             // Call the appropriate function to take action
-            OnLinkCheckAns (linkCheckAns->GetMargin (), linkCheckAns->GetGwCnt ());
+            OnLinkCheckAns (it->GetMargin (), it->GetGwCnt ());
 
             break;
           }
@@ -393,13 +391,18 @@ EndDeviceLorawanMac::ParseCommands (LoraFrameHeader frameHeader)
           {
             NS_LOG_DEBUG ("Detected a LinkAdrReq command.");
 
-            // Cast the command
-            Ptr<LinkAdrReq> linkAdrReq = (*it)->GetObject<LinkAdrReq> ();
+            std::list<int> enabledChannels;
+            for (int i = 0; i < 16; i++)
+              {
+                if (it->GetChannelMask () & (0b1 << i))
+                  {
+                    enabledChannels.push_back (i);
+                  }
+              }
 
             // Call the appropriate function to take action
-            OnLinkAdrReq (linkAdrReq->GetDataRate (), linkAdrReq->GetTxPower (),
-                          linkAdrReq->GetEnabledChannelsList (),
-                          linkAdrReq->GetRepetitions ());
+            OnLinkAdrReq (it->GetDataRate (), it->GetTxPower (),
+                          enabledChannels, it->GetRepetitions ());
 
             break;
           }
@@ -407,11 +410,8 @@ EndDeviceLorawanMac::ParseCommands (LoraFrameHeader frameHeader)
           {
             NS_LOG_DEBUG ("Detected a DutyCycleReq command.");
 
-            // Cast the command
-            Ptr<DutyCycleReq> dutyCycleReq = (*it)->GetObject<DutyCycleReq> ();
-
             // Call the appropriate function to take action
-            OnDutyCycleReq (dutyCycleReq->GetMaximumAllowedDutyCycle ());
+            OnDutyCycleReq (it->GetMaximumAllowedDutyCycle ());
 
             break;
           }
@@ -419,11 +419,8 @@ EndDeviceLorawanMac::ParseCommands (LoraFrameHeader frameHeader)
           {
             NS_LOG_DEBUG ("Detected a RxParamSetupReq command.");
 
-            // Cast the command
-            Ptr<RxParamSetupReq> rxParamSetupReq = (*it)->GetObject<RxParamSetupReq> ();
-
             // Call the appropriate function to take action
-            OnRxParamSetupReq (rxParamSetupReq);
+            OnRxParamSetupReq (it->ToMacCommand ()->GetObject<RxParamSetupReq> ());
 
             break;
           }
@@ -431,9 +428,6 @@ EndDeviceLorawanMac::ParseCommands (LoraFrameHeader frameHeader)
           {
             NS_LOG_DEBUG ("Detected a DevStatusReq command.");
 
-            // Cast the command
-            Ptr<DevStatusReq> devStatusReq = (*it)->GetObject<DevStatusReq> ();
-
             // Call the appropriate function to take action
             OnDevStatusReq ();
 
@@ -443,11 +437,8 @@ EndDeviceLorawanMac::ParseCommands (LoraFrameHeader frameHeader)
           {
             NS_LOG_DEBUG ("Detected a NewChannelReq command.");
 
-            // Cast the command
-            Ptr<NewChannelReq> newChannelReq = (*it)->GetObject<NewChannelReq> ();
-
             // Call the appropriate function to take action
-            OnNewChannelReq (newChannelReq->GetChannelIndex (), newChannelReq->GetFrequency (), newChannelReq->GetMinDataRate (), newChannelReq->GetMaxDataRate ());
+            OnNewChannelReq (it->GetChannelIndex (), it->GetFrequency (), it->GetMinDataRate (), it->GetMaxDataRate ());
 
             break;
           }
@@ -492,7 +483,7 @@ EndDeviceLorawanMac::ApplyNecessaryOptions (LoraFrameHeader& frameHeader)
     {
       NS_LOG_INFO ("Applying a MAC Command of CID " <<
                    unsigned(MacCommand::GetCIDFromMacCommand
-                              (command->GetCommandType ())));
+                              (command.GetCommandType ())));
 
       frameHeader.AddCommand (command);
     }
@@ -539,27 +530,8 @@ EndDeviceLorawanMac::GetNextTransmissionDelay (void)
 
   //    Check duty cycle    //
 
-  // Pick a random channel to transmit on
-  std::vector<Ptr<LogicalLoraChannel> > logicalChannels;
-  logicalChannels = m_channelHelper.GetEnabledChannelList ();                 // Use a separate list to do the shuffle
-  //logicalChannels = Shuffle (logicalChannels);
-
-
-  Time waitingTime = Time::Max ();
-
-  // Try every channel
-  std::vector<Ptr<LogicalLoraChannel> >::iterator it;
-  for (it = logicalChannels.begin (); it != logicalChannels.end (); ++it)
-    {
-      // Pointer to the current channel
-      Ptr<LogicalLoraChannel> logicalChannel = *it;
-      double frequency = logicalChannel->GetFrequency ();
-
-      waitingTime = std::min (waitingTime, m_channelHelper.GetWaitingTime (logicalChannel));
-
-      NS_LOG_DEBUG ("Waiting time before the next transmission in channel with frequecy " <<
-                    frequency << " is = " << waitingTime.GetSeconds () << ".");
-    }
+  // Find the shortest waiting time among the enabled channels
+  Time waitingTime = m_channelHelper.GetMinimumWaitingTime ();
 
   waitingTime = GetNextClassTransmissionDelay (waitingTime);
 
@@ -571,58 +543,19 @@ EndDeviceLorawanMac::GetChannelForTx (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  // Pick a random channel to transmit on
-  std::vector<Ptr<LogicalLoraChannel> > logicalChannels;
-  logicalChannels = m_channelHelper.GetEnabledChannelList ();                 // Use a separate list to do the shuffle
-  logicalChannels = Shuffle (logicalChannels);
+  // Pick a random channel to transmit on. Duty cycle is registered on the
+  // channel's SubBand after the transmission, but is not enforced here.
+  Ptr<LogicalLoraChannel> logicalChannel =
+    m_channelHelper.GetRandomEnabledChannel (m_uniformRV, false);
 
-  // Try every channel
-  std::vector<Ptr<LogicalLoraChannel> >::iterator it;
-  for (it = logicalChannels.begin (); it != logicalChannels.end (); ++it)
+  if (logicalChannel)
     {
-      // Pointer to the current channel
-      Ptr<LogicalLoraChannel> logicalChannel = *it;
-      double frequency = logicalChannel->GetFrequency ();
-
-      NS_LOG_DEBUG ("Frequency of the current channel: " << frequency);
-
-      // Verify that we can send the packet
-      Time waitingTime = m_channelHelper.GetWaitingTime (logicalChannel);
-
+      NS_LOG_DEBUG ("Frequency of the current channel: " << logicalChannel->GetFrequency ());
       NS_LOG_DEBUG ("Waiting time for current channel = " <<
-                    waitingTime.GetSeconds ());
-      return *it;
-      // Send immediately if we can
-      if (waitingTime == Seconds (0))
-        {
-          return *it;
-        }
-      else
-        {
-          NS_LOG_DEBUG ("Packet cannot be immediately transmitted on " <<
-                        "the current channel because of duty cycle limitations.");
-        }
-    }
-  return 0;                 // In this case, no suitable channel was found
-}
-
-
-std::vector<Ptr<LogicalLoraChannel> >
-EndDeviceLorawanMac::Shuffle (std::vector<Ptr<LogicalLoraChannel> > vector)
-{
-  NS_LOG_FUNCTION_NOARGS ();
-
-  int size = vector.size ();
-
-  for (int i = 0; i < size; ++i)
-    {
-      uint16_t random = std::floor (m_uniformRV->GetValue (0, size));
-      Ptr<LogicalLoraChannel> temp = vector.at (random);
-      vector.at (random) = vector.at (i);
-      vector.at (i) = temp;
+                    m_channelHelper.GetWaitingTime (logicalChannel).GetSeconds ());
     }
 
-  return vector;
+  return logicalChannel;                 // 0 if no suitable channel was found
 }
 
 /////////////////////////
@@ -795,18 +728,11 @@ EndDeviceLorawanMac::OnLinkAdrReq (uint8_t dataRate, uint8_t txPower,
   if (channelMaskOk && dataRateOk && txPowerOk)
     {
       // Cycle over all channels in the list
-      for (uint32_t i = 0; i < m_channelHelper.GetChannelList ().size (); i++)
+      for (uint8_t i = 0; i < m_channelHelper.GetNChannels (); i++)
         {
-          if (std::find (enabledChannels.begin (), enabledChannels.end (), i) != enabledChannels.end ())
-            {
-              m_channelHelper.GetChannelList ().at (i)->SetEnabledForUplink ();
-              NS_LOG_DEBUG ("Channel " << i << " enabled");
-            }
-          else
-            {
-              m_channelHelper.GetChannelList ().at (i)->DisableForUplink ();
-              NS_LOG_DEBUG ("Channel " << i << " disabled");
-            }
+          bool enabled = std::find (enabledChannels.begin (), enabledChannels.end (), i) != enabledChannels.end ();
+          m_channelHelper.SetChannelEnabled (i, enabled);
+          NS_LOG_DEBUG ("Channel " << unsigned (i) << (enabled ? " enabled" : " disabled"));
         }
 
       // Set the data rate
@@ -818,8 +744,8 @@ EndDeviceLorawanMac::OnLinkAdrReq (uint8_t dataRate, uint8_t txPower,
   std::cout << "ADRLINKREQ: " << "SF: " << unsigned (sf) << ", BW: " << bw  << " TP:" << unsigned (txPower) << " CR: 1" << std::endl;
   // Craft a LinkAdrAns MAC command as a response
   ///////////////////////////////////////////////
-  m_macCommandList.push_back (CreateObject<LinkAdrAns> (txPowerOk, dataRateOk,
-                                                        channelMaskOk));
+  m_macCommandList.Add (MacCommandValue::CreateLinkAdrAns (txPowerOk, dataRateOk,
+                                                          channelMaskOk));
 }
 
 void
@@ -835,7 +761,7 @@ EndDeviceLorawanMac::OnDutyCycleReq (double dutyCycle)
 
   // Craft a DutyCycleAns as response
   NS_LOG_INFO ("Adding DutyCycleAns reply");
-  m_macCommandList.push_back (CreateObject<DutyCycleAns> ());
+  m_macCommandList.Add (MacCommandValue (DUTY_CYCLE_ANS));
 }
 
 void
@@ -861,7 +787,7 @@ EndDeviceLorawanMac::OnDevStatusReq (void)
 
   // Craft a RxParamSetupAns as response
   NS_LOG_INFO ("Adding DevStatusAns reply");
-  m_macCommandList.push_back (CreateObject<DevStatusAns> (battery, margin));
+  m_macCommandList.Add (MacCommandValue::CreateDevStatusAns (battery, margin));
 }
 
 void
@@ -879,8 +805,8 @@ EndDeviceLorawanMac::OnNewChannelReq (uint8_t chIndex, double frequency, uint8_t
   SetLogicalChannel (chIndex, frequency, minDataRate, maxDataRate);
 
   NS_LOG_INFO ("Adding NewChannelAns reply");
-  m_macCommandList.push_back (CreateObject<NewChannelAns> (dataRateRangeOk,
-                                                           channelFrequencyOk));
+  m_macCommandList.Add (MacCommandValue::CreateNewChannelAns (dataRateRangeOk,
+                                                             channelFrequencyOk));
 }
 
 void
@@ -931,7 +857,15 @@ EndDeviceLorawanMac::AddMacCommand (Ptr<MacCommand> macCommand)
 {
   NS_LOG_FUNCTION (this << macCommand);
 
-  m_macCommandList.push_back (macCommand);
+  m_macCommandList.Add (MacCommandValue::FromMacCommand (macCommand));
+}
+
+void
+EndDeviceLorawanMac::AddMacCommand (const MacCommandValue &macCommand)
+{
+  NS_LOG_FUNCTION (this << macCommand.GetCommandType ());
+
+  m_macCommandList.Add (macCommand);
 }
 
 uint8_t
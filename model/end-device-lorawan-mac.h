@@ -336,6 +336,12 @@ public:
    */
   void AddMacCommand (Ptr<MacCommand> macCommand);
 
+  /**
+   * Add a MAC command to the list of those that will be sent out in the next
+   * packet.
+   */
+  void AddMacCommand (const MacCommandValue &macCommand);
+
 protected:
   /**
    * Structure representing the parameters that will be used in the
@@ -412,7 +418,7 @@ protected:
   /**
    * List of the MAC commands that need to be applied to the next UL packet.
    */
-  std::list<Ptr<MacCommand> > m_macCommandList;
+  MacCommandList m_macCommandList;
 
   /* Structure containing the retransmission parameters
    * for this device.
@@ -420,8 +426,7 @@ protected:
   struct LoraRetxParameters m_retxParams;
 
   /**
-   * An uniform random variable, used by the Shuffle method to randomly reorder
-   * the channel list.
+   * An uniform random variable, used to pick a random channel to transmit on.
    */
   Ptr<UniformRandomVariable> m_uniformRV;
 
@@ -437,13 +442,6 @@ protected:
   TracedCallback<uint8_t, bool, Time, Ptr<Packet> > m_requiredTxCallback;
 
 private:
-  /**
-   * Randomly shuffle a Ptr<LogicalLoraChannel> vector.
-   *
-   * Used to pick a random channel on which to send the packet.
-   */
-  std::vector<Ptr<LogicalLoraChannel> > Shuffle (std::vector<Ptr<LogicalLoraChannel> > vector);
-
   /**
    * Find the minimum waiting time before the next possible transmission.
    */
@@ -454,6 +452,11 @@ private:
    */
   bool m_controlDataRate;
 
+  /**
+   * Whether the last uplink carried a MAC command the NS has to answer.
+   */
+  bool m_uplinkRequestsReply;
+
   /**
    * The event of retransmitting a packet in a consecutive moment if an ACK is not received.
    *
@@ -47,10 +47,11 @@ EndDeviceStatus::GetTypeId (void)
   return tid;
 }
 
+const uint32_t EndDeviceStatus::MAX_RANKED_GATEWAYS;
+
 EndDeviceStatus::EndDeviceStatus (LoraDeviceAddress endDeviceAddress,
                                   Ptr<ClassAEndDeviceLorawanMac> endDeviceMac)
-    : m_reply (EndDeviceStatus::Reply ()),
-      m_endDeviceAddress (endDeviceAddress),
+    : m_endDeviceAddress (endDeviceAddress),
       m_receivedPacketList (ReceivedPacketList ()),
       m_mac (endDeviceMac)
 {
@@ -62,13 +63,84 @@ EndDeviceStatus::EndDeviceStatus ()
   NS_LOG_FUNCTION_NOARGS ();
 
   // Initialize data structure
-  m_reply = EndDeviceStatus::Reply ();
   m_receivedPacketList = ReceivedPacketList ();
 }
 
 EndDeviceStatus::~EndDeviceStatus ()
 {
   NS_LOG_FUNCTION_NOARGS ();
+
+  // Give the entry back to a pool that may be shared with other devices
+  InitializeReply ();
+}
+
+/////////////////
+//  ReplyPool  //
+/////////////////
+
+const uint32_t EndDeviceStatus::ReplyPool::NONE;
+
+uint32_t
+EndDeviceStatus::ReplyPool::Acquire (void)
+{
+  if (m_free.empty ())
+    {
+      m_replies.push_back (Reply ());
+      return m_replies.size () - 1;
+    }
+
+  uint32_t index = m_free.back ();
+  m_free.pop_back ();
+  return index;
+}
+
+void
+EndDeviceStatus::ReplyPool::Release (uint32_t index)
+{
+  NS_ASSERT (index < m_replies.size ());
+
+  // Blank the entry now, so that the payload is freed and Acquire can hand it
+  // out as it is
+  m_replies[index] = Reply ();
+  m_free.push_back (index);
+}
+
+EndDeviceStatus::Reply &
+EndDeviceStatus::ReplyPool::Get (uint32_t index)
+{
+  NS_ASSERT (index < m_replies.size ());
+
+  return m_replies[index];
+}
+
+uint32_t
+EndDeviceStatus::ReplyPool::GetNPending (void) const
+{
+  return m_replies.size () - m_free.size ();
+}
+
+Ptr<Packet>
+EndDeviceStatus::ReplyPool::Serialize (const Reply &reply)
+{
+  uint32_t macHeaderSize = reply.macHeader.GetSerializedSize ();
+  uint32_t size = macHeaderSize + reply.frameHeader.GetSerializedSize ();
+
+  // The buffer only grows, to fit the largest headers seen so far
+  if (m_buffer.GetSize () < size)
+    {
+      m_buffer.AddAtEnd (size - m_buffer.GetSize ());
+    }
+  Buffer::Iterator start = m_buffer.Begin ();
+  reply.macHeader.Serialize (start);
+  start.Next (macHeaderSize);
+  reply.frameHeader.Serialize (start);
+
+  Ptr<Packet> packet = Create<Packet> (m_buffer.PeekData (), size);
+  if (reply.payload) // If it has APP data to send
+    {
+      packet->AddAtEnd (reply.payload);
+    }
+  return packet;
 }
 
 ///////////////
@@ -111,36 +183,17 @@ EndDeviceStatus::GetCompleteReplyPacket (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  // Start from reply payload
-  Ptr<Packet> replyPacket;
-  if (m_reply.payload) // If it has APP data to send
-    {
-      NS_LOG_DEBUG ("Crafting reply packet from existing payload");
-      replyPacket = m_reply.payload->Copy ();
-    }
-  else // If no APP data needs to be sent, use an empty payload
-    {
-      NS_LOG_DEBUG ("Crafting reply packet using an empty payload");
-      replyPacket = Create<Packet> (0);
-    }
+  Reply &reply = GetReply ();
 
-  // Add headers
-  m_reply.frameHeader.SetAddress (m_endDeviceAddress);
-  Ptr<Packet> lastPacket = GetLastPacketReceivedFromDevice ()->Copy ();
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  lastPacket->RemoveHeader (mHdr);
-  lastPacket->RemoveHeader (fHdr);
-  m_reply.frameHeader.SetFCnt (fHdr.GetFCnt ());
-  m_reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
-  replyPacket->AddHeader (m_reply.frameHeader);
-  replyPacket->AddHeader (m_reply.macHeader);
+  // Fill in the headers
+  reply.frameHeader.SetAddress (m_endDeviceAddress);
+  reply.frameHeader.SetFCnt (GetLastReceivedPacketInfo ().fCnt);
+  reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
 
-  NS_LOG_DEBUG ("Added MAC header" << m_reply.macHeader);
-  NS_LOG_DEBUG ("Added frame header" << m_reply.frameHeader);
+  NS_LOG_DEBUG ("Crafting reply packet with MAC header " << reply.macHeader <<
+                " and frame header " << reply.frameHeader);
 
-  return replyPacket;
+  return m_replyPool->Serialize (reply);
 }
 
 bool
@@ -148,28 +201,56 @@ EndDeviceStatus::NeedsReply (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  return m_reply.needsReply;
+  return HasReply () && m_replyPool->Get (m_replyIndex).needsReply;
+}
+
+bool
+EndDeviceStatus::HasReply (void) const
+{
+  return m_replyIndex != ReplyPool::NONE;
+}
+
+EndDeviceStatus::Reply &
+EndDeviceStatus::GetReply (void)
+{
+  if (!m_replyPool)
+    {
+      m_replyPool = Create<ReplyPool> ();
+    }
+  if (m_replyIndex == ReplyPool::NONE)
+    {
+      m_replyIndex = m_replyPool->Acquire ();
+    }
+  return m_replyPool->Get (m_replyIndex);
+}
+
+void
+EndDeviceStatus::SetReplyPool (Ptr<ReplyPool> replyPool)
+{
+  NS_ASSERT_MSG (!HasReply (), "Can't change the pool of a pending reply");
+
+  m_replyPool = replyPool;
 }
 
 LorawanMacHeader
 EndDeviceStatus::GetReplyMacHeader ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  return m_reply.macHeader;
+  return HasReply () ? GetReply ().macHeader : LorawanMacHeader ();
 }
 
 LoraFrameHeader
 EndDeviceStatus::GetReplyFrameHeader ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  return m_reply.frameHeader;
+  return HasReply () ? GetReply ().frameHeader : LoraFrameHeader ();
 }
 
 Ptr<Packet>
 EndDeviceStatus::GetReplyPayload (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  return m_reply.payload->Copy ();
+  return GetReply ().payload->Copy ();
 }
 
 Ptr<ClassAEndDeviceLorawanMac>
@@ -178,13 +259,19 @@ EndDeviceStatus::GetMac (void)
   return m_mac;
 }
 
-EndDeviceStatus::ReceivedPacketList
-EndDeviceStatus::GetReceivedPacketList ()
+const EndDeviceStatus::ReceivedPacketList &
+EndDeviceStatus::GetReceivedPacketList () const
 {
   NS_LOG_FUNCTION_NOARGS ();
   return m_receivedPacketList;
 }
 
+void
+EndDeviceStatus::ReserveReceivedPacketHistory (uint32_t depth)
+{
+  m_receivedPacketList.Reserve (depth);
+}
+
 void
 EndDeviceStatus::SetFirstReceiveWindowSpreadingFactor (uint8_t sf)
 {
@@ -217,21 +304,21 @@ void
 EndDeviceStatus::SetReplyMacHeader (LorawanMacHeader macHeader)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  m_reply.macHeader = macHeader;
+  GetReply ().macHeader = macHeader;
 }
 
 void
 EndDeviceStatus::SetReplyFrameHeader (LoraFrameHeader frameHeader)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  m_reply.frameHeader = frameHeader;
+  GetReply ().frameHeader = frameHeader;
 }
 
 void
 EndDeviceStatus::SetReplyPayload (Ptr<Packet> replyPayload)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  m_reply.payload = replyPayload;
+  GetReply ().payload = replyPayload;
 }
 
 ///////////////////////
@@ -239,115 +326,67 @@ EndDeviceStatus::SetReplyPayload (Ptr<Packet> replyPayload)
 ///////////////////////
 
 void
-EndDeviceStatus::InsertReceivedPacket (Ptr<Packet const> receivedPacket, const Address &gwAddress)
+EndDeviceStatus::InsertReceivedPacket (const DecodedUplink &uplink, uint32_t gatewayIndex)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  // Create a copy of the packet
-  Ptr<Packet> myPacket = receivedPacket->Copy ();
-
-  // Extract the headers
-  LorawanMacHeader macHdr;
-  myPacket->RemoveHeader (macHdr);
-
-  LoraFrameHeader frameHdr;
-  frameHdr.SetAsUplink ();
-  myPacket->RemoveHeader (frameHdr);
+  const Address &gwAddress = uplink.gatewayAddress;
+  uint16_t fCnt = uplink.frameHeader.GetFCnt ();
 
   // Update current parameters
-  LoraTag tag;
-  myPacket->RemovePacketTag (tag);
-  SetFirstReceiveWindowSpreadingFactor (tag.GetSpreadingFactor ());
-  SetFirstReceiveWindowFrequency (tag.GetFrequency ());
-
-  // Update Information on the received packet
-  ReceivedPacketInfo info;
-  info.sf = tag.GetSpreadingFactor ();
-  info.frequency = tag.GetFrequency ();
-  info.packet = receivedPacket;
+  SetFirstReceiveWindowSpreadingFactor (uplink.sf);
+  SetFirstReceiveWindowFrequency (uplink.frequency);
 
-  double rcvPower = tag.GetReceivePower ();
+  // Look for the packet in the history, since it could have been received
+  // by another GW already
+  ReceivedPacketInfo *info = m_receivedPacketList.Find (fCnt);
 
-  // Perform insertion in list, also checking that the packet isn't already in
-  // the list (it could have been received by another GW already)
-
-  // Start searching from the end
-  auto it = m_receivedPacketList.rbegin ();
-  for (; it != m_receivedPacketList.rend (); it++)
+  if (info)
     {
-      // Get the frame counter of the current packet to compare it with the
-      // newly received one
-      Ptr<Packet> packetCopy = ((*it).first)->Copy ();
-      LorawanMacHeader currentMacHdr;
-      packetCopy->RemoveHeader (currentMacHdr);
-      LoraFrameHeader currentFrameHdr;
-      frameHdr.SetAsUplink ();
-      packetCopy->RemoveHeader (currentFrameHdr);
-
-      NS_LOG_DEBUG ("Received packet's frame counter: " << unsigned(frameHdr.GetFCnt ())
-                                                        << "\nCurrent packet's frame counter: "
-                                                        << unsigned(currentFrameHdr.GetFCnt ()));
-
-      if (frameHdr.GetFCnt () == currentFrameHdr.GetFCnt ())
-        {
-          NS_LOG_INFO ("Packet was already received by another gateway");
-
-          // This packet had already been received from another gateway:
-          // add this gateway's reception information.
-          GatewayList &gwList = it->second.gwList;
-
-          PacketInfoPerGw gwInfo;
-          gwInfo.receivedTime = Simulator::Now ();
-          gwInfo.rxPower = rcvPower;
-          gwInfo.gwAddress = gwAddress;
-          gwList.insert (std::pair<Address, PacketInfoPerGw> (gwAddress, gwInfo));
-
-          NS_LOG_DEBUG ("Size of gateway list: " << gwList.size ());
-
-          break; // Exit from the cycle
-        }
+      NS_LOG_INFO ("Packet was already received by another gateway");
     }
-  if (it == m_receivedPacketList.rend ())
+  else
     {
       NS_LOG_INFO ("Packet was received for the first time");
-      PacketInfoPerGw gwInfo;
-      gwInfo.receivedTime = Simulator::Now ();
-      gwInfo.rxPower = rcvPower;
-      gwInfo.gwAddress = gwAddress;
-      info.gwList.insert (std::pair<Address, PacketInfoPerGw> (gwAddress, gwInfo));
-      m_receivedPacketList.push_back (
-          std::pair<Ptr<Packet const>, ReceivedPacketInfo> (receivedPacket, info));
-    }
-  NS_LOG_DEBUG (*this);
-}
 
-EndDeviceStatus::ReceivedPacketInfo
-EndDeviceStatus::GetLastReceivedPacketInfo (void)
-{
-  NS_LOG_FUNCTION_NOARGS ();
-  auto it = m_receivedPacketList.rbegin ();
-  if (it != m_receivedPacketList.rend ())
-    {
-      return it->second;
+      // Update Information on the received packet
+      info = &m_receivedPacketList.Insert (fCnt);
+      info->sf = uplink.sf;
+      info->frequency = uplink.frequency;
+      info->adr = uplink.frameHeader.GetAdr ();
+
+      // Downlinks answer the new packet, so rank its gateways from scratch
+      m_nRankedGateways = 0;
     }
-  else
+
+  // Add this gateway's reception information
+  PacketInfoPerGw gwInfo;
+  gwInfo.receivedTime = uplink.receiveTime;
+  gwInfo.rxPower = uplink.receivePower;
+  gwInfo.gwAddress = gwAddress;
+  info->gwList.insert (std::pair<Address, PacketInfoPerGw> (gwAddress, gwInfo));
+
+  NS_LOG_DEBUG ("Size of gateway list: " << info->gwList.size ());
+
+  if (info == &m_receivedPacketList.GetLast ())
     {
-      return EndDeviceStatus::ReceivedPacketInfo ();
+      RankGateway (uplink.receivePower, gatewayIndex);
     }
+  NS_LOG_DEBUG (*this);
 }
 
-Ptr<Packet const>
-EndDeviceStatus::GetLastPacketReceivedFromDevice (void)
+const EndDeviceStatus::ReceivedPacketInfo &
+EndDeviceStatus::GetLastReceivedPacketInfo (void) const
 {
   NS_LOG_FUNCTION_NOARGS ();
-  auto it = m_receivedPacketList.rbegin ();
-  if (it != m_receivedPacketList.rend ())
+  if (!m_receivedPacketList.IsEmpty ())
     {
-      return it->first;
+      return m_receivedPacketList.GetLast ();
     }
   else
     {
-      return 0;
+      static const EndDeviceStatus::ReceivedPacketInfo empty;
+      return empty;
     }
 }
 
@@ -355,14 +394,17 @@ void
 EndDeviceStatus::InitializeReply ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  m_reply = Reply ();
-  m_reply.needsReply = false;
+  if (HasReply ())
+    {
+      m_replyPool->Release (m_replyIndex);
+      m_replyIndex = ReplyPool::NONE;
+    }
 }
 
 void
 EndDeviceStatus::AddMACCommand (Ptr<MacCommand> macCommand)
 {
-  m_reply.frameHeader.AddCommand (macCommand);
+  GetReply ().frameHeader.AddCommand (macCommand);
 }
 
 bool
@@ -389,8 +431,7 @@ EndDeviceStatus::GetPowerGatewayMap (void)
   // Create a map of the gateways
   // Key: received power
   // Value: address of the corresponding gateway
-  ReceivedPacketInfo info = m_receivedPacketList.back ().second;
-  GatewayList gwList = info.gwList;
+  const GatewayList &gwList = GetLastReceivedPacketInfo ().gwList;
 
   std::map<double, Address> gatewayPowers;
 
@@ -404,19 +445,160 @@ EndDeviceStatus::GetPowerGatewayMap (void)
   return gatewayPowers;
 }
 
+//////////////////////////
+//  ReceivedPacketList  //
+//////////////////////////
+
+EndDeviceStatus::ReceivedPacketList::ReceivedPacketList (uint32_t capacity)
+    : m_slots (capacity), m_fCnts (capacity), m_next (0), m_size (0)
+{
+  NS_ASSERT (capacity > 0);
+}
+
+void
+EndDeviceStatus::ReceivedPacketList::Reserve (uint32_t capacity)
+{
+  if (capacity <= m_slots.size ())
+    {
+      return;
+    }
+
+  // Unroll the ring into the new storage, oldest packet first
+  std::vector<ReceivedPacketInfo> slots (capacity);
+  std::vector<uint16_t> fCnts (capacity);
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      std::swap (slots[i], m_slots[(m_next + m_slots.size () - m_size + i) % m_slots.size ()]);
+      fCnts[i] = slots[i].fCnt;
+    }
+  m_slots.swap (slots);
+  m_fCnts.swap (fCnts);
+  m_next = m_size;
+}
+
+uint32_t
+EndDeviceStatus::ReceivedPacketList::GetCapacity (void) const
+{
+  return m_slots.size ();
+}
+
+uint32_t
+EndDeviceStatus::ReceivedPacketList::GetSize (void) const
+{
+  return m_size;
+}
+
+bool
+EndDeviceStatus::ReceivedPacketList::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+const EndDeviceStatus::ReceivedPacketInfo &
+EndDeviceStatus::ReceivedPacketList::Get (uint32_t i) const
+{
+  NS_ASSERT_MSG (i < m_size, "Only " << m_size << " packets in the history");
+  return m_slots[(m_next + m_slots.size () - 1 - i) % m_slots.size ()];
+}
+
+const EndDeviceStatus::ReceivedPacketInfo &
+EndDeviceStatus::ReceivedPacketList::GetLast (void) const
+{
+  return Get (0);
+}
+
+EndDeviceStatus::ReceivedPacketInfo *
+EndDeviceStatus::ReceivedPacketList::Find (uint16_t fCnt)
+{
+  // Duplicates arrive close to each other, so start from the newest slot
+  uint32_t slot = m_next;
+  for (uint32_t i = 0; i < m_size; i++)
+    {
+      slot = (slot == 0 ? m_slots.size () : slot) - 1;
+      if (m_fCnts[slot] == fCnt)
+        {
+          return &m_slots[slot];
+        }
+    }
+  return 0;
+}
+
+EndDeviceStatus::ReceivedPacketInfo &
+EndDeviceStatus::ReceivedPacketList::Insert (uint16_t fCnt)
+{
+  ReceivedPacketInfo &info = m_slots[m_next];
+  info = ReceivedPacketInfo ();
+  info.fCnt = fCnt;
+  m_fCnts[m_next] = fCnt;
+
+  m_next = (m_next + 1) % m_slots.size ();
+  if (m_size < m_slots.size ())
+    {
+      m_size++;
+    }
+  return info;
+}
+
+uint32_t
+EndDeviceStatus::GetNRankedGateways (void) const
+{
+  return m_nRankedGateways;
+}
+
+const EndDeviceStatus::RankedGateway &
+EndDeviceStatus::GetRankedGateway (uint32_t i) const
+{
+  NS_ASSERT (i < m_nRankedGateways);
+  return m_gatewayRanking[i];
+}
+
+void
+EndDeviceStatus::RankGateway (double rxPower, uint32_t gatewayIndex)
+{
+  // Only the first reception by each gateway counts
+  for (uint32_t i = 0; i < m_nRankedGateways; i++)
+    {
+      if (m_gatewayRanking[i].gatewayIndex == gatewayIndex)
+        {
+          return;
+        }
+    }
+
+  // Find the position, after gateways with the same power
+  uint32_t position = m_nRankedGateways;
+  while (position > 0 && m_gatewayRanking[position - 1].rxPower < rxPower)
+    {
+      position--;
+    }
+  if (position == MAX_RANKED_GATEWAYS)
+    {
+      return;
+    }
+
+  // Shift the worse gateways, dropping the last one if the ranking is full
+  if (m_nRankedGateways < MAX_RANKED_GATEWAYS)
+    {
+      m_nRankedGateways++;
+    }
+  for (uint32_t i = m_nRankedGateways - 1; i > position; i--)
+    {
+      m_gatewayRanking[i] = m_gatewayRanking[i - 1];
+    }
+  m_gatewayRanking[position].rxPower = rxPower;
+  m_gatewayRanking[position].gatewayIndex = gatewayIndex;
+}
+
 std::ostream &
 operator<< (std::ostream &os, const EndDeviceStatus &status)
 {
-  os << "Total packets received: " << status.m_receivedPacketList.size () << std::endl;
+  const EndDeviceStatus::ReceivedPacketList &list = status.m_receivedPacketList;
+  os << "Packets in history: " << list.GetSize () << std::endl;
 
-  for (auto j = status.m_receivedPacketList.begin (); j != status.m_receivedPacketList.end (); j++)
+  for (uint32_t j = list.GetSize (); j > 0; j--)
     {
-      EndDeviceStatus::ReceivedPacketInfo info = (*j).second;
-      EndDeviceStatus::GatewayList gatewayList = info.gwList;
-      Ptr<Packet const> pkt = (*j).first;
-      os << pkt << " " << gatewayList.size () << std::endl;
-      for (EndDeviceStatus::GatewayList::iterator k = gatewayList.begin (); k != gatewayList.end ();
-           k++)
+      const EndDeviceStatus::GatewayList &gatewayList = list.Get (j - 1).gwList;
+      os << list.Get (j - 1).fCnt << " " << gatewayList.size () << std::endl;
+      for (auto k = gatewayList.begin (); k != gatewayList.end (); k++)
         {
           EndDeviceStatus::PacketInfoPerGw infoPerGw = (*k).second;
           os << "  " << infoPerGw.gwAddress << " " << infoPerGw.rxPower << std::endl;
@@ -28,8 +28,12 @@
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/lora-frame-header.h"
 #include "ns3/pointer.h"
+#include "ns3/decoded-uplink.h"
 #include "ns3/lora-frame-header.h"
+#include "ns3/buffer.h"
+#include "ns3/simple-ref-count.h"
 #include <iostream>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -60,7 +64,7 @@ namespace lorawan {
  *                   - First Receive Window frequency
  *                   - Second Window SF and DR
  *                   - Second Receive Window frequency
- *               --- Reply
+ *               --- Reply (held in a ReplyPool, only while one is pending)
  *                   - Need for reply (true/false)
  *                   - Updated reply
  *               --- Received Packets
@@ -105,6 +109,53 @@ public:
     bool needsReply = false;
   };
 
+  /**
+   * Storage for the replies of a set of devices.
+   *
+   * A device only holds an entry while it has a reply in the making, and
+   * released entries are recycled, so the memory used for replies follows the
+   * number of pending replies rather than the number of devices. The headers
+   * of a reply are serialized in a buffer that is reused across replies.
+   */
+  class ReplyPool : public SimpleRefCount<ReplyPool>
+  {
+  public:
+    static const uint32_t NONE = 0xffffffff;
+
+    /**
+     * Get a blank entry.
+     *
+     * \return The index of the entry.
+     */
+    uint32_t Acquire (void);
+
+    /**
+     * Give back an entry, so that it can be recycled.
+     */
+    void Release (uint32_t index);
+
+    /**
+     * Get the reply stored in an entry. The reference is invalidated by the
+     * next call to Acquire.
+     */
+    Reply &Get (uint32_t index);
+
+    /**
+     * Get the number of entries currently held.
+     */
+    uint32_t GetNPending (void) const;
+
+    /**
+     * Build the packet of a reply: its headers followed by its payload.
+     */
+    Ptr<Packet> Serialize (const Reply &reply);
+
+  private:
+    std::vector<Reply> m_replies;   //!< The entries
+    std::vector<uint32_t> m_free;   //!< Indices of the released entries
+    Buffer m_buffer;                //!< Scratch space for the headers
+  };
+
   /**
    * Whether the end device needs a reply.
    *
@@ -122,6 +173,24 @@ public:
    */
   Ptr<Packet> GetCompleteReplyPacket (void);
 
+  /**
+   * Whether this device currently holds an entry for its reply.
+   */
+  bool HasReply (void) const;
+
+  /**
+   * Get the reply intended for this device, taking an entry from the pool if
+   * it doesn't hold one yet. The reference is only valid until the next reply
+   * of the pool is started.
+   */
+  Reply &GetReply (void);
+
+  /**
+   * Set the pool the reply of this device is taken from. It should be set
+   * before a reply is started, otherwise the device gets a pool of its own.
+   */
+  void SetReplyPool (Ptr<ReplyPool> replyPool);
+
   /**
    * Get the reply packet mac header.
    *
@@ -167,16 +236,87 @@ public:
   struct ReceivedPacketInfo
   {
     // Members
-    Ptr<Packet const> packet = 0;   //!< The received packet
     GatewayList gwList;      //!< List of gateways that received this packet.
-    uint8_t sf;
-    double frequency;
+    uint8_t sf = 0;
+    double frequency = 0;
+    uint16_t fCnt = 0;       //!< The frame counter of the received packet
+    bool adr = false;        //!< Whether the packet had the ADR bit set
   };
 
-  typedef std::list<std::pair<Ptr<Packet const>, ReceivedPacketInfo> >
-    ReceivedPacketList;
+  /**
+   * Fixed-capacity history of the packets received from a device, keyed by
+   * frame counter. Once the history is full, each new packet overwrites the
+   * oldest one, so that memory does not grow with the simulation length.
+   */
+  class ReceivedPacketList
+  {
+  public:
+    ReceivedPacketList (uint32_t capacity = 1);
+
+    /**
+     * Grow the history to hold at least capacity packets, keeping the ones
+     * that are already stored. The history never shrinks.
+     */
+    void Reserve (uint32_t capacity);
+
+    uint32_t GetCapacity (void) const;
+
+    /**
+     * Get the number of packets currently stored.
+     */
+    uint32_t GetSize (void) const;
+
+    bool IsEmpty (void) const;
+
+    /**
+     * Get the i-th most recent packet, 0 being the last one.
+     */
+    const ReceivedPacketInfo &Get (uint32_t i) const;
+
+    /**
+     * Get the last packet that was stored.
+     */
+    const ReceivedPacketInfo &GetLast (void) const;
+
+    /**
+     * Find the stored packet with the given frame counter.
+     *
+     * \return A pointer to the packet's information, or 0 if it isn't in the
+     * history.
+     */
+    ReceivedPacketInfo *Find (uint16_t fCnt);
+
+    /**
+     * Make room for a new packet with the given frame counter, overwriting
+     * the oldest one if the history is full.
+     *
+     * \return The cleared slot of the new packet, to be filled in place.
+     */
+    ReceivedPacketInfo &Insert (uint16_t fCnt);
+
+  private:
+    std::vector<ReceivedPacketInfo> m_slots; //!< Ring of stored packets
+    std::vector<uint16_t> m_fCnts;  //!< Frame counter of each slot, kept
+                                    //!< apart so that lookups scan integers
+    uint32_t m_next;                //!< Slot the next packet will go into
+    uint32_t m_size;                //!< Number of occupied slots
+  };
 
 
+  /**
+   * A gateway that received the last packet from this device.
+   */
+  struct RankedGateway
+  {
+    double rxPower;          //!< Reception power of the packet at this gateway.
+    uint32_t gatewayIndex;   //!< Index of the gateway in the NetworkStatus.
+  };
+
+  /**
+   * Maximum number of gateways kept in the ranking of each device.
+   */
+  static const uint32_t MAX_RANKED_GATEWAYS = 8;
+
   /*******************************************/
   /* Proper EndDeviceStatus class definition */
   /*******************************************/
@@ -219,7 +359,13 @@ public:
    *
    * \return The received packet list.
    */
-  ReceivedPacketList GetReceivedPacketList (void);
+  const ReceivedPacketList &GetReceivedPacketList (void) const;
+
+  /**
+   * Make sure that at least the last depth packets received from this device
+   * are kept in its received packet list.
+   */
+  void ReserveReceivedPacketHistory (uint32_t depth);
 
   /**
    * Set the spreading factor this device is using in the first receive window.
@@ -264,20 +410,18 @@ public:
 
   /**
    * Insert a received packet in the packet list.
+   *
+   * \param uplink The received packet.
+   * \param gatewayIndex The index of the receiving gateway in the
+   * NetworkStatus, used to rank the gateways that can reach this device.
    */
-  void InsertReceivedPacket (Ptr<Packet const> receivedPacket,
-                             const Address& gwAddress);
-
-  /**
-   * Return the last packet that was received from this device.
-   */
-  Ptr<Packet const> GetLastPacketReceivedFromDevice (void);
+  void InsertReceivedPacket (const DecodedUplink &uplink, uint32_t gatewayIndex);
 
   /**
    * Return the information about the last packet that was received from the
    * device.
    */
-  EndDeviceStatus::ReceivedPacketInfo GetLastReceivedPacketInfo (void);
+  const EndDeviceStatus::ReceivedPacketInfo &GetLastReceivedPacketInfo (void) const;
 
   /**
    * Initialize reply.
@@ -308,7 +452,19 @@ public:
    */
   std::map<double, Address> GetPowerGatewayMap (void);
 
-  struct Reply m_reply; //<! Next reply intended for this device
+  /**
+   * Get the number of gateways that are ranked for this device.
+   */
+  uint32_t GetNRankedGateways (void) const;
+
+  /**
+   * Get the gateways that received the last packet, sorted by decreasing
+   * reception power. The ranking is updated as receptions arrive, and keeps
+   * at most MAX_RANKED_GATEWAYS gateways.
+   *
+   * \param i The position in the ranking, 0 being the best gateway.
+   */
+  const RankedGateway &GetRankedGateway (uint32_t i) const;
 
   LoraDeviceAddress m_endDeviceAddress;   //<! The address of this device
 
@@ -322,8 +478,21 @@ private:
   double m_secondReceiveWindowFrequency = 869.525;
   EventId m_receiveWindowEvent;
 
+  Ptr<ReplyPool> m_replyPool;   //<! Where the reply of this device is kept
+  uint32_t m_replyIndex = ReplyPool::NONE;   //<! The entry of the next
+                                             //<! reply in m_replyPool
+
   ReceivedPacketList m_receivedPacketList;   //<! List of received packets
 
+  /**
+   * Insert a gateway in the ranking, keeping it sorted.
+   */
+  void RankGateway (double rxPower, uint32_t gatewayIndex);
+
+  RankedGateway m_gatewayRanking[MAX_RANKED_GATEWAYS]; //<! Best gateways for
+                                                       //<! the last packet
+  uint32_t m_nRankedGateways = 0;   //<! Number of gateways in the ranking
+
   // NOTE Using this attribute is 'cheating', since we are assuming perfect
   // synchronization between the info at the device and at the network server
   Ptr<ClassAEndDeviceLorawanMac> m_mac;   //!< Pointer to the MAC layer of this device
@@ -20,6 +20,8 @@
 
 #include "ns3/forwarder.h"
 #include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -34,11 +36,26 @@ Forwarder::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::Forwarder")
     .SetParent<Application> ()
     .AddConstructor<Forwarder> ()
+    .AddAttribute ("MaxBundleFrames",
+                   "The number of uplinks that are bundled into a single "
+                   "backhaul packet. If 1, each uplink is forwarded on its own",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&Forwarder::m_maxBundleFrames),
+                   MakeUintegerChecker<uint32_t> (1, BackhaulBundleHeader::MAX_FRAMES))
+    .AddAttribute ("MaxBundleDelay",
+                   "How long an uplink can wait for others before its bundle is "
+                   "sent. Since the NetworkServer opens the receive windows "
+                   "relative to when it gets an uplink, this should be well "
+                   "below the duration of a receive window",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&Forwarder::m_maxBundleDelay),
+                   MakeTimeChecker ())
     .SetGroupName ("lorawan");
   return tid;
 }
 
-Forwarder::Forwarder ()
+Forwarder::Forwarder () :
+  m_maxBundleFrames (1)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -57,6 +74,14 @@ Forwarder::SetPointToPointNetDevice (Ptr<PointToPointNetDevice>
   m_pointToPointNetDevice = pointToPointNetDevice;
 }
 
+void
+Forwarder::SetDirectBackhaul (Ptr<DirectBackhaul> directBackhaul)
+{
+  NS_LOG_FUNCTION (this << directBackhaul);
+
+  m_directBackhaul = directBackhaul;
+}
+
 void
 Forwarder::SetLoraNetDevice (Ptr<LoraNetDevice> loraNetDevice)
 {
@@ -73,13 +98,65 @@ Forwarder::ReceiveFromLora (Ptr<NetDevice> loraNetDevice, Ptr<const Packet>
 
   Ptr<Packet> packetCopy = packet->Copy ();
 
-  m_pointToPointNetDevice->Send (packetCopy,
-                                 m_pointToPointNetDevice->GetBroadcast (),
-                                 0x800);
+  if (m_maxBundleFrames <= 1)
+    {
+      SendToNetworkServer (packetCopy);
+      return true;
+    }
+
+  // Add the uplink to the bundle, with the reception information the LoraTag
+  // would lose in the concatenation
+  LoraTag tag;
+  packetCopy->PeekPacketTag (tag);
+  if (m_bundle == 0)
+    {
+      m_bundle = Create<Packet> ();
+    }
+  m_bundleHeader.AddFrame (packetCopy->GetSize (), tag);
+  m_bundle->AddAtEnd (packetCopy);
+
+  if (m_bundleHeader.GetNFrames () >= m_maxBundleFrames)
+    {
+      SendBundle ();
+    }
+  else if (!m_bundleEvent.IsRunning ())
+    {
+      m_bundleEvent = Simulator::Schedule (m_maxBundleDelay, &Forwarder::SendBundle, this);
+    }
 
   return true;
 }
 
+void
+Forwarder::SendBundle (void)
+{
+  NS_LOG_FUNCTION (this << m_bundleHeader.GetNFrames ());
+
+  m_bundleEvent.Cancel ();
+
+  Ptr<Packet> bundle = m_bundle;
+  bundle->AddHeader (m_bundleHeader);
+  bundle->AddPacketTag (BackhaulBundleTag ());
+  m_bundle = 0;
+  m_bundleHeader.Clear ();
+
+  SendToNetworkServer (bundle);
+}
+
+void
+Forwarder::SendToNetworkServer (Ptr<Packet> packet)
+{
+  if (m_directBackhaul != 0)
+    {
+      m_directBackhaul->SendToNetworkServer (packet);
+      return;
+    }
+
+  m_pointToPointNetDevice->Send (packet,
+                                 m_pointToPointNetDevice->GetBroadcast (),
+                                 0x800);
+}
+
 bool
 Forwarder::ReceiveFromPointToPoint (Ptr<NetDevice> pointToPointNetDevice,
                                     Ptr<const Packet> packet, uint16_t protocol,
@@ -107,6 +184,12 @@ Forwarder::StopApplication (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  // Don't hold back the uplinks collected so far
+  if (m_bundle != 0)
+    {
+      SendBundle ();
+    }
+
   // TODO Get rid of callbacks
 }
 
@@ -24,6 +24,9 @@
 #include "ns3/application.h"
 #include "ns3/lora-net-device.h"
 #include "ns3/point-to-point-net-device.h"
+#include "ns3/direct-backhaul.h"
+#include "ns3/backhaul-bundle-header.h"
+#include "ns3/event-id.h"
 #include "ns3/nstime.h"
 #include "ns3/attribute.h"
 
@@ -33,6 +36,10 @@ namespace lorawan {
 /**
  * This application forwards packets between NetDevices:
  * LoraNetDevice -> PointToPointNetDevice and vice versa.
+ *
+ * Like real packet forwarders, it can bundle the uplinks it receives within
+ * a short time into a single backhaul packet, which the NetworkServer
+ * unpacks. See the MaxBundleFrames and MaxBundleDelay attributes.
  */
 class Forwarder : public Application
 {
@@ -56,6 +63,14 @@ public:
    */
   void SetPointToPointNetDevice (Ptr<PointToPointNetDevice> pointToPointNetDevice);
 
+  /**
+   * Sets the in-process link to use to communicate with the NS, instead of
+   * the P2P device.
+   *
+   * \param directBackhaul The DirectBackhaul aggregated to this node.
+   */
+  void SetDirectBackhaul (Ptr<DirectBackhaul> directBackhaul);
+
   /**
    * Receive a packet from the LoraNetDevice.
    *
@@ -69,7 +84,8 @@ public:
                         uint16_t protocol, const Address& sender);
 
   /**
-   * Receive a packet from the PointToPointNetDevice
+   * Receive a packet from the PointToPointNetDevice, or from the
+   * DirectBackhaul, in which case pointToPointNetDevice is null.
    */
   bool ReceiveFromPointToPoint (Ptr<NetDevice> pointToPointNetDevice,
                                 Ptr<const Packet> packet, uint16_t protocol,
@@ -81,16 +97,35 @@ public:
   void StartApplication (void);
 
   /**
-   * Stop the application
+   * Stop the application, sending the bundle being collected, if any.
    */
   void StopApplication (void);
 
 private:
+  /**
+   * Send the uplinks collected so far as a single bundle.
+   */
+  void SendBundle (void);
+
+  /**
+   * Send a packet to the NS, through the DirectBackhaul if there is one.
+   */
+  void SendToNetworkServer (Ptr<Packet> packet);
+
   Ptr<LoraNetDevice> m_loraNetDevice; //!< Pointer to the node's LoraNetDevice
 
   Ptr<PointToPointNetDevice> m_pointToPointNetDevice; //!< Pointer to the
   //!P2PNetDevice we use to
   //!communicate with the NS
+
+  Ptr<DirectBackhaul> m_directBackhaul; //!< In-process link to the NS, if any
+
+  uint32_t m_maxBundleFrames;   //!< Uplinks that fill a bundle
+  Time m_maxBundleDelay;        //!< How long an uplink can wait in a bundle
+  Ptr<Packet> m_bundle;         //!< Frames of the bundle being collected
+  BackhaulBundleHeader m_bundleHeader;  //!< Header of the bundle being
+                                        //!< collected
+  EventId m_bundleEvent;        //!< Sends the bundle when its delay expires
 };
 
 } //namespace ns3
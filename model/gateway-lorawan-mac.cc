@@ -23,6 +23,9 @@
 #include "ns3/lora-net-device.h"
 #include "ns3/lora-frame-header.h"
 #include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include <algorithm>
 
 namespace ns3 {
 namespace lorawan {
@@ -37,11 +40,19 @@ GatewayLorawanMac::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::GatewayLorawanMac")
     .SetParent<LorawanMac> ()
     .AddConstructor<GatewayLorawanMac> ()
-    .SetGroupName ("lorawan");
+    .SetGroupName ("lorawan")
+    .AddAttribute ("EnforceDutyCycle",
+                   "Whether the duty cycle of the SubBands limits the "
+                   "transmissions of this gateway",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&GatewayLorawanMac::m_enforceDutyCycle),
+                   MakeBooleanChecker ());
   return tid;
 }
 
 GatewayLorawanMac::GatewayLorawanMac ()
+  : m_busyUntil (Seconds (0)),
+  m_enforceDutyCycle (false)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -68,14 +79,12 @@ GatewayLorawanMac::Send (Ptr<Packet> packet)
   packet->AddPacketTag (tag);
 
   // Make sure we can transmit this packet
-  /*
-  //Another hack to disable Duty Cycle limitations.
-  if (m_channelHelper.GetWaitingTime(CreateObject<LogicalLoraChannel> (frequency)) > Time(0))
+  if (m_enforceDutyCycle && m_channelHelper.GetWaitingTime (frequency).IsStrictlyPositive ())
     {
       // We cannot send now!
       NS_LOG_WARN ("Trying to send a packet but Duty Cycle won't allow it. Aborting.");
       return;
-    }*/
+    }
 
   LoraTxParameters params;
   params.sf = GetSfFromDataRate (dataRate);
@@ -92,11 +101,13 @@ GatewayLorawanMac::Send (Ptr<Packet> packet)
   NS_LOG_DEBUG ("Duration: " << duration.GetSeconds ());
 
   // Find the channel with the desired frequency
-  double sendingPower = m_channelHelper.GetTxPowerForChannel
-      (CreateObject<LogicalLoraChannel> (frequency));
+  double sendingPower = m_channelHelper.GetTxPowerForFrequency (frequency);
 
   // Add the event to the channelHelper to keep track of duty cycle
-  m_channelHelper.AddEvent (duration, CreateObject<LogicalLoraChannel> (frequency));
+  m_channelHelper.AddEvent (duration, frequency);
+
+  // The radio is busy until the end of the transmission
+  m_busyUntil = Simulator::Now () + duration;
 
   // Send the packet to the PHY layer to send it on the channel
   m_phy->Send (packet, params, frequency, sendingPower);
@@ -107,7 +118,7 @@ GatewayLorawanMac::Send (Ptr<Packet> packet)
 bool
 GatewayLorawanMac::IsTransmitting (void)
 {
-  return m_phy->IsTransmitting ();
+  return m_busyUntil > Simulator::Now ();
 }
 
 void
@@ -146,6 +157,8 @@ void
 GatewayLorawanMac::TxFinished (Ptr<const Packet> packet)
 {
   NS_LOG_FUNCTION_NOARGS ();
+
+  m_busyUntil = std::min (m_busyUntil, Simulator::Now ());
 }
 
 Time
@@ -153,8 +166,13 @@ GatewayLorawanMac::GetWaitingTime (double frequency)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  return m_channelHelper.GetWaitingTime (CreateObject<LogicalLoraChannel>
-                                           (frequency));
+  return m_channelHelper.GetWaitingTime (frequency);
+}
+
+bool
+GatewayLorawanMac::IsDutyCycleEnforced (void) const
+{
+  return m_enforceDutyCycle;
 }
 }
 }
@@ -38,7 +38,12 @@ public:
   // Implementation of the LorawanMac interface
   virtual void Send (Ptr<Packet> packet);
 
-  // Implementation of the LorawanMac interface
+  /**
+   * Check whether the gateway is currently transmitting.
+   *
+   * This is answered from the end time of the last transmission recorded by
+   * Send, without asking the PHY.
+   */
   bool IsTransmitting (void);
 
   // Implementation of the LorawanMac interface
@@ -56,8 +61,18 @@ public:
    * \return The next transmission time.
    */
   Time GetWaitingTime (double frequency);
+
+  /**
+   * Check whether the gateway is subject to the duty cycle limitations of
+   * its SubBands.
+   */
+  bool IsDutyCycleEnforced (void) const;
+
 private:
 protected:
+  Time m_busyUntil;   //!< The end time of the last transmission
+
+  bool m_enforceDutyCycle;   //!< Whether the duty cycle limits downlinks
 };
 
 } /* namespace ns3 */
@@ -84,6 +84,18 @@ GatewayStatus::SetNetDevice (Ptr<NetDevice> netDevice)
   m_netDevice = netDevice;
 }
 
+Ptr<DirectBackhaul>
+GatewayStatus::GetDirectBackhaul (void)
+{
+  return m_directBackhaul;
+}
+
+void
+GatewayStatus::SetDirectBackhaul (Ptr<DirectBackhaul> directBackhaul)
+{
+  m_directBackhaul = directBackhaul;
+}
+
 Ptr<GatewayLorawanMac>
 GatewayStatus::GetGatewayMac (void)
 {
@@ -92,6 +104,12 @@ GatewayStatus::GetGatewayMac (void)
 
 bool
 GatewayStatus::IsAvailableForTransmission (double frequency)
+{
+  return IsIdle () && IsAllowedByDutyCycle (frequency);
+}
+
+bool
+GatewayStatus::IsIdle (void)
 {
   // We can't send multiple packets at once, see SX1301 V2.01 page 29
 
@@ -109,19 +127,26 @@ GatewayStatus::IsAvailableForTransmission (double frequency)
       return false;
     }
 
+  return true;
+}
+
+bool
+GatewayStatus::IsAllowedByDutyCycle (double frequency)
+{
   // Check that the gateway is not constrained by the duty cycle
-  //Note: Temp hack to disable Duty Cycle for downlink trans
-  /*
+  if (!m_gatewayMac->IsDutyCycleEnforced ())
+    {
+      return true;
+    }
+
   Time waitingTime = m_gatewayMac->GetWaitingTime (frequency);
-  if (waitingTime > Seconds (0))
+  if (waitingTime.IsStrictlyPositive ())
     {
-      NS_LOG_WARN ("Gateway cannot be used because of duty cycle");
-      NS_LOG_WARN ("Waiting time at current GW: " << waitingTime.GetSeconds ()
+      NS_LOG_INFO ("Gateway cannot be used because of duty cycle");
+      NS_LOG_INFO ("Waiting time at current GW: " << waitingTime.GetSeconds ()
                                                   << " seconds");
-
       return false;
     }
-  */
 
   return true;
 }
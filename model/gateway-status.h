@@ -25,6 +25,7 @@
 #include "ns3/address.h"
 #include "ns3/net-device.h"
 #include "ns3/gateway-lorawan-mac.h"
+#include "ns3/direct-backhaul.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -58,6 +59,18 @@ public:
    */
   void SetNetDevice (Ptr<NetDevice> netDevice);
 
+  /**
+   * Get the in-process link through which to contact this gateway from the
+   * server, if it's used instead of a NetDevice.
+   */
+  Ptr<DirectBackhaul> GetDirectBackhaul (void);
+
+  /**
+   * Set the in-process link through which to contact this gateway from the
+   * server.
+   */
+  void SetDirectBackhaul (Ptr<DirectBackhaul> directBackhaul);
+
   /**
    * Get a pointer to this gateway's MAC instance.
    */
@@ -78,6 +91,21 @@ public:
    */
   bool IsAvailableForTransmission (double frequency);
 
+  /**
+   * Query whether this gateway is neither booked for nor busy with a
+   * transmission. Unlike IsAvailableForTransmission, this doesn't depend on
+   * the frequency.
+   */
+  bool IsIdle (void);
+
+  /**
+   * Query whether the duty cycle allows this gateway to transmit now on a
+   * frequency. This is always true if the gateway doesn't enforce it.
+   *
+   * \param frequency The frequency, in MHz.
+   */
+  bool IsAllowedByDutyCycle (double frequency);
+
   void SetNextTransmissionTime (Time nextTransmissionTime);
   // Time GetNextTransmissionTime (void);
 
@@ -86,6 +114,9 @@ private:
 
   Ptr<NetDevice> m_netDevice;     //!< The NetDevice through which to reach this gateway from the server
 
+  Ptr<DirectBackhaul> m_directBackhaul;   //!< The in-process link to this
+                                          //!< gateway, if any
+
   Ptr<GatewayLorawanMac> m_gatewayMac;     //!< The Mac layer of the gateway
 
   Time m_nextTransmissionTime;   //!< This gateway's next transmission time
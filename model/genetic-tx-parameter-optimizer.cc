@@ -25,6 +25,10 @@ namespace ns3
                                                   UintegerValue(100),
                                                   MakeUintegerAccessor(&GeneticTXParameterOptimizer::maxGenerations),
                                                   MakeUintegerChecker<uint32_t>())
+                                    .AddAttribute("SeededGenerations", "The maximum number of generations when the population was seeded with genomes from neighbouring devices.",
+                                                  UintegerValue(10),
+                                                  MakeUintegerAccessor(&GeneticTXParameterOptimizer::seededMaxGenerations),
+                                                  MakeUintegerChecker<uint32_t>(1))
                                     .AddAttribute("EliteCount", "The number of elite individuals.",
                                                   UintegerValue(4),
                                                   MakeUintegerAccessor(&GeneticTXParameterOptimizer::eliteCount),
@@ -47,6 +51,29 @@ namespace ns3
 
         void GeneticTXParameterOptimizer::Initialize()
         {
+            Initialize(std::vector<Ptr<TransmissionParameterSet>>());
+        }
+
+        void GeneticTXParameterOptimizer::Initialize(const std::vector<Ptr<TransmissionParameterSet>> &seeds)
+        {
+            transmissionParameterSets.clear();
+            currentPopulationIndices.clear();
+            currentTPSIndex = 0;
+            currentGeneration = 0;
+            isOptimizing = true;
+            MostFitTPS = 0;
+
+            for (auto &seed : seeds)
+            {
+                if (transmissionParameterSets.size() >= populationSize)
+                {
+                    break;
+                }
+                AddToMasterList(CreateObject<TransmissionParameterSet>(seed->spreadingFactor, seed->power, seed->bandwidth, seed->codingRate));
+            }
+            generationLimit = static_cast<int>(transmissionParameterSets.empty() ? maxGenerations : std::min<double>(seededMaxGenerations, maxGenerations));
+            NS_LOG_INFO("Initializing population with " << transmissionParameterSets.size() << " seeds.");
+
             for (int i = 0; i < populationSize; i++)
             {
                 currentPopulationIndices.push_back(i);
@@ -69,10 +96,20 @@ namespace ns3
             transmissionParameterSets.push_back(new TransmissionParameterSet(12, 12, 125000, 4));
             transmissionParameterSets.push_back(new TransmissionParameterSet(8, 8, 250000, 3));*/
 
-            transmissionParameterSets.push_back(CreateObject<TransmissionParameterSet>(12, 10, 125000, 2));
-            transmissionParameterSets.push_back(CreateObject<TransmissionParameterSet>(12, 14, 250000, 2));
-            transmissionParameterSets.push_back(CreateObject<TransmissionParameterSet>(7, 8, 125000, 3));
-            transmissionParameterSets.push_back(CreateObject<TransmissionParameterSet>(7, 2, 125000, 1));
+            //The default genomes are always part of the initial population, after the seeds.
+            std::vector<Ptr<TransmissionParameterSet>> defaults;
+            defaults.push_back(CreateObject<TransmissionParameterSet>(12, 10, 125000, 2));
+            defaults.push_back(CreateObject<TransmissionParameterSet>(12, 14, 250000, 2));
+            defaults.push_back(CreateObject<TransmissionParameterSet>(7, 8, 125000, 3));
+            defaults.push_back(CreateObject<TransmissionParameterSet>(7, 2, 125000, 1));
+            for (auto &tps : defaults)
+            {
+                if (transmissionParameterSets.size() >= populationSize)
+                {
+                    break;
+                }
+                AddToMasterList(tps);
+            }
             
             
             
@@ -84,10 +121,11 @@ namespace ns3
             transmissionParameterSets.push_back(CreateObject<TransmissionParameterSet>(11, 10, 125000, 1));
             */
             
-            for (int i = 4; i < populationSize; i++)
+            int parents = transmissionParameterSets.size();
+            for (int i = parents; i < populationSize; i++)
             {
-                int parent_a = randomGenerator->GetInteger(0, 3);
-                int parent_b = randomGenerator->GetInteger(0, 3);
+                int parent_a = randomGenerator->GetInteger(0, parents - 1);
+                int parent_b = randomGenerator->GetInteger(0, parents - 1);
                 int pivot = randomGenerator->GetInteger(1, 3);
                 Ptr<TransmissionParameterSet> new_tps = CreateObject<TransmissionParameterSet>();
                 new_tps->Crossover(transmissionParameterSets[parent_a], transmissionParameterSets[parent_b], pivot);
@@ -182,7 +220,7 @@ namespace ns3
                 PrintPopulation();
                 PrintMasterList();
                 currentGeneration++;
-                if (currentGeneration == maxGenerations)
+                if (currentGeneration >= generationLimit)
                 {
                     //Get the most-fit individual from the master list.
                     std::sort(transmissionParameterSets.begin(), transmissionParameterSets.end(), TransmissionParameterSet::CompareFitness);
@@ -255,6 +293,19 @@ namespace ns3
             }
         }
 
+        bool GeneticTXParameterOptimizer::AddToMasterList(Ptr<TransmissionParameterSet> tps)
+        {
+            for (uint32_t i = 0; i < transmissionParameterSets.size(); i++)
+            {
+                if (tps->isEqual(transmissionParameterSets[i]))
+                {
+                    return false;
+                }
+            }
+            transmissionParameterSets.push_back(tps);
+            return true;
+        }
+
         bool GeneticTXParameterOptimizer::AddToPopulation(int offset, Ptr<TransmissionParameterSet> tps)
         {
             //check to see if this tps is identical to any other's in the major list.
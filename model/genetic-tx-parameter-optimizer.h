@@ -32,6 +32,13 @@ namespace ns3
             GeneticTXParameterOptimizer();
             Ptr<TransmissionParameterSet> GetCurrentTransmissionParameterSet();
             void Initialize();
+            /**
+             * (Re)start the optimization from the given genomes, typically the
+             * ones that converged at neighbouring devices. Missing individuals
+             * are filled in with the default genomes and their crossovers.
+             * A seeded population runs for at most SeededGenerations.
+             */
+            void Initialize(const std::vector<Ptr<TransmissionParameterSet>> &seeds);
             void SetCurrentTransmissionParameterSetSuccess(bool successful);
             void StopOptimizing();
             bool IsOptimizing();
@@ -40,6 +47,7 @@ namespace ns3
 
             double populationSize;
             double maxGenerations = 8;
+            uint32_t seededMaxGenerations;
             double mutationRate;
             double crossoverRate;
             int eliteCount;
@@ -50,6 +58,7 @@ namespace ns3
         private:
             void AdvancePopulationOrGeneration();
             bool AddToPopulation(int offset, Ptr<TransmissionParameterSet> tps);
+            bool AddToMasterList(Ptr<TransmissionParameterSet> tps);
             //A vector containing all TPSs that have been tried.
             std::vector<Ptr<TransmissionParameterSet>> transmissionParameterSets;
             
@@ -62,6 +71,7 @@ namespace ns3
             int currentTPSIndex = 0;
 
             int currentGeneration = 0;
+            int generationLimit = 0;
             bool isOptimizing = true;
             Ptr<TransmissionParameterSet> MostFitTPS;
             Ptr<UniformRandomVariable> randomGenerator;
@@ -0,0 +1,173 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/genome-seed-index.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ns3
+{
+    namespace lorawan
+    {
+        NS_LOG_COMPONENT_DEFINE("GenomeSeedIndex");
+        NS_OBJECT_ENSURE_REGISTERED(GenomeSeedIndex);
+
+        TypeId GenomeSeedIndex::GetTypeId(void)
+        {
+            static TypeId tid = TypeId("ns3::GenomeSeedIndex")
+                                    .SetParent<Object>()
+                                    .SetGroupName("lorawan")
+                                    .AddConstructor<GenomeSeedIndex>()
+                                    .AddAttribute("CellSize", "The side of a grid cell, in meters.",
+                                                  DoubleValue(250),
+                                                  MakeDoubleAccessor(&GenomeSeedIndex::m_cellSize),
+                                                  MakeDoubleChecker<double>(1));
+            return tid;
+        }
+
+        GenomeSeedIndex::GenomeSeedIndex()
+        {
+            NS_LOG_FUNCTION(this);
+        }
+
+        GenomeSeedIndex::~GenomeSeedIndex()
+        {
+            NS_LOG_FUNCTION(this);
+        }
+
+        int64_t GenomeSeedIndex::GetCellCoordinate(double coordinate) const
+        {
+            return static_cast<int64_t>(std::floor(coordinate / m_cellSize));
+        }
+
+        int64_t GenomeSeedIndex::GetCellKey(int64_t cellX, int64_t cellY) const
+        {
+            return static_cast<int64_t>((static_cast<uint64_t>(cellX) << 32) | (static_cast<uint64_t>(cellY) & 0xffffffff));
+        }
+
+        void GenomeSeedIndex::Insert(LoraDeviceAddress address, Vector position, Ptr<const TransmissionParameterSet> tps)
+        {
+            NS_LOG_FUNCTION(this << address << position);
+
+            Remove(address);
+
+            Genome genome;
+            genome.address = address;
+            genome.position = position;
+            genome.spreadingFactor = tps->spreadingFactor;
+            genome.power = tps->power;
+            genome.bandwidth = tps->bandwidth;
+            genome.codingRate = tps->codingRate;
+
+            int64_t key = GetCellKey(GetCellCoordinate(position.x), GetCellCoordinate(position.y));
+            m_cells[key].push_back(genome);
+            m_deviceCells[address] = key;
+        }
+
+        void GenomeSeedIndex::Remove(LoraDeviceAddress address)
+        {
+            auto deviceCell = m_deviceCells.find(address);
+            if (deviceCell == m_deviceCells.end())
+            {
+                return;
+            }
+
+            auto cell = m_cells.find(deviceCell->second);
+            if (cell != m_cells.end())
+            {
+                std::vector<Genome> &genomes = cell->second;
+                genomes.erase(std::remove_if(genomes.begin(), genomes.end(),
+                                             [&address](const Genome &g) { return g.address == address; }),
+                              genomes.end());
+                if (genomes.empty())
+                {
+                    m_cells.erase(cell);
+                }
+            }
+            m_deviceCells.erase(deviceCell);
+        }
+
+        std::vector<Ptr<TransmissionParameterSet>> GenomeSeedIndex::GetSeeds(LoraDeviceAddress address, Vector position,
+                                                                             double radius, uint32_t maxCount) const
+        {
+            NS_LOG_FUNCTION(this << address << position << radius << maxCount);
+
+            // Collect the candidates from every cell overlapping the query circle.
+            std::vector<std::pair<double, const Genome *>> candidates;
+            int64_t minX = GetCellCoordinate(position.x - radius);
+            int64_t maxX = GetCellCoordinate(position.x + radius);
+            int64_t minY = GetCellCoordinate(position.y - radius);
+            int64_t maxY = GetCellCoordinate(position.y + radius);
+            for (int64_t cx = minX; cx <= maxX; cx++)
+            {
+                for (int64_t cy = minY; cy <= maxY; cy++)
+                {
+                    auto cell = m_cells.find(GetCellKey(cx, cy));
+                    if (cell == m_cells.end())
+                    {
+                        continue;
+                    }
+                    for (const Genome &genome : cell->second)
+                    {
+                        double distance = CalculateDistance(position, genome.position);
+                        if (genome.address != address && distance <= radius)
+                        {
+                            candidates.push_back(std::make_pair(distance, &genome));
+                        }
+                    }
+                }
+            }
+
+            std::sort(candidates.begin(), candidates.end(),
+                      [](const std::pair<double, const Genome *> &a, const std::pair<double, const Genome *> &b) { return a.first < b.first; });
+
+            std::vector<Ptr<TransmissionParameterSet>> seeds;
+            for (auto &candidate : candidates)
+            {
+                if (seeds.size() >= maxCount)
+                {
+                    break;
+                }
+                const Genome *genome = candidate.second;
+                Ptr<TransmissionParameterSet> seed = CreateObject<TransmissionParameterSet>(genome->spreadingFactor, genome->power,
+                                                                                            genome->bandwidth, genome->codingRate);
+                bool duplicate = false;
+                for (auto &other : seeds)
+                {
+                    if (seed->isEqual(other))
+                    {
+                        duplicate = true;
+                        break;
+                    }
+                }
+                if (!duplicate)
+                {
+                    seeds.push_back(seed);
+                }
+            }
+
+            NS_LOG_DEBUG("Found " << seeds.size() << " seeds among " << candidates.size() << " neighbours.");
+            return seeds;
+        }
+
+        uint32_t GenomeSeedIndex::GetNGenomes(void) const
+        {
+            return m_deviceCells.size();
+        }
+    }
+}
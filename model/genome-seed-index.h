@@ -0,0 +1,98 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef GENOME_SEED_INDEX_H
+#define GENOME_SEED_INDEX_H
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/vector.h"
+#include "ns3/lora-device-address.h"
+#include "ns3/transmission-parameter-set.h"
+
+namespace ns3
+{
+    namespace lorawan
+    {
+        /**
+         * Spatial index of the best genomes found by devices whose genetic
+         * optimizer has converged.
+         *
+         * Genomes are bucketed in a uniform grid of CellSize metres, so that
+         * looking up the neighbours of a device only touches the cells that
+         * overlap the query radius. Every device owns at most one entry: a
+         * device that converges again replaces its previous genome.
+         */
+        class GenomeSeedIndex : public Object
+        {
+        public:
+            static TypeId GetTypeId(void);
+            GenomeSeedIndex();
+            virtual ~GenomeSeedIndex();
+
+            /**
+             * Store (or replace) the converged genome of a device.
+             *
+             * Only the genes are kept: the success/failure counters of tps
+             * belong to the device that evaluated it.
+             */
+            void Insert(LoraDeviceAddress address, Vector position, Ptr<const TransmissionParameterSet> tps);
+
+            /**
+             * Forget the genome of a device, if any.
+             */
+            void Remove(LoraDeviceAddress address);
+
+            /**
+             * Get fresh copies of the genomes stored within radius metres of
+             * position, closest first, excluding the one owned by address.
+             * Identical genomes are returned only once.
+             */
+            std::vector<Ptr<TransmissionParameterSet>> GetSeeds(LoraDeviceAddress address, Vector position,
+                                                                double radius, uint32_t maxCount) const;
+
+            /**
+             * Get the number of genomes in the index.
+             */
+            uint32_t GetNGenomes(void) const;
+
+        private:
+            struct Genome
+            {
+                LoraDeviceAddress address;
+                Vector position;
+                int spreadingFactor;
+                int power;
+                int bandwidth;
+                int codingRate;
+            };
+
+            int64_t GetCellKey(int64_t cellX, int64_t cellY) const;
+            int64_t GetCellCoordinate(double coordinate) const;
+
+            double m_cellSize;
+
+            // The genomes stored in each grid cell.
+            std::unordered_map<int64_t, std::vector<Genome>> m_cells;
+
+            // The cell holding each device's genome, to replace it in O(1) cells.
+            std::map<LoraDeviceAddress, int64_t> m_deviceCells;
+        };
+    }
+}
+#endif
@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/link-statistics.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("LinkStatistics");
+
+LinkStatistics::LinkStatistics (uint32_t window, double ewmaAlpha)
+  : m_window (window),
+  m_ewmaAlpha (ewmaAlpha)
+{
+  NS_ASSERT_MSG (window > 0, "The window must hold at least one outcome");
+  NS_ASSERT_MSG (ewmaAlpha > 0 && ewmaAlpha <= 1, "Invalid EWMA weight");
+
+  Reset ();
+}
+
+void
+LinkStatistics::AddOutcome (bool success)
+{
+  NS_LOG_FUNCTION (this << success);
+
+  // Evict the oldest outcome, which sits where the new one goes
+  if (m_windowOutcomes == m_window)
+    {
+      m_windowSuccesses -= GetBit (m_next);
+    }
+  else
+    {
+      m_windowOutcomes++;
+    }
+
+  SetBit (m_next, success);
+  m_windowSuccesses += success;
+  m_next = (m_next + 1 == m_window) ? 0 : m_next + 1;
+
+  m_ewma = (m_totalOutcomes == 0) ? success :
+    m_ewmaAlpha * success + (1 - m_ewmaAlpha) * m_ewma;
+
+  m_totalOutcomes++;
+  m_totalFailures += !success;
+}
+
+void
+LinkStatistics::Reset (void)
+{
+  m_bits.assign ((m_window + 63) / 64, 0);
+  m_next = 0;
+  m_windowOutcomes = 0;
+  m_windowSuccesses = 0;
+  m_ewma = 0;
+  m_totalOutcomes = 0;
+  m_totalFailures = 0;
+}
+
+void
+LinkStatistics::SetWindow (uint32_t window)
+{
+  NS_ASSERT_MSG (window > 0, "The window must hold at least one outcome");
+
+  m_window = window;
+  Reset ();
+}
+
+uint32_t
+LinkStatistics::GetWindow (void) const
+{
+  return m_window;
+}
+
+void
+LinkStatistics::SetEwmaAlpha (double alpha)
+{
+  NS_ASSERT_MSG (alpha > 0 && alpha <= 1, "Invalid EWMA weight");
+
+  m_ewmaAlpha = alpha;
+}
+
+double
+LinkStatistics::GetEwmaAlpha (void) const
+{
+  return m_ewmaAlpha;
+}
+
+bool
+LinkStatistics::IsWindowFull (void) const
+{
+  return m_windowOutcomes == m_window;
+}
+
+uint32_t
+LinkStatistics::GetWindowOutcomes (void) const
+{
+  return m_windowOutcomes;
+}
+
+uint32_t
+LinkStatistics::GetWindowSuccesses (void) const
+{
+  return m_windowSuccesses;
+}
+
+double
+LinkStatistics::GetWindowSuccessRate (void) const
+{
+  if (m_windowOutcomes == 0)
+    {
+      return 0;
+    }
+  return double (m_windowSuccesses) / m_windowOutcomes;
+}
+
+double
+LinkStatistics::GetSuccessRateEwma (void) const
+{
+  return m_ewma;
+}
+
+uint64_t
+LinkStatistics::GetTotalOutcomes (void) const
+{
+  return m_totalOutcomes;
+}
+
+uint64_t
+LinkStatistics::GetTotalFailures (void) const
+{
+  return m_totalFailures;
+}
+
+double
+LinkStatistics::GetTotalErrorRate (void) const
+{
+  if (m_totalOutcomes == 0)
+    {
+      return 0;
+    }
+  return double (m_totalFailures) / m_totalOutcomes;
+}
+
+bool
+LinkStatistics::GetBit (uint32_t position) const
+{
+  return (m_bits[position / 64] >> (position % 64)) & 1;
+}
+
+void
+LinkStatistics::SetBit (uint32_t position, bool value)
+{
+  uint64_t mask = uint64_t (1) << (position % 64);
+  if (value)
+    {
+      m_bits[position / 64] |= mask;
+    }
+  else
+    {
+      m_bits[position / 64] &= ~mask;
+    }
+}
+
+} // namespace lorawan
+} // namespace ns3
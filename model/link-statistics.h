@@ -0,0 +1,130 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LINK_STATISTICS_H
+#define LINK_STATISTICS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Running statistics on the outcome (success or failure) of the frames sent
+ * over a link.
+ *
+ * The last Window outcomes are kept as bits of a ring buffer, together with
+ * the number of successes among them, so that recording an outcome and
+ * reading the windowed success rate both take constant time. An
+ * exponentially weighted moving average of the success rate and the totals
+ * since the last reset are maintained alongside.
+ */
+class LinkStatistics
+{
+public:
+  /**
+   * Create an empty set of statistics.
+   *
+   * \param window The number of most recent outcomes the windowed rate is
+   * computed on.
+   * \param ewmaAlpha The weight of a new outcome in the moving average.
+   */
+  LinkStatistics (uint32_t window = 32, double ewmaAlpha = 0.1);
+
+  /**
+   * Record the outcome of a frame.
+   */
+  void AddOutcome (bool success);
+
+  /**
+   * Discard all recorded outcomes.
+   */
+  void Reset (void);
+
+  /**
+   * Change the size of the window. This discards all recorded outcomes.
+   */
+  void SetWindow (uint32_t window);
+
+  uint32_t GetWindow (void) const;
+
+  void SetEwmaAlpha (double alpha);
+
+  double GetEwmaAlpha (void) const;
+
+  /**
+   * Whether Window outcomes have been recorded since the last reset.
+   */
+  bool IsWindowFull (void) const;
+
+  /**
+   * Get the number of outcomes currently in the window.
+   */
+  uint32_t GetWindowOutcomes (void) const;
+
+  /**
+   * Get the number of successes among the outcomes in the window.
+   */
+  uint32_t GetWindowSuccesses (void) const;
+
+  /**
+   * Get the fraction of successes among the outcomes in the window, or 0 if
+   * no outcome was recorded.
+   */
+  double GetWindowSuccessRate (void) const;
+
+  /**
+   * Get the exponentially weighted moving average of the success rate. The
+   * first outcome initializes the average.
+   */
+  double GetSuccessRateEwma (void) const;
+
+  /**
+   * Get the number of outcomes recorded since the last reset.
+   */
+  uint64_t GetTotalOutcomes (void) const;
+
+  /**
+   * Get the number of failures recorded since the last reset.
+   */
+  uint64_t GetTotalFailures (void) const;
+
+  /**
+   * Get the fraction of failures among all outcomes recorded since the last
+   * reset, or 0 if no outcome was recorded.
+   */
+  double GetTotalErrorRate (void) const;
+
+private:
+  bool GetBit (uint32_t position) const;
+  void SetBit (uint32_t position, bool value);
+
+  uint32_t m_window;              //!< The number of outcomes in a full window
+  double m_ewmaAlpha;             //!< The weight of new outcomes in the EWMA
+  std::vector<uint64_t> m_bits;   //!< Ring buffer of the window's outcomes
+  uint32_t m_next;                //!< The position of the next outcome
+  uint32_t m_windowOutcomes;      //!< Outcomes currently in the window
+  uint32_t m_windowSuccesses;     //!< Successes currently in the window
+  double m_ewma;                  //!< Moving average of the success rate
+  uint64_t m_totalOutcomes;       //!< Outcomes since the last reset
+  uint64_t m_totalFailures;       //!< Failures since the last reset
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LINK_STATISTICS_H */
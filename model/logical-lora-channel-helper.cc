@@ -21,6 +21,7 @@
 #include "ns3/logical-lora-channel-helper.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
+#include <bitset>
 
 namespace ns3 {
 namespace lorawan {
@@ -39,6 +40,7 @@ LogicalLoraChannelHelper::GetTypeId (void)
 }
 
 LogicalLoraChannelHelper::LogicalLoraChannelHelper () :
+  m_enabledChannels (0),
   m_nextAggregatedTransmissionTime (Seconds (0)),
   m_aggregatedDutyCycle (1)
 {
@@ -50,18 +52,56 @@ LogicalLoraChannelHelper::~LogicalLoraChannelHelper ()
   NS_LOG_FUNCTION (this);
 }
 
+void
+LogicalLoraChannelHelper::SetRegionPlan (Ptr<RegionPlan> plan)
+{
+  NS_LOG_FUNCTION (this << plan);
+
+  NS_ABORT_MSG_IF (plan->GetChannels ().size () > 64,
+                   "LogicalLoraChannelHelper supports at most 64 channels");
+
+  m_plan = plan;
+  m_nextTransmissionTimes.assign (plan->GetSubBands ().size (), Seconds (0));
+  m_enabledChannels = 0;
+  for (uint8_t i = 0; i < GetNChannels (); i++)
+    {
+      if (m_plan->GetChannels ()[i]->IsEnabledForUplink ())
+        {
+          m_enabledChannels |= uint64_t (1) << i;
+        }
+    }
+}
+
+Ptr<RegionPlan>
+LogicalLoraChannelHelper::GetRegionPlan (void) const
+{
+  return m_plan;
+}
+
+void
+LogicalLoraChannelHelper::PrepareToModifyPlan (void)
+{
+  if (m_plan == 0)
+    {
+      m_plan = CreateObject<RegionPlan> ();
+    }
+  else if (m_plan->GetReferenceCount () > 1)
+    {
+      NS_LOG_DEBUG ("Copying the shared region plan");
+      m_plan = m_plan->Copy ();
+    }
+}
+
 std::vector<Ptr <LogicalLoraChannel> >
 LogicalLoraChannelHelper::GetChannelList (void)
 {
   NS_LOG_FUNCTION (this);
 
-  // Make a copy of the channel vector
-  std::vector<Ptr<LogicalLoraChannel> > vector;
-  vector.reserve (m_channelList.size ());
-  std::copy (m_channelList.begin (), m_channelList.end (), std::back_inserter
-               (vector));
-
-  return vector;
+  if (m_plan == 0)
+    {
+      return std::vector<Ptr <LogicalLoraChannel> > ();
+    }
+  return m_plan->GetChannels ();
 }
 
 
@@ -70,49 +110,176 @@ LogicalLoraChannelHelper::GetEnabledChannelList (void)
 {
   NS_LOG_FUNCTION (this);
 
-  // Make a copy of the channel vector
-  std::vector<Ptr<LogicalLoraChannel> > vector;
-  vector.reserve (m_channelList.size ());
-  std::copy (m_channelList.begin (), m_channelList.end (), std::back_inserter
-               (vector));     // Working on a copy
-
   std::vector<Ptr <LogicalLoraChannel> > channels;
-  std::vector<Ptr <LogicalLoraChannel> >::iterator it;
-  for (it = vector.begin (); it != vector.end (); it++)
+  for (uint8_t i = 0; i < GetNChannels (); i++)
     {
-      if ((*it)->IsEnabledForUplink ())
+      if (IsChannelEnabled (i))
         {
-          channels.push_back (*it);
+          channels.push_back (m_plan->GetChannels ()[i]);
         }
     }
 
   return channels;
 }
 
+Ptr<LogicalLoraChannel>
+LogicalLoraChannelHelper::GetRandomEnabledChannel (Ptr<UniformRandomVariable> rv,
+                                                   bool onlyAvailable)
+{
+  NS_LOG_FUNCTION (this << onlyAvailable);
+
+  uint64_t candidates = m_enabledChannels;
+  if (onlyAvailable)
+    {
+      for (uint8_t i = 0; i < GetNChannels (); i++)
+        {
+          if (IsChannelEnabled (i)
+              && GetSubBandWaitingTime (m_plan->GetChannelSubBandIndex (i)) > Time (0))
+            {
+              candidates &= ~(uint64_t (1) << i);
+            }
+        }
+    }
+
+  uint32_t nCandidates = std::bitset<64> (candidates).count ();
+  if (nCandidates == 0)
+    {
+      NS_LOG_DEBUG ("No suitable channel was found");
+      return 0;
+    }
+
+  // Return the n-th candidate
+  uint32_t n = rv->GetInteger (0, nCandidates - 1);
+  const std::vector<Ptr<LogicalLoraChannel> > &channels = m_plan->GetChannels ();
+  for (uint8_t i = 0; i < channels.size (); i++)
+    {
+      if ((candidates >> i) & 1)
+        {
+          if (n == 0)
+            {
+              NS_LOG_DEBUG ("Picked channel " << unsigned (i) << " at " <<
+                            channels[i]->GetFrequency () << " MHz");
+              return channels[i];
+            }
+          n--;
+        }
+    }
+
+  NS_ASSERT_MSG (false, "Channel mask is out of sync with the channel list");
+  return 0;
+}
+
+uint8_t
+LogicalLoraChannelHelper::GetNChannels (void) const
+{
+  if (m_plan == 0)
+    {
+      return 0;
+    }
+  return m_plan->GetChannels ().size ();
+}
+
+Ptr<LogicalLoraChannel>
+LogicalLoraChannelHelper::GetChannel (uint8_t index) const
+{
+  NS_ABORT_MSG_IF (index >= GetNChannels (), "Invalid channel index " <<
+                   unsigned (index));
+
+  return m_plan->GetChannels ()[index];
+}
+
+void
+LogicalLoraChannelHelper::SetChannelEnabled (uint8_t index, bool enabled)
+{
+  NS_LOG_FUNCTION (this << unsigned (index) << enabled);
+
+  NS_ABORT_MSG_IF (index >= GetNChannels (), "Invalid channel index " <<
+                   unsigned (index));
+
+  // Only the mask changes: the channel object may be shared with other devices
+  if (enabled)
+    {
+      m_enabledChannels |= uint64_t (1) << index;
+    }
+  else
+    {
+      m_enabledChannels &= ~(uint64_t (1) << index);
+    }
+}
+
+bool
+LogicalLoraChannelHelper::IsChannelEnabled (uint8_t index) const
+{
+  return (m_enabledChannels >> index) & 1;
+}
+
+uint64_t
+LogicalLoraChannelHelper::GetEnabledChannelMask (void) const
+{
+  return m_enabledChannels;
+}
+
 Ptr<SubBand>
 LogicalLoraChannelHelper::GetSubBandFromChannel (Ptr<LogicalLoraChannel>
                                                  channel)
 {
-  return GetSubBandFromFrequency (channel->GetFrequency ());
+  return m_plan->GetSubBands ()[GetSubBandIndexForChannel (channel)];
 }
 
 Ptr<SubBand>
 LogicalLoraChannelHelper::GetSubBandFromFrequency (double frequency)
 {
   // Get the SubBand this frequency belongs to
-  std::list< Ptr< SubBand > >::iterator it;
-  for (it = m_subBandList.begin (); it != m_subBandList.end (); it++)
+  int index = GetSubBandIndex (frequency);
+  if (index < 0)
     {
-      if ((*it)->BelongsToSubBand (frequency))
+      NS_LOG_ERROR ("Requested frequency: " << frequency);
+      NS_ABORT_MSG ("Warning: frequency is outside any known SubBand.");
+
+      return 0;     // If no SubBand is found, return 0
+    }
+
+  return m_plan->GetSubBands ()[index];
+}
+
+int
+LogicalLoraChannelHelper::GetSubBandIndex (double frequency) const
+{
+  if (m_plan == 0)
+    {
+      return -1;
+    }
+  return m_plan->GetSubBandIndex (frequency);
+}
+
+int
+LogicalLoraChannelHelper::GetSubBandIndexForChannel (Ptr<LogicalLoraChannel> channel) const
+{
+  int index = -1;
+
+  // Channels managed by this helper have their SubBand already resolved
+  bool found = false;
+  for (uint8_t i = 0; i < GetNChannels (); i++)
+    {
+      if (PeekPointer (m_plan->GetChannels ()[i]) == PeekPointer (channel))
         {
-          return *it;
+          index = m_plan->GetChannelSubBandIndex (i);
+          found = true;
+          break;
         }
     }
+  if (!found)
+    {
+      index = GetSubBandIndex (channel->GetFrequency ());
+    }
 
-  NS_LOG_ERROR ("Requested frequency: " << frequency);
-  NS_ABORT_MSG ("Warning: frequency is outside any known SubBand.");
+  if (index < 0)
+    {
+      NS_LOG_ERROR ("Requested frequency: " << channel->GetFrequency ());
+      NS_ABORT_MSG ("Warning: frequency is outside any known SubBand.");
+    }
 
-  return 0;     // If no SubBand is found, return 0
+  return index;
 }
 
 void
@@ -124,10 +291,10 @@ LogicalLoraChannelHelper::AddChannel (double frequency)
   Ptr<LogicalLoraChannel> channel = Create<LogicalLoraChannel> (frequency);
 
   // Add it to the list
-  m_channelList.push_back (channel);
+  AddChannel (channel);
 
   NS_LOG_DEBUG ("Added a channel. Current number of channels in list is " <<
-                m_channelList.size ());
+                unsigned (GetNChannels ()));
 }
 
 void
@@ -135,8 +302,14 @@ LogicalLoraChannelHelper::AddChannel (Ptr<LogicalLoraChannel> logicalChannel)
 {
   NS_LOG_FUNCTION (this << logicalChannel);
 
+  NS_ABORT_MSG_IF (GetNChannels () >= 64,
+                   "LogicalLoraChannelHelper supports at most 64 channels");
+
   // Add it to the list
-  m_channelList.push_back (logicalChannel);
+  PrepareToModifyPlan ();
+  m_plan->AddChannel (logicalChannel);
+  SetChannelEnabled (GetNChannels () - 1,
+                     logicalChannel->IsEnabledForUplink ());
 }
 
 void
@@ -146,7 +319,9 @@ LogicalLoraChannelHelper::SetChannel (uint8_t chIndex,
 {
   NS_LOG_FUNCTION (this << chIndex << logicalChannel);
 
-  m_channelList.at (chIndex) = logicalChannel;
+  PrepareToModifyPlan ();
+  m_plan->SetChannel (chIndex, logicalChannel);
+  SetChannelEnabled (chIndex, logicalChannel->IsEnabledForUplink ());
 }
 
 void
@@ -159,7 +334,7 @@ LogicalLoraChannelHelper::AddSubBand (double firstFrequency,
   Ptr<SubBand> subBand = Create<SubBand> (firstFrequency, lastFrequency,
                                           dutyCycle, maxTxPowerDbm);
 
-  m_subBandList.push_back (subBand);
+  AddSubBand (subBand);
 }
 
 void
@@ -167,20 +342,26 @@ LogicalLoraChannelHelper::AddSubBand (Ptr<SubBand> subBand)
 {
   NS_LOG_FUNCTION (this << subBand);
 
-  m_subBandList.push_back (subBand);
+  PrepareToModifyPlan ();
+  m_plan->AddSubBand (subBand);
+  m_nextTransmissionTimes.push_back (Seconds (0));
 }
 
 void
 LogicalLoraChannelHelper::RemoveChannel (Ptr<LogicalLoraChannel> logicalChannel)
 {
   // Search and remove the channel from the list
-  std::vector<Ptr<LogicalLoraChannel> >::iterator it;
-  for (it = m_channelList.begin (); it != m_channelList.end (); it++)
+  for (uint8_t i = 0; i < GetNChannels (); i++)
     {
-      Ptr<LogicalLoraChannel> currentChannel = *it;
-      if (currentChannel == logicalChannel)
+      if (m_plan->GetChannels ()[i] == logicalChannel)
         {
-          m_channelList.erase (it);
+          PrepareToModifyPlan ();
+          m_plan->RemoveChannel (i);
+
+          // Shift the mask of the following channels down by one
+          uint64_t lower = m_enabledChannels & ((uint64_t (1) << i) - 1);
+          uint64_t upper = (i + 1 < 64) ? (m_enabledChannels >> (i + 1)) << i : 0;
+          m_enabledChannels = lower | upper;
           return;
         }
     }
@@ -202,37 +383,91 @@ LogicalLoraChannelHelper::GetAggregatedWaitingTime (void)
 }
 
 Time
-LogicalLoraChannelHelper::GetWaitingTime (Ptr<LogicalLoraChannel> channel)
+LogicalLoraChannelHelper::GetSubBandWaitingTime (int subBandIndex) const
 {
-  NS_LOG_FUNCTION (this << channel);
+  NS_ABORT_MSG_IF (subBandIndex < 0, "Frequency is outside any known SubBand.");
 
   // SubBand waiting time
-  Time subBandWaitingTime = GetSubBandFromChannel (channel)->
-    GetNextTransmissionTime () -
+  Time subBandWaitingTime = m_nextTransmissionTimes[subBandIndex] -
     Simulator::Now ();
 
   // Handle case in which waiting time is negative
-  subBandWaitingTime = Seconds (std::max (subBandWaitingTime.GetSeconds (),
-                                          double(0)));
+  return std::max (subBandWaitingTime, Time (0));
+}
+
+Time
+LogicalLoraChannelHelper::GetWaitingTime (Ptr<LogicalLoraChannel> channel)
+{
+  NS_LOG_FUNCTION (this << channel);
+
+  Time subBandWaitingTime = GetSubBandWaitingTime (GetSubBandIndexForChannel (channel));
 
   NS_LOG_DEBUG ("Waiting time: " << subBandWaitingTime.GetSeconds ());
 
   return subBandWaitingTime;
 }
 
+Time
+LogicalLoraChannelHelper::GetWaitingTime (double frequency)
+{
+  NS_LOG_FUNCTION (this << frequency);
+
+  Time subBandWaitingTime = GetSubBandWaitingTime (GetSubBandIndex (frequency));
+
+  NS_LOG_DEBUG ("Waiting time: " << subBandWaitingTime.GetSeconds ());
+
+  return subBandWaitingTime;
+}
+
+Time
+LogicalLoraChannelHelper::GetMinimumWaitingTime (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Time waitingTime = Time::Max ();
+  for (uint8_t i = 0; i < GetNChannels (); i++)
+    {
+      if (IsChannelEnabled (i))
+        {
+          waitingTime = std::min (waitingTime,
+                                  GetSubBandWaitingTime (m_plan->GetChannelSubBandIndex (i)));
+        }
+    }
+
+  NS_LOG_DEBUG ("Minimum waiting time: " << waitingTime.GetSeconds ());
+
+  return waitingTime;
+}
+
 void
 LogicalLoraChannelHelper::AddEvent (Time duration,
                                     Ptr<LogicalLoraChannel> channel)
 {
   NS_LOG_FUNCTION (this << duration << channel);
 
-  Ptr<SubBand> subBand = GetSubBandFromChannel (channel);
+  AddSubBandEvent (duration, GetSubBandIndexForChannel (channel));
+}
+
+void
+LogicalLoraChannelHelper::AddEvent (Time duration, double frequency)
+{
+  NS_LOG_FUNCTION (this << duration << frequency);
+
+  int subBandIndex = GetSubBandIndex (frequency);
+  NS_ABORT_MSG_IF (subBandIndex < 0, "Frequency " << frequency <<
+                   " is outside any known SubBand.");
+
+  AddSubBandEvent (duration, subBandIndex);
+}
 
-  double dutyCycle = subBand->GetDutyCycle ();
+void
+LogicalLoraChannelHelper::AddSubBandEvent (Time duration, int subBandIndex)
+{
+  double dutyCycle = m_plan->GetSubBands ()[subBandIndex]->GetDutyCycle ();
   double timeOnAir = duration.GetSeconds ();
 
   // Computation of necessary waiting time on this sub-band
-  subBand->SetNextTransmissionTime (Simulator::Now () + Seconds(timeOnAir / dutyCycle - timeOnAir));
+  m_nextTransmissionTimes[subBandIndex] = Simulator::Now () + Seconds(timeOnAir / dutyCycle - timeOnAir);
   
   // Computation of necessary aggregate waiting time
   m_nextAggregatedTransmissionTime = Simulator::Now () + Seconds(timeOnAir / m_aggregatedDutyCycle - timeOnAir);
@@ -241,7 +476,7 @@ LogicalLoraChannelHelper::AddEvent (Time duration,
   NS_LOG_DEBUG ("m_aggregatedDutyCycle: " << m_aggregatedDutyCycle);
   NS_LOG_DEBUG ("Current time: " << Simulator::Now ().GetSeconds ());
   NS_LOG_DEBUG ("Next transmission on this sub-band allowed at time: " <<
-                (subBand->GetNextTransmissionTime ()).GetSeconds ());
+                m_nextTransmissionTimes[subBandIndex].GetSeconds ());
   NS_LOG_DEBUG ("Next aggregated transmission allowed at time " <<
                 m_nextAggregatedTransmissionTime.GetSeconds ());
 }
@@ -253,18 +488,21 @@ LogicalLoraChannelHelper::GetTxPowerForChannel (Ptr<LogicalLoraChannel>
   NS_LOG_FUNCTION_NOARGS ();
 
   // Get the maxTxPowerDbm from the SubBand this channel is in
-  std::list< Ptr< SubBand > >::iterator it;
-  for (it = m_subBandList.begin (); it != m_subBandList.end (); it++)
-    {
-      // Check whether this channel is in this SubBand
-      if ((*it)->BelongsToSubBand (logicalChannel->GetFrequency ()))
-        {
-          return (*it)->GetMaxTxPowerDbm ();
-        }
-    }
-  NS_ABORT_MSG ("Logical channel doesn't belong to a known SubBand");
+  int index = GetSubBandIndexForChannel (logicalChannel);
+  NS_ABORT_MSG_IF (index < 0, "Logical channel doesn't belong to a known SubBand");
 
-  return 0;
+  return m_plan->GetSubBands ()[index]->GetMaxTxPowerDbm ();
+}
+
+double
+LogicalLoraChannelHelper::GetTxPowerForFrequency (double frequency)
+{
+  NS_LOG_FUNCTION (this << frequency);
+
+  int index = GetSubBandIndex (frequency);
+  NS_ABORT_MSG_IF (index < 0, "Frequency doesn't belong to a known SubBand");
+
+  return m_plan->GetSubBands ()[index]->GetMaxTxPowerDbm ();
 }
 
 void
@@ -272,7 +510,7 @@ LogicalLoraChannelHelper::DisableChannel (int index)
 {
   NS_LOG_FUNCTION (this << index);
 
-  m_channelList.at (index)->DisableForUplink ();
+  SetChannelEnabled (index, false);
 }
 }
 }
@@ -26,6 +26,8 @@
 #include "ns3/nstime.h"
 #include "ns3/packet.h"
 #include "ns3/sub-band.h"
+#include "ns3/region-plan.h"
+#include "ns3/random-variable-stream.h"
 #include <list>
 #include <iterator>
 #include <vector>
@@ -41,6 +43,18 @@ namespace lorawan {
  * This class also takes into account duty cycle limitations, by updating a list
  * of SubBand objects and providing methods to query whether transmission on a
  * set channel is admissible or not.
+ *
+ * The SubBand of each channel is resolved when the channel (or the SubBand) is
+ * registered, and the channel mask is kept as a bitmask, so that picking a
+ * channel and bookkeeping duty cycle on the transmission path do not allocate.
+ * At most 64 channels can be managed.
+ *
+ * The channels and SubBands themselves are kept in a RegionPlan, which is
+ * shared with the other devices configured for the same region: this helper
+ * only stores, for each SubBand, the time at which the next transmission is
+ * allowed, plus the channel mask. The plan is copied the first time this
+ * helper's channels or SubBands are modified, so that other devices are not
+ * affected.
  */
 class LogicalLoraChannelHelper : public Object
 {
@@ -50,6 +64,20 @@ public:
   LogicalLoraChannelHelper ();
   virtual ~LogicalLoraChannelHelper ();
 
+  /**
+   * Use a (possibly shared) RegionPlan as the channels and SubBands of this
+   * helper. This enables the plan's channels for which IsEnabledForUplink
+   * holds, and resets the duty cycle timers.
+   *
+   * \param plan The plan, which is not modified by this helper.
+   */
+  void SetRegionPlan (Ptr<RegionPlan> plan);
+
+  /**
+   * Get the RegionPlan holding this helper's channels and SubBands.
+   */
+  Ptr<RegionPlan> GetRegionPlan (void) const;
+
   /**
    * Get the time it is necessary to wait before transmitting again, according
    * to the aggregate duty cycle timer.
@@ -72,6 +100,25 @@ public:
    */
   Time GetWaitingTime (Ptr<LogicalLoraChannel> channel);
 
+  /**
+   * Get the time it is necessary to wait for before transmitting on a given
+   * frequency.
+   *
+   * \param frequency The frequency, in MHz.
+   * \return The waiting time imposed by the duty cycle of the frequency's
+   * SubBand.
+   */
+  Time GetWaitingTime (double frequency);
+
+  /**
+   * Get the minimum time it is necessary to wait for before transmitting on
+   * any of the channels enabled for uplink.
+   *
+   * \return The minimum waiting time, or Time::Max () if no channel is
+   * enabled.
+   */
+  Time GetMinimumWaitingTime (void);
+
   /**
    * Register the transmission of a packet.
    *
@@ -80,6 +127,14 @@ public:
    */
   void AddEvent (Time duration, Ptr<LogicalLoraChannel> channel);
 
+  /**
+   * Register the transmission of a packet.
+   *
+   * \param duration The duration of the transmission event.
+   * \param frequency The frequency the transmission was made on, in MHz.
+   */
+  void AddEvent (Time duration, double frequency);
+
   /**
    * Get the list of LogicalLoraChannels currently registered on this helper.
    *
@@ -95,6 +150,45 @@ public:
    */
   std::vector<Ptr<LogicalLoraChannel> > GetEnabledChannelList (void);
 
+  /**
+   * Pick one of the channels enabled for uplink uniformly at random.
+   *
+   * \param rv The random variable to draw from.
+   * \param onlyAvailable Whether to only consider channels on which duty
+   * cycle allows to transmit immediately.
+   * \return The channel, or 0 if no channel qualifies.
+   */
+  Ptr<LogicalLoraChannel> GetRandomEnabledChannel (Ptr<UniformRandomVariable> rv,
+                                                   bool onlyAvailable);
+
+  /**
+   * Get the number of channels registered on this helper.
+   */
+  uint8_t GetNChannels (void) const;
+
+  /**
+   * Get the channel at a specified index.
+   */
+  Ptr<LogicalLoraChannel> GetChannel (uint8_t index) const;
+
+  /**
+   * Enable or disable the channel at a specified index for uplink.
+   *
+   * \param index The index of the channel.
+   * \param enabled Whether the channel can be used for uplink.
+   */
+  void SetChannelEnabled (uint8_t index, bool enabled);
+
+  /**
+   * Test whether the channel at a specified index is enabled for uplink.
+   */
+  bool IsChannelEnabled (uint8_t index) const;
+
+  /**
+   * Get the channel mask, bit i being set if channel i is enabled for uplink.
+   */
+  uint64_t GetEnabledChannelMask (void) const;
+
   /**
    * Add a new channel to the list.
    *
@@ -152,9 +246,21 @@ public:
    */
   double GetTxPowerForChannel (Ptr<LogicalLoraChannel> logicalChannel);
 
+  /**
+   * Returns the maximum transmission power [dBm] that is allowed on a
+   * frequency.
+   *
+   * \param frequency The frequency, in MHz.
+   * \return The power in dBm.
+   */
+  double GetTxPowerForFrequency (double frequency);
+
   /**
    * Get the SubBand a channel belongs to.
    *
+   * \remark SubBands may be shared among devices, so the next transmission
+   * time they report is not this device's: use GetWaitingTime instead.
+   *
    * \param channel The channel whose SubBand we want to get.
    * \return The SubBand the channel belongs to.
    */
@@ -177,16 +283,48 @@ public:
 
 private:
   /**
-   * A list of the SubBands that are currently registered within this helper.
+   * Get the index of the SubBand a frequency belongs to, or -1.
+   */
+  int GetSubBandIndex (double frequency) const;
+
+  /**
+   * Get the index of the SubBand a channel belongs to, using the index
+   * resolved at registration time if the channel is managed by this helper.
+   * Aborts if the channel is outside any known SubBand.
+   */
+  int GetSubBandIndexForChannel (Ptr<LogicalLoraChannel> channel) const;
+
+  /**
+   * Get the waiting time imposed by the duty cycle of a SubBand.
+   */
+  Time GetSubBandWaitingTime (int subBandIndex) const;
+
+  /**
+   * Register a transmission on a SubBand.
+   */
+  void AddSubBandEvent (Time duration, int subBandIndex);
+
+  /**
+   * Make sure m_plan is not shared with anybody else before modifying it.
+   */
+  void PrepareToModifyPlan (void);
+
+  /**
+   * The channels and SubBands used by this helper. The first N channels are
+   * the default ones for a fixed region.
+   */
+  Ptr<RegionPlan> m_plan;
+
+  /**
+   * The time at which transmission will be possible on each of the plan's
+   * SubBands.
    */
-  std::list<Ptr <SubBand> > m_subBandList;
+  std::vector<Time> m_nextTransmissionTimes;
 
   /**
-   * A vector of the LogicalLoraChannels that are currently registered within
-   * this helper. This vector represents the node's channel mask. The first N
-   * channels are the default ones for a fixed region.
+   * The node's channel mask: bit i is set if channel i is enabled for uplink.
    */
-  std::vector<Ptr <LogicalLoraChannel> > m_channelList;
+  uint64_t m_enabledChannels;
 
   Time m_nextAggregatedTransmissionTime; //!< The next time at which
   //!transmission will be possible
@@ -20,6 +20,7 @@
 
 #include "ns3/lora-frame-header.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include <bitset>
 
 namespace ns3 {
@@ -36,6 +37,7 @@ LoraFrameHeader::LoraFrameHeader () :
   m_ack       (0),
   m_fPending  (0),
   m_fOptsLen  (0),
+  m_nUndecodedFOptsBytes (0),
   m_fCnt      (0)
 {
 }
@@ -101,7 +103,7 @@ LoraFrameHeader::Serialize (Buffer::Iterator start) const
   for (auto it = m_macCommands.begin (); it != m_macCommands.end (); it++)
     {
       NS_LOG_DEBUG ("Serializing a MAC command");
-      (*it)->Serialize (start);
+      it->Serialize (start);
     }
 
   // FPort
@@ -123,7 +125,8 @@ LoraFrameHeader::Deserialize (Buffer::Iterator start)
   NS_LOG_FUNCTION_NOARGS ();
 
   // Empty the list of MAC commands
-  m_macCommands.clear ();
+  m_macCommands.Clear ();
+  m_nUndecodedFOptsBytes = 0;
 
   // Read from buffer and save into local variables
   m_address.Set (start.ReadU32 ());
@@ -150,173 +153,25 @@ LoraFrameHeader::Deserialize (Buffer::Iterator start)
   NS_LOG_DEBUG ("Starting deserialization of MAC commands");
   for (uint8_t byteNumber = 0; byteNumber < m_fOptsLen;)
     {
-      uint8_t cid = start.PeekU8 ();
-      NS_LOG_DEBUG ("CID: " << unsigned(cid));
-
-      // Divide Uplink and Downlink messages
-      // This needs to be done because they have the same CID, and the context
-      // about where this message will be Serialized/Deserialized (i.e., at the
-      // ED or at the NS) is umportant.
-      if (m_isUplink)
+      // Uplink and downlink commands share the CIDs, so the direction of
+      // this message decides which command a CID stands for
+      MacCommandValue command;
+      uint8_t size = command.Deserialize (start, m_isUplink);
+      if (size == 0)
         {
-          switch (cid)
-            {
-            // In the case of Uplink messages, the NS will deserialize the
-            // request for a link check
-            case (0x02):
-              {
-                NS_LOG_DEBUG ("Creating a LinkCheckReq command");
-                Ptr<LinkCheckReq> command = Create <LinkCheckReq> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x03):
-              {
-                NS_LOG_DEBUG ("Creating a LinkAdrAns command");
-                Ptr<LinkAdrAns> command = Create <LinkAdrAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x04):
-              {
-                NS_LOG_DEBUG ("Creating a DutyCycleAns command");
-                Ptr<DutyCycleAns> command = Create <DutyCycleAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x05):
-              {
-                NS_LOG_DEBUG ("Creating a RxParamSetupAns command");
-                Ptr<RxParamSetupAns> command = Create <RxParamSetupAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x06):
-              {
-                NS_LOG_DEBUG ("Creating a DevStatusAns command");
-                Ptr<DevStatusAns> command = Create <DevStatusAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x07):
-              {
-                NS_LOG_DEBUG ("Creating a NewChannelAns command");
-                Ptr<NewChannelAns> command = Create <NewChannelAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x08):
-              {
-                NS_LOG_DEBUG ("Creating a RxTimingSetupAns command");
-                Ptr<RxTimingSetupAns> command = Create <RxTimingSetupAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x09):
-              {
-                NS_LOG_DEBUG ("Creating a TxParamSetupAns command");
-                Ptr<TxParamSetupAns> command = Create <TxParamSetupAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x0A):
-              {
-                NS_LOG_DEBUG ("Creating a DlChannelAns command");
-                Ptr<DlChannelAns> command = Create <DlChannelAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            default:
-              {
-                NS_LOG_ERROR ("CID not recognized during deserialization");
-              }
-            }
-        }
-      else
-        {
-          switch (cid)
-            {
-            // In the case of Downlink messages, the ED will deserialize the
-            // answer to a link check
-            case (0x02):
-              {
-                NS_LOG_DEBUG ("Creating a LinkCheckAns command");
-                Ptr<LinkCheckAns> command = Create <LinkCheckAns> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x03):
-              {
-                NS_LOG_DEBUG ("Creating a LinkAdrReq command");
-                Ptr<LinkAdrReq> command = Create <LinkAdrReq> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x04):
-              {
-                NS_LOG_DEBUG ("Creating a DutyCycleReq command");
-                Ptr<DutyCycleReq> command = Create <DutyCycleReq> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x05):
-              {
-                NS_LOG_DEBUG ("Creating a RxParamSetupReq command");
-                Ptr<RxParamSetupReq> command = Create <RxParamSetupReq> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x06):
-              {
-                NS_LOG_DEBUG ("Creating a DevStatusReq command");
-                Ptr<DevStatusReq> command = Create <DevStatusReq> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x07):
-              {
-                NS_LOG_DEBUG ("Creating a NewChannelReq command");
-                Ptr<NewChannelReq> command = Create <NewChannelReq> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x08):
-              {
-                NS_LOG_DEBUG ("Creating a RxTimingSetupReq command");
-                Ptr<RxTimingSetupReq> command = Create <RxTimingSetupReq> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            case (0x09):
-              {
-                NS_LOG_DEBUG ("Creating a TxParamSetupReq command");
-                Ptr<TxParamSetupReq> command = Create <TxParamSetupReq> ();
-                byteNumber += command->Deserialize (start);
-                m_macCommands.push_back (command);
-                break;
-              }
-            default:
-              {
-                NS_LOG_ERROR ("CID not recognized during deserialization");
-              }
-            }
+          // We can't tell where the next command starts: keep the commands
+          // decoded so far and skip the rest of FOpts
+          m_nUndecodedFOptsBytes = m_fOptsLen - byteNumber;
+          NS_LOG_WARN ("Unknown CID " << unsigned (start.PeekU8 ()) <<
+                       ": skipping the last " << unsigned (m_nUndecodedFOptsBytes) <<
+                       " bytes of FOpts, after " << unsigned (m_macCommands.GetN ()) <<
+                       " decoded commands");
+          start.Next (m_nUndecodedFOptsBytes);
+          break;
         }
+      NS_LOG_DEBUG ("Deserialized a command of type " << command.GetCommandType ());
+      byteNumber += size;
+      m_macCommands.Add (command);
     }
 
   m_fPort = uint8_t (start.ReadU8 ());
@@ -339,7 +194,7 @@ LoraFrameHeader::Print (std::ostream &os) const
 
   for (auto it = m_macCommands.begin (); it != m_macCommands.end (); it++)
     {
-      (*it)->Print (os);
+      it->ToMacCommand ()->Print (os);
     }
 
   os << "FPort=" << unsigned(m_fPort) << std::endl;
@@ -435,13 +290,7 @@ uint8_t
 LoraFrameHeader::GetFOptsLen (void) const
 {
   // Sum the serialized lenght of all commands in the list
-  uint8_t fOptsLen = 0;
-  std::list< Ptr< MacCommand> >::const_iterator it;
-  for (it = m_macCommands.begin (); it != m_macCommands.end (); it++)
-    {
-      fOptsLen = fOptsLen + (*it)->GetSerializedSize ();
-    }
-  return fOptsLen;
+  return m_macCommands.GetSerializedSize ();
 }
 
 void
@@ -461,11 +310,7 @@ LoraFrameHeader::AddLinkCheckReq (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
-  Ptr<LinkCheckReq> command = Create<LinkCheckReq> ();
-  m_macCommands.push_back (command);
-
-  NS_LOG_DEBUG ("Command SerializedSize: " << unsigned(command->GetSerializedSize ()));
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue (LINK_CHECK_REQ));
 }
 
 void
@@ -473,10 +318,7 @@ LoraFrameHeader::AddLinkCheckAns (uint8_t margin, uint8_t gwCnt)
 {
   NS_LOG_FUNCTION (this << unsigned(margin) << unsigned(gwCnt));
 
-  Ptr<LinkCheckAns> command = Create<LinkCheckAns> (margin, gwCnt);
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue::CreateLinkCheckAns (margin, gwCnt));
 }
 
 void
@@ -496,10 +338,7 @@ LoraFrameHeader::AddLinkAdrReq (uint8_t dataRate, uint8_t txPower, std::list<int
 
   NS_LOG_DEBUG ("Creating LinkAdrReq with: DR = " << unsigned(dataRate) << " and txPower = " << unsigned(txPower));
 
-  Ptr<LinkAdrReq> command = Create<LinkAdrReq> (dataRate, txPower, channelMask, 0, repetitions);
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue::CreateLinkAdrReq (dataRate, txPower, channelMask, 0, repetitions));
 }
 
 void
@@ -507,10 +346,7 @@ LoraFrameHeader::AddLinkAdrAns (bool powerAck, bool dataRateAck, bool channelMas
 {
   NS_LOG_FUNCTION (this << powerAck << dataRateAck << channelMaskAck);
 
-  Ptr<LinkAdrAns> command = Create<LinkAdrAns> (powerAck, dataRateAck, channelMaskAck);
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue::CreateLinkAdrAns (powerAck, dataRateAck, channelMaskAck));
 }
 
 void
@@ -518,11 +354,7 @@ LoraFrameHeader::AddDutyCycleReq (uint8_t dutyCycle)
 {
   NS_LOG_FUNCTION (this << unsigned (dutyCycle));
 
-  Ptr<DutyCycleReq> command = Create<DutyCycleReq> (dutyCycle);
-
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue::CreateDutyCycleReq (dutyCycle));
 }
 
 void
@@ -530,11 +362,7 @@ LoraFrameHeader::AddDutyCycleAns (void)
 {
   NS_LOG_FUNCTION (this);
 
-  Ptr<DutyCycleAns> command = Create<DutyCycleAns> ();
-
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue (DUTY_CYCLE_ANS));
 }
 
 void
@@ -546,13 +374,8 @@ LoraFrameHeader::AddRxParamSetupReq (uint8_t rx1DrOffset, uint8_t rx2DataRate, d
   // Evaluate whether to eliminate this assert in case new offsets can be defined.
   NS_ASSERT (0 <= rx1DrOffset && rx1DrOffset <= 5);
 
-  Ptr<RxParamSetupReq> command = Create<RxParamSetupReq> (rx1DrOffset,
-                                                          rx2DataRate,
-                                                          frequency);
-
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue::CreateRxParamSetupReq (rx1DrOffset, rx2DataRate,
+                                                      frequency));
 }
 
 void
@@ -560,11 +383,7 @@ LoraFrameHeader::AddRxParamSetupAns (void)
 {
   NS_LOG_FUNCTION (this);
 
-  Ptr<RxParamSetupAns> command = Create<RxParamSetupAns> ();
-
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue (RX_PARAM_SETUP_ANS));
 }
 
 void
@@ -572,11 +391,7 @@ LoraFrameHeader::AddDevStatusReq (void)
 {
   NS_LOG_FUNCTION (this);
 
-  Ptr<DevStatusReq> command = Create<DevStatusReq> ();
-
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue (DEV_STATUS_REQ));
 }
 
 void
@@ -585,12 +400,8 @@ LoraFrameHeader::AddNewChannelReq (uint8_t chIndex, double frequency,
 {
   NS_LOG_FUNCTION (this);
 
-  Ptr<NewChannelReq> command = Create<NewChannelReq> (chIndex, frequency,
-                                                      minDataRate, maxDataRate);
-
-  m_macCommands.push_back (command);
-
-  m_fOptsLen += command->GetSerializedSize ();
+  AddCommand (MacCommandValue::CreateNewChannelReq (chIndex, frequency,
+                                                    minDataRate, maxDataRate));
 }
 
 std::list<Ptr<MacCommand> >
@@ -598,16 +409,42 @@ LoraFrameHeader::GetCommands (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
 
+  std::list<Ptr<MacCommand> > commands;
+  for (auto it = m_macCommands.begin (); it != m_macCommands.end (); it++)
+    {
+      commands.push_back (it->ToMacCommand ());
+    }
+  return commands;
+}
+
+const MacCommandList &
+LoraFrameHeader::GetCommandValues (void) const
+{
   return m_macCommands;
 }
 
+uint8_t
+LoraFrameHeader::GetNUndecodedFOptsBytes (void) const
+{
+  return m_nUndecodedFOptsBytes;
+}
+
 void
 LoraFrameHeader::AddCommand (Ptr<MacCommand> macCommand)
 {
   NS_LOG_FUNCTION (this << macCommand);
 
-  m_macCommands.push_back (macCommand);
-  m_fOptsLen += macCommand->GetSerializedSize ();
+  AddCommand (MacCommandValue::FromMacCommand (macCommand));
+}
+
+void
+LoraFrameHeader::AddCommand (const MacCommandValue &macCommand)
+{
+  NS_ABORT_MSG_IF (m_fOptsLen + macCommand.GetSerializedSize () > 15,
+                   "MAC commands exceed the 15 bytes of FOpts");
+
+  m_macCommands.Add (macCommand);
+  m_fOptsLen += macCommand.GetSerializedSize ();
 }
 
 }
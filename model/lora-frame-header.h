@@ -208,6 +208,9 @@ public:
   /**
    * Return a pointer to a MacCommand, or 0 if the MacCommand does not exist
    * in this header.
+   *
+   * \remark This creates MacCommand objects: use GetCommandValues ().Find ()
+   * where allocations matter.
    */
   template<typename T>
   inline Ptr<T> GetMacCommand (void);
@@ -287,14 +290,39 @@ public:
 
   /**
    * Return a list of pointers to all the MAC commands saved in this header.
+   *
+   * \remark This creates a MacCommand object for each command: use
+   * GetCommandValues where allocations matter.
    */
   std::list<Ptr<MacCommand> > GetCommands (void);
 
+  /**
+   * Get the MAC commands saved in this header.
+   */
+  const MacCommandList &GetCommandValues (void) const;
+
+  /**
+   * Get the number of FOpts bytes that could not be decoded by the last
+   * Deserialize call.
+   *
+   * Commands have no length field, so an unknown CID hides where the next
+   * command starts: the commands before it are kept, and the bytes from the
+   * unknown CID to the end of FOpts are skipped and counted here.
+   *
+   * \return The number of skipped bytes, 0 if all of FOpts was decoded.
+   */
+  uint8_t GetNUndecodedFOptsBytes (void) const;
+
   /**
    * Add a predefined command to the list.
    */
   void AddCommand (Ptr<MacCommand> macCommand);
 
+  /**
+   * Add a command to the list.
+   */
+  void AddCommand (const MacCommandValue &macCommand);
+
 private:
   uint8_t m_fPort;
 
@@ -305,16 +333,14 @@ private:
   bool m_ack;
   bool m_fPending;
   uint8_t m_fOptsLen;
+  uint8_t m_nUndecodedFOptsBytes;   //!< FOpts bytes after an unknown CID
 
   uint16_t m_fCnt;
 
-  Buffer m_fOpts;
-
   /**
-   * List containing all the MacCommand instances that are contained in this
-   * LoraFrameHeader.
+   * The MAC commands contained in this LoraFrameHeader.
    */
-  std::list< Ptr< MacCommand> > m_macCommands;
+  MacCommandList m_macCommands;
 
   bool m_isUplink;
 };
@@ -324,13 +350,13 @@ template<typename T>
 Ptr<T>
 LoraFrameHeader::GetMacCommand ()
 {
-  // Iterate on MAC commands and try casting
-  std::list< Ptr< MacCommand> >::const_iterator it;
-  for (it = m_macCommands.begin (); it != m_macCommands.end (); ++it)
+  // Create the MAC command objects and try casting
+  for (auto it = m_macCommands.begin (); it != m_macCommands.end (); ++it)
     {
-      if ((*it)->GetObject<T> () != 0)
+      Ptr<T> command = it->ToMacCommand ()->GetObject<T> ();
+      if (command != 0)
         {
-          return (*it)->GetObject<T> ();
+          return command;
         }
     }
 
@@ -22,6 +22,7 @@
 #include "ns3/log.h"
 #include "ns3/simulator.h"
 #include <algorithm>
+#include <cmath>
 
 namespace ns3 {
 namespace lorawan {
@@ -163,9 +164,127 @@ LoraPhy::GetTSym (LoraTxParameters txParams)
 Time
 LoraPhy::GetOnAirTime (Ptr<Packet> packet, LoraTxParameters txParams)
 {
-
   NS_LOG_FUNCTION (packet << txParams);
 
+  return GetOnAirTime (packet->GetSize (), txParams);
+}
+
+namespace {
+
+// Bounds of the time on air table
+const uint8_t kMinTableSf = 6;
+const uint8_t kMaxTableSf = 12;
+const uint32_t kTablePayloadSizes = 256;
+
+/**
+ * Number of payload symbols (header included) of a LoRa frame, computed with
+ * integer arithmetic from the formula of the SX1272 designer's guide.
+ */
+uint16_t
+ComputePayloadSymbols (uint32_t pl, uint8_t sf, uint8_t codingRate,
+                       bool h, bool crc, bool de)
+{
+  int32_t num = 8 * int32_t (pl) - 4 * sf + 28 + 16 * crc - 20 * h;
+  int32_t den = 4 * (sf - 2 * de);
+  // Integer division truncates towards zero, which is the ceiling for num < 0
+  int32_t ceiling = num > 0 ? (num + den - 1) / den : num / den;
+  return 8 + std::max (ceiling * (codingRate + 4), 0);
+}
+
+uint32_t
+GetPayloadSymbolIndex (uint32_t pl, uint8_t sf, uint8_t codingRate,
+                       bool h, bool crc, bool de)
+{
+  uint32_t flags = h | (crc << 1) | (de << 2);
+  return (((sf - kMinTableSf) * 4 + (codingRate - 1)) * 8 + flags)
+         * kTablePayloadSizes + pl;
+}
+
+} // namespace
+
+const std::vector<uint16_t> &
+LoraPhy::GetPayloadSymbolTable (void)
+{
+  static std::vector<uint16_t> table;
+
+  if (table.empty ())
+    {
+      uint32_t nSf = kMaxTableSf - kMinTableSf + 1;
+      table.resize (nSf * 4 * 8 * kTablePayloadSizes);
+      for (uint8_t sf = kMinTableSf; sf <= kMaxTableSf; sf++)
+        {
+          for (uint8_t cr = 1; cr <= 4; cr++)
+            {
+              for (uint8_t flags = 0; flags < 8; flags++)
+                {
+                  bool h = flags & 1;
+                  bool crc = flags & 2;
+                  bool de = flags & 4;
+                  for (uint32_t pl = 0; pl < kTablePayloadSizes; pl++)
+                    {
+                      table[GetPayloadSymbolIndex (pl, sf, cr, h, crc, de)] =
+                        ComputePayloadSymbols (pl, sf, cr, h, crc, de);
+                    }
+                }
+            }
+        }
+    }
+
+  return table;
+}
+
+Time
+LoraPhy::GetOnAirTime (uint32_t payloadSize, LoraTxParameters txParams)
+{
+  NS_LOG_FUNCTION (payloadSize << txParams);
+
+  // Symbol duration in ns: 2^SF * 1e9 / BW
+  int64_t tSymUnitNs;
+  if (txParams.bandwidthHz == 125000)
+    {
+      tSymUnitNs = 8000;
+    }
+  else if (txParams.bandwidthHz == 250000)
+    {
+      tSymUnitNs = 4000;
+    }
+  else if (txParams.bandwidthHz == 500000)
+    {
+      tSymUnitNs = 2000;
+    }
+  else
+    {
+      return ComputeOnAirTime (payloadSize, txParams);
+    }
+
+  if (txParams.sf < kMinTableSf || txParams.sf > kMaxTableSf
+      || txParams.codingRate < 1 || txParams.codingRate > 4
+      || payloadSize >= kTablePayloadSizes)
+    {
+      return ComputeOnAirTime (payloadSize, txParams);
+    }
+
+  int64_t tSymNs = (int64_t (1) << txParams.sf) * tSymUnitNs;
+
+  uint16_t payloadSymbNb =
+    GetPayloadSymbolTable ()[GetPayloadSymbolIndex (payloadSize, txParams.sf,
+                                                    txParams.codingRate,
+                                                    txParams.headerDisabled,
+                                                    txParams.crcEnabled,
+                                                    txParams.lowDataRateOptimizationEnabled)];
+
+  // The preamble lasts nPreamble + 4.25 symbols, and tSymNs is a multiple of 4
+  int64_t tPreambleNs = (int64_t (txParams.nPreamble) * 4 + 17) * (tSymNs / 4);
+  int64_t tPayloadNs = payloadSymbNb * tSymNs;
+
+  return NanoSeconds (tPreambleNs + tPayloadNs);
+}
+
+Time
+LoraPhy::ComputeOnAirTime (uint32_t payloadSize, LoraTxParameters txParams)
+{
+  NS_LOG_FUNCTION (payloadSize << txParams);
+
   // The contents of this function are based on [1].
   // [1] SX1272 LoRa modem designer's guide.
 
@@ -177,7 +296,7 @@ LoraPhy::GetOnAirTime (Ptr<Packet> packet, LoraTxParameters txParams)
   double tPreamble = (double(txParams.nPreamble) + 4.25) * tSym;
 
   // Payload size
-  uint32_t pl = packet->GetSize ();      // Size in bytes
+  uint32_t pl = payloadSize;      // Size in bytes
   NS_LOG_DEBUG ("Packet of size " << pl << " bytes");
 
   // This step is needed since the formula deals with double values.
@@ -188,7 +307,7 @@ LoraPhy::GetOnAirTime (Ptr<Packet> packet, LoraTxParameters txParams)
   double crc = txParams.crcEnabled ? 1 : 0;
 
   // num and den refer to numerator and denominator of the time on air formula
-  double num = 8 * pl - 4 * txParams.sf + 28 + 16 * crc - 20 * h;
+  double num = 8 * double (pl) - 4 * txParams.sf + 28 + 16 * crc - 20 * h;
   double den = 4 * (txParams.sf - 2 * de);
   double payloadSymbNb = 8 + std::max (std::ceil (num / den) *
                                        (txParams.codingRate + 4), double(0));
@@ -31,6 +31,7 @@
 #include "ns3/net-device.h"
 #include "ns3/lora-interference-helper.h"
 #include <list>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -254,7 +255,38 @@ public:
    */
   static Time GetOnAirTime (Ptr<Packet> packet, LoraTxParameters txParams);
 
+  /**
+   * Compute the time that a payload of a certain size will take to be
+   * transmitted.
+   *
+   * Payloads of up to 255 bytes sent with SF 6 to 12, a bandwidth of 125, 250
+   * or 500 kHz and a codingRate of 1 to 4 are looked up in a table of symbol
+   * counts that is built on first use, and their duration is exact to the
+   * nanosecond. Other parameters fall back to ComputeOnAirTime.
+   *
+   * \param payloadSize The size of the PHY payload, in bytes.
+   * \param txParams The set of parameters that will be used for transmission.
+   * \return The time necessary to transmit the payload.
+   */
+  static Time GetOnAirTime (uint32_t payloadSize, LoraTxParameters txParams);
+
+  /**
+   * Compute the time on air of a payload by evaluating the formula of the
+   * SX1272 LoRa modem designer's guide in floating point.
+   *
+   * \param payloadSize The size of the PHY payload, in bytes.
+   * \param txParams The set of parameters that will be used for transmission.
+   * \return The time necessary to transmit the payload.
+   */
+  static Time ComputeOnAirTime (uint32_t payloadSize, LoraTxParameters txParams);
+
 private:
+  /**
+   * Get the table of payload symbol counts used by GetOnAirTime, indexed by
+   * SF, coding rate, header/CRC/LDRO flags and payload size.
+   */
+  static const std::vector<uint16_t> &GetPayloadSymbolTable (void);
+
   Ptr<MobilityModel> m_mobility;   //!< The mobility model associated to this PHY.
 
 protected:
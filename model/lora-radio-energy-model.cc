@@ -81,6 +81,7 @@ LoraRadioEnergyModel::LoraRadioEnergyModel ()
   NS_LOG_FUNCTION (this);
   m_currentState = EndDeviceLoraPhy::SLEEP;      // initially STANDBY
   m_lastUpdateTime = Seconds (0.0);
+  m_standbyIntervalCurrentA = 0;
   m_nPendingChangeState = 0;
   m_isSupersededChangeState = false;
   m_energyDepletionCallback.Nullify ();
@@ -90,6 +91,7 @@ LoraRadioEnergyModel::LoraRadioEnergyModel ()
   m_listener->SetChangeStateCallback (MakeCallback (&DeviceEnergyModel::ChangeState, this));
   // set callback for updating the tx current
   m_listener->SetUpdateTxCurrentCallback (MakeCallback (&LoraRadioEnergyModel::SetTxCurrentFromModel, this));
+  m_listener->SetStandbyIntervalCallback (MakeCallback (&LoraRadioEnergyModel::AddStandbyInterval, this));
 }
 
 LoraRadioEnergyModel::~LoraRadioEnergyModel ()
@@ -215,6 +217,40 @@ LoraRadioEnergyModel::SetTxCurrentFromModel (double txPowerDbm)
     }
 }
 
+void
+LoraRadioEnergyModel::AddStandbyInterval (Time duration)
+{
+  NS_LOG_FUNCTION (this << duration);
+
+  // Settle the source at the current draw before raising it
+  double extraCurrentA = m_idleCurrentA - m_sleepCurrentA;
+  m_source->UpdateEnergySource ();
+  m_standbyIntervalCurrentA += extraCurrentA;
+
+  Simulator::Schedule (duration, &LoraRadioEnergyModel::EndStandbyInterval,
+                       this, extraCurrentA, duration);
+}
+
+void
+LoraRadioEnergyModel::EndStandbyInterval (double extraCurrentA, Time duration)
+{
+  NS_LOG_FUNCTION (this << extraCurrentA << duration);
+
+  if (m_source == NULL)
+    {
+      return;
+    }
+
+  m_source->UpdateEnergySource ();
+  m_standbyIntervalCurrentA -= extraCurrentA;
+
+  double supplyVoltage = m_source->GetSupplyVoltage ();
+  m_totalEnergyConsumption += duration.GetSeconds () * extraCurrentA * supplyVoltage;
+
+  NS_LOG_DEBUG ("LoraRadioEnergyModel:Total energy consumption is " <<
+                m_totalEnergyConsumption << "J");
+}
+
 void
 LoraRadioEnergyModel::ChangeState (int newState)
 {
@@ -334,13 +370,13 @@ LoraRadioEnergyModel::DoGetCurrentA (void) const
   switch (m_currentState)
     {
     case EndDeviceLoraPhy::STANDBY:
-      return m_idleCurrentA;
+      return m_idleCurrentA + m_standbyIntervalCurrentA;
     case EndDeviceLoraPhy::TX:
-      return m_txCurrentA;
+      return m_txCurrentA + m_standbyIntervalCurrentA;
     case EndDeviceLoraPhy::RX:
-      return m_rxCurrentA;
+      return m_rxCurrentA + m_standbyIntervalCurrentA;
     case EndDeviceLoraPhy::SLEEP:
-      return m_sleepCurrentA;
+      return m_sleepCurrentA + m_standbyIntervalCurrentA;
     default:
       NS_FATAL_ERROR ("LoraRadioEnergyModel:Undefined radio state:" << m_currentState);
     }
@@ -378,6 +414,7 @@ LoraRadioEnergyModelPhyListener::LoraRadioEnergyModelPhyListener ()
   NS_LOG_FUNCTION (this);
   m_changeStateCallback.Nullify ();
   m_updateTxCurrentCallback.Nullify ();
+  m_standbyIntervalCallback.Nullify ();
 }
 
 LoraRadioEnergyModelPhyListener::~LoraRadioEnergyModelPhyListener ()
@@ -401,6 +438,14 @@ LoraRadioEnergyModelPhyListener::SetUpdateTxCurrentCallback (UpdateTxCurrentCall
   m_updateTxCurrentCallback = callback;
 }
 
+void
+LoraRadioEnergyModelPhyListener::SetStandbyIntervalCallback (StandbyIntervalCallback callback)
+{
+  NS_LOG_FUNCTION (this << &callback);
+  NS_ASSERT (!callback.IsNull ());
+  m_standbyIntervalCallback = callback;
+}
+
 void
 LoraRadioEnergyModelPhyListener::NotifyRxStart ()
 {
@@ -450,6 +495,16 @@ LoraRadioEnergyModelPhyListener::NotifyStandby (void)
   m_changeStateCallback (EndDeviceLoraPhy::STANDBY);
 }
 
+void
+LoraRadioEnergyModelPhyListener::NotifyStandbyInterval (Time duration)
+{
+  NS_LOG_FUNCTION (this << duration);
+  if (!m_standbyIntervalCallback.IsNull ())
+    {
+      m_standbyIntervalCallback (duration);
+    }
+}
+
 /*
  * Private function state here.
  */
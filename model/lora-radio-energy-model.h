@@ -36,6 +36,11 @@ public:
    */
   typedef Callback<void, double> UpdateTxCurrentCallback;
 
+  /**
+   * Callback type for accounting a STANDBY interval spent while asleep.
+   */
+  typedef Callback<void, Time> StandbyIntervalCallback;
+
   LoraRadioEnergyModelPhyListener ();
   virtual ~LoraRadioEnergyModelPhyListener ();
 
@@ -53,6 +58,13 @@ public:
    */
   void SetUpdateTxCurrentCallback (UpdateTxCurrentCallback callback);
 
+  /**
+   * \brief Sets the callback used to account STANDBY intervals.
+   *
+   * \param callback Standby interval callback.
+   */
+  void SetStandbyIntervalCallback (StandbyIntervalCallback callback);
+
   /**
    * \brief Switches the LoraRadioEnergyModel to RX state.
    *
@@ -83,6 +95,11 @@ public:
    */
   void NotifyStandby (void);
 
+  /**
+   * \brief Defined in ns3::EndDeviceLoraPhyListener
+   */
+  void NotifyStandbyInterval (Time duration);
+
 
 private:
   /**
@@ -101,6 +118,11 @@ private:
    * the nominal tx power used to transmit the current frame.
    */
   UpdateTxCurrentCallback m_updateTxCurrentCallback;
+
+  /**
+   * Callback used to account STANDBY intervals spent while asleep.
+   */
+  StandbyIntervalCallback m_standbyIntervalCallback;
 };
 
 
@@ -245,6 +267,19 @@ public:
   // NOTICE VERY WELL: Current  Model linear or constant as possible choices
   void SetTxCurrentFromModel (double txPowerDbm);
 
+  /**
+   * \brief Account for an interval the radio spent in STANDBY while this
+   * model kept it in SLEEP.
+   *
+   * The difference between the two currents is drawn on top of the current of
+   * the radio's state for the given duration, starting now, so that both the
+   * energy source and the total energy consumption are charged the energy the
+   * STANDBY interval would have consumed.
+   *
+   * \param duration The duration of the interval.
+   */
+  void AddStandbyInterval (Time duration);
+
   /**
    * \brief Changes state of the LoraRadioEnergyMode.
    *
@@ -299,6 +334,15 @@ private:
    */
   void SetLoraRadioState (const EndDeviceLoraPhy::State state);
 
+  /**
+   * Stop drawing the extra current of an interval accounted with
+   * AddStandbyInterval.
+   *
+   * \param extraCurrentA The extra current drawn during the interval.
+   * \param duration The duration of the interval.
+   */
+  void EndStandbyInterval (double extraCurrentA, Time duration);
+
   Ptr<EnergySource> m_source; ///< energy source
 
   // Member variables for current draw in different radio modes.
@@ -306,6 +350,7 @@ private:
   double m_rxCurrentA; ///< receive current
   double m_idleCurrentA; ///< idle current
   double m_sleepCurrentA; ///< sleep current
+  double m_standbyIntervalCurrentA; ///< extra current of accounted STANDBY intervals
   // NOTICE VERY WELL: Current  Model linear or constant as possible choices
   Ptr<LoraTxCurrentModel> m_txCurrentModel; ///< current model
 
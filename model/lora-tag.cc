@@ -49,7 +49,8 @@ LoraTag::LoraTag (uint8_t sf, uint8_t destroyedBy) :
   m_destroyedBy (destroyedBy),
   m_receivePower (0),
   m_dataRate (0),
-  m_frequency (0)
+  m_frequency (0),
+  m_receiveWindow (0)
 {
 }
 
@@ -61,8 +62,8 @@ uint32_t
 LoraTag::GetSerializedSize (void) const
 {
   // Each datum about a SF is 1 byte + receivePower (the size of a double) +
-  // frequency (the size of a double)
-  return 3 + 2 * sizeof(double);
+  // frequency (the size of a double) + the receive window (1 byte)
+  return 4 + 2 * sizeof(double);
 }
 
 void
@@ -73,6 +74,7 @@ LoraTag::Serialize (TagBuffer i) const
   i.WriteDouble (m_receivePower);
   i.WriteU8 (m_dataRate);
   i.WriteDouble (m_frequency);
+  i.WriteU8 (m_receiveWindow);
 }
 
 void
@@ -83,6 +85,7 @@ LoraTag::Deserialize (TagBuffer i)
   m_receivePower = i.ReadDouble ();
   m_dataRate = i.ReadU8 ();
   m_frequency = i.ReadDouble ();
+  m_receiveWindow = i.ReadU8 ();
 }
 
 void
@@ -152,5 +155,17 @@ LoraTag::SetDataRate (uint8_t dataRate)
   m_dataRate = dataRate;
 }
 
+uint8_t
+LoraTag::GetReceiveWindow (void) const
+{
+  return m_receiveWindow;
+}
+
+void
+LoraTag::SetReceiveWindow (uint8_t window)
+{
+  m_receiveWindow = window;
+}
+
 }
 } // namespace ns3
@@ -123,6 +123,20 @@ public:
    */
   void SetDataRate (uint8_t dataRate);
 
+  /**
+   * Get the receive window a downlink packet is meant for.
+   *
+   * \return The window number (1 or 2), or 0 if not set.
+   */
+  uint8_t GetReceiveWindow (void) const;
+
+  /**
+   * Set the receive window a downlink packet is meant for.
+   *
+   * \param window The window number (1 or 2).
+   */
+  void SetReceiveWindow (uint8_t window);
+
 private:
   uint8_t m_sf; //!< The Spreading Factor used by the packet.
   uint8_t m_destroyedBy; //!< The Spreading Factor that destroyed the packet.
@@ -130,6 +144,7 @@ private:
   uint8_t m_dataRate; //!< The Data Rate that needs to be used to send this
   //!packet.
   double m_frequency; //!< The frequency of this packet
+  uint8_t m_receiveWindow; //!< The receive window of a downlink packet
 };
 } // namespace ns3
 }
@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/lorawan-header-view.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/assert.h"
+
+namespace ns3 {
+namespace lorawan {
+
+const uint32_t LorawanHeaderView::SIZE;
+
+// The layout follows LorawanMacHeader::Serialize and
+// LoraFrameHeader::Serialize. Multi-byte fields are written by
+// Buffer::Iterator::WriteU16 and WriteU32, least significant byte first.
+LorawanHeaderView::LorawanHeaderView (Ptr<const Packet> packet)
+{
+  m_valid = packet->CopyData (m_bytes, SIZE) == SIZE;
+}
+
+bool
+LorawanHeaderView::IsValid (void) const
+{
+  return m_valid;
+}
+
+uint8_t
+LorawanHeaderView::GetMType (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return m_bytes[0] >> 5;
+}
+
+uint8_t
+LorawanHeaderView::GetMajor (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return m_bytes[0] & 0b11;
+}
+
+bool
+LorawanHeaderView::IsUplink (void) const
+{
+  uint8_t mType = GetMType ();
+  return (mType == LorawanMacHeader::JOIN_REQUEST)
+         || (mType == LorawanMacHeader::UNCONFIRMED_DATA_UP)
+         || (mType == LorawanMacHeader::CONFIRMED_DATA_UP);
+}
+
+bool
+LorawanHeaderView::IsConfirmed (void) const
+{
+  uint8_t mType = GetMType ();
+  return (mType == LorawanMacHeader::CONFIRMED_DATA_DOWN)
+         || (mType == LorawanMacHeader::CONFIRMED_DATA_UP);
+}
+
+LoraDeviceAddress
+LorawanHeaderView::GetAddress (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return LoraDeviceAddress (uint32_t (m_bytes[1])
+                            | uint32_t (m_bytes[2]) << 8
+                            | uint32_t (m_bytes[3]) << 16
+                            | uint32_t (m_bytes[4]) << 24);
+}
+
+bool
+LorawanHeaderView::GetAdr (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return (m_bytes[5] >> 7) & 0b1;
+}
+
+bool
+LorawanHeaderView::GetAdrAckReq (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return (m_bytes[5] >> 6) & 0b1;
+}
+
+bool
+LorawanHeaderView::GetAck (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return (m_bytes[5] >> 5) & 0b1;
+}
+
+bool
+LorawanHeaderView::GetFPending (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return (m_bytes[5] >> 4) & 0b1;
+}
+
+uint8_t
+LorawanHeaderView::GetFOptsLen (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return m_bytes[5] & 0b1111;
+}
+
+uint16_t
+LorawanHeaderView::GetFCnt (void) const
+{
+  NS_ASSERT (m_valid);
+
+  return uint16_t (m_bytes[6]) | uint16_t (m_bytes[7]) << 8;
+}
+
+} // namespace lorawan
+} // namespace ns3
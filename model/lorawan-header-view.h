@@ -0,0 +1,78 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORAWAN_HEADER_VIEW_H
+#define LORAWAN_HEADER_VIEW_H
+
+#include "ns3/packet.h"
+#include "ns3/lora-device-address.h"
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * A read-only view of the MAC header and of the fixed part of the frame
+ * header (DevAddr, FCtrl and FCnt) at the start of a LoRaWAN packet.
+ *
+ * The fields are decoded from the first bytes of the packet buffer, so the
+ * packet is not copied and the MAC commands in FOpts are not deserialized.
+ * Use it where only these fields are needed, in place of removing a
+ * LorawanMacHeader and a LoraFrameHeader from a copy of the packet.
+ */
+class LorawanHeaderView
+{
+public:
+  /**
+   * The number of bytes the view decodes: MHDR, DevAddr, FCtrl and FCnt.
+   */
+  static const uint32_t SIZE = 8;
+
+  /**
+   * Decode the headers at the start of a packet.
+   */
+  explicit LorawanHeaderView (Ptr<const Packet> packet);
+
+  /**
+   * Whether the packet was long enough to hold the fields of the view. The
+   * other methods must not be called on an invalid view.
+   */
+  bool IsValid (void) const;
+
+  /**
+   * Get the MType, as a LorawanMacHeader::MType value.
+   */
+  uint8_t GetMType (void) const;
+  uint8_t GetMajor (void) const;
+  bool IsUplink (void) const;
+  bool IsConfirmed (void) const;
+
+  LoraDeviceAddress GetAddress (void) const;
+  bool GetAdr (void) const;
+  bool GetAdrAckReq (void) const;
+  bool GetAck (void) const;
+  bool GetFPending (void) const;
+  uint8_t GetFOptsLen (void) const;
+  uint16_t GetFCnt (void) const;
+
+private:
+  uint8_t m_bytes[SIZE];
+  bool m_valid;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORAWAN_HEADER_VIEW_H */
@@ -104,18 +104,31 @@ LorawanMac::SetLogicalLoraChannelHelper (LogicalLoraChannelHelper helper)
   m_channelHelper = helper;
 }
 
+void
+LorawanMac::SetRegionPlan (Ptr<RegionPlan> plan)
+{
+  NS_LOG_FUNCTION (this << plan);
+
+  m_regionPlan = plan;
+  m_channelHelper.SetRegionPlan (plan);
+}
+
 uint8_t
 LorawanMac::GetSfFromDataRate (uint8_t dataRate)
 {
   NS_LOG_FUNCTION (this << unsigned(dataRate));
 
+  const std::vector<uint8_t> &sfForDataRate =
+    (m_sfForDataRate.empty () && m_regionPlan != 0) ?
+    m_regionPlan->GetSfForDataRate () : m_sfForDataRate;
+
   // Check we are in range
-  if (dataRate >= m_sfForDataRate.size ())
+  if (dataRate >= sfForDataRate.size ())
     {
       return 0;
     }
 
-  return m_sfForDataRate.at (dataRate);
+  return sfForDataRate.at (dataRate);
 }
 
 double
@@ -123,13 +136,17 @@ LorawanMac::GetBandwidthFromDataRate (uint8_t dataRate)
 {
   NS_LOG_FUNCTION (this << unsigned(dataRate));
 
+  const std::vector<double> &bandwidthForDataRate =
+    (m_bandwidthForDataRate.empty () && m_regionPlan != 0) ?
+    m_regionPlan->GetBandwidthForDataRate () : m_bandwidthForDataRate;
+
   // Check we are in range
-  if (dataRate > m_bandwidthForDataRate.size ())
+  if (dataRate >= bandwidthForDataRate.size ())
     {
       return 0;
     }
 
-  return m_bandwidthForDataRate.at (dataRate);
+  return bandwidthForDataRate.at (dataRate);
 }
 
 double
@@ -137,12 +154,33 @@ LorawanMac::GetDbmForTxPower (uint8_t txPower)
 {
   NS_LOG_FUNCTION (this << unsigned (txPower));
 
-  if (txPower > m_txDbmForTxPower.size ())
+  const std::vector<double> &txDbmForTxPower =
+    (m_txDbmForTxPower.empty () && m_regionPlan != 0) ?
+    m_regionPlan->GetTxDbmForTxPower () : m_txDbmForTxPower;
+
+  if (txPower >= txDbmForTxPower.size ())
+    {
+      return 0;
+    }
+
+  return txDbmForTxPower.at (txPower);
+}
+
+uint32_t
+LorawanMac::GetMaxAppPayloadForDataRate (uint8_t dataRate)
+{
+  NS_LOG_FUNCTION (this << unsigned (dataRate));
+
+  const std::vector<uint32_t> &maxAppPayloadForDataRate =
+    (m_maxAppPayloadForDataRate.empty () && m_regionPlan != 0) ?
+    m_regionPlan->GetMaxAppPayloadForDataRate () : m_maxAppPayloadForDataRate;
+
+  if (dataRate >= maxAppPayloadForDataRate.size ())
     {
       return 0;
     }
 
-  return m_txDbmForTxPower.at (txPower);
+  return maxAppPayloadForDataRate.at (dataRate);
 }
 
 void
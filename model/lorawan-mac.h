@@ -120,6 +120,16 @@ public:
    */
   void SetLogicalLoraChannelHelper (LogicalLoraChannelHelper helper);
 
+  /**
+   * Configure this MAC for a region, sharing the plan's channels, SubBands and
+   * data rate tables with the other devices of the region instead of keeping
+   * a copy of them. Tables that are set explicitly on this MAC with the
+   * Set*For* methods take precedence over the plan's.
+   *
+   * \param plan The region plan, which must not be modified afterwards.
+   */
+  void SetRegionPlan (Ptr<RegionPlan> plan);
+
   /**
    * Get the SF corresponding to a data rate, based on this MAC's region.
    *
@@ -150,6 +160,16 @@ public:
    */
   double GetDbmForTxPower (uint8_t txPower);
 
+  /**
+   * Get the maximum application payload that can be sent at a data rate in
+   * this MAC's region.
+   *
+   * \param dataRate The Data Rate.
+   * \return The maximum payload size in bytes, or 0 if the dataRate is not
+   * valid.
+   */
+  uint32_t GetMaxAppPayloadForDataRate (uint8_t dataRate);
+
   /**
    * Set the vector to use to check up correspondence between SF and DataRate.
    *
@@ -245,6 +265,12 @@ protected:
    */
   LogicalLoraChannelHelper m_channelHelper;
 
+  /**
+   * The plan of the region this MAC operates in, if any. Its tables are used
+   * when the corresponding vector below is empty.
+   */
+  Ptr<RegionPlan> m_regionPlan;
+
   /**
    * A vector holding the SF each Data Rate corresponds to.
    */
@@ -0,0 +1,235 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LORAWAN_REGION_H
+#define LORAWAN_REGION_H
+
+#include <cstdint>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * Compile-time descriptions of the data rates of the LoRaWAN regions, from
+ * the LoRaWAN Regional Parameters.
+ *
+ * Each region is a struct of constexpr functions reading constexpr tables,
+ * so that it can be passed as a template parameter and conversions on the
+ * transmission path reduce to an array read. Table consistency is checked
+ * with static_asserts at the end of this file.
+ */
+
+/**
+ * Value returned by the GetDataRate functions when no data rate of the region
+ * uses the requested modulation.
+ */
+constexpr uint8_t INVALID_DATA_RATE = 0xff;
+
+namespace region {
+
+// Demodulation SNR floor of each SF, indexed by SF - 7
+constexpr double requiredSnrForSf[] = {-7.5, -10.0, -12.5, -15.0, -17.5, -20.0};
+
+constexpr double
+GetRequiredSnrForSf (uint8_t sf)
+{
+  return (sf >= 7 && sf <= 12) ? requiredSnrForSf[sf - 7] : 0;
+}
+
+// EU863-870
+constexpr uint8_t eu868SfForDataRate[] = {12, 11, 10, 9, 8, 7, 7};
+constexpr double eu868BandwidthForDataRate[] = {125000, 125000, 125000, 125000,
+                                                125000, 125000, 250000};
+constexpr uint32_t eu868MaxAppPayloadForDataRate[] = {59, 59, 59, 123, 230, 230,
+                                                      230};
+constexpr double eu868TxDbmForTxPower[] = {16, 14, 12, 10, 8, 6, 4, 2};
+// Data rate of each SF at 125 kHz, indexed by SF
+constexpr uint8_t eu868DataRateForSf[] = {
+  INVALID_DATA_RATE, INVALID_DATA_RATE, INVALID_DATA_RATE, INVALID_DATA_RATE,
+  INVALID_DATA_RATE, INVALID_DATA_RATE, INVALID_DATA_RATE, 5, 4, 3, 2, 1, 0};
+
+// US902-928. DR5 to DR7 are reserved, DR8 and above are downlink only.
+constexpr uint8_t us915SfForDataRate[] = {10, 9, 8, 7, 8, 0, 0, 0,
+                                          12, 11, 10, 9, 8, 7};
+constexpr double us915BandwidthForDataRate[] = {125000, 125000, 125000, 125000,
+                                                500000, 0, 0, 0,
+                                                500000, 500000, 500000, 500000,
+                                                500000, 500000};
+constexpr uint32_t us915MaxAppPayloadForDataRate[] = {11, 53, 125, 242, 242, 0, 0, 0,
+                                                      53, 129, 242, 242, 242, 242};
+constexpr double us915TxDbmForTxPower[] = {30, 28, 26, 24, 22, 20, 18, 16, 14,
+                                           12, 10};
+// Uplink data rate of each SF at 125 kHz, indexed by SF
+constexpr uint8_t us915DataRateForSf[] = {
+  INVALID_DATA_RATE, INVALID_DATA_RATE, INVALID_DATA_RATE, INVALID_DATA_RATE,
+  INVALID_DATA_RATE, INVALID_DATA_RATE, INVALID_DATA_RATE, 3, 2, 1, 0,
+  INVALID_DATA_RATE, INVALID_DATA_RATE};
+
+} // namespace region
+
+/**
+ * The EU863-870 region.
+ */
+struct Eu868Region
+{
+  static constexpr uint8_t GetNDataRates (void)
+  {
+    return sizeof (region::eu868SfForDataRate);
+  }
+
+  static constexpr uint8_t GetNTxPowers (void)
+  {
+    return sizeof (region::eu868TxDbmForTxPower) / sizeof (double);
+  }
+
+  /**
+   * Get the SF of a data rate, or 0 if the data rate is not a LoRa one.
+   */
+  static constexpr uint8_t GetSfForDataRate (uint8_t dataRate)
+  {
+    return dataRate < GetNDataRates () ? region::eu868SfForDataRate[dataRate] : 0;
+  }
+
+  /**
+   * Get the bandwidth of a data rate in Hz, or 0 if the data rate is not a
+   * LoRa one.
+   */
+  static constexpr double GetBandwidthForDataRate (uint8_t dataRate)
+  {
+    return dataRate < GetNDataRates () ? region::eu868BandwidthForDataRate[dataRate] : 0;
+  }
+
+  static constexpr uint32_t GetMaxAppPayloadForDataRate (uint8_t dataRate)
+  {
+    return dataRate < GetNDataRates () ? region::eu868MaxAppPayloadForDataRate[dataRate] : 0;
+  }
+
+  static constexpr double GetTxDbmForTxPower (uint8_t txPower)
+  {
+    return txPower < GetNTxPowers () ? region::eu868TxDbmForTxPower[txPower] : 0;
+  }
+
+  /**
+   * Get the data rate of a modulation. SF8 to SF12 are only defined at
+   * 125 kHz in this region, so their data rate is returned regardless of the
+   * bandwidth.
+   *
+   * \return The data rate, or INVALID_DATA_RATE.
+   */
+  static constexpr uint8_t GetDataRate (uint8_t sf, double bandwidth)
+  {
+    return sf == 7 ? (bandwidth == 250000 ? 6 : (bandwidth == 125000 ? 5 : INVALID_DATA_RATE)) :
+           (sf <= 12 ? region::eu868DataRateForSf[sf] : INVALID_DATA_RATE);
+  }
+
+  /**
+   * Get the minimum SNR a packet sent at a data rate needs to be demodulated.
+   */
+  static constexpr double GetRequiredSnr (uint8_t dataRate)
+  {
+    return region::GetRequiredSnrForSf (GetSfForDataRate (dataRate));
+  }
+};
+
+/**
+ * The US902-928 region.
+ */
+struct Us915Region
+{
+  static constexpr uint8_t GetNDataRates (void)
+  {
+    return sizeof (region::us915SfForDataRate);
+  }
+
+  static constexpr uint8_t GetNTxPowers (void)
+  {
+    return sizeof (region::us915TxDbmForTxPower) / sizeof (double);
+  }
+
+  static constexpr uint8_t GetSfForDataRate (uint8_t dataRate)
+  {
+    return dataRate < GetNDataRates () ? region::us915SfForDataRate[dataRate] : 0;
+  }
+
+  static constexpr double GetBandwidthForDataRate (uint8_t dataRate)
+  {
+    return dataRate < GetNDataRates () ? region::us915BandwidthForDataRate[dataRate] : 0;
+  }
+
+  static constexpr uint32_t GetMaxAppPayloadForDataRate (uint8_t dataRate)
+  {
+    return dataRate < GetNDataRates () ? region::us915MaxAppPayloadForDataRate[dataRate] : 0;
+  }
+
+  static constexpr double GetTxDbmForTxPower (uint8_t txPower)
+  {
+    return txPower < GetNTxPowers () ? region::us915TxDbmForTxPower[txPower] : 0;
+  }
+
+  /**
+   * Get the uplink data rate of a modulation.
+   *
+   * \return The data rate, or INVALID_DATA_RATE.
+   */
+  static constexpr uint8_t GetDataRate (uint8_t sf, double bandwidth)
+  {
+    return bandwidth == 500000 ? (sf == 8 ? 4 : INVALID_DATA_RATE) :
+           (bandwidth == 125000 && sf <= 12 ? region::us915DataRateForSf[sf] : INVALID_DATA_RATE);
+  }
+
+  static constexpr double GetRequiredSnr (uint8_t dataRate)
+  {
+    return region::GetRequiredSnrForSf (GetSfForDataRate (dataRate));
+  }
+};
+
+namespace region {
+
+/**
+ * Check that the data rates in [dataRate, end) map back to themselves.
+ */
+template <typename Region>
+constexpr bool
+CheckDataRates (uint8_t dataRate, uint8_t end)
+{
+  return dataRate >= end ||
+         (Region::GetDataRate (Region::GetSfForDataRate (dataRate),
+                               Region::GetBandwidthForDataRate (dataRate)) == dataRate &&
+          CheckDataRates<Region> (dataRate + 1, end));
+}
+
+static_assert (sizeof (eu868BandwidthForDataRate) / sizeof (double) ==
+               sizeof (eu868SfForDataRate), "EU868 data rate tables differ in size");
+static_assert (sizeof (eu868MaxAppPayloadForDataRate) / sizeof (uint32_t) ==
+               sizeof (eu868SfForDataRate), "EU868 payload table has the wrong size");
+static_assert (CheckDataRates<Eu868Region> (0, Eu868Region::GetNDataRates ()),
+               "EU868 data rate tables are inconsistent");
+static_assert (Eu868Region::GetSfForDataRate (0) == 12 &&
+               Eu868Region::GetBandwidthForDataRate (6) == 250000,
+               "Unexpected EU868 data rates");
+
+static_assert (sizeof (us915BandwidthForDataRate) / sizeof (double) ==
+               sizeof (us915SfForDataRate), "US915 data rate tables differ in size");
+static_assert (sizeof (us915MaxAppPayloadForDataRate) / sizeof (uint32_t) ==
+               sizeof (us915SfForDataRate), "US915 payload table has the wrong size");
+static_assert (CheckDataRates<Us915Region> (0, 5), "US915 data rate tables are inconsistent");
+
+} // namespace region
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORAWAN_REGION_H */
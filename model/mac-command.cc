@@ -20,6 +20,7 @@
 
 #include "ns3/mac-command.h"
 #include "ns3/log.h"
+#include "ns3/abort.h"
 #include <bitset>
 #include <cmath>
 
@@ -887,7 +888,8 @@ NewChannelReq::Deserialize (Buffer::Iterator &start)
   // Read the data
   m_chIndex = start.ReadU8 ();
   uint32_t encodedFrequency = 0;
-  encodedFrequency |= uint32_t (start.ReadU16 ()) << 8;
+  encodedFrequency |= uint32_t (start.ReadU8 ()) << 16;
+  encodedFrequency |= uint32_t (start.ReadU8 ()) << 8;
   encodedFrequency |= uint32_t (start.ReadU8 ());
   m_frequency = double (encodedFrequency) * 100;
   uint8_t dataRateByte = start.ReadU8 ();
@@ -1221,5 +1223,472 @@ TxParamSetupAns::Print (std::ostream &os) const
   os << "TxParamSetupAns" << std::endl;
 }
 
+/////////////////////
+// MacCommandValue //
+/////////////////////
+
+const uint8_t MacCommandValue::MAX_PAYLOAD_SIZE;
+
+namespace {
+
+// Serialized size of each MacCommandType, CID included
+const uint8_t serializedSizeForType[] = {0, 1, 3, 5, 2, 2, 1, 5, 2, 1, 3,
+                                         6, 2, 2, 1, 1, 1, 5, 1};
+
+// Command types of the CIDs 0x00 to 0x0A, as sent by end devices...
+const enum MacCommandType uplinkTypeForCid[] = {
+  INVALID, INVALID, LINK_CHECK_REQ, LINK_ADR_ANS, DUTY_CYCLE_ANS,
+  RX_PARAM_SETUP_ANS, DEV_STATUS_ANS, NEW_CHANNEL_ANS, RX_TIMING_SETUP_ANS,
+  TX_PARAM_SETUP_ANS, DL_CHANNEL_ANS};
+
+// ...and by the network server
+const enum MacCommandType downlinkTypeForCid[] = {
+  INVALID, INVALID, LINK_CHECK_ANS, LINK_ADR_REQ, DUTY_CYCLE_REQ,
+  RX_PARAM_SETUP_REQ, DEV_STATUS_REQ, NEW_CHANNEL_REQ, RX_TIMING_SETUP_REQ,
+  TX_PARAM_SETUP_REQ, INVALID};
+
+} // namespace
+
+MacCommandValue::MacCommandValue () :
+  m_type (INVALID),
+  m_payload ()
+{
+}
+
+MacCommandValue::MacCommandValue (enum MacCommandType type) :
+  m_type (type),
+  m_payload ()
+{
+}
+
+MacCommandValue
+MacCommandValue::CreateLinkCheckAns (uint8_t margin, uint8_t gwCnt)
+{
+  MacCommandValue command (LINK_CHECK_ANS);
+  command.m_payload[0] = margin;
+  command.m_payload[1] = gwCnt;
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::CreateLinkAdrReq (uint8_t dataRate, uint8_t txPower,
+                                   uint16_t channelMask, uint8_t chMaskCntl,
+                                   uint8_t nbRep)
+{
+  MacCommandValue command (LINK_ADR_REQ);
+  command.m_payload[0] = dataRate << 4 | (txPower & 0b1111);
+  // Same byte order as Buffer::Iterator::WriteU16
+  command.m_payload[1] = channelMask & 0xff;
+  command.m_payload[2] = channelMask >> 8;
+  command.m_payload[3] = chMaskCntl << 4 | (nbRep & 0b1111);
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::CreateLinkAdrAns (bool powerAck, bool dataRateAck,
+                                   bool channelMaskAck)
+{
+  MacCommandValue command (LINK_ADR_ANS);
+  command.m_payload[0] = (uint8_t (powerAck) << 2) | (uint8_t (dataRateAck) << 1) |
+    uint8_t (channelMaskAck);
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::CreateDutyCycleReq (uint8_t dutyCycle)
+{
+  MacCommandValue command (DUTY_CYCLE_REQ);
+  command.m_payload[0] = dutyCycle;
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::CreateRxParamSetupReq (uint8_t rx1DrOffset, uint8_t rx2DataRate,
+                                        double frequency)
+{
+  MacCommandValue command (RX_PARAM_SETUP_REQ);
+  command.m_payload[0] = (rx1DrOffset & 0b111) << 4 | (rx2DataRate & 0b1111);
+  command.SetFrequency (1, frequency);
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::CreateRxParamSetupAns (bool rx1DrOffsetAck, bool rx2DataRateAck,
+                                        bool channelAck)
+{
+  MacCommandValue command (RX_PARAM_SETUP_ANS);
+  command.m_payload[0] = uint8_t (rx1DrOffsetAck) << 2 |
+    uint8_t (rx2DataRateAck) << 1 | uint8_t (channelAck);
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::CreateDevStatusAns (uint8_t battery, uint8_t margin)
+{
+  MacCommandValue command (DEV_STATUS_ANS);
+  command.m_payload[0] = battery;
+  command.m_payload[1] = margin;
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::CreateNewChannelReq (uint8_t chIndex, double frequency,
+                                      uint8_t minDataRate, uint8_t maxDataRate)
+{
+  MacCommandValue command (NEW_CHANNEL_REQ);
+  command.m_payload[0] = chIndex;
+  command.SetFrequency (1, frequency);
+  command.m_payload[4] = (maxDataRate << 4) | (minDataRate & 0xf);
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::CreateNewChannelAns (bool dataRateRangeOk, bool channelFrequencyOk)
+{
+  MacCommandValue command (NEW_CHANNEL_ANS);
+  command.m_payload[0] = (uint8_t (dataRateRangeOk) << 1) |
+    uint8_t (channelFrequencyOk);
+  return command;
+}
+
+MacCommandValue
+MacCommandValue::FromMacCommand (Ptr<const MacCommand> command)
+{
+  NS_LOG_FUNCTION (command);
+
+  MacCommandValue value (command->GetCommandType ());
+  NS_ASSERT (command->GetSerializedSize () == value.GetSerializedSize ());
+
+  Buffer buffer;
+  buffer.AddAtStart (value.GetSerializedSize ());
+  Buffer::Iterator it = buffer.Begin ();
+  command->Serialize (it);
+
+  it = buffer.Begin ();
+  it.ReadU8 ();
+  it.Read (value.m_payload, value.GetSerializedSize () - 1);
+  return value;
+}
+
+Ptr<MacCommand>
+MacCommandValue::ToMacCommand (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<MacCommand> command;
+  switch (m_type)
+    {
+    case (LINK_CHECK_REQ):
+      command = CreateObject<LinkCheckReq> ();
+      break;
+    case (LINK_CHECK_ANS):
+      command = CreateObject<LinkCheckAns> ();
+      break;
+    case (LINK_ADR_REQ):
+      command = CreateObject<LinkAdrReq> ();
+      break;
+    case (LINK_ADR_ANS):
+      command = CreateObject<LinkAdrAns> ();
+      break;
+    case (DUTY_CYCLE_REQ):
+      command = CreateObject<DutyCycleReq> ();
+      break;
+    case (DUTY_CYCLE_ANS):
+      command = CreateObject<DutyCycleAns> ();
+      break;
+    case (RX_PARAM_SETUP_REQ):
+      command = CreateObject<RxParamSetupReq> ();
+      break;
+    case (RX_PARAM_SETUP_ANS):
+      command = CreateObject<RxParamSetupAns> ();
+      break;
+    case (DEV_STATUS_REQ):
+      command = CreateObject<DevStatusReq> ();
+      break;
+    case (DEV_STATUS_ANS):
+      command = CreateObject<DevStatusAns> ();
+      break;
+    case (NEW_CHANNEL_REQ):
+      command = CreateObject<NewChannelReq> ();
+      break;
+    case (NEW_CHANNEL_ANS):
+      command = CreateObject<NewChannelAns> ();
+      break;
+    case (RX_TIMING_SETUP_REQ):
+      command = CreateObject<RxTimingSetupReq> ();
+      break;
+    case (RX_TIMING_SETUP_ANS):
+      command = CreateObject<RxTimingSetupAns> ();
+      break;
+    case (TX_PARAM_SETUP_REQ):
+      command = CreateObject<TxParamSetupReq> ();
+      break;
+    case (TX_PARAM_SETUP_ANS):
+      command = CreateObject<TxParamSetupAns> ();
+      break;
+    case (DL_CHANNEL_ANS):
+      command = CreateObject<DlChannelAns> ();
+      break;
+    default:
+      NS_ABORT_MSG ("No MacCommand class for command type " << m_type);
+    }
+
+  Buffer buffer;
+  buffer.AddAtStart (GetSerializedSize ());
+  Buffer::Iterator it = buffer.Begin ();
+  Serialize (it);
+  it = buffer.Begin ();
+  command->Deserialize (it);
+  return command;
+}
+
+enum MacCommandType
+MacCommandValue::GetCommandType (void) const
+{
+  return m_type;
+}
+
+uint8_t
+MacCommandValue::GetSerializedSize (void) const
+{
+  return GetSerializedSize (m_type);
+}
+
+uint8_t
+MacCommandValue::GetSerializedSize (enum MacCommandType type)
+{
+  return serializedSizeForType[type];
+}
+
+enum MacCommandType
+MacCommandValue::GetCommandTypeFromCid (uint8_t cid, bool isUplink)
+{
+  if (cid >= sizeof (uplinkTypeForCid) / sizeof (uplinkTypeForCid[0]))
+    {
+      return INVALID;
+    }
+  return isUplink ? uplinkTypeForCid[cid] : downlinkTypeForCid[cid];
+}
+
+void
+MacCommandValue::Serialize (Buffer::Iterator &start) const
+{
+  NS_ASSERT (m_type != INVALID);
+
+  start.WriteU8 (MacCommand::GetCIDFromMacCommand (m_type));
+  start.Write (m_payload, GetSerializedSize () - 1);
+}
+
+uint8_t
+MacCommandValue::Deserialize (Buffer::Iterator &start, bool isUplink)
+{
+  enum MacCommandType type = GetCommandTypeFromCid (start.PeekU8 (), isUplink);
+  if (type == INVALID)
+    {
+      NS_LOG_WARN ("Unknown " << (isUplink ? "uplink" : "downlink") <<
+                   " CID " << unsigned (start.PeekU8 ()));
+      return 0;
+    }
+
+  m_type = type;
+  start.ReadU8 ();
+  start.Read (m_payload, GetSerializedSize () - 1);
+  return GetSerializedSize ();
+}
+
+uint8_t
+MacCommandValue::GetMargin (void) const
+{
+  NS_ASSERT (m_type == LINK_CHECK_ANS || m_type == DEV_STATUS_ANS);
+
+  return m_type == LINK_CHECK_ANS ? m_payload[0] : m_payload[1] & 0b111111;
+}
+
+uint8_t
+MacCommandValue::GetGwCnt (void) const
+{
+  NS_ASSERT (m_type == LINK_CHECK_ANS);
+
+  return m_payload[1];
+}
+
+uint8_t
+MacCommandValue::GetDataRate (void) const
+{
+  NS_ASSERT (m_type == LINK_ADR_REQ);
+
+  return m_payload[0] >> 4;
+}
+
+uint8_t
+MacCommandValue::GetTxPower (void) const
+{
+  NS_ASSERT (m_type == LINK_ADR_REQ);
+
+  return m_payload[0] & 0b1111;
+}
+
+uint16_t
+MacCommandValue::GetChannelMask (void) const
+{
+  NS_ASSERT (m_type == LINK_ADR_REQ);
+
+  return uint16_t (m_payload[2]) << 8 | m_payload[1];
+}
+
+uint8_t
+MacCommandValue::GetRepetitions (void) const
+{
+  NS_ASSERT (m_type == LINK_ADR_REQ);
+
+  return m_payload[3] & 0b1111;
+}
+
+double
+MacCommandValue::GetMaximumAllowedDutyCycle (void) const
+{
+  NS_ASSERT (m_type == DUTY_CYCLE_REQ);
+
+  // Same encoding as DutyCycleReq
+  if (m_payload[0] == 255)
+    {
+      return 0;
+    }
+  return 1 / std::pow (2, double (m_payload[0]));
+}
+
+uint8_t
+MacCommandValue::GetBattery (void) const
+{
+  NS_ASSERT (m_type == DEV_STATUS_ANS);
+
+  return m_payload[0];
+}
+
+uint8_t
+MacCommandValue::GetChannelIndex (void) const
+{
+  NS_ASSERT (m_type == NEW_CHANNEL_REQ);
+
+  return m_payload[0];
+}
+
+double
+MacCommandValue::GetFrequency (void) const
+{
+  NS_ASSERT (m_type == RX_PARAM_SETUP_REQ || m_type == NEW_CHANNEL_REQ);
+
+  uint32_t encodedFrequency = (uint32_t (m_payload[1]) << 16) |
+    (uint32_t (m_payload[2]) << 8) | m_payload[3];
+  return double (encodedFrequency) * 100;
+}
+
+uint8_t
+MacCommandValue::GetMinDataRate (void) const
+{
+  NS_ASSERT (m_type == NEW_CHANNEL_REQ);
+
+  return m_payload[4] & 0xf;
+}
+
+uint8_t
+MacCommandValue::GetMaxDataRate (void) const
+{
+  NS_ASSERT (m_type == NEW_CHANNEL_REQ);
+
+  return m_payload[4] >> 4;
+}
+
+void
+MacCommandValue::SetFrequency (uint8_t offset, double frequency)
+{
+  // The frequency is sent in units of 100 Hz, most significant byte first
+  uint32_t encodedFrequency = uint32_t (frequency / 100);
+  m_payload[offset] = (encodedFrequency & 0xff0000) >> 16;
+  m_payload[offset + 1] = (encodedFrequency & 0xff00) >> 8;
+  m_payload[offset + 2] = encodedFrequency & 0xff;
+}
+
+////////////////////
+// MacCommandList //
+////////////////////
+
+const uint8_t MacCommandList::MAX_COMMANDS;
+
+MacCommandList::MacCommandList () :
+  m_nCommands (0)
+{
+}
+
+void
+MacCommandList::Add (const MacCommandValue &command)
+{
+  NS_ABORT_MSG_IF (m_nCommands == MAX_COMMANDS, "Too many MAC commands in a frame");
+
+  m_commands[m_nCommands++] = command;
+}
+
+void
+MacCommandList::Clear (void)
+{
+  m_nCommands = 0;
+}
+
+uint8_t
+MacCommandList::GetN (void) const
+{
+  return m_nCommands;
+}
+
+bool
+MacCommandList::IsEmpty (void) const
+{
+  return m_nCommands == 0;
+}
+
+const MacCommandValue &
+MacCommandList::Get (uint8_t index) const
+{
+  NS_ASSERT (index < m_nCommands);
+
+  return m_commands[index];
+}
+
+const MacCommandValue *
+MacCommandList::Find (enum MacCommandType type) const
+{
+  for (uint8_t i = 0; i < m_nCommands; i++)
+    {
+      if (m_commands[i].GetCommandType () == type)
+        {
+          return &m_commands[i];
+        }
+    }
+  return 0;
+}
+
+uint8_t
+MacCommandList::GetSerializedSize (void) const
+{
+  uint8_t size = 0;
+  for (uint8_t i = 0; i < m_nCommands; i++)
+    {
+      size += m_commands[i].GetSerializedSize ();
+    }
+  return size;
+}
+
+MacCommandList::ConstIterator
+MacCommandList::begin (void) const
+{
+  return m_commands;
+}
+
+MacCommandList::ConstIterator
+MacCommandList::end (void) const
+{
+  return m_commands + m_nCommands;
+}
+
 }
 }
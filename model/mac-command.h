@@ -609,6 +609,164 @@ public:
 
 private:
 };
+
+/**
+ * A MAC command held by value.
+ *
+ * The command type acts as the tag, and the payload holds the bytes that
+ * follow the CID in the over-the-air encoding. Building, serializing and
+ * deserializing a MacCommandValue never allocates, so it is used in place of
+ * the MacCommand classes on the per-packet paths. FromMacCommand and
+ * ToMacCommand convert from and to the MacCommand classes.
+ */
+class MacCommandValue
+{
+public:
+  /**
+   * The maximum length of a command, CID excluded.
+   */
+  static const uint8_t MAX_PAYLOAD_SIZE = 5;
+
+  MacCommandValue ();
+
+  /**
+   * Create a command whose payload is all zeros, or that has no payload.
+   */
+  explicit MacCommandValue (enum MacCommandType type);
+
+  static MacCommandValue CreateLinkCheckAns (uint8_t margin, uint8_t gwCnt);
+  static MacCommandValue CreateLinkAdrReq (uint8_t dataRate, uint8_t txPower,
+                                           uint16_t channelMask, uint8_t chMaskCntl,
+                                           uint8_t nbRep);
+  static MacCommandValue CreateLinkAdrAns (bool powerAck, bool dataRateAck,
+                                           bool channelMaskAck);
+  static MacCommandValue CreateDutyCycleReq (uint8_t dutyCycle);
+  static MacCommandValue CreateRxParamSetupReq (uint8_t rx1DrOffset,
+                                                uint8_t rx2DataRate,
+                                                double frequency);
+  static MacCommandValue CreateRxParamSetupAns (bool rx1DrOffsetAck,
+                                                bool rx2DataRateAck,
+                                                bool channelAck);
+  static MacCommandValue CreateDevStatusAns (uint8_t battery, uint8_t margin);
+  static MacCommandValue CreateNewChannelReq (uint8_t chIndex, double frequency,
+                                             uint8_t minDataRate,
+                                             uint8_t maxDataRate);
+  static MacCommandValue CreateNewChannelAns (bool dataRateRangeOk,
+                                             bool channelFrequencyOk);
+
+  /**
+   * Copy a MacCommand object into a value.
+   */
+  static MacCommandValue FromMacCommand (Ptr<const MacCommand> command);
+
+  /**
+   * Create the MacCommand object this value represents.
+   */
+  Ptr<MacCommand> ToMacCommand (void) const;
+
+  enum MacCommandType GetCommandType (void) const;
+
+  /**
+   * Get the serialized length of this command, CID included.
+   */
+  uint8_t GetSerializedSize (void) const;
+
+  /**
+   * Get the serialized length of a type of command, CID included.
+   */
+  static uint8_t GetSerializedSize (enum MacCommandType type);
+
+  /**
+   * Get the type of command a CID identifies in an uplink or in a downlink.
+   *
+   * \return The command type, or INVALID if the CID is not known.
+   */
+  static enum MacCommandType GetCommandTypeFromCid (uint8_t cid, bool isUplink);
+
+  void Serialize (Buffer::Iterator &start) const;
+
+  /**
+   * Deserialize a command sent in an uplink or in a downlink.
+   *
+   * \return The number of consumed bytes, or 0 if the CID is not known, in
+   * which case nothing is consumed and a warning is logged. Since commands
+   * carry no length, the caller can't decode past an unknown CID: see
+   * LoraFrameHeader::GetNUndecodedFOptsBytes.
+   */
+  uint8_t Deserialize (Buffer::Iterator &start, bool isUplink);
+
+  // Fields, only valid on the command types that carry them
+
+  /**
+   * The demodulation margin of a LinkCheckAns or a DevStatusAns.
+   */
+  uint8_t GetMargin (void) const;
+  uint8_t GetGwCnt (void) const;
+  uint8_t GetDataRate (void) const;
+  uint8_t GetTxPower (void) const;
+  uint16_t GetChannelMask (void) const;
+  uint8_t GetRepetitions (void) const;
+  /**
+   * The aggregated duty cycle of a DutyCycleReq, as a fraction.
+   */
+  double GetMaximumAllowedDutyCycle (void) const;
+  uint8_t GetBattery (void) const;
+  uint8_t GetChannelIndex (void) const;
+
+  /**
+   * The frequency of a RxParamSetupReq or a NewChannelReq, in Hz.
+   */
+  double GetFrequency (void) const;
+  uint8_t GetMinDataRate (void) const;
+  uint8_t GetMaxDataRate (void) const;
+
+private:
+  void SetFrequency (uint8_t offset, double frequency);
+
+  enum MacCommandType m_type;
+  uint8_t m_payload[MAX_PAYLOAD_SIZE];
+};
+
+/**
+ * The MAC commands of a frame, stored inline.
+ *
+ * Every command takes at least one of the 15 bytes of FOpts, so the capacity
+ * of 15 commands is never the limiting factor.
+ */
+class MacCommandList
+{
+public:
+  static const uint8_t MAX_COMMANDS = 15;
+
+  typedef const MacCommandValue *ConstIterator;
+
+  MacCommandList ();
+
+  void Add (const MacCommandValue &command);
+  void Clear (void);
+  uint8_t GetN (void) const;
+  bool IsEmpty (void) const;
+  const MacCommandValue &Get (uint8_t index) const;
+
+  /**
+   * Find the first command of a type.
+   *
+   * \return A pointer to the command, or 0 if there is none.
+   */
+  const MacCommandValue *Find (enum MacCommandType type) const;
+
+  /**
+   * Get the sum of the serialized sizes of the commands.
+   */
+  uint8_t GetSerializedSize (void) const;
+
+  ConstIterator begin (void) const;
+  ConstIterator end (void) const;
+
+private:
+  MacCommandValue m_commands[MAX_COMMANDS];
+  uint8_t m_nCommands;
+};
 }
 
 }
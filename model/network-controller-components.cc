@@ -45,6 +45,13 @@ NetworkControllerComponent::~NetworkControllerComponent ()
 {
 }
 
+bool
+NetworkControllerComponent::MayAddToReply (Ptr<EndDeviceStatus> status,
+                                           Ptr<NetworkStatus> networkStatus)
+{
+  return false;
+}
+
 ////////////////////////////////
 // ConfirmedMessagesComponent //
 ////////////////////////////////
@@ -66,33 +73,24 @@ ConfirmedMessagesComponent::~ConfirmedMessagesComponent ()
 }
 
 void
-ConfirmedMessagesComponent::OnReceivedPacket (Ptr<const Packet> packet,
+ConfirmedMessagesComponent::OnReceivedPacket (const DecodedUplink &uplink,
                                               Ptr<EndDeviceStatus> status,
                                               Ptr<NetworkStatus> networkStatus)
 {
-  NS_LOG_FUNCTION (this->GetTypeId () << packet << networkStatus);
+  NS_LOG_FUNCTION (this->GetTypeId () << uplink.packet << networkStatus);
 
   // Check whether the received packet requires an acknowledgment.
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  Ptr<Packet> myPacket = packet->Copy ();
-  myPacket->RemoveHeader (mHdr);
-  myPacket->RemoveHeader (fHdr);
-
-  NS_LOG_INFO ("Received packet Mac Header: " << mHdr);
-  NS_LOG_INFO ("Received packet Frame Header: " << fHdr);
-
-  if (mHdr.GetMType () == LorawanMacHeader::CONFIRMED_DATA_UP)
+  if (uplink.macHeader.GetMType () == LorawanMacHeader::CONFIRMED_DATA_UP)
     {
       NS_LOG_INFO ("Packet requires confirmation");
 
       // Set up the ACK bit on the reply
-      status->m_reply.frameHeader.SetAsDownlink ();
-      status->m_reply.frameHeader.SetAck (true);
-      status->m_reply.frameHeader.SetAddress (fHdr.GetAddress ());
-      status->m_reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
-      status->m_reply.needsReply = true;
+      EndDeviceStatus::Reply &reply = status->GetReply ();
+      reply.frameHeader.SetAsDownlink ();
+      reply.frameHeader.SetAck (true);
+      reply.frameHeader.SetAddress (uplink.frameHeader.GetAddress ());
+      reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
+      reply.needsReply = true;
 
       // Note that the acknowledgment procedure dies here: "Acknowledgments
       // are only snt in response to the latest message received and are never
@@ -119,7 +117,10 @@ ConfirmedMessagesComponent::OnFailedReply (Ptr<EndDeviceStatus> status,
   NS_LOG_FUNCTION (this << networkStatus);
 
   // Empty the Ack bit.
-  status->m_reply.frameHeader.SetAck (false);
+  if (status->HasReply ())
+    {
+      status->GetReply ().frameHeader.SetAck (false);
+    }
 }
 
 ////////////////////////
@@ -143,14 +144,23 @@ LinkCheckComponent::~LinkCheckComponent ()
 }
 
 void
-LinkCheckComponent::OnReceivedPacket (Ptr<const Packet> packet,
+LinkCheckComponent::OnReceivedPacket (const DecodedUplink &uplink,
                                       Ptr<EndDeviceStatus> status,
                                       Ptr<NetworkStatus> networkStatus)
 {
-  NS_LOG_FUNCTION (this->GetTypeId () << packet << networkStatus);
+  NS_LOG_FUNCTION (this->GetTypeId () << uplink.packet << networkStatus);
 
-  // We will only act just before reply, when all Gateways will have received
-  // the packet.
+  // Remember the request, but only reply just before sending, when all
+  // Gateways will have received the packet. Find returns 0 if no command is
+  // found.
+  if (uplink.frameHeader.GetCommandValues ().Find (LINK_CHECK_REQ))
+    {
+      m_linkCheckRequests.insert (uplink.frameHeader.GetAddress ());
+    }
+  else
+    {
+      m_linkCheckRequests.erase (uplink.frameHeader.GetAddress ());
+    }
 }
 
 void
@@ -159,29 +169,18 @@ LinkCheckComponent::BeforeSendingReply (Ptr<EndDeviceStatus> status,
 {
   NS_LOG_FUNCTION (this << status << networkStatus);
 
-  Ptr<Packet> myPacket = status->GetLastPacketReceivedFromDevice ()->Copy ();
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  fHdr.SetAsUplink ();
-  myPacket->RemoveHeader (mHdr);
-  myPacket->RemoveHeader (fHdr);
-
-  Ptr<LinkCheckReq> command = fHdr.GetMacCommand<LinkCheckReq> ();
-
-  // GetMacCommand returns 0 if no command is found
-  if (command)
+  if (m_linkCheckRequests.erase (status->m_endDeviceAddress))
     {
-      status->m_reply.needsReply = true;
+      EndDeviceStatus::Reply &reply = status->GetReply ();
+      reply.needsReply = true;
 
       // Get the number of gateways that received the packet and the best
       // margin
       uint8_t gwCount = status->GetLastReceivedPacketInfo ().gwList.size ();
 
-      Ptr<LinkCheckAns> replyCommand = Create<LinkCheckAns> ();
-      replyCommand->SetGwCnt (gwCount);
-      status->m_reply.frameHeader.SetAsDownlink ();
-      status->m_reply.frameHeader.AddCommand (replyCommand);
-      status->m_reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
+      reply.frameHeader.SetAsDownlink ();
+      reply.frameHeader.AddLinkCheckAns (0, gwCount);
+      reply.macHeader.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
     }
   else
     {
@@ -194,6 +193,15 @@ LinkCheckComponent::OnFailedReply (Ptr<EndDeviceStatus> status,
                                    Ptr<NetworkStatus> networkStatus)
 {
   NS_LOG_FUNCTION (this->GetTypeId () << networkStatus);
+
+  m_linkCheckRequests.erase (status->m_endDeviceAddress);
+}
+
+bool
+LinkCheckComponent::MayAddToReply (Ptr<EndDeviceStatus> status,
+                                   Ptr<NetworkStatus> networkStatus)
+{
+  return m_linkCheckRequests.count (status->m_endDeviceAddress) > 0;
 }
 }
 }
@@ -25,6 +25,8 @@
 #include "ns3/log.h"
 #include "ns3/packet.h"
 #include "ns3/network-status.h"
+#include "ns3/decoded-uplink.h"
+#include <set>
 
 namespace ns3 {
 namespace lorawan {
@@ -55,10 +57,10 @@ public:
   /**
    * Method that is called when a new packet is received by the NetworkServer.
    *
-   * \param packet The newly received packet
+   * \param uplink The newly received packet, with its headers decoded
    * \param networkStatus A pointer to the NetworkStatus object
    */
-  virtual void OnReceivedPacket (Ptr<const Packet> packet,
+  virtual void OnReceivedPacket (const DecodedUplink &uplink,
                                  Ptr<EndDeviceStatus> status,
                                  Ptr<NetworkStatus> networkStatus) = 0;
 
@@ -74,6 +76,19 @@ public:
    */
   virtual void OnFailedReply (Ptr<EndDeviceStatus> status,
                               Ptr<NetworkStatus> networkStatus) = 0;
+
+  /**
+   * Whether BeforeSendingReply may add something to the reply of a device.
+   *
+   * This lets the NetworkScheduler plan the gateways of replies that are
+   * only built when their receive window opens. The default implementation
+   * returns false, for components that only act in OnReceivedPacket.
+   *
+   * \param status The EndDeviceStatus of the device.
+   * \param networkStatus A pointer to the NetworkStatus object
+   */
+  virtual bool MayAddToReply (Ptr<EndDeviceStatus> status,
+                              Ptr<NetworkStatus> networkStatus);
 };
 
 ///////////////////////////////
@@ -93,10 +108,10 @@ public:
    * This method checks whether the received packet requires an acknowledgment
    * and sets up the appropriate reply in case it does.
    *
-   * \param packet The newly received packet
+   * \param uplink The newly received packet, with its headers decoded
    * \param networkStatus A pointer to the NetworkStatus object
    */
-  void OnReceivedPacket (Ptr<const Packet> packet,
+  void OnReceivedPacket (const DecodedUplink &uplink,
                          Ptr<EndDeviceStatus> status,
                          Ptr<NetworkStatus> networkStatus);
 
@@ -124,10 +139,10 @@ public:
    * This method checks whether the received packet requires an acknowledgment
    * and sets up the appropriate reply in case it does.
    *
-   * \param packet The newly received packet
+   * \param uplink The newly received packet, with its headers decoded
    * \param networkStatus A pointer to the NetworkStatus object
    */
-  void OnReceivedPacket (Ptr<const Packet> packet,
+  void OnReceivedPacket (const DecodedUplink &uplink,
                          Ptr<EndDeviceStatus> status,
                          Ptr<NetworkStatus> networkStatus);
 
@@ -137,9 +152,12 @@ public:
   void OnFailedReply (Ptr<EndDeviceStatus> status,
                       Ptr<NetworkStatus> networkStatus);
 
+  bool MayAddToReply (Ptr<EndDeviceStatus> status,
+                      Ptr<NetworkStatus> networkStatus);
+
 private:
-  void UpdateLinkCheckAns (Ptr<Packet const> packet,
-                           Ptr<EndDeviceStatus> status);
+  std::set<LoraDeviceAddress> m_linkCheckRequests; //!< Devices whose last
+                                                   //!< uplink had a LinkCheckReq
 };
 }
 
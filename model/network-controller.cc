@@ -60,20 +60,19 @@ NetworkController::Install (Ptr<NetworkControllerComponent> component)
 }
 
 void
-NetworkController::OnNewPacket (Ptr<Packet const> packet)
+NetworkController::OnNewPacket (const DecodedUplink &uplink, uint32_t deviceIndex)
 {
-  NS_LOG_FUNCTION (this << packet);
+  NS_LOG_FUNCTION (this << uplink.packet);
 
   // NOTE As a future optimization, we can allow components to register their
   // callbacks and only be called in case a certain MAC command is contained.
   // For now, we call all components.
 
   // Inform each component about the new packet
+  Ptr<EndDeviceStatus> status = m_status->GetEndDeviceStatusByIndex (deviceIndex);
   for (auto it = m_components.begin (); it != m_components.end (); ++it)
     {
-      (*it)->OnReceivedPacket (packet,
-                               m_status->GetEndDeviceStatus (packet),
-                               m_status);
+      (*it)->OnReceivedPacket (uplink, status, m_status);
     }
 }
 
@@ -89,5 +88,20 @@ NetworkController::BeforeSendingReply (Ptr<EndDeviceStatus> endDeviceStatus)
     }
 }
 
+bool
+NetworkController::MayAddToReply (Ptr<EndDeviceStatus> endDeviceStatus)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (auto it = m_components.begin (); it != m_components.end (); ++it)
+    {
+      if ((*it)->MayAddToReply (endDeviceStatus, m_status))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
 }
 }
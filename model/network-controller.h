@@ -25,6 +25,7 @@
 #include "ns3/packet.h"
 #include "ns3/network-status.h"
 #include "ns3/network-controller-components.h"
+#include "ns3/decoded-uplink.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -54,9 +55,10 @@ public:
   /**
    * Method that is called by the NetworkServer when a new packet is received.
    *
-   * \param packet The newly received packet.
+   * \param uplink The newly received packet, with its headers decoded.
+   * \param deviceIndex The index of the sending device in the NetworkStatus.
    */
-  void OnNewPacket (Ptr<Packet const> packet);
+  void OnNewPacket (const DecodedUplink &uplink, uint32_t deviceIndex);
 
   /**
    * Method that is called by the NetworkScheduler just before sending a reply
@@ -64,6 +66,12 @@ public:
    */
   void BeforeSendingReply (Ptr<EndDeviceStatus> endDeviceStatus);
 
+  /**
+   * Whether any component may add something to the reply of a device when
+   * BeforeSendingReply is called.
+   */
+  bool MayAddToReply (Ptr<EndDeviceStatus> endDeviceStatus);
+
 private:
   Ptr<NetworkStatus> m_status;
   std::list<Ptr<NetworkControllerComponent> > m_components;
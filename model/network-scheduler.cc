@@ -1,4 +1,7 @@
 #include "network-scheduler.h"
+#include "ns3/lora-phy.h"
+#include "ns3/class-a-end-device-lorawan-mac.h"
+#include <algorithm>
 
 namespace ns3 {
 namespace lorawan {
@@ -13,6 +16,26 @@ NetworkScheduler::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::NetworkScheduler")
     .SetParent<Object> ()
     .AddConstructor<NetworkScheduler> ()
+    .AddAttribute ("PlanningHorizon",
+                   "How far ahead to look at the receive windows of other "
+                   "devices when choosing the gateway for a reply. A reply "
+                   "keeps its gateway busy for its time on air, so this should "
+                   "be about the longest downlink time on air. If zero, each "
+                   "reply uses the best available gateway of its device",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&NetworkScheduler::m_planningHorizon),
+                   MakeTimeChecker ())
+    .AddAttribute ("TickResolution",
+                   "Granularity with which receive windows are opened. If "
+                   "positive, windows are delayed to the next multiple of this "
+                   "value and all the windows of a tick are opened by a single "
+                   "event, which checks each gateway only once. If zero, each "
+                   "window gets its own event. At most 2 ms, so that a delayed "
+                   "reply still starts within the shortest receive window of a "
+                   "device (8 symbols at SF7 and 500 kHz, about 2.05 ms)",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&NetworkScheduler::m_tickResolution),
+                   MakeTimeChecker (Seconds (0), MilliSeconds (2)))
     .AddTraceSource ("ReceiveWindowOpened",
                      "Trace source that is fired when a receive window opportunity happens.",
                      MakeTraceSourceAccessor (&NetworkScheduler::m_receiveWindowOpened),
@@ -21,14 +44,20 @@ NetworkScheduler::GetTypeId (void)
   return tid;
 }
 
-NetworkScheduler::NetworkScheduler ()
+NetworkScheduler::NetworkScheduler () :
+  m_inTick (false),
+  m_nSentReplies (0),
+  m_nMissedReplies (0)
 {
 }
 
 NetworkScheduler::NetworkScheduler (Ptr<NetworkStatus> status,
                                     Ptr<NetworkController> controller) :
   m_status (status),
-  m_controller (controller)
+  m_controller (controller),
+  m_inTick (false),
+  m_nSentReplies (0),
+  m_nMissedReplies (0)
 {
 }
 
@@ -37,98 +66,383 @@ NetworkScheduler::~NetworkScheduler ()
 }
 
 void
-NetworkScheduler::OnReceivedPacket (Ptr<const Packet> packet)
+NetworkScheduler::OnReceivedPacket (const DecodedUplink &uplink, uint32_t deviceIndex)
 {
-  NS_LOG_FUNCTION (packet);
+  NS_LOG_FUNCTION (uplink.packet << deviceIndex);
 
-  // Get the current packet's frame counter
-  Ptr<Packet> packetCopy = packet->Copy ();
-  LorawanMacHeader receivedMacHdr;
-  packetCopy->RemoveHeader (receivedMacHdr);
-  LoraFrameHeader receivedFrameHdr;
-  receivedFrameHdr.SetAsUplink ();
-  packetCopy->RemoveHeader (receivedFrameHdr);
+  Ptr<EndDeviceStatus> status = m_status->GetEndDeviceStatusByIndex (deviceIndex);
 
   // Need to decide whether to schedule a receive window
-  if (!m_status->GetEndDeviceStatus (packet)->HasReceiveWindowOpportunityScheduled ())
+  if (!status->HasReceiveWindowOpportunityScheduled ())
   {
-    // Extract the address
-    LoraDeviceAddress deviceAddress = receivedFrameHdr.GetAddress ();
-
     // Schedule OnReceiveWindowOpportunity event
-    m_status->GetEndDeviceStatus (packet)->SetReceiveWindowOpportunity (
-      Simulator::Schedule (Seconds (1),
-                           &NetworkScheduler::OnReceiveWindowOpportunity,
-                           this,
-                           deviceAddress,
-                           1)); // This will be the first receive window
+    ScheduleReceiveWindow (status, deviceIndex, 1); // This will be the first receive window
   }
 }
 
 void
-NetworkScheduler::OnReceiveWindowOpportunity (LoraDeviceAddress deviceAddress, int window)
+NetworkScheduler::ScheduleReceiveWindow (Ptr<EndDeviceStatus> status, uint32_t deviceIndex,
+                                         int window)
+{
+  Time delay = Seconds (1);
+
+  if (m_tickResolution.IsStrictlyPositive ())
+    {
+      // Round up, so that the window is never opened before the device starts
+      // listening
+      int64_t resolution = m_tickResolution.GetTimeStep ();
+      int64_t tick = ((Simulator::Now () + delay).GetTimeStep () + resolution - 1)
+        / resolution;
+      delay = TimeStep (tick * resolution) - Simulator::Now ();
+
+      ReceiveWindowTick &entry = m_ticks[tick];
+      if (entry.windows.empty ())
+        {
+          entry.event = Simulator::Schedule (delay,
+                                             &NetworkScheduler::OnReceiveWindowTick,
+                                             this,
+                                             tick);
+        }
+      entry.windows.push_back (std::make_pair (deviceIndex, window));
+
+      // The event is shared with the other devices of the tick, but it still
+      // tells whether this device has a window coming. It's only cancelled
+      // by the device while it's running, which has no effect.
+      status->SetReceiveWindowOpportunity (entry.event);
+    }
+  else
+    {
+      status->SetReceiveWindowOpportunity (
+        Simulator::Schedule (delay,
+                             &NetworkScheduler::OnReceiveWindowOpportunity,
+                             this,
+                             deviceIndex,
+                             window));
+    }
+
+  // Let the planner know about this window
+  if (m_planningHorizon.IsStrictlyPositive ())
+    {
+      m_plannedWindows.insert (std::make_pair (Simulator::Now () + delay, deviceIndex));
+    }
+}
+
+void
+NetworkScheduler::OnReceiveWindowTick (int64_t tick)
+{
+  NS_LOG_FUNCTION (this << tick);
+
+  // Take the windows out of the queue, since opening them can add the second
+  // windows of some devices to later ticks
+  std::vector<std::pair<uint32_t, int> > windows;
+  std::map<int64_t, ReceiveWindowTick>::iterator it = m_ticks.find (tick);
+  NS_ASSERT (it != m_ticks.end ());
+  windows.swap (it->second.windows);
+  m_ticks.erase (it);
+
+  NS_LOG_DEBUG ("Opening " << windows.size () << " receive windows");
+
+  m_gatewayAvailability.assign (m_status->CountGateways (), -1);
+  m_inTick = true;
+  for (uint32_t i = 0; i < windows.size (); i++)
+    {
+      OnReceiveWindowOpportunity (windows[i].first, windows[i].second);
+    }
+  m_inTick = false;
+}
+
+void
+NetworkScheduler::OnReceiveWindowOpportunity (uint32_t deviceIndex, int window)
 {
-  NS_LOG_FUNCTION (deviceAddress);
+  NS_LOG_FUNCTION (deviceIndex);
+
+  Ptr<EndDeviceStatus> status = m_status->GetEndDeviceStatusByIndex (deviceIndex);
 
   NS_LOG_DEBUG ("Opening receive window number " << window << " for device "
-                                                 << deviceAddress);
+                                                 << status->m_endDeviceAddress);
 
-  // Check whether we can send a reply to the device, again by using
-  // NetworkStatus
-  Address gwAddress = m_status->GetBestGatewayForDevice (deviceAddress, window);
+  // This window is not upcoming anymore
+  if (m_planningHorizon.IsStrictlyPositive ())
+    {
+      auto range = m_plannedWindows.equal_range (Simulator::Now ());
+      for (auto it = range.first; it != range.second; ++it)
+        {
+          if (it->second == deviceIndex)
+            {
+              m_plannedWindows.erase (it);
+              break;
+            }
+        }
+    }
+  uint32_t gwIndex = SelectGateway (deviceIndex, window);
 
-  if (gwAddress == Address () && window == 1)
+  if (gwIndex == NetworkStatus::NOT_FOUND && window == 1)
     {
       NS_LOG_DEBUG ("No suitable gateway found for first window.");
 
       // No suitable GW was found, but there's still hope to find one for the
       // second window.
       // Schedule another OnReceiveWindowOpportunity event
-      m_status->GetEndDeviceStatus (deviceAddress)->SetReceiveWindowOpportunity (
-        Simulator::Schedule (Seconds (1),
-                             &NetworkScheduler::OnReceiveWindowOpportunity,
-                             this,
-                             deviceAddress,
-                             2));     // This will be the second receive window
+      ScheduleReceiveWindow (status, deviceIndex, 2); // This will be the second receive window
     }
-  else if (gwAddress == Address () && window == 2)
+  else if (gwIndex == NetworkStatus::NOT_FOUND && window == 2)
     {
       // No suitable GW was found and this was our last opportunity
       // Simply give up.
       NS_LOG_DEBUG ("Giving up on reply: no suitable gateway was found " <<
                    "on the second receive window");
 
+      if (status->NeedsReply ())
+        {
+          m_nMissedReplies++;
+        }
+
       // Reset the reply
       // XXX Should we reset it here or keep it for the next opportunity?
-      m_status->GetEndDeviceStatus (deviceAddress)->RemoveReceiveWindowOpportunity();
-      m_status->GetEndDeviceStatus (deviceAddress)->InitializeReply ();
+      status->RemoveReceiveWindowOpportunity();
+      status->InitializeReply ();
     }
   else
     {
       // A gateway was found
 
-      NS_LOG_DEBUG ("Found available gateway with address: " << gwAddress);
+      NS_LOG_DEBUG ("Found available gateway with index: " << gwIndex);
 
-      m_controller->BeforeSendingReply (m_status->GetEndDeviceStatus
-                                          (deviceAddress));
+      m_controller->BeforeSendingReply (status);
 
-      // Check whether this device needs a response by querying m_status
-      bool needsReply = m_status->NeedsReply (deviceAddress);
+      // Check whether this device needs a response
+      bool needsReply = status->NeedsReply ();
 
       if (needsReply)
         {
           NS_LOG_INFO ("A reply is needed");
 
           // Send the reply through that gateway
-          m_status->SendThroughGateway (m_status->GetReplyForDevice
-                                          (deviceAddress, window),
-                                        gwAddress);
+          m_status->SendThroughGateway (m_status->GetReplyForDevice (status, window),
+                                        gwIndex);
+          m_nSentReplies++;
+
+          // The gateway is busy for the rest of the tick
+          if (m_inTick)
+            {
+              m_gatewayAvailability[gwIndex] = 0;
+            }
 
           // Reset the reply
-          m_status->GetEndDeviceStatus (deviceAddress)->RemoveReceiveWindowOpportunity();
-          m_status->GetEndDeviceStatus (deviceAddress)->InitializeReply ();
+          status->RemoveReceiveWindowOpportunity();
+          status->InitializeReply ();
+        }
+    }
+}
+
+uint32_t
+NetworkScheduler::SelectGateway (uint32_t deviceIndex, int window)
+{
+  // Check whether we can send a reply to the device, again by using
+  // NetworkStatus, or by planning it together with the other devices
+  if (m_planningHorizon.IsStrictlyPositive ())
+    {
+      return PlanGateway (deviceIndex, window);
+    }
+
+  if (!m_inTick)
+    {
+      return m_status->GetBestGatewayIndexForDevice (deviceIndex, window);
+    }
+
+  // Same as NetworkStatus::GetBestGatewayIndexForDevice, but going through
+  // the availability cache of the tick
+  Ptr<EndDeviceStatus> status = m_status->GetEndDeviceStatusByIndex (deviceIndex);
+  double frequency = window == 1 ? status->GetFirstReceiveWindowFrequency ()
+                                 : status->GetSecondReceiveWindowFrequency ();
+  for (uint32_t i = 0; i < status->GetNRankedGateways (); i++)
+    {
+      uint32_t gwIndex = status->GetRankedGateway (i).gatewayIndex;
+      if (IsGatewayAvailable (gwIndex, frequency))
+        {
+          return gwIndex;
+        }
+    }
+  return NetworkStatus::NOT_FOUND;
+}
+
+bool
+NetworkScheduler::IsGatewayAvailable (uint32_t gatewayIndex, double frequency)
+{
+  if (!m_inTick)
+    {
+      return m_status->GetGatewayStatusByIndex (gatewayIndex)
+             ->IsAvailableForTransmission (frequency);
+    }
+
+  // Whether the gateway is idle doesn't depend on the frequency, so one
+  // check per gateway is enough. The duty cycle, which does, is then a plain
+  // lookup in the gateway's MAC.
+  Ptr<GatewayStatus> gwStatus = m_status->GetGatewayStatusByIndex (gatewayIndex);
+  if (m_gatewayAvailability[gatewayIndex] < 0)
+    {
+      m_gatewayAvailability[gatewayIndex] = gwStatus->IsIdle ();
+    }
+  return m_gatewayAvailability[gatewayIndex]
+         && gwStatus->IsAllowedByDutyCycle (frequency);
+}
+
+Time
+NetworkScheduler::GetReplyOnAirTime (Ptr<EndDeviceStatus> status, int window)
+{
+  // The reply may still grow in BeforeSendingReply, so this is a lower bound
+  uint32_t size = LorawanMacHeader ().GetSerializedSize ()
+    + LoraFrameHeader ().GetSerializedSize ();
+  if (status->HasReply ())
+    {
+      EndDeviceStatus::Reply &reply = status->GetReply ();
+      size = reply.macHeader.GetSerializedSize ()
+        + reply.frameHeader.GetSerializedSize ()
+        + (reply.payload ? reply.payload->GetSize () : 0);
+    }
+
+  // Same parameters as GatewayLorawanMac::Send
+  Ptr<ClassAEndDeviceLorawanMac> mac = status->GetMac ();
+  uint8_t dataRate = window == 1 ? mac->GetFirstReceiveWindowDataRate ()
+                                 : mac->GetSecondReceiveWindowDataRate ();
+  LoraTxParameters params;
+  params.sf = mac->GetSfFromDataRate (dataRate);
+  params.headerDisabled = false;
+  params.codingRate = 1;
+  params.bandwidthHz = mac->GetBandwidthFromDataRate (dataRate);
+  params.nPreamble = 8;
+  params.crcEnabled = 1;
+  params.lowDataRateOptimizationEnabled = LoraPhy::GetTSym (params) > MilliSeconds (16);
+
+  return LoraPhy::GetOnAirTime (size, params);
+}
+
+void
+NetworkScheduler::CollectCompetitors (Ptr<EndDeviceStatus> status, Time start, Time end)
+{
+  // Their replies may still be empty, since the components only fill some of
+  // them in BeforeSendingReply, so ask them as well
+  m_competitors.clear ();
+  for (auto it = m_plannedWindows.lower_bound (start);
+       it != m_plannedWindows.end () && it->first < end; ++it)
+    {
+      Ptr<EndDeviceStatus> competitor = m_status->GetEndDeviceStatusByIndex (it->second);
+      if (competitor != status
+          && competitor->GetNRankedGateways () > 0
+          && (competitor->NeedsReply () || m_controller->MayAddToReply (competitor)))
+        {
+          m_competitors.push_back (competitor);
+        }
+    }
+}
+
+double
+NetworkScheduler::GetGatewayCost (uint32_t gatewayIndex, bool &isOnlyGateway) const
+{
+  double cost = 0;
+  isOnlyGateway = false;
+  for (auto it = m_competitors.begin (); it != m_competitors.end (); ++it)
+    {
+      uint32_t nAlternatives = (*it)->GetNRankedGateways ();
+      for (uint32_t j = 0; j < nAlternatives; j++)
+        {
+          if ((*it)->GetRankedGateway (j).gatewayIndex == gatewayIndex)
+            {
+              cost += 1.0 / nAlternatives;
+              isOnlyGateway = isOnlyGateway || nAlternatives == 1;
+              break;
+            }
+        }
+    }
+  return cost;
+}
+
+uint32_t
+NetworkScheduler::PlanGateway (uint32_t deviceIndex, int window)
+{
+  NS_LOG_FUNCTION (this << deviceIndex << window);
+
+  Ptr<EndDeviceStatus> status = m_status->GetEndDeviceStatusByIndex (deviceIndex);
+  double frequency = window == 1 ? status->GetFirstReceiveWindowFrequency ()
+                                 : status->GetSecondReceiveWindowFrequency ();
+
+  // Only the devices whose windows open while the reply is on air can find
+  // its gateway busy
+  Time now = Simulator::Now ();
+  CollectCompetitors (status, now,
+                      now + std::min (GetReplyOnAirTime (status, window),
+                                      m_planningHorizon));
+
+  // Charge each available gateway for the devices it would keep busy, going
+  // from the best to the worst one so that ties favor the received power
+  uint32_t bestGwIndex = NetworkStatus::NOT_FOUND;
+  double bestCost = 0;
+  bool bestIsOnlyGateway = false;
+  for (uint32_t i = 0; i < status->GetNRankedGateways (); i++)
+    {
+      uint32_t gwIndex = status->GetRankedGateway (i).gatewayIndex;
+      if (!IsGatewayAvailable (gwIndex, frequency))
+        {
+          continue;
+        }
+
+      bool isOnlyGateway;
+      double cost = GetGatewayCost (gwIndex, isOnlyGateway);
+      if (bestGwIndex == NetworkStatus::NOT_FOUND || cost < bestCost)
+        {
+          bestGwIndex = gwIndex;
+          bestCost = cost;
+          bestIsOnlyGateway = isOnlyGateway;
         }
     }
+
+  if (window != 1 || bestGwIndex == NetworkStatus::NOT_FOUND || !bestIsOnlyGateway)
+    {
+      return bestGwIndex;
+    }
+
+  // Leave the gateway to a device that has no alternative, but only if the
+  // second window has a gateway that is free and that is not needed by
+  // anybody else either, otherwise the postponed reply may be lost or take
+  // the place of another one. Replies sent before the second window may
+  // still be on air when it opens.
+  Time secondWindow = now + Seconds (1);
+  double secondFrequency = status->GetSecondReceiveWindowFrequency ();
+  CollectCompetitors (status, secondWindow - m_planningHorizon,
+                      secondWindow + GetReplyOnAirTime (status, 2));
+  for (uint32_t i = 0; i < status->GetNRankedGateways (); i++)
+    {
+      uint32_t gwIndex = status->GetRankedGateway (i).gatewayIndex;
+      Ptr<GatewayLorawanMac> gwMac = m_status->GetGatewayStatusByIndex (gwIndex)
+        ->GetGatewayMac ();
+      if (gwMac->IsDutyCycleEnforced ()
+          && gwMac->GetWaitingTime (secondFrequency) > Seconds (1))
+        {
+          continue;
+        }
+
+      bool isOnlyGateway;
+      if (GetGatewayCost (gwIndex, isOnlyGateway) == 0)
+        {
+          NS_LOG_DEBUG ("Postponing the reply to the second window, cost " << bestCost);
+          return NetworkStatus::NOT_FOUND;
+        }
+    }
+
+  NS_LOG_DEBUG ("The second window is not free, sending in the first one");
+  return bestGwIndex;
+}
+
+uint32_t
+NetworkScheduler::GetNSentReplies (void) const
+{
+  return m_nSentReplies;
+}
+
+uint32_t
+NetworkScheduler::GetNMissedReplies (void) const
+{
+  return m_nMissedReplies;
 }
 }
 }
@@ -29,6 +29,9 @@
 #include "ns3/lora-frame-header.h"
 #include "ns3/network-controller.h"
 #include "ns3/network-status.h"
+#include "ns3/decoded-uplink.h"
+#include <map>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
@@ -50,19 +53,125 @@ public:
    * Method called by NetworkServer to inform the Scheduler of a newly arrived
    * uplink packet. This function schedules the OnReceiveWindowOpportunity
    * events 1 and 2 seconds later.
+   *
+   * If the TickResolution attribute is positive, the receive windows are
+   * rounded up to a multiple of it instead, and a single event opens all the
+   * windows that fall in the same tick.
+   *
+   * \param uplink the received packet.
+   * \param deviceIndex the index of the device in the NetworkStatus.
    */
-  void OnReceivedPacket (Ptr<const Packet> packet);
+  void OnReceivedPacket (const DecodedUplink &uplink, uint32_t deviceIndex);
 
   /**
    * Method that is scheduled after packet arrivals in order to act on
    * receive windows 1 and 2 seconds later receptions.
    */
-  void OnReceiveWindowOpportunity (LoraDeviceAddress deviceAddress, int window);
+  void OnReceiveWindowOpportunity (uint32_t deviceIndex, int window);
+
+  /**
+   * Get the number of replies that were sent to devices.
+   */
+  uint32_t GetNSentReplies (void) const;
+
+  /**
+   * Get the number of replies that were needed, for example to acknowledge a
+   * confirmed uplink, but found no available gateway in either receive
+   * window.
+   */
+  uint32_t GetNMissedReplies (void) const;
 
 private:
+  /**
+   * Choose the gateway for a reply, taking into account the other devices
+   * whose receive windows open while the reply would be on air, up to the
+   * planning horizon.
+   *
+   * Each available gateway of the device is charged for the devices it would
+   * keep from being served, weighted by how few alternatives they have, and
+   * the cheapest one is chosen. A reply in the first window is postponed to
+   * the second one if it would take the only gateway of another device, and
+   * if one of the device's gateways is expected to be free in the second
+   * window without being needed by other devices. Other devices count if
+   * they already need a reply, or if a component of the NetworkController
+   * may add to their reply (see NetworkControllerComponent::MayAddToReply).
+   *
+   * \return The index of the gateway, or NetworkStatus::NOT_FOUND if the
+   * reply can't or shouldn't be sent in this window.
+   */
+  uint32_t PlanGateway (uint32_t deviceIndex, int window);
+
+  /**
+   * Estimate the time on air of the reply to a device in one of its receive
+   * windows, from the reply built so far.
+   */
+  Time GetReplyOnAirTime (Ptr<EndDeviceStatus> status, int window);
+
+  /**
+   * Fill m_competitors with the devices other than status whose receive
+   * windows open in [start, end) and that will need a gateway.
+   */
+  void CollectCompetitors (Ptr<EndDeviceStatus> status, Time start, Time end);
+
+  /**
+   * Get the cost of sending through a gateway for the devices in
+   * m_competitors.
+   *
+   * \param gatewayIndex The index of the gateway.
+   * \param isOnlyGateway Set to whether some of the devices can only be
+   * reached through this gateway.
+   */
+  double GetGatewayCost (uint32_t gatewayIndex, bool &isOnlyGateway) const;
+
+  /**
+   * Schedule a receive window opportunity for a device.
+   */
+  void ScheduleReceiveWindow (Ptr<EndDeviceStatus> status, uint32_t deviceIndex,
+                              int window);
+
+  /**
+   * Open all the receive windows that fall in a tick.
+   */
+  void OnReceiveWindowTick (int64_t tick);
+
+  /**
+   * Choose the gateway for a reply, with the best available gateway of the
+   * device or with PlanGateway.
+   */
+  uint32_t SelectGateway (uint32_t deviceIndex, int window);
+
+  /**
+   * Check whether a gateway can send a reply. While a tick is being
+   * processed, whether the gateway is idle is cached for the other devices of
+   * the tick.
+   */
+  bool IsGatewayAvailable (uint32_t gatewayIndex, double frequency);
+
+  /**
+   * Receive windows due in a tick, as (device index, window number) pairs.
+   */
+  struct ReceiveWindowTick
+  {
+    EventId event;
+    std::vector<std::pair<uint32_t, int> > windows;
+  };
+
   TracedCallback<Ptr<const Packet> > m_receiveWindowOpened;
   Ptr<NetworkStatus> m_status;
   Ptr<NetworkController> m_controller;
+
+  Time m_planningHorizon;   //!< How far ahead PlanGateway looks
+  std::multimap<Time, uint32_t> m_plannedWindows;  //!< Upcoming receive
+                                                   //!< windows, by device index
+  std::vector<Ptr<EndDeviceStatus> > m_competitors;  //!< Buffer for PlanGateway
+  Time m_tickResolution;    //!< Granularity of the receive window ticks
+  std::map<int64_t, ReceiveWindowTick> m_ticks;  //!< Pending ticks, by number
+  bool m_inTick;            //!< Whether a tick is being processed
+  std::vector<int8_t> m_gatewayAvailability;  //!< Per gateway: -1 if not yet
+                                              //!< checked in this tick, else
+                                              //!< whether it's idle
+  uint32_t m_nSentReplies;     //!< Number of replies sent
+  uint32_t m_nMissedReplies;   //!< Number of needed replies that were not sent
 };
 
 } /* namespace ns3 */
@@ -31,6 +31,11 @@
 #include "ns3/node-container.h"
 #include "ns3/class-a-end-device-lorawan-mac.h"
 #include "ns3/mac-command.h"
+#include "ns3/mobility-model.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/backhaul-bundle-header.h"
 
 namespace ns3 {
 namespace lorawan {
@@ -49,6 +54,41 @@ NetworkServer::GetTypeId (void)
                      "Trace source that is fired when a packet arrives at the Network Server",
                      MakeTraceSourceAccessor (&NetworkServer::m_receivedPacket),
                      "ns3::Packet::TracedCallback")
+    .AddAttribute ("GeneticSpatialSeeding",
+                   "Whether to seed the genetic optimizer of devices with "
+                   "the genomes that converged at neighbouring devices",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NetworkServer::m_geneticSpatialSeeding),
+                   MakeBooleanChecker ())
+    .AddAttribute ("GeneticSeedRadius",
+                   "The distance, in meters, within which converged genomes "
+                   "are used as seeds",
+                   DoubleValue (500),
+                   MakeDoubleAccessor (&NetworkServer::m_geneticSeedRadius),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("GeneticSeedCount",
+                   "The maximum number of seeds given to a device",
+                   UintegerValue (4),
+                   MakeUintegerAccessor (&NetworkServer::m_geneticSeedCount),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DeduplicationWindow",
+                   "How long after the first copy of an uplink other copies, "
+                   "received through other gateways, are recognized by their "
+                   "device address and frame counter. Duplicates only add "
+                   "their gateway to the device's information, without going "
+                   "through the scheduler and controller again. Should be "
+                   "shorter than the retransmission interval of confirmed "
+                   "uplinks, which reuse the frame counter. If zero, all copies "
+                   "are processed in full",
+                   TimeValue (Seconds (0)),
+                   MakeTimeAccessor (&NetworkServer::m_deduplicationWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("ProfileStages",
+                   "Whether to measure the wall-clock time spent in each stage "
+                   "of the processing of uplinks, see GetStageTimes",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&NetworkServer::m_profileStages),
+                   MakeBooleanChecker ())
     .SetGroupName ("lorawan");
   return tid;
 }
@@ -56,7 +96,10 @@ NetworkServer::GetTypeId (void)
 NetworkServer::NetworkServer () :
   m_status (Create<NetworkStatus> ()),
   m_controller (Create<NetworkController> (m_status)),
-  m_scheduler (Create<NetworkScheduler> (m_status, m_controller))
+  m_scheduler (CreateObject<NetworkScheduler> (m_status, m_controller)),
+  m_genomeSeedIndex (CreateObject<GenomeSeedIndex> ()),
+  m_nTotalDuplicates (0),
+  m_profileStages (false)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -111,6 +154,27 @@ NetworkServer::AddGateway (Ptr<Node> gateway, Ptr<NetDevice> netDevice)
   m_status->AddGateway (gatewayAddress, gwStatus);
 }
 
+void
+NetworkServer::AddGateway (Ptr<Node> gateway, Ptr<DirectBackhaul> directBackhaul)
+{
+  NS_LOG_FUNCTION (this << gateway << directBackhaul);
+
+  // Get the gateway's LoRa MAC layer (assumes gateway's MAC is configured as first device)
+  Ptr<GatewayLorawanMac> gwMac = gateway->GetDevice (0)->GetObject<LoraNetDevice> ()->
+    GetMac ()->GetObject<GatewayLorawanMac> ();
+  NS_ASSERT (gwMac != 0);
+
+  Address gatewayAddress = directBackhaul->GetAddress ();
+  Ptr<GatewayStatus> gwStatus = Create<GatewayStatus> (gatewayAddress,
+                                                       Ptr<NetDevice> (),
+                                                       gwMac);
+  gwStatus->SetDirectBackhaul (directBackhaul);
+
+  m_status->AddGateway (gatewayAddress, gwStatus);
+
+  directBackhaul->SetNetworkServerCallback (MakeCallback (&NetworkServer::Receive, this));
+}
+
 void
 NetworkServer::AddNodes (NodeContainer nodes)
 {
@@ -147,6 +211,58 @@ NetworkServer::AddNode (Ptr<Node> node)
 
   // Update the NetworkStatus about the existence of this node
   m_status->AddNode (edLorawanMac);
+
+  // Let the genetic optimizer of the device exchange genomes with its
+  // neighbours through the server
+  Ptr<MobilityModel> mobility = node->GetObject<MobilityModel> ();
+  if (mobility != 0)
+    {
+      m_devicePositions[edLorawanMac->GetDeviceAddress ()] = mobility->GetPosition ();
+    }
+  edLorawanMac->SetGeneticSeedCallback
+    (MakeCallback (&NetworkServer::GetGeneticSeeds, this));
+  edLorawanMac->TraceConnectWithoutContext
+    ("GeneticConverged", MakeCallback (&NetworkServer::OnGeneticConverged, this));
+
+  // Let the device skip receive windows in which nothing will be sent
+  edLorawanMac->SetDownlinkPendingCallback
+    (MakeCallback (&NetworkServer::HasPendingDownlink, this));
+}
+
+void
+NetworkServer::OnGeneticConverged (LoraDeviceAddress address,
+                                   Ptr<const TransmissionParameterSet> tps)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  auto position = m_devicePositions.find (address);
+  if (!m_geneticSpatialSeeding || position == m_devicePositions.end ())
+    {
+      return;
+    }
+
+  m_genomeSeedIndex->Insert (address, position->second, tps);
+}
+
+std::vector<Ptr<TransmissionParameterSet> >
+NetworkServer::GetGeneticSeeds (LoraDeviceAddress address)
+{
+  NS_LOG_FUNCTION (this << address);
+
+  auto position = m_devicePositions.find (address);
+  if (!m_geneticSpatialSeeding || position == m_devicePositions.end ())
+    {
+      return std::vector<Ptr<TransmissionParameterSet> > ();
+    }
+
+  return m_genomeSeedIndex->GetSeeds (address, position->second,
+                                      m_geneticSeedRadius, m_geneticSeedCount);
+}
+
+bool
+NetworkServer::HasPendingDownlink (LoraDeviceAddress address)
+{
+  return m_status->HasPendingDownlink (address);
 }
 
 bool
@@ -155,24 +271,156 @@ NetworkServer::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet,
 {
   NS_LOG_FUNCTION (this << packet << protocol << address);
 
-  // Create a copy of the packet
-  Ptr<Packet> myPacket = packet->Copy ();
+  // Unpack the uplinks a gateway bundled together
+  BackhaulBundleTag bundleTag;
+  if (packet->PeekPacketTag (bundleTag))
+    {
+      Ptr<Packet> bundle = packet->Copy ();
+      bundle->RemovePacketTag (bundleTag);
+      BackhaulBundleHeader bundleHeader;
+      bundle->RemoveHeader (bundleHeader);
+
+      NS_LOG_DEBUG ("Unpacking a bundle of " << bundleHeader.GetNFrames () << " uplinks");
+
+      uint32_t offset = 0;
+      for (uint32_t i = 0; i < bundleHeader.GetNFrames (); i++)
+        {
+          uint32_t size = bundleHeader.GetFrameSize (i);
+          Ptr<Packet> frame = bundle->CreateFragment (offset, size);
+          frame->AddPacketTag (bundleHeader.GetFrameTag (i));
+          offset += size;
+
+          Receive (device, frame, protocol, address);
+        }
+      return true;
+    }
+
+  if (m_profileStages)
+    {
+      m_stageStart = std::chrono::steady_clock::now ();
+    }
+
+  // Decode the packet and find the device once for all the components below
+  DecodedUplink uplink (packet, address);
+  uint32_t deviceIndex = m_status->GetEndDeviceIndex (uplink.frameHeader.GetAddress ());
+  NS_ABORT_MSG_IF (deviceIndex == NetworkStatus::NOT_FOUND,
+                   "Packet received from unknown device " << uplink.frameHeader.GetAddress ());
 
   // Fire the trace source
   m_receivedPacket (packet);
 
+  // Copies of an uplink that was already received through another gateway
+  // only bring the information about their gateway
+  if (m_deduplicationWindow.IsStrictlyPositive ())
+    {
+      if (deviceIndex >= m_lastFCnts.size ())
+        {
+          m_lastFCnts.resize (deviceIndex + 1, 0);
+          m_lastFCntExpiries.resize (deviceIndex + 1, Seconds (0));
+          m_lastCopies.resize (deviceIndex + 1, 0);
+        }
+
+      uint16_t fCnt = uplink.frameHeader.GetFCnt ();
+      if (m_lastFCnts[deviceIndex] == fCnt
+          && Simulator::Now () < m_lastFCntExpiries[deviceIndex])
+        {
+          NS_LOG_DEBUG ("Duplicate of uplink " << fCnt << " from device "
+                                               << uplink.frameHeader.GetAddress ());
+
+          m_status->OnReceivedPacket (uplink, deviceIndex);
+
+          m_lastCopies[deviceIndex]++;
+          m_nTotalDuplicates++;
+          EndStage (m_stageTimes.decode);
+          return true;
+        }
+
+      // This is a new uplink, so the copies of the previous one are over
+      CountCopies (deviceIndex);
+      m_lastFCnts[deviceIndex] = fCnt;
+      m_lastFCntExpiries[deviceIndex] = Simulator::Now () + m_deduplicationWindow;
+      m_lastCopies[deviceIndex] = 1;
+    }
+
+  EndStage (m_stageTimes.decode);
+
   // Inform the scheduler of the newly arrived packet
-  m_scheduler->OnReceivedPacket (packet);
+  m_scheduler->OnReceivedPacket (uplink, deviceIndex);
+  EndStage (m_stageTimes.scheduler);
 
   // Inform the status of the newly arrived packet
-  m_status->OnReceivedPacket (packet, address);
+  m_status->OnReceivedPacket (uplink, deviceIndex);
+  EndStage (m_stageTimes.status);
 
   // Inform the controller of the newly arrived packet
-  m_controller->OnNewPacket (packet);
+  m_controller->OnNewPacket (uplink, deviceIndex);
+  EndStage (m_stageTimes.controller);
+
+  if (m_profileStages)
+    {
+      m_stageTimes.nUplinks++;
+    }
 
   return true;
 }
 
+uint32_t
+NetworkServer::GetNDuplicates (void) const
+{
+  return m_nTotalDuplicates;
+}
+
+const std::vector<uint64_t> &
+NetworkServer::GetCopiesHistogram (void)
+{
+  // Count the uplinks whose window is over, but that weren't followed by
+  // another one from the same device yet
+  for (uint32_t i = 0; i < m_lastCopies.size (); i++)
+    {
+      if (Simulator::Now () >= m_lastFCntExpiries[i])
+        {
+          CountCopies (i);
+        }
+    }
+  return m_copiesHistogram;
+}
+
+void
+NetworkServer::CountCopies (uint32_t deviceIndex)
+{
+  uint16_t nCopies = m_lastCopies[deviceIndex];
+  if (nCopies == 0)
+    {
+      return;
+    }
+
+  if (nCopies >= m_copiesHistogram.size ())
+    {
+      m_copiesHistogram.resize (nCopies + 1, 0);
+    }
+  m_copiesHistogram[nCopies]++;
+  m_lastCopies[deviceIndex] = 0;
+}
+
+const NetworkServer::StageTimes &
+NetworkServer::GetStageTimes (void) const
+{
+  return m_stageTimes;
+}
+
+void
+NetworkServer::EndStage (double &stageTime)
+{
+  if (!m_profileStages)
+    {
+      return;
+    }
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now ();
+  stageTime += std::chrono::duration<double> (now - m_stageStart).count ();
+  m_stageStart = now;
+}
+
 void
 NetworkServer::AddComponent (Ptr<NetworkControllerComponent> component)
 {
@@ -187,5 +435,17 @@ NetworkServer::GetNetworkStatus (void)
   return m_status;
 }
 
+Ptr<NetworkScheduler>
+NetworkServer::GetNetworkScheduler (void)
+{
+  return m_scheduler;
+}
+
+Ptr<GenomeSeedIndex>
+NetworkServer::GetGenomeSeedIndex (void)
+{
+  return m_genomeSeedIndex;
+}
+
 }
 }
@@ -35,6 +35,11 @@
 #include "ns3/node-container.h"
 #include "ns3/log.h"
 #include "ns3/class-a-end-device-lorawan-mac.h"
+#include "ns3/genome-seed-index.h"
+#include "ns3/vector.h"
+#include <map>
+#include <vector>
+#include <chrono>
 
 namespace ns3 {
 namespace lorawan {
@@ -85,6 +90,13 @@ public:
    */
   void AddGateway (Ptr<Node> gateway, Ptr<NetDevice> netDevice);
 
+  /**
+   * Add this gateway to the list of gateways connected to this NS, through
+   * an in-process link instead of a NetDevice. The gateway is identified by
+   * the address of the link.
+   */
+  void AddGateway (Ptr<Node> gateway, Ptr<DirectBackhaul> directBackhaul);
+
   /**
    * A NetworkControllerComponent to this NetworkServer instance.
    */
@@ -99,12 +111,110 @@ public:
 
   Ptr<NetworkStatus> GetNetworkStatus (void);
 
+  /**
+   * Get the scheduler that decides when and through which gateway replies
+   * are sent.
+   */
+  Ptr<NetworkScheduler> GetNetworkScheduler (void);
+
+  /**
+   * Get the index of the genomes that converged at the devices of this
+   * network.
+   */
+  Ptr<GenomeSeedIndex> GetGenomeSeedIndex (void);
+
+  /**
+   * Record the genome a device's genetic optimizer converged to.
+   */
+  void OnGeneticConverged (LoraDeviceAddress address,
+                           Ptr<const TransmissionParameterSet> tps);
+
+  /**
+   * Get the initial population for a device starting a genetic optimization
+   * run, taken from the genomes that converged closest to it.
+   */
+  std::vector<Ptr<TransmissionParameterSet> > GetGeneticSeeds (LoraDeviceAddress address);
+
+  /**
+   * Tell a device whether a downlink is already waiting to be sent to it.
+   */
+  bool HasPendingDownlink (LoraDeviceAddress address);
+
+  /**
+   * Get the number of uplink copies that were recognized as duplicates of an
+   * uplink received through another gateway, and only used to update the
+   * gateway information of the device.
+   */
+  uint32_t GetNDuplicates (void) const;
+
+  /**
+   * Get how many gateways delivered each uplink, when the
+   * DeduplicationWindow attribute is positive: element n is the number of
+   * uplinks that were received through n gateways. An uplink is counted once
+   * its deduplication window is over.
+   */
+  const std::vector<uint64_t> &GetCopiesHistogram (void);
+
+  /**
+   * Wall-clock time spent in each stage of the processing of uplinks, when
+   * the ProfileStages attribute is set.
+   */
+  struct StageTimes
+  {
+    uint64_t nUplinks;   //!< Uplinks that went through all the stages
+    double decode;       //!< Seconds spent decoding and deduplicating
+    double scheduler;    //!< Seconds spent in NetworkScheduler
+    double status;       //!< Seconds spent in NetworkStatus
+    double controller;   //!< Seconds spent in NetworkController
+
+    StageTimes () : nUplinks (0), decode (0), scheduler (0), status (0), controller (0)
+    {
+    }
+  };
+
+  /**
+   * Get the time spent in each stage of the processing of uplinks so far.
+   */
+  const StageTimes &GetStageTimes (void) const;
+
 protected:
   Ptr<NetworkStatus> m_status;
   Ptr<NetworkController> m_controller;
   Ptr<NetworkScheduler> m_scheduler;
 
   TracedCallback<Ptr<const Packet>> m_receivedPacket;
+
+  Ptr<GenomeSeedIndex> m_genomeSeedIndex;
+  std::map<LoraDeviceAddress, Vector> m_devicePositions;  //!< Where each device was installed
+  bool m_geneticSpatialSeeding;
+  double m_geneticSeedRadius;
+  uint32_t m_geneticSeedCount;
+
+  Time m_deduplicationWindow;  //!< How long copies of an uplink are expected
+  std::vector<uint16_t> m_lastFCnts;     //!< Last uplink of each device, by
+                                         //!< device index
+  std::vector<Time> m_lastFCntExpiries;  //!< When copies of the last uplink
+                                         //!< stop being duplicates
+  std::vector<uint16_t> m_lastCopies;    //!< Copies received of the last
+                                         //!< uplink of each device, or 0 if
+                                         //!< it was counted already
+  std::vector<uint64_t> m_copiesHistogram;  //!< Uplinks, by number of copies
+  uint32_t m_nTotalDuplicates;           //!< Duplicates through any gateway
+
+  /**
+   * Add the last uplink of a device to m_copiesHistogram, if it wasn't yet.
+   */
+  void CountCopies (uint32_t deviceIndex);
+
+  /**
+   * Add the wall-clock time since the end of the previous stage to a stage.
+   */
+  void EndStage (double &stageTime);
+
+  bool m_profileStages;       //!< Whether to measure m_stageTimes
+  StageTimes m_stageTimes;
+  std::chrono::steady_clock::time_point m_stageStart;  //!< End of the
+                                                       //!< previous stage
 };
 
 } // namespace lorawan
@@ -26,6 +26,7 @@
 #include "ns3/net-device.h"
 #include "ns3/packet.h"
 #include "ns3/lora-device-address.h"
+#include "ns3/lorawan-header-view.h"
 #include "ns3/node-container.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
@@ -37,6 +38,8 @@ NS_LOG_COMPONENT_DEFINE ("NetworkStatus");
 
 NS_OBJECT_ENSURE_REGISTERED (NetworkStatus);
 
+const uint32_t NetworkStatus::NOT_FOUND;
+
 TypeId
 NetworkStatus::GetTypeId (void)
 {
@@ -47,6 +50,7 @@ NetworkStatus::GetTypeId (void)
 }
 
 NetworkStatus::NetworkStatus ()
+  : m_replyPool (Create<EndDeviceStatus::ReplyPool> ())
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -63,15 +67,16 @@ NetworkStatus::AddNode (Ptr<ClassAEndDeviceLorawanMac> edMac)
 
   // Check whether this device already exists in our list
   LoraDeviceAddress edAddress = edMac->GetDeviceAddress ();
-  if (m_endDeviceStatuses.find (edAddress) == m_endDeviceStatuses.end ())
+  if (m_endDeviceIndices.Find (edAddress) == NOT_FOUND)
     {
       // The device doesn't exist. Create new EndDeviceStatus
       Ptr<EndDeviceStatus> edStatus = CreateObject<EndDeviceStatus>
         (edAddress, edMac->GetObject<ClassAEndDeviceLorawanMac>());
+      edStatus->SetReplyPool (m_replyPool);
 
-      // Add it to the map
-      m_endDeviceStatuses.insert (std::pair<LoraDeviceAddress, Ptr<EndDeviceStatus> >
-                                  (edAddress, edStatus));
+      // Add it to the registry
+      m_endDeviceIndices.Insert (edAddress);
+      m_endDeviceStatuses.push_back (edStatus);
       NS_LOG_DEBUG ("Added to the list a device with address " <<
                     edAddress.Print ());
     }
@@ -83,51 +88,90 @@ NetworkStatus::AddGateway (Address& address, Ptr<GatewayStatus> gwStatus)
   NS_LOG_FUNCTION (this);
 
   // Check whether this device already exists in the list
-  if (m_gatewayStatuses.find (address) == m_gatewayStatuses.end ())
+  if (m_gatewayIndices.Find (address) == NOT_FOUND)
     {
       // The device doesn't exist.
 
-      // Add it to the map
-      m_gatewayStatuses.insert (std::pair<Address, Ptr<GatewayStatus> >
-                                (address, gwStatus));
+      // Add it to the registry
+      m_gatewayIndices.Insert (address);
+      m_gatewayStatuses.push_back (gwStatus);
       NS_LOG_DEBUG ("Added to the list a gateway with address " << address);
     }
 }
 
-void
-NetworkStatus::OnReceivedPacket (Ptr<const Packet> packet,
-                                  const Address& gwAddress)
+uint32_t
+NetworkStatus::GetEndDeviceIndex (LoraDeviceAddress deviceAddress) const
 {
-  NS_LOG_FUNCTION (this << packet << gwAddress);
+  return m_endDeviceIndices.Find (deviceAddress);
+}
 
-  // Create a copy of the packet
-  Ptr<Packet> myPacket = packet->Copy ();
+uint32_t
+NetworkStatus::GetGatewayIndex (const Address &gatewayAddress) const
+{
+  return m_gatewayIndices.Find (gatewayAddress);
+}
 
-  // Extract the headers
-  LorawanMacHeader macHdr;
-  myPacket->RemoveHeader (macHdr);
-  LoraFrameHeader frameHdr;
-  frameHdr.SetAsUplink ();
-  myPacket->RemoveHeader (frameHdr);
+Ptr<EndDeviceStatus>
+NetworkStatus::GetEndDeviceStatusByIndex (uint32_t deviceIndex) const
+{
+  NS_ASSERT (deviceIndex < m_endDeviceStatuses.size ());
+  return m_endDeviceStatuses[deviceIndex];
+}
+
+Ptr<GatewayStatus>
+NetworkStatus::GetGatewayStatusByIndex (uint32_t gatewayIndex) const
+{
+  NS_ASSERT (gatewayIndex < m_gatewayStatuses.size ());
+  return m_gatewayStatuses[gatewayIndex];
+}
+
+void
+NetworkStatus::OnReceivedPacket (const DecodedUplink &uplink, uint32_t deviceIndex)
+{
+  NS_LOG_FUNCTION (this << uplink.packet << uplink.gatewayAddress);
 
   // Update the correct EndDeviceStatus object
-  LoraDeviceAddress edAddr = frameHdr.GetAddress ();
-  NS_LOG_DEBUG ("Node address: " << edAddr);
-  m_endDeviceStatuses.at (edAddr)->InsertReceivedPacket (packet, gwAddress);
+  NS_LOG_DEBUG ("Node address: " << uplink.frameHeader.GetAddress ());
+  uint32_t gatewayIndex = m_gatewayIndices.Find (uplink.gatewayAddress);
+  NS_ASSERT_MSG (gatewayIndex != NOT_FOUND,
+                 "Packet received from unknown gateway " << uplink.gatewayAddress);
+  GetEndDeviceStatusByIndex (deviceIndex)->InsertReceivedPacket (uplink, gatewayIndex);
 }
 
 bool
 NetworkStatus::NeedsReply (LoraDeviceAddress deviceAddress)
 {
-  // Throws out of range if no device is found
-  return m_endDeviceStatuses.at (deviceAddress)->NeedsReply ();
+  uint32_t deviceIndex = m_endDeviceIndices.Find (deviceAddress);
+  NS_ABORT_MSG_IF (deviceIndex == NOT_FOUND, "Unknown device " << deviceAddress);
+  return m_endDeviceStatuses[deviceIndex]->NeedsReply ();
+}
+
+bool
+NetworkStatus::HasPendingDownlink (LoraDeviceAddress deviceAddress)
+{
+  uint32_t deviceIndex = m_endDeviceIndices.Find (deviceAddress);
+  return deviceIndex != NOT_FOUND && m_endDeviceStatuses[deviceIndex]->NeedsReply ();
 }
 
 Address
 NetworkStatus::GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int window)
+{
+  uint32_t deviceIndex = m_endDeviceIndices.Find (deviceAddress);
+  NS_ABORT_MSG_IF (deviceIndex == NOT_FOUND, "Unknown device " << deviceAddress);
+
+  uint32_t gatewayIndex = GetBestGatewayIndexForDevice (deviceIndex, window);
+  if (gatewayIndex == NOT_FOUND)
+    {
+      return Address ();
+    }
+  return m_gatewayStatuses[gatewayIndex]->GetAddress ();
+}
+
+uint32_t
+NetworkStatus::GetBestGatewayIndexForDevice (uint32_t deviceIndex, int window)
 {
   // Get the endDeviceStatus we are interested in
-  Ptr<EndDeviceStatus> edStatus = m_endDeviceStatuses.at (deviceAddress);
+  Ptr<EndDeviceStatus> edStatus = GetEndDeviceStatusByIndex (deviceIndex);
   double replyFrequency;
   if (window == 1)
     {
@@ -145,24 +189,20 @@ NetworkStatus::GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int win
   // Get the list of gateways that this device can reach
   // NOTE: At this point, we could also take into account the whole network to
   // identify the best gateway according to various metrics. For now, we just
-  // ask the EndDeviceStatus to pick the best gateway for us via its method.
-  std::map<double, Address> gwAddresses = edStatus->GetPowerGatewayMap ();
-
-  // By iterating on the map in reverse, we go from the 'best'
-  // gateway, i.e. the one with the highest received power, to the
-  // worst.
-  Address bestGwAddress;
-  for (auto it = gwAddresses.rbegin(); it != gwAddresses.rend(); it++)
+  // use the ranking the EndDeviceStatus keeps as receptions arrive.
+
+  // The ranking goes from the 'best' gateway, i.e. the one with the highest
+  // received power, to the worst.
+  for (uint32_t i = 0; i < edStatus->GetNRankedGateways (); i++)
     {
-      bool isAvailable = m_gatewayStatuses.find(it->second)->second->IsAvailableForTransmission (replyFrequency);
-      if (isAvailable)
+      uint32_t gatewayIndex = edStatus->GetRankedGateway (i).gatewayIndex;
+      if (m_gatewayStatuses[gatewayIndex]->IsAvailableForTransmission (replyFrequency))
         {
-          bestGwAddress = it->second;
-          break;
+          return gatewayIndex;
         }
     }
 
-  return bestGwAddress;
+  return NOT_FOUND;
 }
 
 void
@@ -170,16 +210,35 @@ NetworkStatus::SendThroughGateway (Ptr<Packet> packet, Address gwAddress)
 {
   NS_LOG_FUNCTION (packet << gwAddress);
 
-  m_gatewayStatuses.find (gwAddress)->second->GetNetDevice ()->Send (packet,
-                                                                      gwAddress,
-                                                                      0x0800);
+  uint32_t gatewayIndex = m_gatewayIndices.Find (gwAddress);
+  NS_ABORT_MSG_IF (gatewayIndex == NOT_FOUND, "Unknown gateway " << gwAddress);
+  SendThroughGateway (packet, gatewayIndex);
+}
+
+void
+NetworkStatus::SendThroughGateway (Ptr<Packet> packet, uint32_t gatewayIndex)
+{
+  NS_LOG_FUNCTION (packet << gatewayIndex);
+
+  Ptr<GatewayStatus> gwStatus = GetGatewayStatusByIndex (gatewayIndex);
+  if (gwStatus->GetDirectBackhaul () != 0)
+    {
+      gwStatus->GetDirectBackhaul ()->SendToGateway (packet);
+      return;
+    }
+  gwStatus->GetNetDevice ()->Send (packet, gwStatus->GetAddress (), 0x0800);
 }
 
 Ptr<Packet>
 NetworkStatus::GetReplyForDevice (LoraDeviceAddress edAddress, int windowNumber)
+{
+  return GetReplyForDevice (GetEndDeviceStatus (edAddress), windowNumber);
+}
+
+Ptr<Packet>
+NetworkStatus::GetReplyForDevice (Ptr<EndDeviceStatus> edStatus, int windowNumber)
 {
   // Get the reply packet
-  Ptr<EndDeviceStatus> edStatus = m_endDeviceStatuses.find (edAddress)->second;
   Ptr<Packet> packet = edStatus->GetCompleteReplyPacket ();
 
   // Apply the appropriate tag
@@ -195,6 +254,7 @@ NetworkStatus::GetReplyForDevice (LoraDeviceAddress edAddress, int windowNumber)
       tag.SetFrequency (edStatus->GetSecondReceiveWindowFrequency ());
       break;
     }
+  tag.SetReceiveWindow (windowNumber);
 
   packet->AddPacketTag (tag);
   return packet;
@@ -206,21 +266,7 @@ NetworkStatus::GetEndDeviceStatus (Ptr<Packet const> packet)
   NS_LOG_FUNCTION (this << packet);
 
   // Get the address
-  LorawanMacHeader mHdr;
-  LoraFrameHeader fHdr;
-  Ptr<Packet> myPacket = packet->Copy ();
-  myPacket->RemoveHeader (mHdr);
-  myPacket->RemoveHeader (fHdr);
-  auto it = m_endDeviceStatuses.find (fHdr.GetAddress ());
-  if (it != m_endDeviceStatuses.end ())
-    {
-      return (*it).second;
-    }
-  else
-    {
-      NS_LOG_ERROR ("EndDeviceStatus not found");
-      return 0;
-    }
+  return GetEndDeviceStatus (LorawanHeaderView (packet).GetAddress ());
 }
 
 Ptr<EndDeviceStatus>
@@ -228,10 +274,10 @@ NetworkStatus::GetEndDeviceStatus (LoraDeviceAddress address)
 {
   NS_LOG_FUNCTION (this << address);
 
-  auto it = m_endDeviceStatuses.find (address);
-  if (it != m_endDeviceStatuses.end ())
+  uint32_t deviceIndex = m_endDeviceIndices.Find (address);
+  if (deviceIndex != NOT_FOUND)
     {
-      return (*it).second;
+      return m_endDeviceStatuses[deviceIndex];
     }
   else
     {
@@ -247,5 +293,19 @@ NetworkStatus::CountEndDevices (void)
 
   return m_endDeviceStatuses.size ();
 }
+
+int
+NetworkStatus::CountGateways (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  return m_gatewayStatuses.size ();
+}
+
+uint32_t
+NetworkStatus::GetNPendingReplies (void) const
+{
+  return m_replyPool->GetNPending ();
+}
 }
 }
@@ -27,17 +27,22 @@
 #include "ns3/gateway-status.h"
 #include "ns3/lora-device-address.h"
 #include "ns3/network-scheduler.h"
+#include "ns3/decoded-uplink.h"
+#include "ns3/dense-index.h"
 
 #include <iterator>
+#include <vector>
 
 namespace ns3 {
 namespace lorawan {
 
 /**
  * This class represents the knowledge about the state of the network that is
- * available at the Network Server. It is essentially a collection of two maps:
- * one containing DeviceStatus objects, and the other containing GatewayStatus
- * objects.
+ * available at the Network Server. It is essentially a collection of two
+ * registries: one containing DeviceStatus objects, and the other containing
+ * GatewayStatus objects. Devices and gateways are given dense indices as they
+ * are added, so that callers can resolve an address once and then use the
+ * index to reach the status directly.
  *
  * This class is meant to be queried by NetworkController components, which
  * can decide to take action based on the current status of the network.
@@ -62,13 +67,43 @@ public:
    */
   void AddGateway (Address &address, Ptr<GatewayStatus> gwStatus);
 
+  /**
+   * Index returned for devices and gateways that are not in the registries.
+   */
+  static const uint32_t NOT_FOUND =
+    DenseIndex<LoraDeviceAddress, LoraDeviceAddressHash>::NOT_FOUND;
+
+  /**
+   * Get the index of a device.
+   *
+   * \return The index, or NOT_FOUND if the device was never added.
+   */
+  uint32_t GetEndDeviceIndex (LoraDeviceAddress deviceAddress) const;
+
+  /**
+   * Get the index of a gateway.
+   *
+   * \return The index, or NOT_FOUND if the gateway was never added.
+   */
+  uint32_t GetGatewayIndex (const Address &gatewayAddress) const;
+
+  /**
+   * Get the EndDeviceStatus of the device with the given index.
+   */
+  Ptr<EndDeviceStatus> GetEndDeviceStatusByIndex (uint32_t deviceIndex) const;
+
+  /**
+   * Get the GatewayStatus of the gateway with the given index.
+   */
+  Ptr<GatewayStatus> GetGatewayStatusByIndex (uint32_t gatewayIndex) const;
+
   /**
    * Update network status on the received packet.
    *
-   * \param packet the received packet.
-   * \param address the gateway this packet was received from.
+   * \param uplink the received packet.
+   * \param deviceIndex the index of the device that sent the packet.
    */
-  void OnReceivedPacket (Ptr<const Packet> packet, const Address &gwaddress);
+  void OnReceivedPacket (const DecodedUplink &uplink, uint32_t deviceIndex);
 
   /**
    * Return whether the specified device needs a reply.
@@ -77,6 +112,14 @@ public:
    */
   bool NeedsReply (LoraDeviceAddress deviceAddress);
 
+  /**
+   * Return whether a downlink is already waiting to be sent to the specified
+   * device. Unlike NeedsReply, this returns false for unknown devices.
+   *
+   * \param deviceAddress the address of the device we are interested in.
+   */
+  bool HasPendingDownlink (LoraDeviceAddress deviceAddress);
+
   /**
    * Return whether we have a gateway that is available to send a reply to the
    * specified device.
@@ -85,6 +128,14 @@ public:
    */
   Address GetBestGatewayForDevice (LoraDeviceAddress deviceAddress, int window);
 
+  /**
+   * Return the index of the best gateway that is available to send a reply
+   * to the specified device, or NOT_FOUND if no gateway is available.
+   *
+   * \param deviceIndex the index of the device we are interested in.
+   */
+  uint32_t GetBestGatewayIndexForDevice (uint32_t deviceIndex, int window);
+
   /**
    * Send a packet through a Gateway.
    *
@@ -94,11 +145,21 @@ public:
    */
   void SendThroughGateway (Ptr<Packet> packet, Address gwAddress);
 
+  /**
+   * Send a packet through the Gateway with the given index.
+   */
+  void SendThroughGateway (Ptr<Packet> packet, uint32_t gatewayIndex);
+
   /**
    * Get the reply for the specified device address.
    */
   Ptr<Packet> GetReplyForDevice (LoraDeviceAddress edAddress, int windowNumber);
 
+  /**
+   * Get the reply for the specified device.
+   */
+  Ptr<Packet> GetReplyForDevice (Ptr<EndDeviceStatus> edStatus, int windowNumber);
+
   /**
    * Get the EndDeviceStatus for the device that sent a packet.
    */
@@ -114,9 +175,23 @@ public:
    */
   int CountEndDevices (void);
 
-public:
-  std::map<LoraDeviceAddress, Ptr<EndDeviceStatus>> m_endDeviceStatuses;
-  std::map<Address, Ptr<GatewayStatus>> m_gatewayStatuses;
+  /**
+   * Return the number of gateways connected to the server.
+   */
+  int CountGateways (void);
+
+  /**
+   * Return the number of devices that hold an entry for a reply in the
+   * making.
+   */
+  uint32_t GetNPendingReplies (void) const;
+
+private:
+  DenseIndex<LoraDeviceAddress, LoraDeviceAddressHash> m_endDeviceIndices;
+  std::vector<Ptr<EndDeviceStatus> > m_endDeviceStatuses;  //!< By index
+  DenseIndex<Address, AddressHash> m_gatewayIndices;
+  std::vector<Ptr<GatewayStatus> > m_gatewayStatuses;  //!< By index
+  Ptr<EndDeviceStatus::ReplyPool> m_replyPool;  //!< Replies of all devices
 };
 
 } // namespace lorawan
@@ -0,0 +1,188 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/region-plan.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("RegionPlan");
+
+NS_OBJECT_ENSURE_REGISTERED (RegionPlan);
+
+TypeId
+RegionPlan::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RegionPlan")
+    .SetParent<Object> ()
+    .SetGroupName ("lorawan")
+    .AddConstructor<RegionPlan> ();
+  return tid;
+}
+
+RegionPlan::RegionPlan ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+RegionPlan::~RegionPlan ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+Ptr<RegionPlan>
+RegionPlan::Copy (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<RegionPlan> copy = CreateObject<RegionPlan> ();
+  copy->m_subBands = m_subBands;
+  copy->m_channels = m_channels;
+  copy->m_channelSubBands = m_channelSubBands;
+  copy->m_sfForDataRate = m_sfForDataRate;
+  copy->m_bandwidthForDataRate = m_bandwidthForDataRate;
+  copy->m_maxAppPayloadForDataRate = m_maxAppPayloadForDataRate;
+  copy->m_txDbmForTxPower = m_txDbmForTxPower;
+  return copy;
+}
+
+void
+RegionPlan::AddSubBand (Ptr<SubBand> subBand)
+{
+  NS_LOG_FUNCTION (this << subBand);
+
+  m_subBands.push_back (subBand);
+  UpdateChannelSubBands ();
+}
+
+void
+RegionPlan::AddChannel (Ptr<LogicalLoraChannel> channel)
+{
+  NS_LOG_FUNCTION (this << channel);
+
+  m_channels.push_back (channel);
+  m_channelSubBands.push_back (GetSubBandIndex (channel->GetFrequency ()));
+}
+
+void
+RegionPlan::SetChannel (uint8_t index, Ptr<LogicalLoraChannel> channel)
+{
+  NS_LOG_FUNCTION (this << unsigned (index) << channel);
+
+  m_channels.at (index) = channel;
+  m_channelSubBands.at (index) = GetSubBandIndex (channel->GetFrequency ());
+}
+
+void
+RegionPlan::RemoveChannel (uint8_t index)
+{
+  NS_LOG_FUNCTION (this << unsigned (index));
+
+  m_channels.erase (m_channels.begin () + index);
+  m_channelSubBands.erase (m_channelSubBands.begin () + index);
+}
+
+const std::vector<Ptr<SubBand> > &
+RegionPlan::GetSubBands (void) const
+{
+  return m_subBands;
+}
+
+const std::vector<Ptr<LogicalLoraChannel> > &
+RegionPlan::GetChannels (void) const
+{
+  return m_channels;
+}
+
+int
+RegionPlan::GetSubBandIndex (double frequency) const
+{
+  for (uint32_t i = 0; i < m_subBands.size (); i++)
+    {
+      if (m_subBands[i]->BelongsToSubBand (frequency))
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+
+int
+RegionPlan::GetChannelSubBandIndex (uint8_t index) const
+{
+  return m_channelSubBands[index];
+}
+
+void
+RegionPlan::UpdateChannelSubBands (void)
+{
+  for (uint32_t i = 0; i < m_channels.size (); i++)
+    {
+      m_channelSubBands[i] = GetSubBandIndex (m_channels[i]->GetFrequency ());
+    }
+}
+
+void
+RegionPlan::SetSfForDataRate (std::vector<uint8_t> sfForDataRate)
+{
+  m_sfForDataRate = sfForDataRate;
+}
+
+void
+RegionPlan::SetBandwidthForDataRate (std::vector<double> bandwidthForDataRate)
+{
+  m_bandwidthForDataRate = bandwidthForDataRate;
+}
+
+void
+RegionPlan::SetMaxAppPayloadForDataRate (std::vector<uint32_t> maxAppPayloadForDataRate)
+{
+  m_maxAppPayloadForDataRate = maxAppPayloadForDataRate;
+}
+
+void
+RegionPlan::SetTxDbmForTxPower (std::vector<double> txDbmForTxPower)
+{
+  m_txDbmForTxPower = txDbmForTxPower;
+}
+
+const std::vector<uint8_t> &
+RegionPlan::GetSfForDataRate (void) const
+{
+  return m_sfForDataRate;
+}
+
+const std::vector<double> &
+RegionPlan::GetBandwidthForDataRate (void) const
+{
+  return m_bandwidthForDataRate;
+}
+
+const std::vector<uint32_t> &
+RegionPlan::GetMaxAppPayloadForDataRate (void) const
+{
+  return m_maxAppPayloadForDataRate;
+}
+
+const std::vector<double> &
+RegionPlan::GetTxDbmForTxPower (void) const
+{
+  return m_txDbmForTxPower;
+}
+
+} // namespace lorawan
+} // namespace ns3
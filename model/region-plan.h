@@ -0,0 +1,112 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef REGION_PLAN_H
+#define REGION_PLAN_H
+
+#include "ns3/object.h"
+#include "ns3/logical-lora-channel.h"
+#include "ns3/sub-band.h"
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * The frequency plan and data rate tables of a LoRaWAN region.
+ *
+ * A plan is filled in once (typically by the LorawanMacHelper) and then
+ * shared, read-only, by all the devices operating in the region: the SubBand
+ * and LogicalLoraChannel objects it holds are never modified by the devices.
+ * The state that is specific to a device (the time at which each SubBand
+ * becomes available and the channel mask) is kept by the device's
+ * LogicalLoraChannelHelper, which makes a private copy of the plan only if the
+ * device's channels are reconfigured.
+ */
+class RegionPlan : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  RegionPlan ();
+  virtual ~RegionPlan ();
+
+  /**
+   * Make a copy of this plan, sharing its SubBand and LogicalLoraChannel
+   * objects, that can be modified independently.
+   */
+  Ptr<RegionPlan> Copy (void) const;
+
+  /**
+   * Add a SubBand to the plan.
+   */
+  void AddSubBand (Ptr<SubBand> subBand);
+
+  /**
+   * Add a channel to the plan.
+   */
+  void AddChannel (Ptr<LogicalLoraChannel> channel);
+
+  /**
+   * Replace the channel at a fixed index.
+   */
+  void SetChannel (uint8_t index, Ptr<LogicalLoraChannel> channel);
+
+  /**
+   * Remove the channel at a fixed index.
+   */
+  void RemoveChannel (uint8_t index);
+
+  const std::vector<Ptr<SubBand> > &GetSubBands (void) const;
+
+  const std::vector<Ptr<LogicalLoraChannel> > &GetChannels (void) const;
+
+  /**
+   * Get the index of the SubBand a frequency belongs to, or -1.
+   */
+  int GetSubBandIndex (double frequency) const;
+
+  /**
+   * Get the index of the SubBand channel i belongs to, or -1.
+   */
+  int GetChannelSubBandIndex (uint8_t index) const;
+
+  void SetSfForDataRate (std::vector<uint8_t> sfForDataRate);
+  void SetBandwidthForDataRate (std::vector<double> bandwidthForDataRate);
+  void SetMaxAppPayloadForDataRate (std::vector<uint32_t> maxAppPayloadForDataRate);
+  void SetTxDbmForTxPower (std::vector<double> txDbmForTxPower);
+
+  const std::vector<uint8_t> &GetSfForDataRate (void) const;
+  const std::vector<double> &GetBandwidthForDataRate (void) const;
+  const std::vector<uint32_t> &GetMaxAppPayloadForDataRate (void) const;
+  const std::vector<double> &GetTxDbmForTxPower (void) const;
+
+private:
+  void UpdateChannelSubBands (void);
+
+  std::vector<Ptr<SubBand> > m_subBands;              //!< The region's SubBands
+  std::vector<Ptr<LogicalLoraChannel> > m_channels;   //!< The default channels
+  std::vector<int> m_channelSubBands;                 //!< SubBand of each channel
+  std::vector<uint8_t> m_sfForDataRate;               //!< DR -> SF
+  std::vector<double> m_bandwidthForDataRate;         //!< DR -> bandwidth
+  std::vector<uint32_t> m_maxAppPayloadForDataRate;   //!< DR -> max payload
+  std::vector<double> m_txDbmForTxPower;              //!< TXPOWER -> dBm
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* REGION_PLAN_H */
@@ -0,0 +1,530 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/semtech-udp-ingest.h"
+#include "ns3/direct-backhaul.h"
+#include "ns3/lorawan-header-view.h"
+#include "ns3/lora-tag.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("SemtechUdpIngest");
+
+NS_OBJECT_ENSURE_REGISTERED (SemtechUdpIngest);
+
+namespace {
+
+const uint8_t PROTOCOL_VERSION = 2;
+const uint8_t PUSH_DATA = 0x00;
+const uint8_t PUSH_ACK = 0x01;
+const uint8_t PULL_DATA = 0x02;
+const uint8_t PULL_RESP = 0x03;
+const uint8_t PULL_ACK = 0x04;
+const uint32_t MIC_SIZE = 4;
+const uint32_t MAX_DATAGRAM_SIZE = 65536;
+
+const char BASE64_ALPHABET[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string
+EncodeBase64 (const std::vector<uint8_t> &data)
+{
+  std::string text;
+  for (uint32_t i = 0; i < data.size (); i += 3)
+    {
+      uint32_t n = std::min<uint32_t> (3, data.size () - i);
+      uint32_t bits = data[i] << 16;
+      bits |= n > 1 ? data[i + 1] << 8 : 0;
+      bits |= n > 2 ? data[i + 2] : 0;
+      text += BASE64_ALPHABET[(bits >> 18) & 0x3f];
+      text += BASE64_ALPHABET[(bits >> 12) & 0x3f];
+      text += n > 1 ? BASE64_ALPHABET[(bits >> 6) & 0x3f] : '=';
+      text += n > 2 ? BASE64_ALPHABET[bits & 0x3f] : '=';
+    }
+  return text;
+}
+
+bool
+DecodeBase64 (const std::string &text, std::vector<uint8_t> &data)
+{
+  data.clear ();
+  uint32_t bits = 0;
+  int nBits = 0;
+  for (uint32_t i = 0; i < text.size () && text[i] != '='; i++)
+    {
+      const char *digit = std::strchr (BASE64_ALPHABET, text[i]);
+      if (digit == 0 || *digit == '\0')
+        {
+          return false;
+        }
+      bits = (bits << 6) | (digit - BASE64_ALPHABET);
+      nBits += 6;
+      if (nBits >= 8)
+        {
+          nBits -= 8;
+          data.push_back ((bits >> nBits) & 0xff);
+        }
+    }
+  return true;
+}
+
+// Get the text of the value of a key in a flat JSON object, without the
+// quotes if it's a string
+bool
+FindJsonValue (const std::string &object, const std::string &key, std::string &value)
+{
+  std::string::size_type position = object.find ("\"" + key + "\"");
+  if (position == std::string::npos)
+    {
+      return false;
+    }
+  position = object.find_first_not_of (" \t\r\n:", position + key.size () + 2);
+  if (position == std::string::npos)
+    {
+      return false;
+    }
+
+  std::string::size_type end;
+  if (object[position] == '"')
+    {
+      position++;
+      end = object.find ('"', position);
+    }
+  else
+    {
+      end = object.find_first_of (",} \t\r\n", position);
+    }
+  if (end == std::string::npos)
+    {
+      return false;
+    }
+  value = object.substr (position, end - position);
+  return true;
+}
+
+} // anonymous namespace
+
+TypeId
+SemtechUdpIngest::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SemtechUdpIngest")
+    .SetParent<Application> ()
+    .AddConstructor<SemtechUdpIngest> ()
+    .AddAttribute ("Port",
+                   "The local UDP port the packet forwarders send to",
+                   UintegerValue (1700),
+                   MakeUintegerAccessor (&SemtechUdpIngest::m_port),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("PollInterval",
+                   "The time between two polls of the socket",
+                   TimeValue (MilliSeconds (1)),
+                   MakeTimeAccessor (&SemtechUdpIngest::m_pollInterval),
+                   MakeTimeChecker ())
+    .SetGroupName ("lorawan");
+  return tid;
+}
+
+SemtechUdpIngest::SemtechUdpIngest () :
+  m_port (1700),
+  m_socket (-1),
+  m_buffer (MAX_DATAGRAM_SIZE),
+  m_nDatagrams (0),
+  m_nUplinks (0),
+  m_nDropped (0),
+  m_nDownlinks (0),
+  m_nUndeliverable (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+SemtechUdpIngest::~SemtechUdpIngest ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+
+  if (m_socket >= 0)
+    {
+      close (m_socket);
+    }
+}
+
+uint32_t
+SemtechUdpIngest::ParseRxpks (const std::string &json, std::vector<Rxpk> &rxpks)
+{
+  std::string::size_type position = json.find ("\"rxpk\"");
+  if (position == std::string::npos)
+    {
+      return 0;
+    }
+  position = json.find ('[', position);
+  std::string::size_type arrayEnd = json.find (']', position);
+  if (position == std::string::npos || arrayEnd == std::string::npos)
+    {
+      return 0;
+    }
+
+  // The rxpk objects are flat, so each one ends at the first closing brace
+  uint32_t nRxpks = 0;
+  while ((position = json.find ('{', position)) < arrayEnd)
+    {
+      std::string::size_type end = json.find ('}', position);
+      if (end == std::string::npos)
+        {
+          break;
+        }
+      std::string object = json.substr (position, end - position + 1);
+      position = end;
+
+      std::string tmst, freq, datr, rssi, data;
+      Rxpk rxpk;
+      if (!FindJsonValue (object, "tmst", tmst) || !FindJsonValue (object, "freq", freq)
+          || !FindJsonValue (object, "datr", datr) || !FindJsonValue (object, "rssi", rssi)
+          || !FindJsonValue (object, "data", data)
+          || datr.compare (0, 2, "SF") != 0 || !DecodeBase64 (data, rxpk.data))
+        {
+          NS_LOG_WARN ("Skipping rxpk " << object);
+          continue;
+        }
+      rxpk.tmst = std::strtoul (tmst.c_str (), 0, 10);
+      rxpk.freq = std::atof (freq.c_str ());
+      rxpk.sf = std::atoi (datr.c_str () + 2);
+      rxpk.rssi = std::atof (rssi.c_str ());
+      rxpks.push_back (rxpk);
+      nRxpks++;
+    }
+  return nRxpks;
+}
+
+std::string
+SemtechUdpIngest::FormatRxpk (const Rxpk &rxpk)
+{
+  char fields[256];
+  std::snprintf (fields, sizeof (fields),
+                 "{\"tmst\":%u,\"chan\":0,\"rfch\":0,\"freq\":%.6f,\"stat\":1,"
+                 "\"modu\":\"LORA\",\"datr\":\"SF%uBW125\",\"codr\":\"4/5\","
+                 "\"rssi\":%g,\"lsnr\":0,\"size\":%u,\"data\":\"",
+                 rxpk.tmst, rxpk.freq, unsigned (rxpk.sf), rxpk.rssi,
+                 unsigned (rxpk.data.size ()));
+  return fields + EncodeBase64 (rxpk.data) + "\"}";
+}
+
+std::string
+SemtechUdpIngest::FormatTxpk (const Txpk &txpk)
+{
+  char fields[256];
+  std::snprintf (fields, sizeof (fields),
+                 "{\"txpk\":{\"imme\":false,\"tmst\":%u,\"freq\":%.6f,\"rfch\":0,"
+                 "\"powe\":%g,\"modu\":\"LORA\",\"datr\":\"SF%uBW125\","
+                 "\"codr\":\"4/5\",\"ipol\":true,\"size\":%u,\"data\":\"",
+                 txpk.tmst, txpk.freq, txpk.powe, unsigned (txpk.sf),
+                 unsigned (txpk.data.size ()));
+  return fields + EncodeBase64 (txpk.data) + "\"}}";
+}
+
+void
+SemtechUdpIngest::SetNetworkServer (Ptr<NetworkServer> networkServer)
+{
+  m_networkServer = networkServer;
+}
+
+void
+SemtechUdpIngest::SetGateways (NodeContainer gateways)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_gatewayAddresses.clear ();
+  for (NodeContainer::Iterator i = gateways.Begin (); i != gateways.End (); ++i)
+    {
+      Ptr<DirectBackhaul> directBackhaul = (*i)->GetObject<DirectBackhaul> ();
+      NS_ABORT_MSG_IF (directBackhaul == 0,
+                       "Gateways must be connected to the server through a DirectBackhaul");
+      directBackhaul->SetGatewayCallback
+        (MakeCallback (&SemtechUdpIngest::ReceiveDownlink, this));
+      m_gatewayAddresses.push_back (directBackhaul->GetAddress ());
+    }
+}
+
+uint64_t
+SemtechUdpIngest::GetNDatagrams (void) const
+{
+  return m_nDatagrams;
+}
+
+uint64_t
+SemtechUdpIngest::GetNUplinks (void) const
+{
+  return m_nUplinks;
+}
+
+uint64_t
+SemtechUdpIngest::GetNDropped (void) const
+{
+  return m_nDropped;
+}
+
+uint64_t
+SemtechUdpIngest::GetNDownlinks (void) const
+{
+  return m_nDownlinks;
+}
+
+uint64_t
+SemtechUdpIngest::GetNUndeliverable (void) const
+{
+  return m_nUndeliverable;
+}
+
+void
+SemtechUdpIngest::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_ABORT_MSG_IF (m_networkServer == 0, "No NetworkServer to hand the uplinks to");
+
+  m_socket = socket (AF_INET, SOCK_DGRAM, 0);
+  NS_ABORT_MSG_IF (m_socket < 0, "Can't create socket: " << std::strerror (errno));
+
+  sockaddr_in address;
+  std::memset (&address, 0, sizeof (address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons (m_port);
+  address.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  NS_ABORT_MSG_IF (bind (m_socket, (sockaddr *) &address, sizeof (address)) < 0,
+                   "Can't bind to port " << m_port << ": " << std::strerror (errno));
+  fcntl (m_socket, F_SETFL, fcntl (m_socket, F_GETFL) | O_NONBLOCK);
+
+  m_pollEvent = Simulator::ScheduleNow (&SemtechUdpIngest::Poll, this);
+}
+
+void
+SemtechUdpIngest::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Simulator::Cancel (m_pollEvent);
+  if (m_socket >= 0)
+    {
+      close (m_socket);
+      m_socket = -1;
+    }
+}
+
+void
+SemtechUdpIngest::Poll (void)
+{
+  sockaddr_in sender;
+  socklen_t senderSize = sizeof (sender);
+  ssize_t size;
+  while ((size = recvfrom (m_socket, &m_buffer[0], m_buffer.size (), 0,
+                           (sockaddr *) &sender, &senderSize)) >= 0)
+    {
+      m_nDatagrams++;
+      if (size < 4 || m_buffer[0] != PROTOCOL_VERSION)
+        {
+          NS_LOG_WARN ("Skipping datagram with unknown protocol");
+          continue;
+        }
+
+      uint8_t identifier = m_buffer[3];
+      if ((identifier == PUSH_DATA || identifier == PULL_DATA) && size >= 12)
+        {
+          // Acknowledge with the same token
+          uint8_t ack[4] = {PROTOCOL_VERSION, m_buffer[1], m_buffer[2],
+                            identifier == PUSH_DATA ? PUSH_ACK : PULL_ACK};
+          sendto (m_socket, ack, sizeof (ack), 0, (sockaddr *) &sender, senderSize);
+
+          if (identifier == PUSH_DATA)
+            {
+              HandlePushData (&m_buffer[0], size);
+            }
+          else
+            {
+              uint64_t eui = 0;
+              for (int i = 4; i < 12; i++)
+                {
+                  eui = (eui << 8) | m_buffer[i];
+                }
+              uint32_t gatewayIndex = GetGatewayIndex (eui);
+              if (gatewayIndex != NetworkStatus::NOT_FOUND)
+                {
+                  m_pullAddresses[gatewayIndex] =
+                    std::make_pair (sender.sin_addr.s_addr, sender.sin_port);
+                  m_hasPullAddress[gatewayIndex] = true;
+                }
+            }
+        }
+      senderSize = sizeof (sender);
+    }
+
+  m_pollEvent = Simulator::Schedule (m_pollInterval, &SemtechUdpIngest::Poll, this);
+}
+
+void
+SemtechUdpIngest::HandlePushData (const uint8_t *buffer, uint32_t size)
+{
+  uint64_t eui = 0;
+  for (int i = 4; i < 12; i++)
+    {
+      eui = (eui << 8) | buffer[i];
+    }
+
+  std::vector<Rxpk> rxpks;
+  ParseRxpks (std::string ((const char *) buffer + 12, size - 12), rxpks);
+
+  uint32_t gatewayIndex = GetGatewayIndex (eui);
+  if (gatewayIndex == NetworkStatus::NOT_FOUND)
+    {
+      m_nDropped += rxpks.size ();
+      return;
+    }
+
+  for (uint32_t i = 0; i < rxpks.size (); i++)
+    {
+      const Rxpk &rxpk = rxpks[i];
+      if (rxpk.data.size () < LorawanHeaderView::SIZE + MIC_SIZE)
+        {
+          m_nDropped++;
+          continue;
+        }
+
+      // The packet carries the PHY payload, without the MIC
+      Ptr<Packet> packet = Create<Packet> (&rxpk.data[0], rxpk.data.size () - MIC_SIZE);
+      LorawanHeaderView view (packet);
+      if (!view.IsUplink ()
+          || m_networkServer->GetNetworkStatus ()->GetEndDeviceIndex (view.GetAddress ())
+          == NetworkStatus::NOT_FOUND)
+        {
+          m_nDropped++;
+          continue;
+        }
+
+      LoraTag tag (rxpk.sf);
+      tag.SetReceivePower (rxpk.rssi);
+      tag.SetFrequency (rxpk.freq);
+      packet->AddPacketTag (tag);
+
+      // Remember when the device transmitted, to time the replies
+      Rxpk &last = m_lastRxpks[view.GetAddress ().Get ()];
+      last.tmst = rxpk.tmst;
+      last.freq = rxpk.freq;
+
+      m_networkServer->Receive (0, packet, 0x800, m_gatewayAddresses[gatewayIndex]);
+      m_nUplinks++;
+    }
+}
+
+uint32_t
+SemtechUdpIngest::GetGatewayIndex (uint64_t eui)
+{
+  for (uint32_t i = 0; i < m_gatewayEuis.size (); i++)
+    {
+      if (m_gatewayEuis[i] == eui)
+        {
+          return i;
+        }
+    }
+
+  if (m_gatewayEuis.size () == m_gatewayAddresses.size ())
+    {
+      NS_LOG_WARN ("No gateway left for packet forwarder " << eui);
+      return NetworkStatus::NOT_FOUND;
+    }
+
+  m_gatewayEuis.push_back (eui);
+  m_pullAddresses.push_back (std::make_pair (0, 0));
+  m_hasPullAddress.push_back (false);
+  return m_gatewayEuis.size () - 1;
+}
+
+bool
+SemtechUdpIngest::ReceiveDownlink (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                                   uint16_t protocol, const Address &gatewayAddress)
+{
+  NS_LOG_FUNCTION (this << packet << gatewayAddress);
+
+  uint32_t gatewayIndex = 0;
+  while (gatewayIndex < m_gatewayEuis.size ()
+         && !(m_gatewayAddresses[gatewayIndex] == gatewayAddress))
+    {
+      gatewayIndex++;
+    }
+  LorawanHeaderView view (packet);
+  std::map<uint32_t, Rxpk>::const_iterator last =
+    view.IsValid () ? m_lastRxpks.find (view.GetAddress ().Get ()) : m_lastRxpks.end ();
+  if (gatewayIndex == m_gatewayEuis.size () || !m_hasPullAddress[gatewayIndex]
+      || last == m_lastRxpks.end ())
+    {
+      NS_LOG_WARN ("Can't send downlink: the packet forwarder sent no PULL_DATA");
+      m_nUndeliverable++;
+      return false;
+    }
+
+  Ptr<NetworkStatus> networkStatus = m_networkServer->GetNetworkStatus ();
+  Ptr<GatewayStatus> gwStatus = networkStatus
+    ->GetGatewayStatusByIndex (networkStatus->GetGatewayIndex (gatewayAddress));
+  Ptr<EndDeviceStatus> edStatus = networkStatus->GetEndDeviceStatus (view.GetAddress ());
+  LoraTag tag;
+  packet->PeekPacketTag (tag);
+  NS_ASSERT (tag.GetReceiveWindow () == 1 || tag.GetReceiveWindow () == 2);
+
+  // Send when the device opens the window the reply was built for
+  Txpk txpk;
+  txpk.freq = tag.GetFrequency ();
+  txpk.tmst = last->second.tmst
+    + edStatus->GetMac ()->GetReceiveDelay (tag.GetReceiveWindow ()).GetMicroSeconds ();
+  txpk.sf = gwStatus->GetGatewayMac ()->GetSfFromDataRate (tag.GetDataRate ());
+  txpk.powe = 14;
+  // No MIC is computed: leave zeros in its place
+  txpk.data.resize (packet->GetSize () + MIC_SIZE, 0);
+  packet->CopyData (&txpk.data[0], packet->GetSize ());
+
+  std::string json = FormatTxpk (txpk);
+  std::vector<uint8_t> datagram (4);
+  datagram[0] = PROTOCOL_VERSION;
+  datagram[3] = PULL_RESP;
+  datagram.insert (datagram.end (), json.begin (), json.end ());
+  sockaddr_in destination;
+  std::memset (&destination, 0, sizeof (destination));
+  destination.sin_family = AF_INET;
+  destination.sin_addr.s_addr = m_pullAddresses[gatewayIndex].first;
+  destination.sin_port = m_pullAddresses[gatewayIndex].second;
+  if (sendto (m_socket, &datagram[0], datagram.size (), 0,
+              (sockaddr *) &destination, sizeof (destination)) < 0)
+    {
+      NS_LOG_WARN ("Can't send downlink: " << std::strerror (errno));
+      m_nUndeliverable++;
+      return false;
+    }
+  m_nDownlinks++;
+
+  return true;
+}
+
+} // namespace lorawan
+} // namespace ns3
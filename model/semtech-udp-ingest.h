@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SEMTECH_UDP_INGEST_H
+#define SEMTECH_UDP_INGEST_H
+
+#include "ns3/application.h"
+#include "ns3/network-server.h"
+#include "ns3/node-container.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include <string>
+#include <vector>
+#include <map>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * An application that feeds a NetworkServer with the UDP traffic of Semtech
+ * packet forwarders (protocol version 2), received on a local socket.
+ *
+ * The rxpk objects of each PUSH_DATA datagram become tagged packets for
+ * NetworkServer::Receive, and the downlinks the NetworkServer sends through
+ * a gateway are sent back as PULL_RESP datagrams with a txpk object, to the
+ * address the gateway last sent a PULL_DATA from. The socket is
+ * non-blocking and is drained every PollInterval; with the realtime
+ * simulator, this serves forwarders running as separate processes.
+ *
+ * Like the UplinkTraceReplayer, this takes the place of the Forwarders of
+ * gateways connected to the server through DirectBackhaul links. Gateways
+ * are given to forwarders in the order in which their EUIs first show up.
+ *
+ * The simulated network server doesn't compute MICs, so the PHY payload of
+ * each txpk ends with four zero bytes where the MIC goes. Devices that check
+ * the MIC will reject these downlinks.
+ */
+class SemtechUdpIngest : public Application
+{
+public:
+  /**
+   * The fields of an rxpk object that are used.
+   */
+  struct Rxpk
+  {
+    uint32_t tmst;               //!< Concentrator timestamp, in microseconds
+    double freq;                 //!< Frequency, in MHz
+    uint8_t sf;                  //!< Spreading factor, from datr
+    double rssi;                 //!< Received power, in dBm
+    std::vector<uint8_t> data;   //!< PHY payload
+  };
+
+  /**
+   * The fields of a txpk object.
+   */
+  struct Txpk
+  {
+    uint32_t tmst;               //!< When to send, in concentrator time
+    double freq;                 //!< Frequency, in MHz
+    uint8_t sf;                  //!< Spreading factor, for datr
+    double powe;                 //!< Transmission power, in dBm
+    std::vector<uint8_t> data;   //!< PHY payload
+  };
+
+  static TypeId GetTypeId (void);
+
+  SemtechUdpIngest ();
+  virtual ~SemtechUdpIngest ();
+
+  /**
+   * Extract the rxpk objects of the JSON object of a PUSH_DATA datagram.
+   *
+   * This is not a general JSON parser: it only looks for the fields above,
+   * and skips the objects that lack any of them.
+   *
+   * \return The number of objects that were added to rxpks.
+   */
+  static uint32_t ParseRxpks (const std::string &json, std::vector<Rxpk> &rxpks);
+
+  /**
+   * Write an rxpk object, as a packet forwarder would put in the rxpk array
+   * of a PUSH_DATA datagram.
+   */
+  static std::string FormatRxpk (const Rxpk &rxpk);
+
+  /**
+   * Write the JSON object of a PULL_RESP datagram.
+   */
+  static std::string FormatTxpk (const Txpk &txpk);
+
+  /**
+   * Set the NetworkServer that receives the uplinks.
+   */
+  void SetNetworkServer (Ptr<NetworkServer> networkServer);
+
+  /**
+   * Set the gateways that stand for the packet forwarders, and connect to
+   * their DirectBackhaul links.
+   */
+  void SetGateways (NodeContainer gateways);
+
+  /**
+   * Get the number of datagrams that were received.
+   */
+  uint64_t GetNDatagrams (void) const;
+
+  /**
+   * Get the number of uplinks that were handed to the NetworkServer.
+   */
+  uint64_t GetNUplinks (void) const;
+
+  /**
+   * Get the number of rxpk objects that were dropped, because they came from
+   * an unknown device or from too many gateways.
+   */
+  uint64_t GetNDropped (void) const;
+
+  /**
+   * Get the number of downlinks that were sent as PULL_RESP datagrams.
+   */
+  uint64_t GetNDownlinks (void) const;
+
+  /**
+   * Get the number of downlinks that could not be sent, because the packet
+   * forwarder of their gateway sent no PULL_DATA yet or the socket refused
+   * the datagram. The NetworkScheduler counts these among its sent replies.
+   */
+  uint64_t GetNUndeliverable (void) const;
+
+protected:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+private:
+  /**
+   * Handle all the datagrams waiting on the socket.
+   */
+  void Poll (void);
+
+  /**
+   * Hand the uplinks of a PUSH_DATA datagram to the NetworkServer.
+   */
+  void HandlePushData (const uint8_t *buffer, uint32_t size);
+
+  /**
+   * Get the index of the gateway standing for a packet forwarder, or
+   * NetworkStatus::NOT_FOUND if all the gateways are taken.
+   */
+  uint32_t GetGatewayIndex (uint64_t eui);
+
+  /**
+   * Send a downlink to the packet forwarder of a gateway.
+   */
+  bool ReceiveDownlink (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                        uint16_t protocol, const Address &gatewayAddress);
+
+  uint16_t m_port;                  //!< Local UDP port
+  Time m_pollInterval;              //!< Time between two polls of the socket
+  int m_socket;                     //!< The socket, or -1 if closed
+  EventId m_pollEvent;
+  Ptr<NetworkServer> m_networkServer;
+  std::vector<Address> m_gatewayAddresses;   //!< DirectBackhaul addresses
+  std::vector<uint64_t> m_gatewayEuis;       //!< EUI of the forwarder of
+                                             //!< each gateway in use
+  std::vector<std::pair<uint32_t, uint16_t> > m_pullAddresses;
+                                 //!< IPv4 address and port, in network byte
+                                 //!< order, where each forwarder expects
+                                 //!< PULL_RESP
+  std::vector<bool> m_hasPullAddress;
+  std::map<uint32_t, Rxpk> m_lastRxpks;      //!< Last uplink of each device,
+                                             //!< without its payload
+  std::vector<uint8_t> m_buffer;             //!< Datagram buffer
+  uint64_t m_nDatagrams;
+  uint64_t m_nUplinks;
+  uint64_t m_nDropped;
+  uint64_t m_nDownlinks;
+  uint64_t m_nUndeliverable;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* SEMTECH_UDP_INGEST_H */
@@ -0,0 +1,275 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/uplink-trace-replayer.h"
+#include "ns3/direct-backhaul.h"
+#include "ns3/lora-frame-header.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/lora-tag.h"
+#include "ns3/lora-phy.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/log.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+
+namespace ns3 {
+namespace lorawan {
+
+NS_LOG_COMPONENT_DEFINE ("UplinkTraceReplayer");
+
+NS_OBJECT_ENSURE_REGISTERED (UplinkTraceReplayer);
+
+TypeId
+UplinkTraceReplayer::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::UplinkTraceReplayer")
+    .SetParent<Application> ()
+    .AddConstructor<UplinkTraceReplayer> ()
+    .AddAttribute ("PayloadSize",
+                   "The size of the application payload of each uplink",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&UplinkTraceReplayer::m_payloadSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .SetGroupName ("lorawan");
+  return tid;
+}
+
+UplinkTraceReplayer::UplinkTraceReplayer () :
+  m_next (0),
+  m_payloadSize (10),
+  m_nUplinks (0),
+  m_nDropped (0),
+  m_nDownlinks (0),
+  m_receiveTime (0)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+UplinkTraceReplayer::~UplinkTraceReplayer ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+bool
+UplinkTraceReplayer::ReadCsvTrace (std::string filename, std::vector<UplinkRecord> &trace)
+{
+  NS_LOG_FUNCTION (filename);
+
+  std::ifstream file (filename.c_str ());
+  if (!file.is_open ())
+    {
+      return false;
+    }
+
+  std::string line;
+  while (std::getline (file, line))
+    {
+      if (line.empty () || !(std::isdigit (line[0]) || line[0] == '.'))
+        {
+          continue;
+        }
+
+      // Fields are separated by commas
+      std::istringstream fields (line);
+      std::string field[7];
+      int nFields = 0;
+      while (nFields < 7 && std::getline (fields, field[nFields], ','))
+        {
+          nFields++;
+        }
+      if (nFields < 7)
+        {
+          NS_LOG_WARN ("Skipping malformed line: " << line);
+          continue;
+        }
+
+      UplinkRecord record;
+      record.time = Seconds (std::atof (field[0].c_str ()));
+      record.devAddr = std::strtoul (field[1].c_str (), 0, 0);
+      record.fCnt = std::strtoul (field[2].c_str (), 0, 0);
+      record.gateway = std::strtoul (field[3].c_str (), 0, 0);
+      record.sf = std::strtoul (field[4].c_str (), 0, 0);
+      record.rxPower = std::atof (field[5].c_str ());
+      record.frequency = std::atof (field[6].c_str ());
+      trace.push_back (record);
+    }
+
+  return true;
+}
+
+void
+UplinkTraceReplayer::SetTrace (const std::vector<UplinkRecord> &trace)
+{
+  m_trace = trace;
+  m_next = 0;
+}
+
+void
+UplinkTraceReplayer::SetNetworkServer (Ptr<NetworkServer> networkServer)
+{
+  m_networkServer = networkServer;
+}
+
+void
+UplinkTraceReplayer::SetGateways (NodeContainer gateways)
+{
+  NS_LOG_FUNCTION (this);
+
+  m_gatewayAddresses.clear ();
+  for (NodeContainer::Iterator i = gateways.Begin (); i != gateways.End (); ++i)
+    {
+      Ptr<DirectBackhaul> directBackhaul = (*i)->GetObject<DirectBackhaul> ();
+      NS_ABORT_MSG_IF (directBackhaul == 0,
+                       "Gateways must be connected to the server through a DirectBackhaul");
+      directBackhaul->SetGatewayCallback
+        (MakeCallback (&UplinkTraceReplayer::ReceiveDownlink, this));
+      m_gatewayAddresses.push_back (directBackhaul->GetAddress ());
+    }
+}
+
+uint64_t
+UplinkTraceReplayer::GetNUplinks (void) const
+{
+  return m_nUplinks;
+}
+
+uint64_t
+UplinkTraceReplayer::GetNDropped (void) const
+{
+  return m_nDropped;
+}
+
+uint64_t
+UplinkTraceReplayer::GetNDownlinks (void) const
+{
+  return m_nDownlinks;
+}
+
+double
+UplinkTraceReplayer::GetReceiveTime (void) const
+{
+  return m_receiveTime;
+}
+
+void
+UplinkTraceReplayer::StartApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  NS_ABORT_MSG_IF (m_networkServer == 0, "No NetworkServer to replay the trace to");
+
+  if (m_next < m_trace.size ())
+    {
+      m_nextEvent = Simulator::Schedule (std::max (m_trace[m_next].time - Simulator::Now (),
+                                                   Seconds (0)),
+                                         &UplinkTraceReplayer::ReplayNext, this);
+    }
+}
+
+void
+UplinkTraceReplayer::StopApplication (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Simulator::Cancel (m_nextEvent);
+}
+
+void
+UplinkTraceReplayer::ReplayNext (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Only one event is pending at any time, however long the trace
+  Time now = Simulator::Now ();
+  while (m_next < m_trace.size () && m_trace[m_next].time <= now)
+    {
+      const UplinkRecord &record = m_trace[m_next++];
+      NS_ABORT_MSG_IF (record.gateway >= m_gatewayAddresses.size (),
+                       "Unknown gateway " << record.gateway << " in the trace");
+
+      // The server can't take uplinks from devices it doesn't know
+      LoraDeviceAddress address (record.devAddr);
+      if (m_networkServer->GetNetworkStatus ()->GetEndDeviceIndex (address)
+          == NetworkStatus::NOT_FOUND)
+        {
+          NS_LOG_DEBUG ("Skipping uplink from unknown device " << address);
+          m_nDropped++;
+          continue;
+        }
+
+      // Build the packet as the gateway would forward it
+      Ptr<Packet> packet = Create<Packet> (m_payloadSize);
+
+      LoraFrameHeader frameHdr;
+      frameHdr.SetAsUplink ();
+      frameHdr.SetAddress (address);
+      frameHdr.SetFCnt (record.fCnt);
+      frameHdr.SetAdr (true);
+      packet->AddHeader (frameHdr);
+
+      LorawanMacHeader macHdr;
+      macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+      packet->AddHeader (macHdr);
+
+      LoraTag tag (record.sf);
+      tag.SetReceivePower (record.rxPower);
+      tag.SetFrequency (record.frequency);
+      packet->AddPacketTag (tag);
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      m_networkServer->Receive (0, packet, 0x800, m_gatewayAddresses[record.gateway]);
+      m_receiveTime += std::chrono::duration<double>
+        (std::chrono::steady_clock::now () - start).count ();
+      m_nUplinks++;
+    }
+
+  if (m_next < m_trace.size ())
+    {
+      m_nextEvent = Simulator::Schedule (m_trace[m_next].time - now,
+                                         &UplinkTraceReplayer::ReplayNext, this);
+    }
+}
+
+bool
+UplinkTraceReplayer::ReceiveDownlink (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                                      uint16_t protocol, const Address &gatewayAddress)
+{
+  NS_LOG_FUNCTION (this << packet << gatewayAddress);
+
+  m_nDownlinks++;
+
+  // Keep the gateway busy for the time it would take to transmit
+  Ptr<NetworkStatus> status = m_networkServer->GetNetworkStatus ();
+  Ptr<GatewayStatus> gwStatus =
+    status->GetGatewayStatusByIndex (status->GetGatewayIndex (gatewayAddress));
+
+  LoraTag tag;
+  packet->PeekPacketTag (tag);
+  LoraTxParameters params;
+  params.sf = gwStatus->GetGatewayMac ()->GetSfFromDataRate (tag.GetDataRate ());
+  params.lowDataRateOptimizationEnabled = params.sf >= 11;
+  gwStatus->SetNextTransmissionTime (Simulator::Now ()
+                                     + LoraPhy::GetOnAirTime (packet->GetSize (), params));
+
+  return true;
+}
+
+} // namespace lorawan
+} // namespace ns3
@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef UPLINK_TRACE_REPLAYER_H
+#define UPLINK_TRACE_REPLAYER_H
+
+#include "ns3/application.h"
+#include "ns3/network-server.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+/**
+ * An application that feeds a NetworkServer with uplinks read from a trace,
+ * without simulating the radio.
+ *
+ * Each uplink is built as the packet a gateway would forward, with its
+ * LoraTag, and handed straight to NetworkServer::Receive at its time. The
+ * gateways must be connected to the server through DirectBackhaul links: the
+ * replayer takes the place of their Forwarders, and stands in for their
+ * transmissions by keeping each gateway busy for the time on air of the
+ * downlinks it is given. Replies never reach the devices.
+ */
+class UplinkTraceReplayer : public Application
+{
+public:
+  /**
+   * An uplink, as received by one gateway.
+   */
+  struct UplinkRecord
+  {
+    Time time;            //!< When the gateway forwards the uplink
+    uint32_t devAddr;     //!< Address of the device
+    uint16_t fCnt;        //!< Frame counter of the uplink
+    uint32_t gateway;     //!< Index of the gateway in SetGateways' container
+    uint8_t sf;           //!< Spreading factor
+    double rxPower;       //!< Received power, in dBm
+    double frequency;     //!< Frequency, in MHz
+  };
+
+  static TypeId GetTypeId (void);
+
+  UplinkTraceReplayer ();
+  virtual ~UplinkTraceReplayer ();
+
+  /**
+   * Read a trace in CSV format, with one uplink per line:
+   * time in seconds, device address, frame counter, gateway, spreading
+   * factor, received power in dBm and frequency in MHz. Addresses can be
+   * given in hexadecimal with a 0x prefix. Lines that don't start with a
+   * number, like a header, are skipped.
+   *
+   * \return Whether the file could be read.
+   */
+  static bool ReadCsvTrace (std::string filename, std::vector<UplinkRecord> &trace);
+
+  /**
+   * Set the uplinks to replay, sorted by time.
+   */
+  void SetTrace (const std::vector<UplinkRecord> &trace);
+
+  /**
+   * Set the NetworkServer that receives the uplinks.
+   */
+  void SetNetworkServer (Ptr<NetworkServer> networkServer);
+
+  /**
+   * Set the gateways the uplinks come through, and connect to their
+   * DirectBackhaul links.
+   */
+  void SetGateways (NodeContainer gateways);
+
+  /**
+   * Get the number of uplinks that were handed to the NetworkServer.
+   */
+  uint64_t GetNUplinks (void) const;
+
+  /**
+   * Get the number of uplinks that were skipped because their device is
+   * unknown to the NetworkServer.
+   */
+  uint64_t GetNDropped (void) const;
+
+  /**
+   * Get the number of downlinks the NetworkServer sent.
+   */
+  uint64_t GetNDownlinks (void) const;
+
+  /**
+   * Get the wall-clock time spent in NetworkServer::Receive, in seconds.
+   */
+  double GetReceiveTime (void) const;
+
+protected:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+private:
+  /**
+   * Hand all the uplinks of the current time to the NetworkServer and
+   * schedule the next ones.
+   */
+  void ReplayNext (void);
+
+  /**
+   * Stand in for a gateway's transmission of a downlink.
+   */
+  bool ReceiveDownlink (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                        uint16_t protocol, const Address &gatewayAddress);
+
+  std::vector<UplinkRecord> m_trace;
+  uint32_t m_next;                   //!< Index of the next uplink to replay
+  EventId m_nextEvent;
+  Ptr<NetworkServer> m_networkServer;
+  std::vector<Address> m_gatewayAddresses;  //!< By index in the trace
+  uint32_t m_payloadSize;            //!< Application payload of each uplink
+  uint64_t m_nUplinks;
+  uint64_t m_nDropped;
+  uint64_t m_nDownlinks;
+  double m_receiveTime;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* UPLINK_TRACE_REPLAYER_H */
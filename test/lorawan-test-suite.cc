@@ -8,6 +8,10 @@
 #include "ns3/mobility-helper.h"
 #include "ns3/one-shot-sender-helper.h"
 #include "ns3/constant-position-mobility-model.h"
+#include "ns3/link-statistics.h"
+#include "ns3/region-plan.h"
+#include "ns3/lorawan-header-view.h"
+#include "ns3/lora-packet-tracker.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -340,6 +344,22 @@ HeaderTest::DoRun (void)
   //        = 10 + (8+3) + 1 = 22
   NS_TEST_EXPECT_MSG_EQ ((pkt->GetSize ()), 22, "Wrong size of packet + headers");
 
+  // The view must decode the same fields without removing the headers
+  LorawanHeaderView view (pkt);
+  NS_TEST_ASSERT_MSG_EQ (view.IsValid (), true, "View of a complete header is invalid");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (view.GetMType ()), unsigned (macHdr.GetMType ()),
+                         "View decoded the wrong MType");
+  NS_TEST_EXPECT_MSG_EQ (view.IsUplink (), macHdr.IsUplink (), "View decoded the wrong direction");
+  NS_TEST_EXPECT_MSG_EQ ((view.GetAddress () == frameHdr.GetAddress ()), true,
+                         "View decoded the wrong address");
+  NS_TEST_EXPECT_MSG_EQ (view.GetAck (), true, "View decoded the wrong Ack bit");
+  NS_TEST_EXPECT_MSG_EQ (view.GetAdr (), false, "View decoded the wrong ADR bit");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (view.GetFOptsLen ()), 3u, "View decoded the wrong FOptsLen");
+  NS_TEST_EXPECT_MSG_EQ (view.GetFCnt (), frameHdr.GetFCnt (), "View decoded the wrong FCnt");
+  NS_TEST_EXPECT_MSG_EQ ((pkt->GetSize ()), 22, "Building a view changed the packet");
+  NS_TEST_EXPECT_MSG_EQ (LorawanHeaderView (Create<Packet> (5)).IsValid (), false,
+                         "View of a truncated header is valid");
+
   LorawanMacHeader macHdr1;
 
   pkt->RemoveHeader (macHdr1);
@@ -375,6 +395,73 @@ HeaderTest::DoRun (void)
                          "Removed header's MAC command contents don't match");
   NS_TEST_EXPECT_MSG_EQ (linkCheckAns->GetGwCnt (), 1,
                          "Removed header's MAC command contents don't match");
+
+  ////////////////////////////////////////////////////
+  // Test MAC commands held by value against objects //
+  ////////////////////////////////////////////////////
+  LoraFrameHeader downlinkHdr;
+  downlinkHdr.SetAsDownlink ();
+  std::list<int> enabledChannels;
+  enabledChannels.push_back (0);
+  enabledChannels.push_back (2);
+  enabledChannels.push_back (9);
+  downlinkHdr.AddLinkAdrReq (3, 2, enabledChannels, 1);
+  downlinkHdr.AddDutyCycleReq (4);
+  downlinkHdr.AddNewChannelReq (5, 867.1e6, 0, 5);
+  NS_TEST_EXPECT_MSG_EQ (unsigned (downlinkHdr.GetFOptsLen ()), 13u,
+                         "Wrong FOpts length");
+
+  Ptr<Packet> downlink = Create<Packet> (10);
+  downlink->AddHeader (downlinkHdr);
+  LoraFrameHeader receivedHdr;
+  receivedHdr.SetAsDownlink ();
+  downlink->RemoveHeader (receivedHdr);
+
+  const MacCommandList &values = receivedHdr.GetCommandValues ();
+  NS_TEST_ASSERT_MSG_EQ (unsigned (values.GetN ()), 3u, "Wrong number of MAC commands");
+  NS_TEST_EXPECT_MSG_EQ (values.Get (0).GetCommandType (), LINK_ADR_REQ, "Wrong command type");
+  NS_TEST_EXPECT_MSG_EQ (values.Get (0).GetChannelMask (), 0b1000000101, "Wrong channel mask");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (values.Get (0).GetDataRate ()), 3u, "Wrong data rate");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (values.Get (0).GetTxPower ()), 2u, "Wrong tx power");
+  NS_TEST_EXPECT_MSG_EQ (values.Get (1).GetMaximumAllowedDutyCycle (), 1.0 / 16,
+                         "Wrong duty cycle");
+  NS_TEST_EXPECT_MSG_EQ (values.Get (2).GetFrequency (), 867.1e6, "Wrong frequency");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (values.Get (2).GetMaxDataRate ()), 5u, "Wrong data rate");
+  NS_TEST_EXPECT_MSG_EQ ((values.Find (DEV_STATUS_REQ) == 0), true,
+                         "Found a command that was not added");
+
+  // The MacCommand objects must decode the same bytes to the same fields
+  std::list<Ptr<MacCommand> > objects = receivedHdr.GetCommands ();
+  Ptr<LinkAdrReq> linkAdrReq = objects.front ()->GetObject<LinkAdrReq> ();
+  NS_TEST_EXPECT_MSG_EQ ((linkAdrReq->GetEnabledChannelsList () == enabledChannels), true,
+                         "LinkAdrReq object and value disagree");
+  Ptr<NewChannelReq> newChannelReq = objects.back ()->GetObject<NewChannelReq> ();
+  NS_TEST_EXPECT_MSG_EQ (newChannelReq->GetFrequency (), 867.1e6,
+                         "NewChannelReq object and value disagree");
+  MacCommandValue copy = MacCommandValue::FromMacCommand (linkAdrReq);
+  NS_TEST_EXPECT_MSG_EQ (copy.GetChannelMask (), values.Get (0).GetChannelMask (),
+                         "Converting a LinkAdrReq object changed it");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (receivedHdr.GetNUndecodedFOptsBytes ()), 0u,
+                         "Skipped bytes of a valid FOpts");
+
+  // An unknown CID keeps the commands before it, and the rest is reported
+  LoraFrameHeader unknownHdr;
+  unknownHdr.SetAsDownlink ();
+  unknownHdr.AddLinkCheckAns (10, 1);
+  unknownHdr.AddDutyCycleReq (4);
+  Buffer unknownBuf;
+  unknownBuf.AddAtStart (unknownHdr.GetSerializedSize ());
+  unknownHdr.Serialize (unknownBuf.Begin ());
+  Buffer::Iterator cid = unknownBuf.Begin ();
+  cid.Next (7 + 3);   // DevAddr, FCtrl, FCnt and the LinkCheckAns
+  cid.WriteU8 (0x7f);
+  LoraFrameHeader truncatedHdr;
+  truncatedHdr.SetAsDownlink ();
+  truncatedHdr.Deserialize (unknownBuf.Begin ());
+  NS_TEST_EXPECT_MSG_EQ (unsigned (truncatedHdr.GetCommandValues ().GetN ()), 1u,
+                         "Lost the command before the unknown CID");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (truncatedHdr.GetNUndecodedFOptsBytes ()), 2u,
+                         "Wrong number of skipped FOpts bytes");
 }
 
 /*******************
@@ -847,6 +934,68 @@ LogicalLoraChannelTest::DoRun (void)
                          "Waiting time affects other subbands");
   NS_TEST_EXPECT_MSG_EQ (channelHelper->GetWaitingTime (channel5), Time (0),
                          "Waiting time affects other subbands");
+
+  // Channel mask and random channel selection
+  ////////////////////////////////////////////
+
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->GetEnabledChannelMask (), uint64_t (0x1f),
+                         "All channels should be enabled when added");
+  channelHelper->DisableChannel (3);
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->IsChannelEnabled (3), false,
+                         "Channel was not disabled");
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->GetEnabledChannelList ().size (), 4u,
+                         "Disabled channel is still in the enabled list");
+  NS_TEST_EXPECT_MSG_EQ (channelHelper->GetMinimumWaitingTime (), Time (0),
+                         "Channel 5 should be available");
+
+  Ptr<UniformRandomVariable> rv = CreateObject<UniformRandomVariable> ();
+  for (int i = 0; i < 20; i++)
+    {
+      // Only channel 5 is both enabled and out of the busy SubBand
+      NS_TEST_EXPECT_MSG_EQ (channelHelper->GetRandomEnabledChannel (rv, true), channel5,
+                             "Picked a channel that is disabled or busy");
+      NS_TEST_EXPECT_MSG_NE (channelHelper->GetRandomEnabledChannel (rv, false), channel4,
+                             "Picked a disabled channel");
+    }
+
+  channelHelper->DisableChannel (4);
+  NS_TEST_EXPECT_MSG_EQ (PeekPointer (channelHelper->GetRandomEnabledChannel (rv, true)) == 0, true,
+                         "No channel should be available");
+
+  // Shared region plans
+  //////////////////////
+
+  Ptr<RegionPlan> plan = CreateObject<RegionPlan> ();
+  plan->AddSubBand (Create<SubBand> (868, 868.6, 0.01, 14));
+  plan->AddChannel (CreateObject<LogicalLoraChannel> (868.1));
+  plan->AddChannel (CreateObject<LogicalLoraChannel> (868.3));
+
+  LogicalLoraChannelHelper helperA;
+  LogicalLoraChannelHelper helperB;
+  helperA.SetRegionPlan (plan);
+  helperB.SetRegionPlan (plan);
+
+  // Duty cycle and channel mask are per device
+  helperA.AddEvent (Seconds (1), 868.1);
+  helperA.DisableChannel (1);
+  NS_TEST_EXPECT_MSG_EQ (helperA.GetWaitingTime (868.1), Seconds (1 / 0.01 - 1),
+                         "Waiting time doesn't behave as expected");
+  NS_TEST_EXPECT_MSG_EQ (helperB.GetWaitingTime (868.1), Time (0),
+                         "Duty cycle leaked to a device sharing the plan");
+  NS_TEST_EXPECT_MSG_EQ (helperB.IsChannelEnabled (1), true,
+                         "Channel mask leaked to a device sharing the plan");
+  NS_TEST_EXPECT_MSG_EQ (plan->GetChannels ()[1]->IsEnabledForUplink (), true,
+                         "The shared channel was modified");
+
+  // Changing the channels makes a private copy of the plan
+  helperA.AddChannel (868.5);
+  NS_TEST_EXPECT_MSG_EQ (PeekPointer (helperA.GetRegionPlan ()) != PeekPointer (plan), true,
+                         "The shared plan was not copied before being modified");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (helperA.GetNChannels ()), 3u, "Channel was not added");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (helperB.GetNChannels ()), 2u,
+                         "Channel leaked to a device sharing the plan");
+  NS_TEST_EXPECT_MSG_EQ (helperA.GetWaitingTime (868.5), Seconds (1 / 0.01 - 1),
+                         "Duty cycle state was lost when copying the plan");
 }
 
 /*****************
@@ -957,6 +1106,46 @@ TimeOnAirTest::DoRun (void)
   txParams.codingRate = 1;
   duration = LoraPhy::GetOnAirTime (packet, txParams);
   NS_TEST_EXPECT_MSG_EQ_TOL (duration.GetSeconds (), 2.301952, 0.0001, "Unexpected duration");
+
+  // The table lookup matches the formula over the whole table
+  double bandwidths[3] = {125000, 250000, 500000};
+  uint32_t mismatches = 0;
+  txParams.nPreamble = 8;
+  for (uint8_t sf = 6; sf <= 12; sf++)
+    {
+      for (double bandwidth : bandwidths)
+        {
+          for (uint8_t cr = 1; cr <= 4; cr++)
+            {
+              for (uint8_t flags = 0; flags < 8; flags++)
+                {
+                  txParams.sf = sf;
+                  txParams.bandwidthHz = bandwidth;
+                  txParams.codingRate = cr;
+                  txParams.headerDisabled = flags & 1;
+                  txParams.crcEnabled = flags & 2;
+                  txParams.lowDataRateOptimizationEnabled = flags & 4;
+                  for (uint32_t size = 0; size < 256; size++)
+                    {
+                      int64_t difference = (LoraPhy::GetOnAirTime (size, txParams) -
+                                            LoraPhy::ComputeOnAirTime (size, txParams))
+                        .GetNanoSeconds ();
+                      if (difference > 1 || difference < -1)
+                        {
+                          mismatches++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (mismatches, 0u, "Table and formula disagree");
+
+  // Parameters outside of the table fall back to the formula
+  txParams.sf = 12;
+  txParams.bandwidthHz = 62500;
+  NS_TEST_EXPECT_MSG_EQ (LoraPhy::GetOnAirTime (10, txParams),
+                         LoraPhy::ComputeOnAirTime (10, txParams), "Fallback not used");
 }
 
 /**************************
@@ -1393,6 +1582,217 @@ LorawanMacTest::DoRun (void)
   NS_LOG_DEBUG ("LorawanMacTest");
 }
 
+/**********************
+ * LinkStatisticsTest *
+ **********************/
+
+class LinkStatisticsTest : public TestCase
+{
+public:
+  LinkStatisticsTest ();
+  virtual ~LinkStatisticsTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+LinkStatisticsTest::LinkStatisticsTest ()
+    : TestCase ("Verify that the windowed link statistics track the last outcomes")
+{
+}
+
+// Reminder that the test case should clean up after itself
+LinkStatisticsTest::~LinkStatisticsTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+LinkStatisticsTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("LinkStatisticsTest");
+
+  // A window spanning more than one word of the ring buffer
+  LinkStatistics stats (70, 0.5);
+
+  NS_TEST_EXPECT_MSG_EQ (stats.GetWindowSuccessRate (), 0, "Empty window should have no successes");
+
+  // 70 failures, then 35 successes
+  for (int i = 0; i < 70; i++)
+    {
+      stats.AddOutcome (false);
+    }
+  NS_TEST_EXPECT_MSG_EQ (stats.IsWindowFull (), true, "Window should be full");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetWindowSuccesses (), 0u, "Unexpected number of successes");
+  for (int i = 0; i < 35; i++)
+    {
+      stats.AddOutcome (true);
+    }
+  NS_TEST_EXPECT_MSG_EQ (stats.GetWindowOutcomes (), 70u, "Window should not grow");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetWindowSuccesses (), 35u, "Unexpected number of successes");
+  NS_TEST_EXPECT_MSG_EQ_TOL (stats.GetWindowSuccessRate (), 0.5, 1e-9, "Unexpected success rate");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetTotalOutcomes (), 105u, "Unexpected number of outcomes");
+  NS_TEST_EXPECT_MSG_EQ_TOL (stats.GetTotalErrorRate (), 70.0 / 105, 1e-9, "Unexpected error rate");
+
+  // Evict all the failures
+  for (int i = 0; i < 35; i++)
+    {
+      stats.AddOutcome (true);
+    }
+  NS_TEST_EXPECT_MSG_EQ_TOL (stats.GetWindowSuccessRate (), 1, 1e-9, "Failures were not evicted");
+
+  // The moving average halves the distance to the new outcome each time
+  LinkStatistics ewma (4, 0.5);
+  ewma.AddOutcome (true);
+  NS_TEST_EXPECT_MSG_EQ_TOL (ewma.GetSuccessRateEwma (), 1, 1e-9, "First outcome should initialize the EWMA");
+  ewma.AddOutcome (false);
+  ewma.AddOutcome (false);
+  NS_TEST_EXPECT_MSG_EQ_TOL (ewma.GetSuccessRateEwma (), 0.25, 1e-9, "Unexpected EWMA");
+
+  // Resizing discards the history
+  ewma.SetWindow (2);
+  NS_TEST_EXPECT_MSG_EQ (ewma.GetWindowOutcomes (), 0u, "Resizing should reset the window");
+
+  // The MAC layer reports the same statistics the optimizers read
+  Ptr<ClassAEndDeviceLorawanMac> mac = CreateObject<ClassAEndDeviceLorawanMac> ();
+  mac->AckNotRecieved ();
+  mac->AckNotRecieved ();
+  UintegerValue failed;
+  mac->GetAttribute ("FailedTransmissionCount", failed);
+  NS_TEST_EXPECT_MSG_EQ (failed.Get (), 2u, "MAC and link statistics disagree");
+  NS_TEST_EXPECT_MSG_EQ (mac->GetLinkStatistics ().GetTotalFailures (), 2u,
+                         "Outcome not recorded in the link statistics");
+  NS_TEST_EXPECT_MSG_EQ (mac->SetAttributeFailSafe ("LinkStatisticsEwmaAlpha", DoubleValue (0)),
+                         false, "A zero EWMA weight was accepted");
+}
+
+/*************************
+ * LoraPacketTrackerTest *
+ *************************/
+
+class LoraPacketTrackerTest : public TestCase
+{
+public:
+  LoraPacketTrackerTest ();
+  virtual ~LoraPacketTrackerTest ();
+
+private:
+  virtual void DoRun (void);
+  Ptr<Packet> CreateFrame (bool uplink);
+};
+
+// Add some help text to this case to describe what it is intended to test
+LoraPacketTrackerTest::LoraPacketTrackerTest ()
+    : TestCase ("Verify that the LoraPacketTracker keeps one record per uplink, "
+                "with the outcomes at all the gateways")
+{
+}
+
+// Reminder that the test case should clean up after itself
+LoraPacketTrackerTest::~LoraPacketTrackerTest ()
+{
+}
+
+Ptr<Packet>
+LoraPacketTrackerTest::CreateFrame (bool uplink)
+{
+  Ptr<Packet> packet = Create<Packet> (10);
+
+  LoraFrameHeader frameHdr;
+  LorawanMacHeader macHdr;
+  if (uplink)
+    {
+      frameHdr.SetAsUplink ();
+      macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+    }
+  else
+    {
+      frameHdr.SetAsDownlink ();
+      macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
+    }
+  packet->AddHeader (frameHdr);
+  packet->AddHeader (macHdr);
+
+  return packet;
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+LoraPacketTrackerTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("LoraPacketTrackerTest");
+
+  LoraPacketTracker tracker (CreateTempDirFilename ("tracker-"));
+  Ptr<Packet> uplink = CreateFrame (true);
+  Ptr<Packet> downlink = CreateFrame (false);
+  uint32_t edId = 0;
+
+  // The uplink is heard by more gateways than are stored inline: all of them
+  // receive it but the last one
+  Simulator::ScheduleWithContext (edId, Seconds (1), &LoraPacketTracker::MacTransmissionCallback,
+                                  &tracker, uplink);
+  Simulator::ScheduleWithContext (edId, Seconds (1), &LoraPacketTracker::TransmissionCallback,
+                                  &tracker, uplink, edId);
+  for (uint32_t gwId = 1; gwId <= 6; gwId++)
+    {
+      if (gwId < 6)
+        {
+          Simulator::ScheduleWithContext (gwId, Seconds (2),
+                                          &LoraPacketTracker::PacketReceptionCallback,
+                                          &tracker, uplink, gwId);
+          Simulator::ScheduleWithContext (gwId, Seconds (2),
+                                          &LoraPacketTracker::MacGwReceptionCallback,
+                                          &tracker, uplink);
+        }
+      else
+        {
+          Simulator::ScheduleWithContext (gwId, Seconds (2),
+                                          &LoraPacketTracker::InterferenceCallback,
+                                          &tracker, uplink, gwId);
+        }
+    }
+
+  // A retransmission reuses the packet, and so the record of the first attempt
+  Simulator::ScheduleWithContext (edId, Seconds (3), &LoraPacketTracker::MacTransmissionCallback,
+                                  &tracker, uplink);
+  Simulator::ScheduleWithContext (edId, Seconds (3), &LoraPacketTracker::TransmissionCallback,
+                                  &tracker, uplink, edId);
+  Simulator::ScheduleWithContext (1, Seconds (4), &LoraPacketTracker::InterferenceCallback,
+                                  &tracker, uplink, 1);
+
+  // Downlinks are not tracked
+  Simulator::ScheduleWithContext (1, Seconds (5), &LoraPacketTracker::MacTransmissionCallback,
+                                  &tracker, downlink);
+  Simulator::ScheduleWithContext (1, Seconds (5), &LoraPacketTracker::TransmissionCallback,
+                                  &tracker, downlink, 1);
+  Simulator::ScheduleWithContext (edId, Seconds (6), &LoraPacketTracker::PacketReceptionCallback,
+                                  &tracker, downlink, edId);
+
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  std::vector<int> firstGw = tracker.CountPhyPacketsPerGw (Seconds (0), Seconds (10), 1);
+  NS_TEST_EXPECT_MSG_EQ (firstGw[0], 1, "Retransmission or downlink tracked as a new packet");
+  NS_TEST_EXPECT_MSG_EQ (firstGw[1], 1, "The first outcome at a gateway was not kept");
+  NS_TEST_EXPECT_MSG_EQ (firstGw[2], 0, "A later outcome replaced the first one");
+
+  std::vector<int> lastGw = tracker.CountPhyPacketsPerGw (Seconds (0), Seconds (10), 6);
+  NS_TEST_EXPECT_MSG_EQ (lastGw[2], 1, "The outcome at a gateway past the inline one was lost");
+
+  std::vector<int> afterFirstAttempt = tracker.CountPhyPacketsPerGw (Seconds (2), Seconds (10), 1);
+  NS_TEST_EXPECT_MSG_EQ (afterFirstAttempt[0], 0, "The retransmission replaced the first record");
+
+  std::vector<int> device = tracker.CountPhyPacketsPerGw (Seconds (0), Seconds (10), edId);
+  NS_TEST_EXPECT_MSG_EQ (device[1], 0, "The reception of a downlink was tracked");
+
+  NS_TEST_EXPECT_MSG_EQ (tracker.CountMacPacketsGlobally (Seconds (0), Seconds (10)),
+                         std::to_string (1.0) + " " + std::to_string (1.0),
+                         "Unexpected number of sent and received MAC packets");
+}
+
 /**************
  * Test Suite *
  **************/
@@ -1418,6 +1818,8 @@ LorawanTestSuite::LorawanTestSuite () : TestSuite ("lorawan", UNIT)
   AddTestCase (new LogicalLoraChannelTest, TestCase::QUICK);
   AddTestCase (new TimeOnAirTest, TestCase::QUICK);
   AddTestCase (new PhyConnectivityTest, TestCase::QUICK);
+  AddTestCase (new LinkStatisticsTest, TestCase::QUICK);
+  AddTestCase (new LoraPacketTrackerTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -6,6 +6,9 @@
 // Include headers of classes to test
 #include "ns3/log.h"
 #include "ns3/network-scheduler.h"
+#include "ns3/network-server.h"
+#include "utilities.h"
+#include <algorithm>
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -52,6 +55,363 @@ NetworkSchedulerTest::DoRun (void)
   // scheduled to happen 1 second after the reception.
 }
 
+/////////////////////////
+// PlanningHorizonTest //
+/////////////////////////
+
+class PlanningHorizonTest : public TestCase
+{
+public:
+  PlanningHorizonTest ();
+  virtual ~PlanningHorizonTest ();
+
+private:
+  virtual void DoRun (void);
+  void RunSharedGateway (Time planningHorizon);
+  void RunOverlappingReplies (Time planningHorizon);
+  void SendPacket (Ptr<Node> endDevice);
+  static void Acknowledged (Time *ackTime, uint8_t requiredTransmissions, bool success,
+                            Time firstAttempt, Ptr<Packet> packet);
+
+  static const uint32_t N_DEVICES = 3;
+  Time m_ackTimes[N_DEVICES];
+  uint32_t m_nSentReplies;
+  uint32_t m_nMissedReplies;
+};
+
+// Add some help text to this case to describe what it is intended to test
+PlanningHorizonTest::PlanningHorizonTest ()
+  : TestCase ("Verify that the planner keeps replies in the first window when "
+              "they don't conflict, and that it delivers more of them than the "
+              "greedy choice when they do")
+{
+}
+
+// Reminder that the test case should clean up after itself
+PlanningHorizonTest::~PlanningHorizonTest ()
+{
+}
+
+void
+PlanningHorizonTest::SendPacket (Ptr<Node> endDevice)
+{
+  GetMacLayerFromNode<EndDeviceLorawanMac> (endDevice)->SetMType
+    (LorawanMacHeader::CONFIRMED_DATA_UP);
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+void
+PlanningHorizonTest::Acknowledged (Time *ackTime, uint8_t requiredTransmissions,
+                                   bool success, Time firstAttempt, Ptr<Packet> packet)
+{
+  if (success)
+    {
+      *ackTime = Simulator::Now ();
+    }
+}
+
+void
+PlanningHorizonTest::RunSharedGateway (Time planningHorizon)
+{
+  // Two SF7 devices served by the same gateway, whose first windows open
+  // 200 ms apart, while a reply takes about 50 ms
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (100, 0, 0));
+  allocator->Add (Vector (0, 100, 0));
+  allocator->Add (Vector (0, 0, 0));
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+  NodeContainer endDevices = CreateEndDevices (2, mobility, channel);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+  Ptr<Node> nsNode = CreateNetworkServer (endDevices, gateways);
+
+  Ptr<NetworkScheduler> scheduler =
+    nsNode->GetApplication (0)->GetObject<NetworkServer> ()->GetNetworkScheduler ();
+  scheduler->SetAttribute ("PlanningHorizon", TimeValue (planningHorizon));
+
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      m_ackTimes[i] = Seconds (0);
+      Ptr<EndDeviceLorawanMac> mac =
+        GetMacLayerFromNode<EndDeviceLorawanMac> (endDevices.Get (i));
+      mac->SetDataRate (5);
+      mac->TraceConnectWithoutContext ("RequiredTransmissions",
+                                       MakeBoundCallback (&PlanningHorizonTest::Acknowledged,
+                                                          &m_ackTimes[i]));
+      Simulator::Schedule (Seconds (1 + 0.2 * i), &PlanningHorizonTest::SendPacket, this,
+                           endDevices.Get (i));
+    }
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  m_nSentReplies = scheduler->GetNSentReplies ();
+  m_nMissedReplies = scheduler->GetNMissedReplies ();
+
+  Simulator::Destroy ();
+}
+
+void
+PlanningHorizonTest::RunOverlappingReplies (Time planningHorizon)
+{
+  // Gateway A is at the origin and gateway B 6 km away. Device 0 uses SF12
+  // and reaches both gateways, A being the best one. Devices 1 and 2 use SF7
+  // and only reach A.
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (2500, 0, 0));
+  allocator->Add (Vector (-100, 0, 0));
+  allocator->Add (Vector (0, -100, 0));
+  allocator->Add (Vector (0, 0, 0));
+  allocator->Add (Vector (6000, 0, 0));
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+  NodeContainer endDevices = CreateEndDevices (N_DEVICES, mobility, channel);
+  NodeContainer gateways = CreateGateways (2, mobility, channel);
+  Ptr<Node> nsNode = CreateNetworkServer (endDevices, gateways);
+
+  Ptr<NetworkScheduler> scheduler =
+    nsNode->GetApplication (0)->GetObject<NetworkServer> ()->GetNetworkScheduler ();
+  scheduler->SetAttribute ("PlanningHorizon", TimeValue (planningHorizon));
+
+  // The uplinks don't overlap. Device 0's window opens at about 3.81 s and
+  // its SF12 reply lasts about 1 s, covering the windows of device 1 (about
+  // 4.07 s) and device 2 (about 4.57 s). If device 0 takes A, device 1 goes
+  // to the second window, where its SF12 reply keeps A busy through both
+  // windows of device 2.
+  uint8_t dataRates[N_DEVICES] = {0, 5, 5};
+  Time sendTimes[N_DEVICES] = {Seconds (1), Seconds (3), Seconds (3.5)};
+  for (uint32_t i = 0; i < N_DEVICES; i++)
+    {
+      m_ackTimes[i] = Seconds (0);
+      Ptr<EndDeviceLorawanMac> mac =
+        GetMacLayerFromNode<EndDeviceLorawanMac> (endDevices.Get (i));
+      mac->SetDataRate (dataRates[i]);
+      mac->TraceConnectWithoutContext ("RequiredTransmissions",
+                                       MakeBoundCallback (&PlanningHorizonTest::Acknowledged,
+                                                          &m_ackTimes[i]));
+      Simulator::Schedule (sendTimes[i], &PlanningHorizonTest::SendPacket, this,
+                           endDevices.Get (i));
+    }
+
+  // Stop before device 2 may retransmit, which the duty cycle delays to
+  // about 10.7 s
+  Simulator::Stop (Seconds (8));
+  Simulator::Run ();
+
+  m_nSentReplies = scheduler->GetNSentReplies ();
+  m_nMissedReplies = scheduler->GetNMissedReplies ();
+
+  Simulator::Destroy ();
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+PlanningHorizonTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("PlanningHorizonTest");
+
+  // Replies that don't overlap the other windows stay in the first window
+  RunSharedGateway (MilliSeconds (500));
+
+  NS_TEST_EXPECT_MSG_EQ (m_nSentReplies, 2u, "Unexpected number of replies");
+  NS_TEST_EXPECT_MSG_EQ (m_nMissedReplies, 0u, "A reply was missed");
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      NS_TEST_EXPECT_MSG_GT (m_ackTimes[i], Seconds (1 + 0.2 * i),
+                             "Device " << i << " was not acknowledged");
+      NS_TEST_EXPECT_MSG_LT (m_ackTimes[i], Seconds (3 + 0.2 * i),
+                             "The reply to device " << i << " was postponed");
+    }
+
+  // When the replies overlap, the greedy choice loses one of them
+  RunOverlappingReplies (Seconds (0));
+
+  NS_TEST_EXPECT_MSG_EQ (m_nSentReplies, 2u, "Unexpected number of greedy replies");
+  NS_TEST_EXPECT_MSG_EQ (m_nMissedReplies, 1u, "Unexpected number of missed greedy replies");
+  NS_TEST_EXPECT_MSG_EQ (m_ackTimes[2], Seconds (0), "Device 2 was acknowledged");
+
+  // The planner sends device 0's reply through B instead, so that all the
+  // replies go out in the first window
+  RunOverlappingReplies (Seconds (2));
+
+  NS_TEST_EXPECT_MSG_EQ (m_nSentReplies, 3u, "Unexpected number of planned replies");
+  NS_TEST_EXPECT_MSG_EQ (m_nMissedReplies, 0u, "A planned reply was missed");
+  for (uint32_t i = 0; i < N_DEVICES; i++)
+    {
+      NS_TEST_EXPECT_MSG_GT (m_ackTimes[i], Seconds (0),
+                             "Device " << i << " was not acknowledged");
+    }
+  NS_TEST_EXPECT_MSG_LT (m_ackTimes[1], Seconds (5),
+                         "The reply to device 1 was postponed");
+  NS_TEST_EXPECT_MSG_LT (m_ackTimes[2], Seconds (5.5),
+                         "The reply to device 2 was postponed");
+}
+
+////////////////////////
+// TickResolutionTest //
+////////////////////////
+
+class TickResolutionTest : public TestCase
+{
+public:
+  TickResolutionTest ();
+  virtual ~TickResolutionTest ();
+
+private:
+  virtual void DoRun (void);
+  void RunScenario (Time tickResolution, Time spacing);
+  void SendPacket (Ptr<Node> endDevice);
+  static void Acknowledged (Time *ackTime, uint8_t requiredTransmissions, bool success,
+                            Time firstAttempt, Ptr<Packet> packet);
+
+  static const uint32_t N_DEVICES = 3;
+  Time m_ackTimes[N_DEVICES];
+  uint32_t m_nSentReplies;
+  uint32_t m_nMissedReplies;
+};
+
+// Add some help text to this case to describe what it is intended to test
+TickResolutionTest::TickResolutionTest ()
+  : TestCase ("Verify that opening the receive windows in ticks sends the "
+              "same replies as opening each of them with its own event, and "
+              "that the windows of a tick share the gateway")
+{
+}
+
+// Reminder that the test case should clean up after itself
+TickResolutionTest::~TickResolutionTest ()
+{
+}
+
+void
+TickResolutionTest::SendPacket (Ptr<Node> endDevice)
+{
+  GetMacLayerFromNode<EndDeviceLorawanMac> (endDevice)->SetMType
+    (LorawanMacHeader::CONFIRMED_DATA_UP);
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+void
+TickResolutionTest::Acknowledged (Time *ackTime, uint8_t requiredTransmissions,
+                                  bool success, Time firstAttempt, Ptr<Packet> packet)
+{
+  if (success)
+    {
+      *ackTime = Simulator::Now ();
+    }
+}
+
+void
+TickResolutionTest::RunScenario (Time tickResolution, Time spacing)
+{
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (100, 0, 0));
+  allocator->Add (Vector (0, 100, 0));
+  allocator->Add (Vector (-100, 0, 0));
+  allocator->Add (Vector (0, 0, 0));
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+  NodeContainer endDevices = CreateEndDevices (N_DEVICES, mobility, channel);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+  Ptr<Node> nsNode = CreateNetworkServer (endDevices, gateways);
+
+  Ptr<NetworkScheduler> scheduler =
+    nsNode->GetApplication (0)->GetObject<NetworkServer> ()->GetNetworkScheduler ();
+  scheduler->SetAttribute ("TickResolution", TimeValue (tickResolution));
+
+  // Each device uses SF7 on a channel of its own, so that uplinks sent at the
+  // same time don't collide and end together. They reach the server about
+  // 0.1 ms apart, after going through the backhaul one at a time, so they
+  // are sent half a millisecond into the second to keep their windows away
+  // from the edges of a tick.
+  for (uint32_t i = 0; i < N_DEVICES; i++)
+    {
+      m_ackTimes[i] = Seconds (0);
+      Ptr<EndDeviceLorawanMac> mac =
+        GetMacLayerFromNode<EndDeviceLorawanMac> (endDevices.Get (i));
+      mac->OnLinkAdrReq (5, 1, std::list<int> (1, i), 1);
+      mac->TraceConnectWithoutContext ("RequiredTransmissions",
+                                       MakeBoundCallback (&TickResolutionTest::Acknowledged,
+                                                          &m_ackTimes[i]));
+      Simulator::Schedule (MicroSeconds (1000500) + spacing * i,
+                           &TickResolutionTest::SendPacket, this, endDevices.Get (i));
+    }
+
+  // Stop before unacknowledged devices retransmit, which the duty cycle
+  // delays to about 6.6 s
+  Simulator::Stop (Seconds (5));
+  Simulator::Run ();
+
+  m_nSentReplies = scheduler->GetNSentReplies ();
+  m_nMissedReplies = scheduler->GetNMissedReplies ();
+
+  Simulator::Destroy ();
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+TickResolutionTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("TickResolutionTest");
+
+  // Windows that open in different ticks get the same replies either way,
+  // all of them in the first window
+  RunScenario (Seconds (0), MilliSeconds (300));
+  Time ackTimes[N_DEVICES];
+  std::copy (m_ackTimes, m_ackTimes + N_DEVICES, ackTimes);
+  NS_TEST_EXPECT_MSG_EQ (m_nSentReplies, N_DEVICES, "Unexpected number of replies");
+  NS_TEST_EXPECT_MSG_EQ (m_nMissedReplies, 0u, "A reply was missed");
+
+  RunScenario (MilliSeconds (1), MilliSeconds (300));
+
+  NS_TEST_EXPECT_MSG_EQ (m_nSentReplies, N_DEVICES, "Different number of replies");
+  NS_TEST_EXPECT_MSG_EQ (m_nMissedReplies, 0u, "Different number of missed replies");
+  for (uint32_t i = 0; i < N_DEVICES; i++)
+    {
+      NS_TEST_EXPECT_MSG_GT (ackTimes[i], Seconds (0),
+                             "Device " << i << " was not acknowledged");
+      NS_TEST_EXPECT_MSG_GT (m_ackTimes[i], Seconds (0),
+                             "Device " << i << " was not acknowledged in ticks");
+    }
+
+  // Uplinks that end together have their windows in the same tick. The first
+  // device takes the gateway, which stays busy for the rest of the tick, so
+  // the others move to their second window, where again only one of them
+  // gets the gateway and the last one is missed.
+  RunScenario (MilliSeconds (1), Seconds (0));
+
+  NS_TEST_EXPECT_MSG_EQ (m_nSentReplies, 2u, "Unexpected number of replies in one tick");
+  NS_TEST_EXPECT_MSG_EQ (m_nMissedReplies, 1u, "Unexpected number of missed replies in one tick");
+  uint32_t nFirstWindow = 0;
+  uint32_t nSecondWindow = 0;
+  for (uint32_t i = 0; i < N_DEVICES; i++)
+    {
+      if (m_ackTimes[i].IsStrictlyPositive ())
+        {
+          (m_ackTimes[i] < Seconds (2.5) ? nFirstWindow : nSecondWindow)++;
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (nFirstWindow, 1u, "Unexpected number of replies in the first window");
+  NS_TEST_EXPECT_MSG_EQ (nSecondWindow, 1u, "Unexpected number of replies in the second window");
+
+  // Ticks longer than the shortest receive window are rejected
+  Ptr<NetworkScheduler> scheduler = CreateObject<NetworkScheduler> ();
+  NS_TEST_EXPECT_MSG_EQ (scheduler->SetAttributeFailSafe ("TickResolution",
+                                                          TimeValue (MilliSeconds (10))),
+                         false, "A tick longer than a receive window was accepted");
+}
+
 /**************
  * Test Suite *
  **************/
@@ -72,6 +432,8 @@ NetworkSchedulerTestSuite::NetworkSchedulerTestSuite ()
   LogComponentEnable ("NetworkSchedulerTestSuite", LOG_LEVEL_DEBUG);
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new NetworkSchedulerTest, TestCase::QUICK);
+  AddTestCase (new PlanningHorizonTest, TestCase::QUICK);
+  AddTestCase (new TickResolutionTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -15,10 +15,24 @@
 #include "ns3/callback.h"
 #include "ns3/network-server.h"
 #include "ns3/network-server-helper.h"
+#include "ns3/genome-seed-index.h"
+#include "ns3/end-device-status.h"
+#include "ns3/decoded-uplink.h"
+#include "ns3/dense-index.h"
+#include "ns3/adr-component.h"
+#include "ns3/lora-tag.h"
+#include "ns3/mac48-address.h"
+#include "ns3/backhaul-bundle-header.h"
+#include "ns3/semtech-udp-ingest.h"
+#include "ns3/uplink-trace-replayer.h"
+#include "ns3/basic-energy-source-helper.h"
+#include "ns3/lora-radio-energy-model-helper.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
 
+#include <fstream>
+
 using namespace ns3;
 using namespace lorawan;
 
@@ -267,6 +281,1201 @@ LinkCheckTest::DoRun (void)
   NS_ASSERT (m_receivedPacketAtEd);
 }
 
+/////////////////////////
+// GenomeSeedIndexTest //
+/////////////////////////
+
+class GenomeSeedIndexTest : public TestCase
+{
+public:
+  GenomeSeedIndexTest ();
+  virtual ~GenomeSeedIndexTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+GenomeSeedIndexTest::GenomeSeedIndexTest ()
+  : TestCase ("Verify that the NetworkServer's genome index returns the "
+              "genomes of the closest converged devices")
+{
+}
+
+// Reminder that the test case should clean up after itself
+GenomeSeedIndexTest::~GenomeSeedIndexTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+GenomeSeedIndexTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("GenomeSeedIndexTest");
+
+  Ptr<GenomeSeedIndex> index = CreateObject<GenomeSeedIndex> ();
+
+  index->Insert (LoraDeviceAddress (1), Vector (100, 0, 0),
+                 CreateObject<TransmissionParameterSet> (7, 2, 125000, 1));
+  index->Insert (LoraDeviceAddress (2), Vector (10, 0, 0),
+                 CreateObject<TransmissionParameterSet> (9, 6, 125000, 1));
+  index->Insert (LoraDeviceAddress (3), Vector (5000, 0, 0),
+                 CreateObject<TransmissionParameterSet> (12, 14, 125000, 4));
+  NS_TEST_EXPECT_MSG_EQ (index->GetNGenomes (), 3u, "Unexpected index size");
+
+  // Closest first, out of range genomes and the device's own genome excluded
+  std::vector<Ptr<TransmissionParameterSet> > seeds =
+    index->GetSeeds (LoraDeviceAddress (4), Vector (0, 0, 0), 500, 4);
+  NS_TEST_ASSERT_MSG_EQ (seeds.size (), 2u, "Unexpected number of seeds");
+  NS_TEST_EXPECT_MSG_EQ (seeds[0]->spreadingFactor, 9, "Closest genome should come first");
+  NS_TEST_EXPECT_MSG_EQ (seeds[1]->spreadingFactor, 7, "Unexpected second seed");
+
+  seeds = index->GetSeeds (LoraDeviceAddress (2), Vector (0, 0, 0), 500, 4);
+  NS_TEST_EXPECT_MSG_EQ (seeds.size (), 1u, "A device should not be seeded with its own genome");
+
+  // A device converging again replaces its previous genome
+  index->Insert (LoraDeviceAddress (1), Vector (5010, 0, 0),
+                 CreateObject<TransmissionParameterSet> (8, 4, 125000, 2));
+  NS_TEST_EXPECT_MSG_EQ (index->GetNGenomes (), 3u, "Genome was not replaced");
+  seeds = index->GetSeeds (LoraDeviceAddress (4), Vector (0, 0, 0), 500, 4);
+  NS_TEST_EXPECT_MSG_EQ (seeds.size (), 1u, "Replaced genome is still in its old cell");
+}
+
+///////////////////////////////
+// ReceivedPacketHistoryTest //
+///////////////////////////////
+
+class ReceivedPacketHistoryTest : public TestCase
+{
+public:
+  ReceivedPacketHistoryTest ();
+  virtual ~ReceivedPacketHistoryTest ();
+
+private:
+  virtual void DoRun (void);
+  DecodedUplink MakeUplink (uint16_t fCnt, double rxPower, const Address &gwAddress);
+};
+
+// Add some help text to this case to describe what it is intended to test
+ReceivedPacketHistoryTest::ReceivedPacketHistoryTest ()
+  : TestCase ("Verify that the EndDeviceStatus keeps a bounded history of "
+              "received packets, merging receptions of the same packet and "
+              "ranking the gateways that received it")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ReceivedPacketHistoryTest::~ReceivedPacketHistoryTest ()
+{
+}
+
+DecodedUplink
+ReceivedPacketHistoryTest::MakeUplink (uint16_t fCnt, double rxPower, const Address &gwAddress)
+{
+  Ptr<Packet> packet = Create<Packet> (10);
+
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  frameHdr.SetAddress (LoraDeviceAddress (1));
+  frameHdr.SetFCnt (fCnt);
+  frameHdr.SetAdr (true);
+  packet->AddHeader (frameHdr);
+
+  LorawanMacHeader macHdr;
+  macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+  packet->AddHeader (macHdr);
+
+  LoraTag tag (7);
+  tag.SetReceivePower (rxPower);
+  tag.SetFrequency (868.1);
+  packet->AddPacketTag (tag);
+
+  return DecodedUplink (packet, gwAddress);
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+ReceivedPacketHistoryTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("ReceivedPacketHistoryTest");
+
+  Address gw1 = Mac48Address ("00:00:00:00:00:01");
+  Address gw2 = Mac48Address ("00:00:00:00:00:02");
+
+  Ptr<EndDeviceStatus> status = CreateObject<EndDeviceStatus> ();
+  status->ReserveReceivedPacketHistory (4);
+
+  for (uint16_t fCnt = 0; fCnt < 10; fCnt++)
+    {
+      status->InsertReceivedPacket (MakeUplink (fCnt, -100, gw1), 0);
+    }
+
+  const EndDeviceStatus::ReceivedPacketList &history = status->GetReceivedPacketList ();
+  NS_TEST_EXPECT_MSG_EQ (history.GetSize (), 4u, "History grew past its depth");
+  NS_TEST_EXPECT_MSG_EQ (history.GetLast ().fCnt, 9, "Unexpected last packet");
+  NS_TEST_EXPECT_MSG_EQ (history.Get (3).fCnt, 6, "Unexpected oldest packet");
+  NS_TEST_EXPECT_MSG_EQ (history.GetLast ().adr, true, "ADR bit was not stored");
+
+  // A second gateway receiving the last packet doesn't add a new entry
+  status->InsertReceivedPacket (MakeUplink (9, -90, gw2), 1);
+  NS_TEST_EXPECT_MSG_EQ (history.GetSize (), 4u, "Duplicate was stored as a new packet");
+  NS_TEST_EXPECT_MSG_EQ (history.GetLast ().gwList.size (), 2u, "Gateway was not added");
+
+  // The stronger gateway goes first in the ranking
+  NS_TEST_ASSERT_MSG_EQ (status->GetNRankedGateways (), 2u, "Unexpected ranking size");
+  NS_TEST_EXPECT_MSG_EQ (status->GetRankedGateway (0).gatewayIndex, 1u, "Unexpected best gateway");
+  NS_TEST_EXPECT_MSG_EQ (status->GetRankedGateway (1).gatewayIndex, 0u, "Unexpected second gateway");
+
+  // Growing the history keeps the packets in order
+  status->ReserveReceivedPacketHistory (8);
+  NS_TEST_EXPECT_MSG_EQ (history.GetSize (), 4u, "Packets were lost while growing");
+  NS_TEST_EXPECT_MSG_EQ (history.Get (3).fCnt, 6, "Packets were reordered while growing");
+  status->InsertReceivedPacket (MakeUplink (10, -100, gw1), 0);
+  NS_TEST_EXPECT_MSG_EQ (history.GetSize (), 5u, "History did not grow");
+  NS_TEST_EXPECT_MSG_EQ (history.Get (1).gwList.size (), 2u, "Packet was overwritten");
+  NS_TEST_EXPECT_MSG_EQ (status->GetNRankedGateways (), 1u, "Ranking was not reset");
+}
+
+////////////////////
+// DenseIndexTest //
+////////////////////
+
+class DenseIndexTest : public TestCase
+{
+public:
+  DenseIndexTest ();
+  virtual ~DenseIndexTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+DenseIndexTest::DenseIndexTest ()
+  : TestCase ("Verify that the DenseIndex gives stable, dense indices to "
+              "device and gateway addresses")
+{
+}
+
+// Reminder that the test case should clean up after itself
+DenseIndexTest::~DenseIndexTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+DenseIndexTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("DenseIndexTest");
+
+  typedef DenseIndex<LoraDeviceAddress, LoraDeviceAddressHash> DeviceIndex;
+  DeviceIndex devices;
+
+  // Insert enough devices to rehash the table several times
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (devices.Insert (LoraDeviceAddress (i * 3)), i,
+                             "Indices are not dense");
+    }
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (devices.Find (LoraDeviceAddress (i * 3)), i,
+                             "Index changed after rehashing");
+    }
+  NS_TEST_EXPECT_MSG_EQ (devices.Find (LoraDeviceAddress (1)), DeviceIndex::NOT_FOUND,
+                         "Found a device that was never inserted");
+  NS_TEST_EXPECT_MSG_EQ (devices.Insert (LoraDeviceAddress (6)), 2u,
+                         "Inserting a device twice changed its index");
+  NS_TEST_EXPECT_MSG_EQ (devices.GetN (), 1000u, "Unexpected number of devices");
+
+  DenseIndex<Address, AddressHash> gateways;
+  Address gw1 = Mac48Address ("00:00:00:00:00:01");
+  Address gw2 = Mac48Address ("00:00:00:00:00:02");
+  gateways.Insert (gw1);
+  gateways.Insert (gw2);
+  NS_TEST_EXPECT_MSG_EQ (gateways.Find (gw2), 1u, "Unexpected gateway index");
+  NS_TEST_EXPECT_MSG_EQ (gateways.GetKey (0), gw1, "Unexpected gateway address");
+}
+
+///////////////////
+// SnrWindowTest //
+///////////////////
+
+class SnrWindowTest : public TestCase
+{
+public:
+  SnrWindowTest ();
+  virtual ~SnrWindowTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+SnrWindowTest::SnrWindowTest ()
+  : TestCase ("Verify that the AdrComponent's rolling SNR statistics match "
+              "the ones computed over the last packets")
+{
+}
+
+// Reminder that the test case should clean up after itself
+SnrWindowTest::~SnrWindowTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+SnrWindowTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("SnrWindowTest");
+
+  double snrs[] = {3, -1, 4, 1, -5, 9, 2, -6};
+  AdrComponent::SnrWindow window;
+
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      window.Push (snrs[i], 3);
+
+      // Compute the statistics of the last three values directly
+      uint32_t first = i < 2 ? 0 : i - 2;
+      double sum = 0;
+      double min = snrs[first];
+      double max = snrs[first];
+      for (uint32_t j = first; j <= i; j++)
+        {
+          sum += snrs[j];
+          min = std::min (min, snrs[j]);
+          max = std::max (max, snrs[j]);
+        }
+
+      NS_TEST_EXPECT_MSG_EQ (window.GetN (), i - first + 1, "Unexpected window size");
+      NS_TEST_EXPECT_MSG_EQ_TOL (window.GetSum (), sum, 1e-9, "Unexpected sum");
+      NS_TEST_EXPECT_MSG_EQ (window.GetMin (), min, "Unexpected minimum");
+      NS_TEST_EXPECT_MSG_EQ (window.GetMax (), max, "Unexpected maximum");
+    }
+}
+
+///////////////////////
+// AdrEvaluationTest //
+///////////////////////
+
+class AdrEvaluationTest : public TestCase
+{
+public:
+  AdrEvaluationTest ();
+  virtual ~AdrEvaluationTest ();
+
+private:
+  virtual void DoRun (void);
+  void RunScenario (Time evaluationInterval);
+  void DataRateChanged (uint8_t oldDataRate, uint8_t newDataRate);
+  void TxPowerChanged (double oldTxPower, double newTxPower);
+  void SendPacket (Ptr<Node> endDevice);
+
+  // The parameters set by the LinkAdrReqs the device received
+  std::vector<std::pair<Time, unsigned> > m_dataRates;
+  std::vector<std::pair<Time, double> > m_txPowers;
+};
+
+// Add some help text to this case to describe what it is intended to test
+AdrEvaluationTest::AdrEvaluationTest ()
+  : TestCase ("Verify that the batched ADR evaluation issues the same "
+              "LinkAdrReqs as the evaluation before each reply")
+{
+}
+
+// Reminder that the test case should clean up after itself
+AdrEvaluationTest::~AdrEvaluationTest ()
+{
+}
+
+void
+AdrEvaluationTest::DataRateChanged (uint8_t oldDataRate, uint8_t newDataRate)
+{
+  m_dataRates.push_back (std::make_pair (Simulator::Now (), unsigned (newDataRate)));
+}
+
+void
+AdrEvaluationTest::TxPowerChanged (double oldTxPower, double newTxPower)
+{
+  m_txPowers.push_back (std::make_pair (Simulator::Now (), newTxPower));
+}
+
+void
+AdrEvaluationTest::SendPacket (Ptr<Node> endDevice)
+{
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+void
+AdrEvaluationTest::RunScenario (Time evaluationInterval)
+{
+  m_dataRates.clear ();
+  m_txPowers.clear ();
+
+  Config::SetDefault ("ns3::AdrComponent::EvaluationInterval", TimeValue (evaluationInterval));
+
+  // One device, far enough from the gateway to need SF12 without ADR but
+  // close enough for ADR to raise its data rate
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (1000, 0, 0));
+  allocator->Add (Vector (0, 0, 0));
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+  NodeContainer endDevices = CreateEndDevices (1, mobility, channel);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+
+  NetworkServerHelper networkServerHelper;
+  networkServerHelper.SetEndDevices (endDevices);
+  networkServerHelper.SetGateways (gateways);
+  networkServerHelper.EnableAdr (true);
+  Ptr<Node> nsNode = CreateObject<Node> ();
+  networkServerHelper.Install (nsNode);
+  ForwarderHelper ().Install (gateways);
+
+  Ptr<EndDeviceLorawanMac> mac = GetMacLayerFromNode<EndDeviceLorawanMac> (endDevices.Get (0));
+  mac->SetDataRate (0);
+  mac->SetAttribute ("DRControl", BooleanValue (true));
+  mac->TraceConnectWithoutContext ("DataRate",
+                                   MakeCallback (&AdrEvaluationTest::DataRateChanged, this));
+  mac->TraceConnectWithoutContext ("TxPower",
+                                   MakeCallback (&AdrEvaluationTest::TxPowerChanged, this));
+
+  // Leave room for the duty cycle of SF12 between the uplinks
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      Simulator::Schedule (Seconds (1 + 200 * i), &AdrEvaluationTest::SendPacket, this,
+                           endDevices.Get (0));
+    }
+
+  Simulator::Stop (Seconds (1300));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  Config::SetDefault ("ns3::AdrComponent::EvaluationInterval", TimeValue (Seconds (0)));
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+AdrEvaluationTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("AdrEvaluationTest");
+
+  RunScenario (Seconds (0));
+  std::vector<std::pair<Time, unsigned> > dataRates = m_dataRates;
+  std::vector<std::pair<Time, double> > txPowers = m_txPowers;
+  NS_TEST_ASSERT_MSG_GT (dataRates.size (), 0u, "No LinkAdrReq was received");
+
+  // Evaluate well before the reply, which is sent one second after the uplink
+  RunScenario (MilliSeconds (100));
+
+  NS_TEST_ASSERT_MSG_EQ (m_dataRates.size (), dataRates.size (),
+                         "Different number of data rate changes");
+  for (uint32_t i = 0; i < dataRates.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_dataRates[i].first, dataRates[i].first,
+                             "Data rate changed at a different time");
+      NS_TEST_EXPECT_MSG_EQ (m_dataRates[i].second, dataRates[i].second,
+                             "Different data rate");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_txPowers.size (), txPowers.size (),
+                         "Different number of TX power changes");
+  for (uint32_t i = 0; i < txPowers.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_txPowers[i].first, txPowers[i].first,
+                             "TX power changed at a different time");
+      NS_TEST_EXPECT_MSG_EQ (m_txPowers[i].second, txPowers[i].second,
+                             "Different TX power");
+    }
+}
+
+///////////////////////
+// DeduplicationTest //
+///////////////////////
+
+class DeduplicationTest : public TestCase
+{
+public:
+  DeduplicationTest ();
+  virtual ~DeduplicationTest ();
+
+private:
+  virtual void DoRun (void);
+  void ReceivedPacket (Ptr<Packet const> packet);
+  void SendPacket (Ptr<Node> endDevice);
+  void SaveHistogram (Ptr<NetworkServer> ns);
+
+  uint32_t m_nReceivedCopies;
+  std::vector<uint64_t> m_histogram;
+};
+
+// Add some help text to this case to describe what it is intended to test
+DeduplicationTest::DeduplicationTest ()
+  : TestCase ("Verify that the NetworkServer recognizes the copies of an "
+              "uplink received through several gateways"),
+  m_nReceivedCopies (0)
+{
+}
+
+// Reminder that the test case should clean up after itself
+DeduplicationTest::~DeduplicationTest ()
+{
+}
+
+void
+DeduplicationTest::ReceivedPacket (Ptr<Packet const> packet)
+{
+  m_nReceivedCopies++;
+}
+
+void
+DeduplicationTest::SendPacket (Ptr<Node> endDevice)
+{
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+void
+DeduplicationTest::SaveHistogram (Ptr<NetworkServer> ns)
+{
+  m_histogram = ns->GetCopiesHistogram ();
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+DeduplicationTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("DeduplicationTest");
+
+  Config::SetDefault ("ns3::NetworkServer::DeduplicationWindow",
+                      TimeValue (MilliSeconds (100)));
+
+  // Surround the device with gateways close enough for all of them to
+  // receive its uplink
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (0, 0, 0));
+  allocator->Add (Vector (100, 0, 0));
+  allocator->Add (Vector (-100, 0, 0));
+  allocator->Add (Vector (0, 100, 0));
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+  NodeContainer endDevices = CreateEndDevices (1, mobility, channel);
+  NodeContainer gateways = CreateGateways (3, mobility, channel);
+  LorawanMacHelper ().SetSpreadingFactorsUp (endDevices, gateways, channel);
+  Ptr<Node> nsNode = CreateNetworkServer (endDevices, gateways);
+
+  Ptr<NetworkServer> ns = nsNode->GetApplication (0)->GetObject<NetworkServer> ();
+  ns->TraceConnectWithoutContext ("ReceivedPacket",
+                                  MakeCallback (&DeduplicationTest::ReceivedPacket, this));
+
+  // The second uplink leaves room for the duty cycle of the first one. The
+  // histogram is looked at in between, once the first uplink's window is
+  // over, and after the second uplink's window, without a third uplink to
+  // close it.
+  Simulator::Schedule (Seconds (1), &DeduplicationTest::SendPacket, this,
+                       endDevices.Get (0));
+  Simulator::Schedule (Seconds (5), &DeduplicationTest::SaveHistogram, this, ns);
+  Simulator::Schedule (Seconds (10), &DeduplicationTest::SendPacket, this,
+                       endDevices.Get (0));
+
+  Simulator::Stop (Seconds (20));
+  Simulator::Run ();
+
+  // Every copy but the first one of each uplink is a duplicate
+  NS_TEST_ASSERT_MSG_GT (m_nReceivedCopies, 2u, "The uplinks were not received by several gateways");
+  NS_TEST_EXPECT_MSG_EQ (ns->GetNDuplicates (), m_nReceivedCopies - 2,
+                         "Unexpected number of duplicates");
+
+  // Each uplink reached the three gateways
+  NS_TEST_ASSERT_MSG_EQ (m_histogram.size (), 4u, "Unexpected first histogram");
+  NS_TEST_EXPECT_MSG_EQ (m_histogram[3], 1u, "The first uplink was not counted");
+  std::vector<uint64_t> histogram = ns->GetCopiesHistogram ();
+  NS_TEST_ASSERT_MSG_EQ (histogram.size (), 4u, "Unexpected final histogram");
+  NS_TEST_EXPECT_MSG_EQ (histogram[1] + histogram[2], 0u, "An uplink missed a gateway");
+  NS_TEST_EXPECT_MSG_EQ (histogram[3], 2u, "Not all the uplinks were counted");
+  NS_TEST_EXPECT_MSG_EQ (m_nReceivedCopies, 6u, "Unexpected number of copies");
+
+  Simulator::Destroy ();
+
+  Config::SetDefault ("ns3::NetworkServer::DeduplicationWindow", TimeValue (Seconds (0)));
+}
+
+////////////////////////
+// DirectBackhaulTest //
+////////////////////////
+
+class DirectBackhaulTest : public TestCase
+{
+public:
+  DirectBackhaulTest ();
+  virtual ~DirectBackhaulTest ();
+
+private:
+  virtual void DoRun (void);
+  void ReceivedPacketAtEndDevice (uint8_t requiredTransmissions, bool success,
+                                  Time time, Ptr<Packet> packet);
+  void SendPacket (Ptr<Node> endDevice);
+
+  bool m_receivedPacketAtEd;
+};
+
+// Add some help text to this case to describe what it is intended to test
+DirectBackhaulTest::DirectBackhaulTest ()
+  : TestCase ("Verify that the NetworkServer can receive uplinks and send "
+              "replies through in-process links to the gateways"),
+  m_receivedPacketAtEd (false)
+{
+}
+
+// Reminder that the test case should clean up after itself
+DirectBackhaulTest::~DirectBackhaulTest ()
+{
+}
+
+void
+DirectBackhaulTest::ReceivedPacketAtEndDevice (uint8_t requiredTransmissions, bool success,
+                                               Time time, Ptr<Packet> packet)
+{
+  m_receivedPacketAtEd = success;
+}
+
+void
+DirectBackhaulTest::SendPacket (Ptr<Node> endDevice)
+{
+  GetMacLayerFromNode<EndDeviceLorawanMac> (endDevice)->SetMType
+    (LorawanMacHeader::CONFIRMED_DATA_UP);
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+DirectBackhaulTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("DirectBackhaulTest");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
+                                 "rho", DoubleValue (1000),
+                                 "X", DoubleValue (0.0),
+                                 "Y", DoubleValue (0.0));
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  NodeContainer endDevices = CreateEndDevices (1, mobility, channel);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+  LorawanMacHelper ().SetSpreadingFactorsUp (endDevices, gateways, channel);
+
+  NetworkServerHelper networkServerHelper;
+  networkServerHelper.SetEndDevices (endDevices);
+  networkServerHelper.SetGateways (gateways);
+  networkServerHelper.EnableDirectBackhaul (true);
+  networkServerHelper.SetDirectBackhaulAttribute
+    ("Latency", StringValue ("ns3::UniformRandomVariable[Min=0.001|Max=0.01]"));
+  Ptr<Node> nsNode = CreateObject<Node> ();
+  networkServerHelper.Install (nsNode);
+  ForwarderHelper ().Install (gateways);
+
+  NS_TEST_EXPECT_MSG_EQ (nsNode->GetNDevices (), 0u, "A PointToPoint link was created");
+
+  GetMacLayerFromNode<EndDeviceLorawanMac> (endDevices.Get (0))->TraceConnectWithoutContext
+    ("RequiredTransmissions", MakeCallback (&DirectBackhaulTest::ReceivedPacketAtEndDevice, this));
+
+  Simulator::Schedule (Seconds (1), &DirectBackhaulTest::SendPacket, this,
+                       endDevices.Get (0));
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_receivedPacketAtEd, true, "The reply was not received");
+}
+
+////////////////////////
+// BackhaulBundleTest //
+////////////////////////
+
+class BackhaulBundleTest : public TestCase
+{
+public:
+  BackhaulBundleTest ();
+  virtual ~BackhaulBundleTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+BackhaulBundleTest::BackhaulBundleTest ()
+  : TestCase ("Verify that the BackhaulBundleHeader carries the size and "
+              "reception information of each bundled uplink")
+{
+}
+
+// Reminder that the test case should clean up after itself
+BackhaulBundleTest::~BackhaulBundleTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+BackhaulBundleTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("BackhaulBundleTest");
+
+  BackhaulBundleHeader header;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      LoraTag tag (7 + i);
+      tag.SetReceivePower (-100.125 - i);
+      tag.SetFrequency (868.1 + 0.2 * i);
+      tag.SetDataRate (5 - i);
+      header.AddFrame (10 + i, tag);
+    }
+
+  Ptr<Packet> bundle = Create<Packet> (10 + 11 + 12);
+  bundle->AddHeader (header);
+  NS_TEST_EXPECT_MSG_EQ (bundle->GetSize (), header.GetSerializedSize () + 33,
+                         "Unexpected bundle size");
+
+  BackhaulBundleHeader received;
+  bundle->RemoveHeader (received);
+  NS_TEST_ASSERT_MSG_EQ (received.GetNFrames (), 3u, "Unexpected number of frames");
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      LoraTag tag = received.GetFrameTag (i);
+      NS_TEST_EXPECT_MSG_EQ (received.GetFrameSize (i), 10 + i, "Unexpected frame size");
+      NS_TEST_EXPECT_MSG_EQ (unsigned (tag.GetSpreadingFactor ()), 7 + i, "Unexpected SF");
+      NS_TEST_EXPECT_MSG_EQ (tag.GetReceivePower (), -100.125 - i, "Unexpected power");
+      NS_TEST_EXPECT_MSG_EQ (tag.GetFrequency (), 868.1 + 0.2 * i, "Unexpected frequency");
+      NS_TEST_EXPECT_MSG_EQ (unsigned (tag.GetDataRate ()), 5 - i, "Unexpected data rate");
+    }
+}
+
+/////////////////////////
+// ForwarderBundleTest //
+/////////////////////////
+
+class ForwarderBundleTest : public TestCase
+{
+public:
+  ForwarderBundleTest ();
+  virtual ~ForwarderBundleTest ();
+
+private:
+  virtual void DoRun (void);
+  void ReceiveFromLora (Ptr<Forwarder> forwarder, LoraDeviceAddress address,
+                        uint16_t fCnt, double rxPower);
+  bool ReceiveBackhaul (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                        uint16_t protocol, const Address &address);
+  void ReceivedPacket (Ptr<Packet const> packet);
+
+  Ptr<NetworkServer> m_networkServer;
+  std::vector<std::pair<Time, uint32_t> > m_bundles;  //!< Arrival and number
+                                                      //!< of frames
+  std::vector<LoraTag> m_receivedTags;
+};
+
+// Add some help text to this case to describe what it is intended to test
+ForwarderBundleTest::ForwarderBundleTest ()
+  : TestCase ("Verify that the Forwarder bundles uplinks when a bundle is "
+              "full, when its delay expires and when it stops, and that the "
+              "NetworkServer receives each of them with its reception "
+              "information")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ForwarderBundleTest::~ForwarderBundleTest ()
+{
+}
+
+void
+ForwarderBundleTest::ReceiveFromLora (Ptr<Forwarder> forwarder, LoraDeviceAddress address,
+                                      uint16_t fCnt, double rxPower)
+{
+  Ptr<Packet> packet = Create<Packet> (10);
+
+  LoraFrameHeader frameHdr;
+  frameHdr.SetAsUplink ();
+  frameHdr.SetAddress (address);
+  frameHdr.SetFCnt (fCnt);
+  packet->AddHeader (frameHdr);
+
+  LorawanMacHeader macHdr;
+  macHdr.SetMType (LorawanMacHeader::UNCONFIRMED_DATA_UP);
+  packet->AddHeader (macHdr);
+
+  LoraTag tag (7);
+  tag.SetReceivePower (rxPower);
+  tag.SetFrequency (868.1);
+  tag.SetDataRate (5);
+  packet->AddPacketTag (tag);
+
+  forwarder->ReceiveFromLora (0, packet, 0, Address ());
+}
+
+bool
+ForwarderBundleTest::ReceiveBackhaul (Ptr<NetDevice> device, Ptr<const Packet> packet,
+                                      uint16_t protocol, const Address &address)
+{
+  BackhaulBundleTag bundleTag;
+  uint32_t nFrames = 1;
+  if (packet->PeekPacketTag (bundleTag))
+    {
+      BackhaulBundleHeader bundleHeader;
+      packet->PeekHeader (bundleHeader);
+      nFrames = bundleHeader.GetNFrames ();
+    }
+  m_bundles.push_back (std::make_pair (Simulator::Now (), nFrames));
+
+  return m_networkServer->Receive (device, packet, protocol, address);
+}
+
+void
+ForwarderBundleTest::ReceivedPacket (Ptr<Packet const> packet)
+{
+  LoraTag tag;
+  packet->PeekPacketTag (tag);
+  m_receivedTags.push_back (tag);
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+ForwarderBundleTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("ForwarderBundleTest");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  NodeContainer endDevices = CreateEndDevices (3, mobility, channel);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+
+  NetworkServerHelper networkServerHelper;
+  networkServerHelper.SetEndDevices (endDevices);
+  networkServerHelper.SetGateways (gateways);
+  networkServerHelper.EnableDirectBackhaul (true);
+  networkServerHelper.SetDirectBackhaulAttribute
+    ("Latency", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
+  Ptr<Node> nsNode = CreateObject<Node> ();
+  networkServerHelper.Install (nsNode);
+
+  ForwarderHelper forwarderHelper;
+  forwarderHelper.SetAttribute ("MaxBundleFrames", UintegerValue (2));
+  forwarderHelper.SetAttribute ("MaxBundleDelay", TimeValue (MilliSeconds (5)));
+  forwarderHelper.Install (gateways);
+
+  m_networkServer = nsNode->GetApplication (0)->GetObject<NetworkServer> ();
+  m_networkServer->TraceConnectWithoutContext
+    ("ReceivedPacket", MakeCallback (&ForwarderBundleTest::ReceivedPacket, this));
+
+  // Count the backhaul packets on their way to the server
+  gateways.Get (0)->GetObject<DirectBackhaul> ()->SetNetworkServerCallback
+    (MakeCallback (&ForwarderBundleTest::ReceiveBackhaul, this));
+
+  Ptr<Forwarder> forwarder = gateways.Get (0)->GetApplication (0)->GetObject<Forwarder> ();
+  forwarder->SetStopTime (MilliSeconds (3002));
+
+  LoraDeviceAddress addresses[3];
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      addresses[i] = GetMacLayerFromNode<EndDeviceLorawanMac> (endDevices.Get (i))
+        ->GetDeviceAddress ();
+    }
+
+  // Two uplinks fill a bundle, a lone one waits for the delay, and another
+  // one is sent when the forwarder stops
+  Simulator::Schedule (Seconds (1), &ForwarderBundleTest::ReceiveFromLora, this,
+                       forwarder, addresses[0], 0, -100);
+  Simulator::Schedule (MilliSeconds (1001), &ForwarderBundleTest::ReceiveFromLora, this,
+                       forwarder, addresses[1], 0, -101);
+  Simulator::Schedule (Seconds (2), &ForwarderBundleTest::ReceiveFromLora, this,
+                       forwarder, addresses[2], 0, -102);
+  Simulator::Schedule (Seconds (3), &ForwarderBundleTest::ReceiveFromLora, this,
+                       forwarder, addresses[0], 1, -103);
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_bundles.size (), 3u, "Unexpected number of backhaul packets");
+  NS_TEST_EXPECT_MSG_EQ (m_bundles[0].first, MilliSeconds (1001), "The full bundle was held back");
+  NS_TEST_EXPECT_MSG_EQ (m_bundles[0].second, 2u, "Unexpected size of the full bundle");
+  NS_TEST_EXPECT_MSG_EQ (m_bundles[1].first, MilliSeconds (2005), "The delay was not respected");
+  NS_TEST_EXPECT_MSG_EQ (m_bundles[1].second, 1u, "Unexpected size of the delayed bundle");
+  NS_TEST_EXPECT_MSG_EQ (m_bundles[2].first, MilliSeconds (3002),
+                         "The bundle was not sent when the forwarder stopped");
+  NS_TEST_EXPECT_MSG_EQ (m_bundles[2].second, 1u, "Unexpected size of the last bundle");
+
+  // Each uplink reached the server on its own, with its own tag
+  NS_TEST_ASSERT_MSG_EQ (m_receivedTags.size (), 4u, "Unexpected number of receptions");
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (m_receivedTags[i].GetReceivePower (), -100.0 - i,
+                             "Unexpected receive power of uplink " << i);
+      NS_TEST_EXPECT_MSG_EQ (m_receivedTags[i].GetFrequency (), 868.1,
+                             "Unexpected frequency of uplink " << i);
+      NS_TEST_EXPECT_MSG_EQ (unsigned (m_receivedTags[i].GetDataRate ()), 5u,
+                             "Unexpected data rate of uplink " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (m_networkServer->GetNetworkStatus ()->GetEndDeviceStatus
+                           (addresses[0])->GetReceivedPacketList ().GetSize (), 2u,
+                         "The uplinks of the first device were not both received");
+
+  m_networkServer = 0;
+  Simulator::Destroy ();
+}
+
+////////////////////
+// SemtechUdpTest //
+////////////////////
+
+class SemtechUdpTest : public TestCase
+{
+public:
+  SemtechUdpTest ();
+  virtual ~SemtechUdpTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+SemtechUdpTest::SemtechUdpTest ()
+  : TestCase ("Verify that SemtechUdpIngest reads back the rxpk objects of a "
+              "PUSH_DATA datagram, skipping the incomplete ones")
+{
+}
+
+// Reminder that the test case should clean up after itself
+SemtechUdpTest::~SemtechUdpTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+SemtechUdpTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("SemtechUdpTest");
+
+  SemtechUdpIngest::Rxpk rxpk;
+  rxpk.tmst = 4000000000u;
+  rxpk.freq = 868.3;
+  rxpk.sf = 9;
+  rxpk.rssi = -117.5;
+  for (uint8_t i = 0; i < 13; i++)
+    {
+      rxpk.data.push_back (i * 23);
+    }
+
+  std::string json = "{\"rxpk\":[" + SemtechUdpIngest::FormatRxpk (rxpk)
+    + ",{\"tmst\":1,\"datr\":\"SF7BW125\"}]"
+    + ",\"stat\":{\"time\":\"2014-01-12 08:59:28 GMT\",\"rxnb\":2}}";
+
+  std::vector<SemtechUdpIngest::Rxpk> rxpks;
+  NS_TEST_ASSERT_MSG_EQ (SemtechUdpIngest::ParseRxpks (json, rxpks), 1u,
+                         "Unexpected number of rxpk objects");
+  NS_TEST_EXPECT_MSG_EQ (rxpks[0].tmst, rxpk.tmst, "Unexpected timestamp");
+  NS_TEST_EXPECT_MSG_EQ (rxpks[0].freq, rxpk.freq, "Unexpected frequency");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (rxpks[0].sf), 9u, "Unexpected SF");
+  NS_TEST_EXPECT_MSG_EQ (rxpks[0].rssi, rxpk.rssi, "Unexpected RSSI");
+  NS_TEST_EXPECT_MSG_EQ ((rxpks[0].data == rxpk.data), true, "Payload was not decoded");
+}
+
+/////////////////////////////
+// UplinkTraceReplayerTest //
+/////////////////////////////
+
+class UplinkTraceReplayerTest : public TestCase
+{
+public:
+  UplinkTraceReplayerTest ();
+  virtual ~UplinkTraceReplayerTest ();
+
+private:
+  virtual void DoRun (void);
+  void CheckGatewayIdle (Ptr<GatewayStatus> gwStatus, bool idle);
+};
+
+// Add some help text to this case to describe what it is intended to test
+UplinkTraceReplayerTest::UplinkTraceReplayerTest ()
+  : TestCase ("Verify that the UplinkTraceReplayer reads CSV traces and "
+              "replays them to the NetworkServer, standing in for the "
+              "gateways' transmissions")
+{
+}
+
+// Reminder that the test case should clean up after itself
+UplinkTraceReplayerTest::~UplinkTraceReplayerTest ()
+{
+}
+
+void
+UplinkTraceReplayerTest::CheckGatewayIdle (Ptr<GatewayStatus> gwStatus, bool idle)
+{
+  NS_TEST_EXPECT_MSG_EQ (gwStatus->IsIdle (), idle,
+                         "Unexpected gateway state at " << Simulator::Now ().GetSeconds ());
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+UplinkTraceReplayerTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("UplinkTraceReplayerTest");
+
+  // Lines with missing fields or that don't start with a number are skipped
+  std::string filename = CreateTempDirFilename ("trace.csv");
+  std::ofstream file (filename.c_str ());
+  file << "time,devAddr,fCnt,gateway,sf,rxPower,frequency" << std::endl
+       << "1.5,0x01020304,7,2,9,-110.5,868.3" << std::endl
+       << "2,5,8,0" << std::endl
+       << "garbage" << std::endl
+       << ".25,16,9,1,12,-120,868.5" << std::endl;
+  file.close ();
+
+  std::vector<UplinkTraceReplayer::UplinkRecord> records;
+  NS_TEST_ASSERT_MSG_EQ (UplinkTraceReplayer::ReadCsvTrace (filename, records), true,
+                         "The trace was not read");
+  NS_TEST_ASSERT_MSG_EQ (records.size (), 2u, "Unexpected number of records");
+  NS_TEST_EXPECT_MSG_EQ (records[0].time, MilliSeconds (1500), "Unexpected time");
+  NS_TEST_EXPECT_MSG_EQ (records[0].devAddr, 0x01020304u, "Unexpected address");
+  NS_TEST_EXPECT_MSG_EQ (records[0].fCnt, 7, "Unexpected frame counter");
+  NS_TEST_EXPECT_MSG_EQ (records[0].gateway, 2u, "Unexpected gateway");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (records[0].sf), 9u, "Unexpected SF");
+  NS_TEST_EXPECT_MSG_EQ (records[0].rxPower, -110.5, "Unexpected power");
+  NS_TEST_EXPECT_MSG_EQ (records[0].frequency, 868.3, "Unexpected frequency");
+  NS_TEST_EXPECT_MSG_EQ (records[1].time, MilliSeconds (250), "Unexpected time");
+  NS_TEST_EXPECT_MSG_EQ (records[1].devAddr, 16u, "Unexpected address");
+  NS_TEST_EXPECT_MSG_EQ (unsigned (records[1].sf), 12u, "Unexpected SF");
+  NS_TEST_EXPECT_MSG_EQ (UplinkTraceReplayer::ReadCsvTrace (filename + ".missing", records),
+                         false, "A missing trace was read");
+
+  // Replay strong SF12 uplinks of a device at DR0, one per second, so that
+  // ADR asks it to change its data rate after its fourth uplink. An uplink
+  // from an unknown device is skipped.
+  Ptr<LoraChannel> channel = CreateChannel ();
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  NodeContainer endDevices = CreateEndDevices (1, mobility, channel);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+
+  NetworkServerHelper networkServerHelper;
+  networkServerHelper.SetEndDevices (endDevices);
+  networkServerHelper.SetGateways (gateways);
+  networkServerHelper.EnableAdr (true);
+  networkServerHelper.EnableDirectBackhaul (true);
+  networkServerHelper.SetAttribute ("ProfileStages", BooleanValue (true));
+  Ptr<Node> nsNode = CreateObject<Node> ();
+  Ptr<NetworkServer> ns = networkServerHelper.Install (nsNode).Get (0)
+    ->GetObject<NetworkServer> ();
+
+  uint32_t devAddr = GetMacLayerFromNode<EndDeviceLorawanMac> (endDevices.Get (0))
+    ->GetDeviceAddress ().Get ();
+  std::vector<UplinkTraceReplayer::UplinkRecord> trace;
+  for (uint16_t fCnt = 0; fCnt < 4; fCnt++)
+    {
+      UplinkTraceReplayer::UplinkRecord record;
+      record.time = Seconds (1 + fCnt);
+      record.devAddr = devAddr;
+      record.fCnt = fCnt;
+      record.gateway = 0;
+      record.sf = 12;
+      record.rxPower = -60;
+      record.frequency = 868.1;
+      trace.push_back (record);
+
+      // Uplinks of the same time are replayed by the same event
+      if (fCnt == 2)
+        {
+          record.devAddr = devAddr + 1;
+          trace.push_back (record);
+        }
+    }
+
+  Ptr<UplinkTraceReplayer> replayer = CreateObject<UplinkTraceReplayer> ();
+  replayer->SetTrace (trace);
+  replayer->SetNetworkServer (ns);
+  replayer->SetGateways (gateways);
+  nsNode->AddApplication (replayer);
+
+  // The reply goes out in the first window, at 5 s, and keeps the gateway
+  // busy for its time on air at SF12, about 1 s
+  Ptr<GatewayStatus> gwStatus = ns->GetNetworkStatus ()->GetGatewayStatusByIndex (0);
+  Simulator::Schedule (MilliSeconds (4500), &UplinkTraceReplayerTest::CheckGatewayIdle,
+                       this, gwStatus, true);
+  Simulator::Schedule (MilliSeconds (5500), &UplinkTraceReplayerTest::CheckGatewayIdle,
+                       this, gwStatus, false);
+  Simulator::Schedule (Seconds (7), &UplinkTraceReplayerTest::CheckGatewayIdle,
+                       this, gwStatus, true);
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (replayer->GetNUplinks (), 4u, "Unexpected number of uplinks");
+  NS_TEST_EXPECT_MSG_EQ (replayer->GetNDropped (), 1u, "The unknown device was not skipped");
+  NS_TEST_EXPECT_MSG_EQ (replayer->GetNDownlinks (), 1u, "Unexpected number of downlinks");
+  NS_TEST_EXPECT_MSG_EQ (ns->GetNetworkScheduler ()->GetNSentReplies (), 1u,
+                         "The downlink was not counted by the scheduler");
+  NS_TEST_EXPECT_MSG_EQ (ns->GetStageTimes ().nUplinks, 4u,
+                         "Unexpected number of profiled uplinks");
+
+  Simulator::Destroy ();
+}
+
+//////////////////////////////////
+// AnalyticalReceiveWindowsTest //
+//////////////////////////////////
+
+class AnalyticalReceiveWindowsTest : public TestCase
+{
+public:
+  AnalyticalReceiveWindowsTest ();
+  virtual ~AnalyticalReceiveWindowsTest ();
+
+private:
+  virtual void DoRun (void);
+  void RunScenario (bool analytical);
+  void ReceivedPacket (Ptr<Packet const> packet);
+  void SendPacket (Ptr<Node> endDevice);
+  void SamplePhyState (Ptr<EndDeviceLoraPhy> phy);
+
+  uint32_t m_nReceivedPackets;
+  uint32_t m_nStandbySamples;
+  double m_remainingEnergy;
+  double m_totalEnergyConsumption;
+};
+
+// Add some help text to this case to describe what it is intended to test
+AnalyticalReceiveWindowsTest::AnalyticalReceiveWindowsTest ()
+  : TestCase ("Verify that accounting for empty receive windows analytically "
+              "consumes the same energy and delivers the same unconfirmed "
+              "uplinks as opening them")
+{
+}
+
+// Reminder that the test case should clean up after itself
+AnalyticalReceiveWindowsTest::~AnalyticalReceiveWindowsTest ()
+{
+}
+
+void
+AnalyticalReceiveWindowsTest::ReceivedPacket (Ptr<Packet const> packet)
+{
+  m_nReceivedPackets++;
+}
+
+void
+AnalyticalReceiveWindowsTest::SendPacket (Ptr<Node> endDevice)
+{
+  endDevice->GetDevice (0)->Send (Create<Packet> (20), Address (), 0);
+}
+
+void
+AnalyticalReceiveWindowsTest::SamplePhyState (Ptr<EndDeviceLoraPhy> phy)
+{
+  if (phy->GetState () == EndDeviceLoraPhy::STANDBY)
+    {
+      m_nStandbySamples++;
+    }
+  Simulator::Schedule (MilliSeconds (1), &AnalyticalReceiveWindowsTest::SamplePhyState,
+                       this, phy);
+}
+
+void
+AnalyticalReceiveWindowsTest::RunScenario (bool analytical)
+{
+  m_nReceivedPackets = 0;
+  m_nStandbySamples = 0;
+
+  // Place the device and the gateway deterministically, so that both runs
+  // use the same spreading factor
+  Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
+  allocator->Add (Vector (100, 0, 0));
+  allocator->Add (Vector (0, 0, 0));
+  MobilityHelper mobility;
+  mobility.SetPositionAllocator (allocator);
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+
+  Ptr<LoraChannel> channel = CreateChannel ();
+  NodeContainer endDevices = CreateEndDevices (1, mobility, channel);
+  NodeContainer gateways = CreateGateways (1, mobility, channel);
+  LorawanMacHelper ().SetSpreadingFactorsUp (endDevices, gateways, channel);
+  Ptr<Node> nsNode = CreateNetworkServer (endDevices, gateways);
+
+  Ptr<ClassAEndDeviceLorawanMac> mac =
+    GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (0));
+  mac->SetAttribute ("AnalyticalReceiveWindows", BooleanValue (analytical));
+
+  BasicEnergySourceHelper basicSourceHelper;
+  basicSourceHelper.Set ("BasicEnergySourceInitialEnergyJ", DoubleValue (100));
+  LoraRadioEnergyModelHelper radioEnergyHelper;
+  EnergySourceContainer sources = basicSourceHelper.Install (endDevices);
+  DeviceEnergyModelContainer deviceModels = radioEnergyHelper.Install
+      (NetDeviceContainer (endDevices.Get (0)->GetDevice (0)), sources);
+
+  nsNode->GetApplication (0)->TraceConnectWithoutContext
+    ("ReceivedPacket", MakeCallback (&AnalyticalReceiveWindowsTest::ReceivedPacket, this));
+
+  Simulator::Schedule (Seconds (1), &AnalyticalReceiveWindowsTest::SendPacket, this,
+                       endDevices.Get (0));
+  Simulator::Schedule (Seconds (10), &AnalyticalReceiveWindowsTest::SendPacket, this,
+                       endDevices.Get (0));
+  Simulator::Schedule (Seconds (0), &AnalyticalReceiveWindowsTest::SamplePhyState, this,
+                       mac->GetPhy ()->GetObject<EndDeviceLoraPhy> ());
+
+  // Stop once the windows of both uplinks are over in either mode
+  Simulator::Stop (Seconds (20));
+  Simulator::Run ();
+
+  m_remainingEnergy = sources.Get (0)->GetRemainingEnergy ();
+  m_totalEnergyConsumption = deviceModels.Get (0)->GetTotalEnergyConsumption ();
+
+  Simulator::Destroy ();
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+AnalyticalReceiveWindowsTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("AnalyticalReceiveWindowsTest");
+
+  RunScenario (false);
+  uint32_t nReceivedPackets = m_nReceivedPackets;
+  double remainingEnergy = m_remainingEnergy;
+  double totalEnergyConsumption = m_totalEnergyConsumption;
+  NS_TEST_ASSERT_MSG_GT (m_nStandbySamples, 0u, "No receive window was opened");
+
+  RunScenario (true);
+  NS_TEST_ASSERT_MSG_EQ (m_nStandbySamples, 0u, "A receive window was opened");
+
+  NS_TEST_EXPECT_MSG_EQ (nReceivedPackets, 2u, "Uplinks were lost");
+  NS_TEST_EXPECT_MSG_EQ (m_nReceivedPackets, nReceivedPackets,
+                         "Different uplinks were delivered");
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_remainingEnergy, remainingEnergy, 1e-9,
+                             "The energy source was drained differently");
+  NS_TEST_EXPECT_MSG_EQ_TOL (m_totalEnergyConsumption, totalEnergyConsumption, 1e-9,
+                             "Different energy consumption was accounted");
+}
+
 /**************
  * Test Suite *
  **************/
@@ -305,6 +1514,18 @@ NetworkServerTestSuite::NetworkServerTestSuite ()
   AddTestCase (new UplinkPacketTest, TestCase::QUICK);
   AddTestCase (new DownlinkPacketTest, TestCase::QUICK);
   AddTestCase (new LinkCheckTest, TestCase::QUICK);
+  AddTestCase (new GenomeSeedIndexTest, TestCase::QUICK);
+  AddTestCase (new ReceivedPacketHistoryTest, TestCase::QUICK);
+  AddTestCase (new DenseIndexTest, TestCase::QUICK);
+  AddTestCase (new SnrWindowTest, TestCase::QUICK);
+  AddTestCase (new AdrEvaluationTest, TestCase::QUICK);
+  AddTestCase (new DeduplicationTest, TestCase::QUICK);
+  AddTestCase (new DirectBackhaulTest, TestCase::QUICK);
+  AddTestCase (new BackhaulBundleTest, TestCase::QUICK);
+  AddTestCase (new ForwarderBundleTest, TestCase::QUICK);
+  AddTestCase (new SemtechUdpTest, TestCase::QUICK);
+  AddTestCase (new UplinkTraceReplayerTest, TestCase::QUICK);
+  AddTestCase (new AnalyticalReceiveWindowsTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -12,6 +12,9 @@
 #include "ns3/log.h"
 #include "ns3/end-device-status.h"
 #include "ns3/network-status.h"
+#include "ns3/gateway-status.h"
+#include "ns3/lora-tag.h"
+#include "ns3/boolean.h"
 #include "utilities.h"
 
 // An essential include is test.h
@@ -104,6 +107,163 @@ NetworkStatusTest::DoRun (void)
   ns.AddNode (GetMacLayerFromNode<ClassAEndDeviceLorawanMac> (endDevices.Get (0)));
 }
 
+///////////////////////////
+// GatewayStatus testing //
+///////////////////////////
+
+class GatewayStatusTest : public TestCase
+{
+public:
+  GatewayStatusTest ();
+  virtual ~GatewayStatusTest ();
+
+private:
+  virtual void DoRun (void);
+  void Send (Ptr<GatewayLorawanMac> gwMac, double frequency);
+  void Check (Ptr<GatewayStatus> status, bool idle, bool allowedOn869,
+              bool allowedOn868);
+};
+
+// Add some help text to this case to describe what it is intended to test
+GatewayStatusTest::GatewayStatusTest ()
+  : TestCase ("Verify that GatewayStatus tracks the radio and the duty cycle "
+              "of a gateway")
+{
+}
+
+// Reminder that the test case should clean up after itself
+GatewayStatusTest::~GatewayStatusTest ()
+{
+}
+
+void
+GatewayStatusTest::Send (Ptr<GatewayLorawanMac> gwMac, double frequency)
+{
+  Ptr<Packet> packet = Create<Packet> (10);
+  LoraTag tag;
+  tag.SetDataRate (0);
+  tag.SetFrequency (frequency);
+  packet->AddPacketTag (tag);
+  gwMac->Send (packet);
+}
+
+void
+GatewayStatusTest::Check (Ptr<GatewayStatus> status, bool idle,
+                          bool allowedOn869, bool allowedOn868)
+{
+  NS_TEST_EXPECT_MSG_EQ (status->IsIdle (), idle,
+                         "Wrong idle state at " << Simulator::Now ().GetSeconds ());
+  NS_TEST_EXPECT_MSG_EQ (status->IsAllowedByDutyCycle (869.525), allowedOn869,
+                         "Wrong duty cycle state on 869.525 MHz at "
+                         << Simulator::Now ().GetSeconds ());
+  NS_TEST_EXPECT_MSG_EQ (status->IsAllowedByDutyCycle (868.1), allowedOn868,
+                         "Wrong duty cycle state on 868.1 MHz at "
+                         << Simulator::Now ().GetSeconds ());
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+GatewayStatusTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("GatewayStatusTest");
+
+  NetworkComponents components = InitializeNetwork (1, 1);
+
+  Ptr<GatewayLorawanMac> gwMac =
+    GetMacLayerFromNode<GatewayLorawanMac> (components.gateways.Get (0));
+  gwMac->SetAttribute ("EnforceDutyCycle", BooleanValue (true));
+  Ptr<GatewayStatus> status = Create<GatewayStatus> (Address (), Ptr<NetDevice> (), gwMac);
+
+  // A SF12 transmission lasts more than one second, and the 10% duty cycle of
+  // the 869.525 MHz SubBand then keeps it closed for about ten more
+  Simulator::Schedule (Seconds (1), &GatewayStatusTest::Send, this, gwMac, 869.525);
+  Simulator::Schedule (Seconds (1.1), &GatewayStatusTest::Check, this, status,
+                       false, false, true);
+  Simulator::Schedule (Seconds (4), &GatewayStatusTest::Check, this, status,
+                       true, false, true);
+  Simulator::Schedule (Seconds (30), &GatewayStatusTest::Check, this, status,
+                       true, true, true);
+
+  Simulator::Stop (Seconds (40));
+  Simulator::Run ();
+  Simulator::Destroy ();
+}
+
+///////////////////////
+// ReplyPool testing //
+///////////////////////
+
+class ReplyPoolTest : public TestCase
+{
+public:
+  ReplyPoolTest ();
+  virtual ~ReplyPoolTest ();
+
+private:
+  virtual void DoRun (void);
+};
+
+// Add some help text to this case to describe what it is intended to test
+ReplyPoolTest::ReplyPoolTest ()
+  : TestCase ("Verify that devices only hold a reply while one is pending")
+{
+}
+
+// Reminder that the test case should clean up after itself
+ReplyPoolTest::~ReplyPoolTest ()
+{
+}
+
+// This method is the pure virtual method from class TestCase that every
+// TestCase must implement
+void
+ReplyPoolTest::DoRun (void)
+{
+  NS_LOG_DEBUG ("ReplyPoolTest");
+
+  Ptr<EndDeviceStatus::ReplyPool> pool = Create<EndDeviceStatus::ReplyPool> ();
+  Ptr<EndDeviceStatus> first = CreateObject<EndDeviceStatus> ();
+  Ptr<EndDeviceStatus> second = CreateObject<EndDeviceStatus> ();
+  first->SetReplyPool (pool);
+  second->SetReplyPool (pool);
+
+  // Asking whether a reply is needed doesn't take an entry
+  NS_TEST_EXPECT_MSG_EQ (first->NeedsReply (), false, "Unexpected reply");
+  NS_TEST_EXPECT_MSG_EQ (pool->GetNPending (), 0u, "Unexpected entry");
+
+  first->m_endDeviceAddress = LoraDeviceAddress (0x1234);
+  EndDeviceStatus::Reply &reply = first->GetReply ();
+  reply.frameHeader.SetAsDownlink ();
+  reply.frameHeader.SetAck (true);
+  reply.needsReply = true;
+  NS_TEST_EXPECT_MSG_EQ (first->NeedsReply (), true, "Reply not pending");
+  NS_TEST_EXPECT_MSG_EQ (second->NeedsReply (), false, "Unexpected reply");
+  NS_TEST_EXPECT_MSG_EQ (pool->GetNPending (), 1u, "Wrong number of entries");
+
+  // The serialized headers read back as they were set
+  Ptr<Packet> packet = first->GetCompleteReplyPacket ();
+  LorawanMacHeader macHeader;
+  packet->RemoveHeader (macHeader);
+  LoraFrameHeader frameHeader;
+  frameHeader.SetAsDownlink ();
+  packet->RemoveHeader (frameHeader);
+  NS_TEST_EXPECT_MSG_EQ (macHeader.GetMType (), LorawanMacHeader::UNCONFIRMED_DATA_DOWN,
+                         "Wrong message type");
+  NS_TEST_EXPECT_MSG_EQ (frameHeader.GetAck (), true, "Lost the ACK bit");
+  NS_TEST_EXPECT_MSG_EQ (frameHeader.GetAddress (), LoraDeviceAddress (0x1234),
+                         "Wrong address");
+  NS_TEST_EXPECT_MSG_EQ (packet->GetSize (), 0u, "Unexpected payload");
+
+  // Released entries are recycled
+  first->InitializeReply ();
+  NS_TEST_EXPECT_MSG_EQ (first->NeedsReply (), false, "Reply still pending");
+  NS_TEST_EXPECT_MSG_EQ (pool->GetNPending (), 0u, "Entry not released");
+  NS_TEST_EXPECT_MSG_EQ (second->GetReply ().frameHeader.GetAck (), false,
+                         "Recycled entry not blank");
+  NS_TEST_EXPECT_MSG_EQ (pool->GetNPending (), 1u, "Wrong number of entries");
+}
+
 /**************
  * Test Suite *
  **************/
@@ -125,6 +285,8 @@ NetworkStatusTestSuite::NetworkStatusTestSuite ()
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new EndDeviceStatusTest, TestCase::QUICK);
   AddTestCase (new NetworkStatusTest, TestCase::QUICK);
+  AddTestCase (new GatewayStatusTest, TestCase::QUICK);
+  AddTestCase (new ReplyPoolTest, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -23,8 +23,9 @@ CreateEndDevices (int nDevices, MobilityHelper mobility, Ptr<LoraChannel> channe
   LoraPhyHelper phyHelper = LoraPhyHelper ();
   phyHelper.SetChannel (channel);
 
-  // Create the LorawanMacHelper
+  // Create the LorawanMacHelper, giving each device its own address
   LorawanMacHelper macHelper = LorawanMacHelper ();
+  macHelper.SetAddressGenerator (CreateObject<LoraDeviceAddressGenerator> ());
 
   // Create the LoraHelper
   LoraHelper helper = LoraHelper ();